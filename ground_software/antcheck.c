@@ -0,0 +1,464 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's antenna deployment sequence (main_software/antenna.c) against a model of the
+    ISIS antenna controller, behind fake i2cStartMessage() and i2cIsBusy():
+
+      antcheck
+
+    A message started with i2cStartMessage() stays I2CERR_IN_PROGRESS until the bus next runs (between two calls of
+    antennaStep()), so the sequence sees its transfers in progress as it does on the satellite.  The controller burns
+    the stowed antennas one after the other, ANTENNA_BURN_SECONDS each, once it is armed and sent
+    ANTENNA_CMD_DEPLOY_AUTO, and stops when it is disarmed.  Time is kept in Salvo ticks from what antennaStep()
+    returns.  deploysim.c runs the sequence on the real I2C driver and the host model instead, beside the IMU
+    acquisition, for the jitter of the sample period during deployment.
+
+    The checks:
+      - deploy: arm, deploy, status polls backing off from ANTENNA_POLL_MIN_TICKS to ANTENNA_POLL_MAX_TICKS, disarm,
+        ANT_DEPLOYED after one attempt
+      - an antenna that never comes out: each attempt ends ANTENNA_DEPLOY_TIMEOUT ticks after its deploy command, the
+        sequence is started over ANTENNA_MAX_ATTEMPTS times, then disarms and ends in ANT_FAILED
+      - the controller not answering for a while: retried every ANTENNA_FAULT_RETRY_TICKS, then carried on; not
+        answering at all: ANT_FAILED after ANTENNA_MAX_FAULTS
+      - the bus busy with another message: antennaStep() yields and counts no fault
+      - warm restarts (watchdogGetKept()): a finished sequence stays finished, and attempts made are not made again
+
+    It fails (exit code 1) if any check does.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o antcheck antcheck.c host/msp430.c \
+        ../main_software/antenna.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "antenna.h"
+#include "i2c_peripherals.h"
+#include "watchdog.h"
+
+/* CONSTANTS */
+#define LOG_LEN               256
+#define STEP_LIMIT            100000 //Calls of antennaStep() in one run, far more than a sequence takes
+#define RUN_TICKS             (60UL * 60 * OS_TICK_HZ) //An hour
+
+static const unsigned int stowedBit[ANTENNA_COUNT] = {0x8000, 0x0800, 0x0080, 0x0008}; //Antennas 1-4
+
+/* Name: Controller_s
+   Type: struct
+   Parameters:
+    char armed - ANTENNA_CMD_ARM received since the last disarm
+    char burning - deploying, from burnStart on
+    unsigned long burnStart - tick the deploy command came in
+    unsigned char burnSeconds - its argument
+    int slot[] - place of each antenna in the burn, from 1, 0 if out before it started
+    char stuck[] - antennas that never come out
+    unsigned long outAt[] - tick each antenna came out, 0 while stowed
+    int silent - messages left to NACK, -1 for all of them
+*/
+struct Controller_s {
+  char armed;
+  char burning;
+  unsigned long burnStart;
+  unsigned char burnSeconds;
+  int slot[ANTENNA_COUNT];
+  char stuck[ANTENNA_COUNT];
+  unsigned long outAt[ANTENNA_COUNT];
+  int silent;
+};
+typedef struct Controller_s Controller;
+
+/* Name: Command_s
+   Type: struct
+   Parameters:
+    unsigned char command - first byte of a message the controller answered
+    unsigned long tick - when
+*/
+struct Command_s {
+  unsigned char command;
+  unsigned long tick;
+};
+typedef struct Command_s Command;
+
+static Controller controller;
+static Command commandLog[LOG_LEN];
+static int commands;
+static unsigned long now;
+static I2CMessage* onBus; //Started, not finished
+static char otherBusy; //Another task's message holds the bus
+static char messagesStarted;
+static WatchdogKept kept;
+static char warm;
+static int failures;
+
+static void check(int passed, const char* scenario, const char* what) {
+  if (!passed) {
+    printf("FAIL: %s: %s\n", scenario, what);
+    failures++;
+  }
+}
+
+/* The controller */
+
+/* Name: controllerBurn
+   Description:
+    Brings the antennas out that the burn has got to by now.  They go in order, a stuck one taking its time too.
+*/
+static void controllerBurn(void) {
+  unsigned long burnTicks = (unsigned long)controller.burnSeconds * OS_TICK_HZ;
+  int n;
+
+  if (!controller.burning) {
+    return;
+  }
+  for (n = 0; n < ANTENNA_COUNT; n++) {
+    unsigned long at = controller.burnStart + controller.slot[n] * burnTicks;
+
+    if (controller.slot[n] && !controller.outAt[n] && !controller.stuck[n] && at <= now) {
+      controller.outAt[n] = at;
+    }
+  }
+}
+
+static unsigned int controllerStatus(void) {
+  unsigned int status = controller.armed ? ANTENNA_STATUS_ARMED : 0;
+  int n;
+
+  for (n = 0; n < ANTENNA_COUNT; n++) {
+    if (!controller.outAt[n]) {
+      status |= stowedBit[n];
+    }
+  }
+  return status;
+}
+
+/* Name: controllerMessage
+   Return value:
+    int - 1 if answered, 0 if NACKed
+   Description:
+    Carries out the message at the tick it finishes.
+*/
+static int controllerMessage(I2CMessage* message) {
+  unsigned char command = (unsigned char)message->message[0];
+  int slots = 0;
+  int n;
+
+  if (message->address != ANTENNA_I2C_ADDR || controller.silent < 0) {
+    return 0;
+  }
+  if (controller.silent > 0) {
+    controller.silent--;
+    return 0;
+  }
+  controllerBurn();
+  if (commands < LOG_LEN) {
+    commandLog[commands].command = command;
+    commandLog[commands].tick = now;
+    commands++;
+  }
+
+  switch (command) {
+    case ANTENNA_CMD_ARM:
+      controller.armed = 1;
+      break;
+    case ANTENNA_CMD_DISARM:
+      controller.armed = 0;
+      controller.burning = 0;
+      break;
+    case ANTENNA_CMD_DEPLOY_AUTO:
+      if (controller.armed && message->messageLength == 2) {
+        controller.burning = 1;
+        controller.burnStart = now;
+        controller.burnSeconds = (unsigned char)message->message[1];
+        for (n = 0; n < ANTENNA_COUNT; n++) { //Skips the antennas already out
+          controller.slot[n] = controller.outAt[n] ? 0 : ++slots;
+        }
+      }
+      break;
+    case ANTENNA_CMD_GET_STATUS:
+      if (message->txrxMode == RX_MODE && message->respLen == 2) {
+        message->response[0] = (char)(controllerStatus() & 0xFF);
+        message->response[1] = (char)(controllerStatus() >> 8);
+      }
+      break;
+  }
+  return 1;
+}
+
+/* Name: busRun
+   Description:
+    Finishes the message on the bus, if there is one.
+*/
+static void busRun(void) {
+  if (onBus) {
+    onBus->error = controllerMessage(onBus) ? I2CERR_NO_ERROR : I2CERR_NACK_LIMIT_REACHED;
+    onBus = 0;
+  }
+}
+
+/* The firmware's I2C driver (i2c_driver.h) and watchdog (watchdog.h) */
+
+void i2cInit(I2CConfig* configStruct) {
+  configStruct->error = I2CERR_NO_ERROR;
+}
+
+void i2cInitializeConfigRate(I2CConfig* configStruct, char interface, unsigned long busHz) {
+  memset(configStruct, 0, sizeof(*configStruct));
+  configStruct->i2cInterface = interface;
+  configStruct->isInitialized = 1;
+}
+
+void i2cInitializeMessage(I2CMessage* messageStruct, char* message, int length, char address, char txrxMode,
+                          int respLen, char* response, char i2cInterface) {
+  messageStruct->i2cInterface = i2cInterface;
+  messageStruct->messageLength = length;
+  messageStruct->message = message;
+  messageStruct->address = address;
+  messageStruct->txrxMode = txrxMode;
+  messageStruct->respLen = respLen;
+  messageStruct->response = response;
+  messageStruct->busHz = 0;
+  messageStruct->error = I2CERR_NO_ERROR;
+  messageStruct->isInitialized = 1;
+}
+
+void i2cSetMessageRate(I2CMessage* messageStruct, unsigned long busHz) {
+  messageStruct->busHz = busHz;
+}
+
+char i2cIsBusy(char i2cInterface) {
+  return onBus != 0 || otherBusy;
+}
+
+void i2cStartMessage(I2CMessage* messageStruct) {
+  if (i2cIsBusy(messageStruct->i2cInterface)) {
+    messageStruct->error = I2CERR_BUS_BUSY;
+    return;
+  }
+  messagesStarted++;
+  messageStruct->error = I2CERR_IN_PROGRESS;
+  onBus = messageStruct;
+}
+
+const WatchdogKept* watchdogGetKept(void) {
+  return warm ? &kept : 0;
+}
+
+/* The runs */
+
+/* Name: start
+   Description:
+    A new controller with all antennas stowed, stuck ones as given (bit n for antenna n + 1), and antennaInit().
+*/
+static void start(int stuck, int silent) {
+  int n;
+
+  memset(&controller, 0, sizeof(controller));
+  for (n = 0; n < ANTENNA_COUNT; n++) {
+    controller.stuck[n] = (stuck >> n) & 1;
+  }
+  controller.silent = silent;
+  commands = 0;
+  now = 1;
+  onBus = 0;
+  otherBusy = 0;
+  antennaInit();
+}
+
+/* Name: run
+   Return value:
+    int - calls of antennaStep() made
+   Description:
+    Steps the sequence until it is done (ANT_DEPLOYED or ANT_FAILED) or maxTicks have gone by, checking that it yields
+    while a transfer is in progress.
+*/
+static int run(const char* scenario, unsigned long maxTicks) {
+  unsigned long end = now + maxTicks;
+  int calls = 0;
+
+  while (now < end && calls < STEP_LIMIT) {
+    const AntennaHealth* health = antennaGetHealth();
+    unsigned char wait;
+
+    if (health->state == ANT_DEPLOYED || health->state == ANT_FAILED) {
+      break;
+    }
+    wait = antennaStep();
+    calls++;
+    check(!onBus || wait == 0, scenario, "delayed with a transfer in progress");
+    busRun();
+    now += wait;
+  }
+  check(calls < STEP_LIMIT, scenario, "sequence never ends");
+  return calls;
+}
+
+static int countCommand(unsigned char command) {
+  int count = 0;
+  int n;
+
+  for (n = 0; n < commands; n++) {
+    count += commandLog[n].command == command;
+  }
+  return count;
+}
+
+static void checkDeploy(void) {
+  const char* scenario = "deploy";
+  const AntennaHealth* health = antennaGetHealth();
+  unsigned long expected = ANTENNA_POLL_MIN_TICKS;
+  unsigned long previous;
+  int polls = 0;
+  int n;
+
+  start(0, 0);
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_DEPLOYED, scenario, "not ANT_DEPLOYED");
+  check(health->attempts == 1 && health->faults == 0, scenario, "more than one attempt, or faults");
+  check(!(health->status & ANTENNA_STATUS_NOT_DEPLOYED_MASK), scenario, "status still shows antennas stowed");
+  check(commands >= 4 && commandLog[0].command == ANTENNA_CMD_ARM && commandLog[1].command == ANTENNA_CMD_DEPLOY_AUTO &&
+        commandLog[commands - 1].command == ANTENNA_CMD_DISARM, scenario, "not arm, deploy, ..., disarm");
+  check(!controller.armed, scenario, "controller left armed");
+
+  //Polls back off, doubling up to the cap
+  previous = commandLog[1].tick;
+  for (n = 2; n < commands && commandLog[n].command == ANTENNA_CMD_GET_STATUS; n++) {
+    char what[80];
+
+    sprintf(what, "poll %d after %lu ticks, not %lu", polls + 1, commandLog[n].tick - previous, expected);
+    check(commandLog[n].tick - previous == expected, scenario, what);
+    previous = commandLog[n].tick;
+    expected = (expected < ANTENNA_POLL_MAX_TICKS / 2) ? 2 * expected : ANTENNA_POLL_MAX_TICKS;
+    polls++;
+  }
+  check(n == commands - 1, scenario, "something other than status polls between deploy and disarm");
+  check(previous - controller.outAt[ANTENNA_COUNT - 1] <= ANTENNA_POLL_MAX_TICKS, scenario,
+        "last antenna out for more than one poll before the sequence saw it");
+  printf("%s: %d polls, deployed %.2f s after the deploy command\n", scenario, polls,
+         (double)(previous - commandLog[1].tick) / OS_TICK_HZ);
+}
+
+static void checkStuck(void) {
+  const char* scenario = "stuck antenna";
+  const AntennaHealth* health = antennaGetHealth();
+  int deploys = 0;
+  int n;
+
+  start(1 << 2, 0); //Antenna 3
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_FAILED, scenario, "not ANT_FAILED");
+  check(health->attempts == ANTENNA_MAX_ATTEMPTS, scenario, "not ANTENNA_MAX_ATTEMPTS attempts");
+  check(countCommand(ANTENNA_CMD_DEPLOY_AUTO) == ANTENNA_MAX_ATTEMPTS, scenario, "deploy commands not one per attempt");
+  check(countCommand(ANTENNA_CMD_ARM) == ANTENNA_MAX_ATTEMPTS, scenario, "not armed again for each attempt");
+  check((health->status & ANTENNA_STATUS_NOT_DEPLOYED_MASK) == stowedBit[2], scenario,
+        "status not antenna 3 alone stowed");
+  check(commandLog[commands - 1].command == ANTENNA_CMD_DISARM && !controller.armed, scenario, "not disarmed");
+
+  //Each attempt gives up at the timeout, to within one poll
+  for (n = 0; n < commands; n++) {
+    if (commandLog[n].command == ANTENNA_CMD_DEPLOY_AUTO) {
+      unsigned long deployTick = commandLog[n].tick;
+      unsigned long lastPoll = deployTick;
+      int m;
+
+      for (m = n + 1; m < commands && commandLog[m].command == ANTENNA_CMD_GET_STATUS; m++) {
+        lastPoll = commandLog[m].tick;
+      }
+      check(lastPoll - deployTick >= ANTENNA_DEPLOY_TIMEOUT &&
+            lastPoll - deployTick < ANTENNA_DEPLOY_TIMEOUT + ANTENNA_POLL_MAX_TICKS, scenario,
+            "attempt not ended at ANTENNA_DEPLOY_TIMEOUT");
+      deploys++;
+    }
+  }
+  printf("%s: %d attempts, ANT_FAILED after %.1f s\n", scenario, deploys, (double)(now - 1) / OS_TICK_HZ);
+}
+
+static void checkFaults(void) {
+  const char* scenario = "controller not answering";
+  const AntennaHealth* health = antennaGetHealth();
+  int calls;
+
+  //Three NACKs on the arm command, then answers
+  start(0, 3);
+  run(scenario, 3 * ANTENNA_FAULT_RETRY_TICKS);
+  check(health->faults == 3 && health->lastError == I2CERR_NACK_LIMIT_REACHED, scenario,
+        "three NACKs not counted as three faults");
+  check(health->state == ANT_ARMING && commands == 0, scenario, "went on without an answer");
+  check(now - 1 == 3 * ANTENNA_FAULT_RETRY_TICKS, scenario, "not retried every ANTENNA_FAULT_RETRY_TICKS");
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_DEPLOYED && health->faults == 0, scenario, "not deployed once answering");
+
+  //Never answers
+  start(0, -1);
+  messagesStarted = 0;
+  calls = run(scenario, RUN_TICKS);
+  check(health->state == ANT_FAILED && health->faults == ANTENNA_MAX_FAULTS, scenario,
+        "not ANT_FAILED after ANTENNA_MAX_FAULTS");
+  check(messagesStarted == ANTENNA_MAX_FAULTS && calls == 2 * ANTENNA_MAX_FAULTS, scenario, "not one try per fault");
+  check(antennaStep() == ANTENNA_IDLE_TICKS && !onBus, scenario, "ANT_FAILED still sending");
+  printf("%s: ANT_FAILED after %d faults, %.1f s\n", scenario, health->faults, (double)(now - 1) / OS_TICK_HZ);
+}
+
+static void checkBusBusy(void) {
+  const char* scenario = "bus busy";
+  const AntennaHealth* health = antennaGetHealth();
+  int n;
+
+  start(0, 0);
+  otherBusy = 1;
+  messagesStarted = 0;
+  for (n = 0; n < 5; n++) {
+    check(antennaStep() == 0, scenario, "did not yield");
+  }
+  check(messagesStarted == 0 && health->faults == 0 && health->state == ANT_ARMING, scenario,
+        "refused message counted as a fault or sent");
+  otherBusy = 0;
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_DEPLOYED && health->attempts == 1, scenario, "not deployed once the bus was free");
+}
+
+static void checkWarm(void) {
+  const char* scenario = "warm restart";
+  const AntennaHealth* health = antennaGetHealth();
+
+  warm = 1;
+
+  //Done before the reset: nothing sent
+  memset(&kept, 0, sizeof(kept));
+  kept.antennaState = ANT_DEPLOYED;
+  kept.antennaAttempts = 1;
+  start(0, 0);
+  messagesStarted = 0;
+  check(antennaStep() == ANTENNA_IDLE_TICKS && messagesStarted == 0 && health->state == ANT_DEPLOYED, scenario,
+        "finished sequence started again");
+
+  //Reset while polling on the last attempt: disarm and stop
+  kept.antennaState = ANT_POLLING;
+  kept.antennaAttempts = ANTENNA_MAX_ATTEMPTS;
+  kept.antennaStatus = ANTENNA_STATUS_NOT_DEPLOYED_MASK;
+  start(0, 0);
+  check(health->state == ANT_DISARMING, scenario, "out of attempts, but not disarming");
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_FAILED && countCommand(ANTENNA_CMD_DEPLOY_AUTO) == 0, scenario,
+        "burned again after the last attempt");
+
+  //Reset during the first attempt: two more
+  kept.antennaState = ANT_POLLING;
+  kept.antennaAttempts = 1;
+  start(1 << 0, 0);
+  run(scenario, RUN_TICKS);
+  check(health->state == ANT_FAILED && countCommand(ANTENNA_CMD_DEPLOY_AUTO) == ANTENNA_MAX_ATTEMPTS - 1, scenario,
+        "attempts before the reset not counted");
+
+  warm = 0;
+}
+
+int main(void) {
+  checkDeploy();
+  checkStuck();
+  checkFaults();
+  checkBusBusy();
+  checkWarm();
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
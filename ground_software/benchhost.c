@@ -0,0 +1,698 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that times the firmware's hot paths on the host, the wall clock counterpart of the cycle-count build in
+    main_software/benchmark.c: the same paths, called the same way, with the firmware modules built by gcc:
+
+      benchhost [-o <file>] [-b <file>]
+
+    Each path gets HOST_CALLS calls in HOST_BATCHES batches, timed with CLOCK_MONOTONIC, and the fastest batch's
+    average is reported, which keeps most of the scheduler noise out.  Batches are timed as a whole, except where the
+    cycle build leaves set-up between calls out of the measurement: there every call is timed on its own, less the
+    cost of an empty measurement (as cyclesSince() does).  i2cSendMessage() runs against the USCI model of
+    host/msp430.c with a slave that ACKs everything, so its time is mostly the model's.  The Timer A routine's work
+    (clockTimerService()) is called directly, with an empty OSTimer(); the interrupt entry and exit are the cycle
+    build's cost model only.
+
+    -o writes the results to a file, one "<ns> <name>" line per path, as the baselines for this machine.  -b reads a
+    file written by -o and compares: a path more than HOST_TOLERANCE_PERCENT (and HOST_SLACK_NS) slower than its
+    baseline, or with no baseline in the file, counts as a regression.  A path that looks slower is run again, up to
+    HOST_RETRIES times in all, and its best run kept.  Wall time on a shared host is noisy, so this only catches gross
+    slowdowns; the cycle build, at BENCH_TOLERANCE_PERCENT, is the fine check.  The exit code is the number of
+    regressions.
+
+    benchhost.baseline holds the baselines of the development machine, the slowest of three -o runs, so the check runs
+    from the tree:
+
+      benchhost -b benchhost.baseline
+
+    Record it again with -o on a machine much slower or faster than that, and when a path gets faster on purpose.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o benchhost benchhost.c host/msp430.c \
+        ../main_software/i2c_driver.c ../main_software/data.c ../main_software/calib.c ../main_software/decim.c \
+        ../main_software/snapshot.c ../main_software/telemetry.c ../main_software/command.c ../main_software/fec.c \
+        ../main_software/log_format.c ../main_software/recorder.c ../main_software/clock.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msp430.h"
+#include "data.h"
+#include "i2c_driver.h"
+#include "i2c_peripherals.h"
+#include "log_format.h"
+#include "recorder.h"
+#include "arena.h"
+#include "calib.h"
+#include "decim.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "command.h"
+#include "radio.h"
+#include "fec.h"
+#include "flash.h"
+#include "watchdog.h"
+#include "boot.h"
+#include "clock.h"
+
+/* CONSTANTS */
+#define HOST_CALLS            5000 //Per batch
+#define HOST_BATCHES          40
+#define HOST_WARMUP_NS        200000000LL
+#define HOST_RETRIES          5 //Runs of a path that looks slower than its baseline before it counts
+#define HOST_PATHS            14
+#define HOST_NAME_LEN         32 //In a baseline file
+#define STEP_LIMIT            0 //No limit on the USCI model
+#define HOST_TOLERANCE_PERCENT 50 //Wall time on a shared machine moves by a third from run to run
+#define HOST_SLACK_NS         10 //Allowed on top, the jitter of a measurement of a few ns
+
+/* Name: HostResult_s
+   Type: struct
+   Parameters:
+    const char* name - what was measured, as in the cycle build
+    double ns - average of the fastest batch, per call
+    double baseline - from -b, 0 if none
+*/
+struct HostResult_s {
+  const char* name;
+  double ns;
+  double baseline;
+};
+typedef struct HostResult_s HostResult;
+
+/* Name: HostPath_s
+   Type: struct
+   Parameters:
+    const char* name - as in the cycle build
+    void (*run)(void) - times HOST_BATCHES batches of calls, the fastest left in fastestNs
+*/
+struct HostPath_s {
+  const char* name;
+  void (*run)(void);
+};
+typedef struct HostPath_s HostPath;
+
+static HostResult results[HOST_PATHS];
+static long long emptyNs; //Cost of an empty measurement
+static unsigned long long batchNs; //Sum over the batch being run
+static double fastestNs; //Per call, over the batches run so far
+static unsigned char crcBlock[LOG_BLOCK_SIZE];
+
+/* The rest of the firmware the paths link against */
+
+void OSTimer(void) {
+}
+
+void radioSetSourceClock(unsigned long smclkHz) {
+}
+
+void radioServiceTx(void) {
+}
+
+void radioServiceRx(void) {
+}
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  return 1;
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  return 1;
+}
+
+unsigned char hostI2cRead(int usci) {
+  return 0x5A;
+}
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return calloc(1, size);
+}
+
+const WatchdogKept* watchdogGetKept(void) {
+  return 0;
+}
+
+unsigned char bootWait(BootDevice device) {
+  return 0;
+}
+
+void bootMark(BootEvent event) {
+}
+
+char flashEraseSegment(unsigned int address) {
+  return 1;
+}
+
+void flashRead(unsigned int address, unsigned char* data, unsigned int length) {
+  memset(data, 0xFF, length);
+}
+
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length) {
+  return 1;
+}
+
+char sdAcquireBus(SDCard* card) {
+  card->hasBus = 1;
+  return 1;
+}
+
+void sdReleaseBus(SDCard* card) {
+  card->hasBus = 0;
+}
+
+void sdInitStart(SDCard* card) {
+  card->isInitialized = IS_INITIALIZED;
+  card->isHighCapacity = 1;
+  card->error = SDERR_NO_ERROR;
+}
+
+char sdInitPoll(SDCard* card) {
+  return 1;
+}
+
+char sdIsReady(SDCard* card) {
+  return 1;
+}
+
+void sdReadRange(SDCard* card, unsigned long block, unsigned int start, unsigned char* buffer, unsigned int length) {
+  memset(buffer, 0, length); //A blank card
+  card->error = SDERR_NO_ERROR;
+}
+
+void sdReadBlock(SDCard* card, unsigned long block, unsigned char* buffer) {
+  sdReadRange(card, block, 0, buffer, SD_BLOCK_SIZE);
+}
+
+void sdWriteBlocks(SDCard* card, unsigned long block, unsigned char* const* buffers, int count) {
+  card->error = SDERR_NO_ERROR;
+}
+
+static unsigned char handlerOk(const CommandArgs* args) {
+  return COMMAND_OK;
+}
+
+unsigned char commandSetRate(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+unsigned char commandSetMode(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+unsigned char commandDumpHealth(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+unsigned char commandDownload(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+unsigned char commandBulkAck(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+unsigned char commandSetConfig(const CommandArgs* args) {
+  return handlerOk(args);
+}
+
+/* Timing */
+
+static long long hostNow(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/* Name: hostRecord
+   Description:
+    Adds one call to the batch, less the empty measurement.  Ends the batch after HOST_CALLS calls.
+*/
+static void hostRecord(long long start, unsigned long call) {
+  long long ns = hostNow() - start - emptyNs;
+
+  batchNs += ns > 0 ? ns : 0;
+  if ((call + 1) % HOST_CALLS == 0) {
+    if (batchNs < fastestNs * HOST_CALLS) {
+      fastestNs = (double)batchNs / HOST_CALLS;
+    }
+    batchNs = 0;
+  }
+}
+
+/* Name: hostBatch
+   Description:
+    Ends a batch of HOST_CALLS calls timed as a whole, for paths with nothing to set up between calls.
+*/
+static void hostBatch(long long start) {
+  double ns = (double)(hostNow() - start - emptyNs) / HOST_CALLS;
+
+  if (ns < fastestNs) {
+    fastestNs = ns;
+  }
+}
+
+static void hostBegin(void) {
+  batchNs = 0;
+  fastestNs = 1e30;
+}
+
+/* Name: hostRegressed
+   Return value:
+    int - 1 if the result is more than HOST_TOLERANCE_PERCENT and HOST_SLACK_NS over its baseline, or has none
+*/
+static int hostRegressed(const HostResult* result) {
+  return !result->baseline ||
+         result->ns * 100 > result->baseline * (100 + HOST_TOLERANCE_PERCENT) + HOST_SLACK_NS * 100;
+}
+
+static void hostReport(const HostResult* result, int comparing) {
+  if (comparing) {
+    printf("%-18s %10.1f %10.1f  %s\n", result->name, result->ns, result->baseline,
+           result->baseline ? (hostRegressed(result) ? "REGRESSED" : "ok") : "NO BASELINE");
+  } else {
+    printf("%-18s %10.1f\n", result->name, result->ns);
+  }
+}
+
+/* Name: hostCalibrate
+   Description:
+    Keeps the CPU busy for HOST_WARMUP_NS, so the first path is not timed while the clock speeds up, then takes the
+    cost of an empty measurement, the least of many.
+*/
+static void hostCalibrate(void) {
+  long long start = hostNow();
+  long long ns;
+  int n;
+
+  while (hostNow() - start < HOST_WARMUP_NS);
+  emptyNs = 1LL << 62;
+  for (n = 0; n < HOST_CALLS; n++) {
+    start = hostNow();
+    ns = hostNow() - start;
+    if (ns < emptyNs) {
+      emptyNs = ns;
+    }
+  }
+}
+
+/* The paths, as in benchmark.c */
+
+static void pathI2CInit(void) {
+  I2CConfig cfg;
+  unsigned long n;
+  int batch;
+  long long start;
+
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      i2cInitializeConfigRate(&cfg, SECONDARY, I2C_FAST_HZ);
+      i2cInit(&cfg);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathI2CSend(void) {
+  I2CMessage msg;
+  char message_str[IMU_DATA_MSG_LEN];
+  char response_str[IMU_DATA_RESP_LEN];
+  unsigned long n;
+  int batch;
+  long long start;
+
+  hostBegin();
+  message_str[0] = GYROSCOPE_START;
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      i2cInitializeMessage(&msg, message_str, IMU_DATA_MSG_LEN, IMU_I2C_ADDR, RX_MODE, IMU_DATA_RESP_LEN, response_str,
+                           SECONDARY);
+      i2cSetMessageRate(&msg, IMU_I2C_MAX_HZ);
+      i2cSendMessage(&msg);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathStoreSample(void) {
+  int gyro[DATA_AXES] = {1, 2, 3};
+  int accel[DATA_AXES] = {4, 5, 6};
+  int magnet[DATA_AXES] = {7, 8, 9};
+  unsigned long n;
+  int batch;
+  long long start;
+
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      dataStoreSample(gyro, accel, magnet);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathCalib(CalibSensor sensor) {
+  static const int matrix[9] = {16800, -210, 95, -180, 15900, 330, 60, 270, 16420}; //About the identity at shift 1
+  unsigned char image[CALIB_IMAGE_BYTES];
+  char raw[IMU_DATA_RESP_LEN] = {0x12, 0x34, 0xF0, 0x0D, 0x05, 0x5A};
+  int out[DATA_AXES];
+  unsigned long n;
+  int batch;
+  long long start;
+
+  memset(image, 0, sizeof(image));
+  logPut16(image + CALIB_IMG_MAGIC, CALIB_MAGIC);
+  for (n = 0; n < 3; n++) {
+    logPut16(image + CALIB_IMG_GYRO_BIAS + 2 * n, 17 * n - 20);
+    logPut16(image + CALIB_IMG_ACCEL_BIAS + 2 * n, 120 - 50 * n);
+    logPut16(image + CALIB_IMG_MAGNET_BIAS + 2 * n, 35 * n + 8);
+  }
+  for (n = 0; n < 9; n++) {
+    logPut16(image + CALIB_IMG_ACCEL_MATRIX + 2 * n, matrix[n]);
+    logPut16(image + CALIB_IMG_MAGNET_MATRIX + 2 * n, matrix[8 - n]);
+  }
+  image[CALIB_IMG_ACCEL_SHIFT] = 1;
+  image[CALIB_IMG_MAGNET_SHIFT] = 1;
+  logPut16(image + CALIB_IMG_CRC, logCrc16(image, CALIB_IMG_CRC));
+  calibLoad(image);
+
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      calibApply(sensor, raw, out);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathCalibGyro(void) {
+  pathCalib(CALIB_GYRO);
+}
+
+static void pathCalibAccel(void) {
+  pathCalib(CALIB_ACCEL);
+}
+
+static void pathCalibMagnet(void) {
+  pathCalib(CALIB_MAGNET);
+}
+
+static void pathDecim(void) {
+  static Decimator decimator;
+  int in[DECIM_AXES] = {1200, -3400, 560};
+  int out[DECIM_AXES];
+  unsigned long n;
+  int batch;
+  long long start;
+
+  decimInit(&decimator);
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) { //HOST_CALLS is a multiple of DECIM_RATIO: whole outputs
+      in[n % DECIM_AXES] += 97;
+      decimPush(&decimator, in, out);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathSnapshot(void) {
+  int gyro[SNAPSHOT_AXES] = {150, -80, 30};
+  int accel[SNAPSHOT_AXES] = {200, -120, 16384};
+  Snapshot* snapshot;
+  unsigned long n;
+  long long start;
+
+  hostBegin();
+  for (n = 0; n < HOST_CALLS * HOST_BATCHES; n++) {
+    accel[1] = (n & 7) ? -120 : SNAPSHOT_SHOCK_LEVEL;
+    start = hostNow();
+    snapshotSample(gyro, accel, n);
+    hostRecord(start, n);
+    while ((snapshot = snapshotNext())) {
+      snapshotRelease(snapshot);
+    }
+  }
+}
+
+static void pathTelemetry(void) {
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  unsigned long n;
+  int batch;
+  long long start;
+
+  for (n = 0; n < TELEMETRY_PAYLOAD_MAX; n++) {
+    payload[n] = n;
+  }
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    telemetryPut(n, payload, TELEMETRY_PAYLOAD_MAX, 0);
+  }
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      telemetryPut(n % TELEMETRY_CLASSES, payload, TELEMETRY_PAYLOAD_MAX, n);
+      telemetryBeginPass();
+      telemetryDequeue(frame, TELEMETRY_FRAME_MAX, n);
+    }
+    hostBatch(start);
+  }
+}
+
+static void pathCommand(void) {
+  unsigned char ring[RADIO_RX_LEN];
+  unsigned char frame[COMMAND_OVERHEAD + 3];
+  unsigned char reply[TELEMETRY_FRAME_MAX];
+  unsigned char head = RADIO_RX_LEN - 4;
+  unsigned long n;
+  long long start;
+
+  frame[0] = COMMAND_SYNC_0;
+  frame[1] = COMMAND_SYNC_1;
+  frame[2] = 3;
+  frame[3] = COMMAND_SET_MODE;
+  frame[4] = 0;
+  frame[5] = COMMAND_MODE_DOWNLINK;
+  logPut16(frame + 6, 1);
+  logPut16(frame + 8, logCrc16(frame, 8));
+  for (n = 0; n < sizeof(frame); n++) {
+    ring[(head + n) & (RADIO_RX_LEN - 1)] = frame[n];
+  }
+  commandReset();
+  hostBegin();
+  for (n = 0; n < HOST_CALLS * HOST_BATCHES; n++) {
+    start = hostNow();
+    commandParse(ring, RADIO_RX_LEN - 1, head, sizeof(frame), n);
+    hostRecord(start, n);
+    telemetryBeginPass();
+    while (telemetryDequeue(reply, TELEMETRY_FRAME_MAX, n)) {
+    }
+  }
+}
+
+static void pathFec(void) {
+  unsigned char frame[FEC_FRAME_MAX];
+  unsigned long n;
+  long long start;
+  int i;
+
+  hostBegin();
+  for (n = 0; n < HOST_CALLS * HOST_BATCHES; n++) {
+    frame[0] = TELEMETRY_SYNC_0;
+    frame[1] = TELEMETRY_SYNC_1;
+    frame[2] = TELEMETRY_PAYLOAD_MAX;
+    for (i = 3; i < TELEMETRY_FRAME_MAX; i++) {
+      frame[i] = i * 29 + n;
+    }
+    start = hostNow();
+    fecEncode(frame, TELEMETRY_FRAME_MAX);
+    hostRecord(start, n);
+  }
+}
+
+static void pathTimerIsr(void) {
+  unsigned long n;
+  int batch;
+  long long start;
+
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      clockTimerService();
+    }
+    hostBatch(start);
+  }
+}
+
+/* Name: pathRecorderSample
+   Description:
+    Recorder running on a blank card, with recorderStep() between calls (outside the measurement) so full blocks go
+    out and nothing is dropped.
+*/
+static void pathRecorderSample(void) {
+  const RecorderHealth* health = recorderGetHealth();
+  char gyro[LOG_AXIS_BYTES] = {1, 2, 3, 4, 5, 6};
+  char magnet[LOG_AXIS_BYTES] = {7, 8, 9, 10, 11, 12};
+  unsigned long n;
+  long long start;
+
+  recorderInit();
+  for (n = 0; n < 1000 && health->state != REC_RUNNING; n++) {
+    recorderStep();
+  }
+  hostBegin();
+  for (n = 0; n < HOST_CALLS * HOST_BATCHES; n++) {
+    start = hostNow();
+    recorderAddSample(n, gyro, magnet);
+    hostRecord(start, n);
+    recorderStep();
+  }
+  if (health->state != REC_RUNNING || health->droppedSamples) {
+    printf("recorder not running, or dropped samples: timing not representative\n");
+  }
+}
+
+static void pathLogCrc(void) {
+  unsigned long n;
+  int batch;
+  long long start;
+
+  for (n = 0; n < LOG_BLOCK_SIZE; n++) {
+    crcBlock[n] = n;
+  }
+  hostBegin();
+  for (batch = 0; batch < HOST_BATCHES; batch++) {
+    start = hostNow();
+    for (n = 0; n < HOST_CALLS; n++) {
+      logCrc16(crcBlock, LOG_CRC_OFFSET);
+    }
+    hostBatch(start);
+  }
+}
+
+static const HostPath paths[HOST_PATHS] = {{"i2cInit", pathI2CInit},
+                                           {"i2cSendMessage", pathI2CSend},
+                                           {"dataStoreSample", pathStoreSample},
+                                           {"calib gyro", pathCalibGyro},
+                                           {"calib accel", pathCalibAccel},
+                                           {"calib magnet", pathCalibMagnet},
+                                           {"decimPush", pathDecim},
+                                           {"snapshotSample", pathSnapshot},
+                                           {"telemetry put+get", pathTelemetry},
+                                           {"command parse", pathCommand},
+                                           {"fecEncode (frame)", pathFec},
+                                           {"Timer A ISR", pathTimerIsr},
+                                           {"recorderAddSample", pathRecorderSample},
+                                           {"logCrc16 (block)", pathLogCrc}};
+
+/* Baselines */
+
+/* Name: readBaselines
+   Description:
+    Fills in results[].baseline from a file written by -o, in the order the paths run.
+*/
+static int readBaselines(const char* path) {
+  char line[HOST_NAME_LEN * 2];
+  char name[HOST_NAME_LEN];
+  double ns;
+  FILE* file = fopen(path, "r");
+  int n;
+
+  if (!file) {
+    perror(path);
+    return 0;
+  }
+  while (fgets(line, sizeof(line), file)) {
+    if (sscanf(line, "%lf %31[^\n]", &ns, name) != 2) {
+      continue;
+    }
+    for (n = 0; n < HOST_PATHS; n++) {
+      if (!strcmp(paths[n].name, name)) {
+        results[n].baseline = ns;
+      }
+    }
+  }
+  fclose(file);
+  return 1;
+}
+
+static int writeBaselines(const char* path) {
+  FILE* file = fopen(path, "w");
+  int n;
+
+  if (!file) {
+    perror(path);
+    return 0;
+  }
+  for (n = 0; n < HOST_PATHS; n++) {
+    fprintf(file, "%.1f %s\n", results[n].ns, results[n].name);
+  }
+  fclose(file);
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  const char* output = 0;
+  const char* baselines = 0;
+  int regressions = 0;
+  int n;
+
+  for (n = 1; n + 1 < argc; n += 2) {
+    if (!strcmp(argv[n], "-o")) {
+      output = argv[n + 1];
+    } else if (!strcmp(argv[n], "-b")) {
+      baselines = argv[n + 1];
+    } else {
+      break;
+    }
+  }
+  if (n != argc) {
+    fprintf(stderr, "usage: benchhost [-o <file>] [-b <file>]\n");
+    return 2;
+  }
+  if (baselines && !readBaselines(baselines)) {
+    return 1;
+  }
+
+  hostSetStepLimit(STEP_LIMIT);
+  __enable_interrupt();
+  dataInit();
+  hostCalibrate();
+
+  printf("%-18s %10s %10s\n", "benchmark", "ns", baselines ? "baseline" : "");
+  for (n = 0; n < HOST_PATHS; n++) {
+    HostResult* result = &results[n];
+    int tries = 0;
+
+    result->name = paths[n].name;
+    result->ns = 1e30;
+    do { //A regression has to stand HOST_RETRIES runs, a busy machine only slows some of them
+      paths[n].run();
+      if (fastestNs < result->ns) {
+        result->ns = fastestNs;
+      }
+    } while (baselines && result->baseline && hostRegressed(result) && ++tries < HOST_RETRIES);
+    hostReport(result, baselines != 0);
+    regressions += baselines && hostRegressed(result);
+  }
+  printf("empty measurement %.0f ns, taken off every call\n", (double)emptyNs);
+
+  if (output && !writeBaselines(output)) {
+    return 1;
+  }
+  if (baselines) {
+    printf("%d regression(s)\n", regressions);
+  }
+  return regressions;
+}
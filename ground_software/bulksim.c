@@ -0,0 +1,372 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's bulk download (main_software/inc/bulk.h) over a lossy loopback link:
+
+      bulksim [-b baud] [-k bytes] [-d delay ticks] [-c contact s] [-p passes] [-s seed] [loss % ...]
+
+    The satellite side is bulk.c and the telemetry queue as downlink.c drives them: every DOWNLINK_PASS_TICKS the sender
+    queues the chunks that are due (a health packet every 5 s goes with them), and the queue is emptied into a model of
+    the radio's transmit ring, which drains at the baud rate.  The source is a byte pattern, busy now and then as the SD
+    card is when the recorder is writing.  Each frame that leaves the ring is lost with the given probability, and the
+    rest reach the ground after the delay.  The ground side checks every chunk against the pattern and acknowledges
+    as a ground station would: after a quarter of the window, at once on a gap, and every second while it is missing
+    anything.  Acknowledgements (BULK_ACK) are lost with the same probability and take the same delay.  The link is
+    only up for the contact time of each 90 minute orbit; at the start of each contact the ground repeats the
+    DOWNLOAD command, and the transfer carries on.
+
+    For each loss rate (default 0, 1, 2, 5, 10, 20 and 30 %) the same transfer is run with the largest window
+    (BULK_WINDOW), a window of 8, and stop and wait (window 1, every chunk acknowledged).  It reports the contact time
+    the transfer took, the goodput (data bytes delivered per second of contact) against the raw link rate, chunks sent
+    again, and timeouts.  It fails (exit code 1) if the ground ever sees a wrong byte, or the sender claims to be done
+    before the ground has everything.
+
+    The uplink is taken to be full duplex and never short of room: acknowledgements are 14 bytes at most every few
+    chunks.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o bulksim bulksim.c ../main_software/bulk.c ../main_software/telemetry.c \
+        ../main_software/log_format.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bulk.h"
+#include "telemetry.h"
+#include "log_format.h"
+
+/* CONSTANTS */
+#define TICK_HZ               100 //OS_TICK_HZ
+#define PASS_TICKS            10 //DOWNLINK_PASS_TICKS
+#define HEALTH_TICKS          500 //DOWNLINK_HEALTH_TICKS
+#define HEALTH_BYTES          (34 + 2 * TELEMETRY_CLASSES) //DOWNLINK_HEALTH_BYTES
+#define TX_RING               127 //RADIO_TX_LEN, less the byte kept free
+#define ORBIT_S               5400
+#define ACK_EVERY_TICKS       TICK_HZ //While anything is missing
+#define IN_FLIGHT             1024 //Frames or acknowledgements on their way at once, at most
+#define BUSY_PERCENT          5 //Reads the source refuses
+#define TRANSFER              7
+#define SOURCE                2 //COMMAND_DOWNLOAD_LOG
+
+/* Name: Flight_s
+   Type: struct
+   Purpose:
+    A frame or acknowledgement on its way, arriving at tick.
+*/
+struct Flight_s {
+  unsigned long tick;
+  unsigned char bytes[TELEMETRY_FRAME_MAX];
+};
+typedef struct Flight_s Flight;
+
+/* Name: Run_s
+   Type: struct
+   Purpose:
+    Results of one transfer.
+*/
+struct Run_s {
+  unsigned long contactTicks; //Until the ground had everything
+  unsigned long delivered; //Data bytes, first copies
+  int passes;
+  char complete;
+  char failed;
+};
+typedef struct Run_s Run;
+
+static TelemetryPacket pool[TELEMETRY_SLOTS];
+static unsigned int seed;
+static unsigned int lossPerMille;
+
+static Flight down[IN_FLIGHT];
+static unsigned int downHead;
+static unsigned int downCount;
+static Flight up[IN_FLIGHT];
+static unsigned int upHead;
+static unsigned int upCount;
+
+static unsigned char* received; //One per chunk, on the ground
+static unsigned int groundBase; //First chunk missing
+static unsigned int newSinceAck;
+static unsigned long lastAck;
+static char gap;
+static unsigned long wrongBytes;
+
+static unsigned int nextRandom(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
+
+static unsigned char pattern(unsigned long address) {
+  return (unsigned char)((address * 37) ^ (address >> 8) ^ (address >> 17));
+}
+
+/* Name: readPattern
+   Description:
+    BulkReader for the simulated source.
+*/
+static char readPattern(unsigned long address, unsigned char* buffer, unsigned char length) {
+  unsigned char n;
+
+  if (nextRandom() % 100 < BUSY_PERCENT) {
+    return 0;
+  }
+  for (n = 0; n < length; n++) {
+    buffer[n] = pattern(address + n);
+  }
+  return 1;
+}
+
+static void launch(Flight* queue, unsigned int head, unsigned int* count, const unsigned char* bytes,
+                   unsigned int length, unsigned long arrival) {
+  Flight* flight;
+
+  if (nextRandom() % 1000 < lossPerMille || *count >= IN_FLIGHT) {
+    return;
+  }
+  flight = &queue[(head + *count) % IN_FLIGHT];
+  flight -> tick = arrival;
+  memcpy(flight->bytes, bytes, length);
+  (*count)++;
+}
+
+/* Name: groundReceive
+   Description:
+    A frame reached the ground: checks it and marks its chunk.
+*/
+static void groundReceive(const unsigned char* frame, unsigned long length, unsigned int chunks) {
+  const unsigned char* payload = frame + TELEMETRY_FRAME_HEADER;
+  unsigned int chunk;
+  unsigned long address;
+  int n;
+
+  if (frame[3] != TELEMETRY_BULK || payload[0] != TRANSFER) {
+    return;
+  }
+  if (logGet16(frame + TELEMETRY_FRAME_HEADER + frame[2]) !=
+      logCrc16(frame, TELEMETRY_FRAME_HEADER + frame[2])) {
+    wrongBytes++;
+    return;
+  }
+  chunk = logGet16(payload + 1);
+  address = (unsigned long)chunk * BULK_CHUNK_BYTES;
+  if (chunk >= chunks || frame[2] - BULK_HEADER != (length - address < BULK_CHUNK_BYTES ? length - address :
+                                                                                         BULK_CHUNK_BYTES)) {
+    wrongBytes++;
+    return;
+  }
+  for (n = 0; n < frame[2] - BULK_HEADER; n++) {
+    wrongBytes += payload[BULK_HEADER + n] != pattern(address + n);
+  }
+  if (chunk > groundBase && !received[chunk - 1]) {
+    gap = 1;
+  }
+  if (!received[chunk]) {
+    received[chunk] = 1;
+    newSinceAck++;
+  }
+  while (groundBase < chunks && received[groundBase]) {
+    groundBase++;
+  }
+}
+
+/* Name: groundAck
+   Description:
+    Sends a BULK_ACK if one is due.
+*/
+static void groundAck(unsigned long tick, unsigned int chunks, unsigned char window, unsigned int delay) {
+  unsigned char ack[BULK_ACK_BYTES];
+  unsigned long bitmap = 0;
+  unsigned int every = window / 4 ? window / 4 : 1;
+  int n;
+
+  if (!(newSinceAck >= every || gap || (groundBase < chunks && tick - lastAck >= ACK_EVERY_TICKS))) {
+    return;
+  }
+  for (n = 0; n < BULK_WINDOW && groundBase + n < chunks; n++) {
+    if (received[groundBase + n]) {
+      bitmap |= 1UL << n;
+    }
+  }
+  ack[0] = TRANSFER;
+  logPut16(ack + 1, groundBase);
+  logPut32(ack + 3, bitmap);
+  launch(up, upHead, &upCount, ack, BULK_ACK_BYTES, tick + delay);
+  newSinceAck = 0;
+  gap = 0;
+  lastAck = tick;
+}
+
+static Run simulate(long baud, unsigned long length, unsigned char window, unsigned int delay, int contactSeconds,
+                    int maxPasses, unsigned int initialSeed) {
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+  unsigned long txEnd[IN_FLIGHT]; //Byte count at which each frame in the ring is out
+  unsigned char txFrames[IN_FLIGHT][TELEMETRY_FRAME_MAX];
+  unsigned int txHead = 0;
+  unsigned int txCount = 0;
+  unsigned long txQueued = 0;
+  double txSent = 0;
+  double perTick = baud / 10.0 / TICK_HZ;
+  unsigned int chunks = (unsigned int)((length + BULK_CHUNK_BYTES - 1) / BULK_CHUNK_BYTES);
+  unsigned long contactTicks = (unsigned long)contactSeconds * TICK_HZ;
+  unsigned long tick = 0;
+  Run run;
+  int pass;
+
+  memset(&run, 0, sizeof(run));
+  memset(payload, 0, sizeof(payload));
+  seed = initialSeed;
+  received = calloc(chunks, 1);
+  groundBase = newSinceAck = 0;
+  gap = 0;
+  wrongBytes = 0;
+  downHead = downCount = upHead = upCount = 0;
+  telemetryInit(pool, telemetryPolicies);
+  bulkInit();
+
+  for (pass = 0; pass < maxPasses && groundBase < chunks; pass++) {
+    unsigned long end;
+
+    tick = (unsigned long)pass * ORBIT_S * TICK_HZ;
+    end = tick + contactTicks;
+    bulkStart(TRANSFER, SOURCE, readPattern, 0, length, window, tick); //Ground repeats DOWNLOAD at the start
+    lastAck = tick;
+    run.passes++;
+    for (; tick < end && groundBase < chunks; tick++) {
+      if (tick % PASS_TICKS == 0) { //downlinkStep()
+        unsigned char bytes;
+
+        if (tick % HEALTH_TICKS == 0) {
+          telemetryPut(TELEMETRY_HEALTH, payload, HEALTH_BYTES, tick);
+        }
+        bulkStep(tick);
+        telemetryBeginPass();
+        while ((bytes = telemetryDequeue(frame, TX_RING - (unsigned int)(txQueued - (unsigned long)txSent), tick))) {
+          unsigned int slot = (txHead + txCount++) % IN_FLIGHT;
+
+          memcpy(txFrames[slot], frame, bytes);
+          txQueued += bytes;
+          txEnd[slot] = txQueued;
+        }
+      }
+
+      txSent = txSent + perTick < txQueued ? txSent + perTick : txQueued; //The UART
+      while (txCount && txEnd[txHead] <= (unsigned long)txSent) {
+        launch(down, downHead, &downCount, txFrames[txHead], TELEMETRY_FRAME_MAX, tick + delay);
+        txHead = (txHead + 1) % IN_FLIGHT;
+        txCount--;
+      }
+
+      while (downCount && down[downHead].tick <= tick) {
+        groundReceive(down[downHead].bytes, length, chunks);
+        downHead = (downHead + 1) % IN_FLIGHT;
+        downCount--;
+      }
+      groundAck(tick, chunks, window, delay);
+      while (upCount && up[upHead].tick <= tick) {
+        const unsigned char* ack = up[upHead].bytes;
+
+        bulkAck(ack[0], logGet16(ack + 1), logGet32(ack + 3), tick);
+        upHead = (upHead + 1) % IN_FLIGHT;
+        upCount--;
+      }
+      if (bulkGetStats()->state == BULK_DONE && groundBase < chunks) {
+        printf("FAIL: sender done with chunk %u missing on the ground\n", groundBase);
+        run.failed = 1;
+        break;
+      }
+    }
+    run.contactTicks += tick - (unsigned long)pass * ORBIT_S * TICK_HZ;
+    txHead = txCount = 0; //Loss of signal: whatever was on its way is gone
+    txQueued = 0;
+    txSent = 0;
+    downCount = upCount = 0;
+    if (run.failed) {
+      break;
+    }
+  }
+
+  run.complete = groundBase >= chunks;
+  run.delivered = groundBase >= chunks ? length : (unsigned long)groundBase * BULK_CHUNK_BYTES;
+  if (wrongBytes) {
+    printf("FAIL: %lu wrong byte(s) or frame(s) on the ground\n", wrongBytes);
+    run.failed = 1;
+  }
+  free(received);
+  return run;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: bulksim [-b baud] [-k bytes] [-d delay ticks] [-c contact s] [-p passes] [-s seed] "
+                  "[loss %% ...]\n");
+}
+
+int main(int argc, char** argv) {
+  static const double defaultLosses[] = {0, 1, 2, 5, 10, 20, 30};
+  static const unsigned char windows[] = {BULK_WINDOW, 8, 1};
+  double losses[16];
+  int lossCount = 0;
+  long baud = 9600;
+  unsigned long length = 1000000;
+  unsigned int delay = 10;
+  int contactSeconds = 480;
+  int maxPasses = 100;
+  unsigned int initialSeed = 1;
+  int failed = 0;
+  int n;
+  int w;
+
+  for (n = 1; n < argc; n++) {
+    if (!strcmp(argv[n], "-b") && n + 1 < argc) {
+      baud = atol(argv[++n]);
+    } else if (!strcmp(argv[n], "-k") && n + 1 < argc) {
+      length = strtoul(argv[++n], 0, 0);
+    } else if (!strcmp(argv[n], "-d") && n + 1 < argc) {
+      delay = (unsigned int)atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-c") && n + 1 < argc) {
+      contactSeconds = atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-p") && n + 1 < argc) {
+      maxPasses = atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-s") && n + 1 < argc) {
+      initialSeed = (unsigned int)atoi(argv[++n]);
+    } else if (argv[n][0] != '-' && lossCount < 16) {
+      losses[lossCount++] = atof(argv[n]);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (baud < 300 || !length || (length + BULK_CHUNK_BYTES - 1) / BULK_CHUNK_BYTES > BULK_CHUNKS_MAX ||
+      contactSeconds < 1 || contactSeconds > ORBIT_S || maxPasses < 1) {
+    usage();
+    return 2;
+  }
+  if (!lossCount) {
+    memcpy(losses, defaultLosses, sizeof(defaultLosses));
+    lossCount = sizeof(defaultLosses) / sizeof(defaultLosses[0]);
+  }
+
+  printf("%lu bytes at %ld baud (%.0f bytes/s raw), %u tick delay each way, %d s contact per orbit\n", length, baud,
+         baud / 10.0, delay, contactSeconds);
+  printf("%6s %6s %7s %10s %8s %7s %8s %8s %8s\n", "loss%", "window", "passes", "contact s", "goodput", "of raw",
+         "resent", "timeouts", "acks");
+  for (n = 0; n < lossCount; n++) {
+    for (w = 0; w < (int)sizeof(windows); w++) {
+      Run run;
+      double seconds;
+
+      lossPerMille = (unsigned int)(losses[n] * 10 + 0.5);
+      run = simulate(baud, length, windows[w], delay, contactSeconds, maxPasses, initialSeed);
+      seconds = (double)run.contactTicks / TICK_HZ;
+      printf("%6.1f %6u %6d%s %10.0f %8.0f %6.1f%% %8u %8u %8u\n", losses[n], windows[w], run.passes,
+             run.complete ? " " : "+", seconds, seconds ? run.delivered / seconds : 0.0,
+             seconds ? 100.0 * run.delivered / seconds / (baud / 10.0) : 0.0, bulkGetStats()->resent,
+             bulkGetStats()->timeouts, bulkGetStats()->acks);
+      failed |= run.failed;
+    }
+  }
+  printf("(+: not finished in %d passes, goodput counts what had arrived in order)\n", maxPasses);
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed;
+}
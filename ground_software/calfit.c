@@ -0,0 +1,553 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that fits the sensor calibration applied by the firmware (format in main_software/inc/calib.h) and
+    writes it as an Intel HEX image of information segment B, to be programmed alongside the firmware or sent up:
+
+      calfit [-g still.csv] [-m turning.csv] [-a tumble.csv] [-o calib.hex]
+
+      -g  gyroscope bias, the mean over samples taken at rest ("flightlog extract" CSV)
+      -m  magnetometer hard and soft iron, an ellipsoid fit over samples taken while turning the board through as many
+          attitudes as possible ("flightlog extract" CSV)
+      -a  accelerometer bias and scale, an axis aligned ellipsoid fit over a six position tumble at rest (CSV of raw
+          x,y,z per line; the flight log does not hold the accelerometer)
+      -o  output file, standard output if not given
+
+    A sensor without data gets the identity.  The fit and its residual are printed to standard error.
+
+    The magnetometer fit is the general quadric a x^2 + b y^2 + c z^2 + 2d xy + 2e xz + 2f yz + 2g x + 2h y + 2i z = 1
+    by least squares.  Its centre is the hard iron offset; the square root of its shape matrix, scaled so the corrected
+    field keeps the mean radius in counts, is the soft iron matrix.  The accelerometer fit drops the cross terms (six
+    positions cannot tell them apart) and is scaled to CALFIT_ACCEL_1G counts.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o calfit calfit.c ../main_software/log_format.c -lm
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "log_format.h"
+#include "calib.h"
+
+/* CONSTANTS */
+#define CALFIT_ACCEL_1G       16384.0 //Counts per g at the MPU-9250's reset default range of 2 g
+#define CALFIT_TERMS          9
+#define CALFIT_HEX_RECORD     16 //Data bytes per Intel HEX record
+
+/* DATATYPES */
+
+/* Name: Points_s
+   Type: struct
+   Parameters:
+    double (*p)[3] - x, y, z of each point
+    long count - points read
+   Purpose:
+    Readings of one sensor, grown as the CSV is read.
+*/
+struct Points_s {
+  double (*p)[3];
+  long count;
+  long size;
+};
+typedef struct Points_s Points;
+
+static void pointsAdd(Points* points, double x, double y, double z) {
+  if (points->count == points->size) {
+    points->size = points->size ? 2 * points->size : 1024;
+    points->p = realloc(points->p, points->size * sizeof(*points->p));
+    if (!points->p) {
+      perror("calfit");
+      exit(1);
+    }
+  }
+  points->p[points->count][0] = x;
+  points->p[points->count][1] = y;
+  points->p[points->count][2] = z;
+  points->count++;
+}
+
+/* Name: readCsv
+   Return value:
+    int - 0 on success, -1 if the file cannot be opened
+   Description:
+    Reads "flightlog extract" rows into gyro and magnet, or x,y,z rows into gyro if magnet is NULL.  Lines that do not
+    parse (the header) are skipped.
+*/
+static int readCsv(const char* path, Points* gyro, Points* magnet) {
+  char line[256];
+  FILE* in = fopen(path, "r");
+
+  if (!in) {
+    perror(path);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), in)) {
+    int v[6];
+
+    if (magnet) {
+      if (sscanf(line, "%*u,%*u,%d,%d,%d,%d,%d,%d", &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6) {
+        pointsAdd(gyro, v[0], v[1], v[2]);
+        pointsAdd(magnet, v[3], v[4], v[5]);
+      }
+    } else if (sscanf(line, "%d,%d,%d", &v[0], &v[1], &v[2]) == 3) {
+      pointsAdd(gyro, v[0], v[1], v[2]);
+    }
+  }
+  fclose(in);
+  return 0;
+}
+
+/* Name: solve
+   Return value:
+    int - 0 on success, -1 if the system is singular
+   Description:
+    Gaussian elimination with partial pivoting of the n by n system a x = b, in place; x ends up in b.
+*/
+static int solve(double a[CALFIT_TERMS][CALFIT_TERMS], double* b, int n) {
+  int row;
+  int col;
+  int k;
+
+  for (col = 0; col < n; col++) {
+    int pivot = col;
+
+    for (row = col + 1; row < n; row++) {
+      if (fabs(a[row][col]) > fabs(a[pivot][col])) {
+        pivot = row;
+      }
+    }
+    if (fabs(a[pivot][col]) < 1e-12) {
+      return -1;
+    }
+    for (k = 0; k < n; k++) {
+      double t = a[col][k];
+
+      a[col][k] = a[pivot][k];
+      a[pivot][k] = t;
+    }
+    {
+      double t = b[col];
+
+      b[col] = b[pivot];
+      b[pivot] = t;
+    }
+    for (row = col + 1; row < n; row++) {
+      double f = a[row][col] / a[col][col];
+
+      for (k = col; k < n; k++) {
+        a[row][k] -= f * a[col][k];
+      }
+      b[row] -= f * b[col];
+    }
+  }
+  for (row = n - 1; row >= 0; row--) {
+    for (k = row + 1; k < n; k++) {
+      b[row] -= a[row][k] * b[k];
+    }
+    b[row] /= a[row][row];
+  }
+  return 0;
+}
+
+/* Name: symmetricSqrt
+   Return value:
+    int - 0 on success, -1 if m is not positive definite
+   Description:
+    Square root of a symmetric 3x3 matrix by Jacobi rotations: m = V diag(l) V', root = V diag(sqrt(l)) V'.
+*/
+static int symmetricSqrt(const double m[3][3], double root[3][3]) {
+  double a[3][3];
+  double v[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  int sweep;
+  int p;
+  int q;
+  int k;
+
+  memcpy(a, m, sizeof(a));
+  for (sweep = 0; sweep < 50; sweep++) {
+    double off = fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]);
+
+    if (off < 1e-15 * (fabs(a[0][0]) + fabs(a[1][1]) + fabs(a[2][2]))) {
+      break;
+    }
+    for (p = 0; p < 2; p++) {
+      for (q = p + 1; q < 3; q++) {
+        double theta;
+        double t;
+        double c;
+        double s;
+
+        if (a[p][q] == 0) {
+          continue;
+        }
+        theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta * theta + 1));
+        c = 1 / sqrt(t * t + 1);
+        s = t * c;
+        for (k = 0; k < 3; k++) { //a = J' a J
+          double akp = a[k][p];
+          double akq = a[k][q];
+
+          a[k][p] = c * akp - s * akq;
+          a[k][q] = s * akp + c * akq;
+        }
+        for (k = 0; k < 3; k++) {
+          double apk = a[p][k];
+          double aqk = a[q][k];
+
+          a[p][k] = c * apk - s * aqk;
+          a[q][k] = s * apk + c * aqk;
+        }
+        for (k = 0; k < 3; k++) {
+          double vkp = v[k][p];
+          double vkq = v[k][q];
+
+          v[k][p] = c * vkp - s * vkq;
+          v[k][q] = s * vkp + c * vkq;
+        }
+      }
+    }
+  }
+
+  for (k = 0; k < 3; k++) {
+    if (a[k][k] <= 0) {
+      return -1;
+    }
+  }
+  for (p = 0; p < 3; p++) {
+    for (q = 0; q < 3; q++) {
+      root[p][q] = 0;
+      for (k = 0; k < 3; k++) {
+        root[p][q] += v[p][k] * sqrt(a[k][k]) * v[q][k];
+      }
+    }
+  }
+  return 0;
+}
+
+/* Name: fitEllipsoid
+   Parameters:
+    const Points* points - readings
+    int full - 1 for the general quadric, 0 for the axis aligned one
+    double radius - radius of the corrected sphere, 0 for the fitted mean radius
+    double centre[3] - the fitted centre (bias)
+    double w[3][3] - the fitted correction, w (x - centre) lies on the sphere
+   Return value:
+    int - 0 on success, -1 if the points do not describe an ellipsoid
+   Description:
+    Points are centred on their mean and scaled to about one before the fit, so the normal equations stay well
+    conditioned with readings in the tens of thousands.
+*/
+static int fitEllipsoid(const Points* points, int full, double radius, double centre[3], double w[3][3]) {
+  double ata[CALFIT_TERMS][CALFIT_TERMS] = {{0}};
+  double atb[CALFIT_TERMS] = {0};
+  double mean[3] = {0, 0, 0};
+  double scale = 0;
+  double q[3][3];
+  double u[3];
+  double c[3];
+  double shape[3][3];
+  double k;
+  double det;
+  int terms = full ? 9 : 6;
+  long n;
+  int i;
+  int j;
+
+  if (points->count < 2 * terms) {
+    return -1;
+  }
+  for (n = 0; n < points->count; n++) {
+    for (i = 0; i < 3; i++) {
+      mean[i] += points->p[n][i] / points->count;
+    }
+  }
+  for (n = 0; n < points->count; n++) {
+    for (i = 0; i < 3; i++) {
+      if (fabs(points->p[n][i] - mean[i]) > scale) {
+        scale = fabs(points->p[n][i] - mean[i]);
+      }
+    }
+  }
+  if (scale == 0) {
+    return -1;
+  }
+
+  for (n = 0; n < points->count; n++) { //Rows x^2, y^2, z^2, 2x, 2y, 2z [, 2xy, 2xz, 2yz], right side 1
+    double x = (points->p[n][0] - mean[0]) / scale;
+    double y = (points->p[n][1] - mean[1]) / scale;
+    double z = (points->p[n][2] - mean[2]) / scale;
+    double row[CALFIT_TERMS] = {x * x, y * y, z * z, 2 * x, 2 * y, 2 * z, 2 * x * y, 2 * x * z, 2 * y * z};
+
+    for (i = 0; i < terms; i++) {
+      for (j = 0; j < terms; j++) {
+        ata[i][j] += row[i] * row[j];
+      }
+      atb[i] += row[i];
+    }
+  }
+  if (solve(ata, atb, terms) < 0) {
+    return -1;
+  }
+
+  q[0][0] = atb[0];
+  q[1][1] = atb[1];
+  q[2][2] = atb[2];
+  q[0][1] = q[1][0] = full ? atb[6] : 0;
+  q[0][2] = q[2][0] = full ? atb[7] : 0;
+  q[1][2] = q[2][1] = full ? atb[8] : 0;
+  u[0] = atb[3];
+  u[1] = atb[4];
+  u[2] = atb[5];
+
+  //Centre c solves q c = -u; then (y - c)' q (y - c) = 1 + c' q c
+  {
+    double a[CALFIT_TERMS][CALFIT_TERMS];
+
+    for (i = 0; i < 3; i++) {
+      for (j = 0; j < 3; j++) {
+        a[i][j] = q[i][j];
+      }
+      c[i] = -u[i];
+    }
+    if (solve(a, c, 3) < 0) {
+      return -1;
+    }
+  }
+  k = 1;
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      k += c[i] * q[i][j] * c[j];
+    }
+  }
+  if (k <= 0) {
+    return -1;
+  }
+  for (i = 0; i < 3; i++) {
+    centre[i] = mean[i] + scale * c[i];
+    for (j = 0; j < 3; j++) {
+      shape[i][j] = q[i][j] / (k * scale * scale); //Back to counts
+    }
+  }
+  if (symmetricSqrt(shape, w) < 0) {
+    return -1;
+  }
+
+  det = w[0][0] * (w[1][1] * w[2][2] - w[1][2] * w[2][1]) - w[0][1] * (w[1][0] * w[2][2] - w[1][2] * w[2][0]) +
+        w[0][2] * (w[1][0] * w[2][1] - w[1][1] * w[2][0]);
+  if (radius == 0) {
+    radius = pow(det, -1.0 / 3); //Geometric mean of the semi-axes
+  }
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      w[i][j] *= radius;
+    }
+  }
+  return 0;
+}
+
+/* Name: residual
+   Return value:
+    double - RMS of |w (x - centre)| - radius over the points, relative to radius
+*/
+static double residual(const Points* points, const double centre[3], const double w[3][3], double* radius) {
+  double sum = 0;
+  double sumSquares = 0;
+  long n;
+  int i;
+  int j;
+
+  for (n = 0; n < points->count; n++) {
+    double length = 0;
+
+    for (i = 0; i < 3; i++) {
+      double out = 0;
+
+      for (j = 0; j < 3; j++) {
+        out += w[i][j] * (points->p[n][j] - centre[j]);
+      }
+      length += out * out;
+    }
+    length = sqrt(length);
+    sum += length;
+    sumSquares += length * length;
+  }
+  *radius = sum / points->count;
+  return sqrt(sumSquares / points->count - *radius * *radius) / *radius;
+}
+
+static int toInt16(double value) {
+  long rounded = lround(value);
+
+  return rounded > 32767 ? 32767 : (rounded < -32768 ? -32768 : (int)rounded);
+}
+
+/* Name: putMatrix
+   Return value:
+    int - shift used, the smallest that holds every entry
+   Description:
+    Quantizes w to Q15 with a shift (see calib.h) into the image.
+*/
+static int putMatrix(unsigned char* image, int offset, const double w[3][3]) {
+  double largest = 0;
+  int shift = 0;
+  int i;
+  int j;
+
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      if (fabs(w[i][j]) > largest) {
+        largest = fabs(w[i][j]);
+      }
+    }
+  }
+  while (shift < CALIB_MAX_SHIFT && largest * CALIB_Q15_ONE / (1L << shift) >= 32767.5) {
+    shift++;
+  }
+  for (i = 0; i < 3; i++) {
+    for (j = 0; j < 3; j++) {
+      logPut16(image + offset + 2 * (3 * i + j), (unsigned int)toInt16(w[i][j] * CALIB_Q15_ONE / (1L << shift)));
+    }
+  }
+  return shift;
+}
+
+static void putBias(unsigned char* image, int offset, const double bias[3]) {
+  int i;
+
+  for (i = 0; i < 3; i++) {
+    logPut16(image + offset + 2 * i, (unsigned int)toInt16(bias[i]));
+  }
+}
+
+/* Name: fitSensor
+   Return value:
+    int - 0 on success or if there was no data (identity), -1 if the fit failed
+*/
+static int fitSensor(const char* name, const Points* points, int full, double radius, unsigned char* image,
+                     int biasOffset, int matrixOffset, int shiftOffset) {
+  double identity[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  double centre[3] = {0, 0, 0};
+  double w[3][3];
+  double mean;
+  double spread;
+
+  if (points->count == 0) {
+    fprintf(stderr, "%s: no data, identity\n", name);
+    putBias(image, biasOffset, centre);
+    image[shiftOffset] = (unsigned char)putMatrix(image, matrixOffset, identity);
+    return 0;
+  }
+  if (fitEllipsoid(points, full, radius, centre, w) < 0) {
+    fprintf(stderr, "%s: %ld points do not describe an ellipsoid, more attitudes are needed\n", name, points->count);
+    return -1;
+  }
+  putBias(image, biasOffset, centre);
+  image[shiftOffset] = (unsigned char)putMatrix(image, matrixOffset, w);
+
+  spread = residual(points, centre, w, &mean);
+  fprintf(stderr, "%s: %ld points, bias %.1f %.1f %.1f, radius %.1f, residual %.2f %%\n", name, points->count,
+          centre[0], centre[1], centre[2], mean, 100 * spread);
+  fprintf(stderr, "%s: matrix %8.5f %8.5f %8.5f\n%*s         %8.5f %8.5f %8.5f\n%*s         %8.5f %8.5f %8.5f\n",
+          name, w[0][0], w[0][1], w[0][2], (int)strlen(name), "", w[1][0], w[1][1], w[1][2], (int)strlen(name), "",
+          w[2][0], w[2][1], w[2][2]);
+  return 0;
+}
+
+/* Name: writeHex
+   Description:
+    Intel HEX, 16 data bytes per record, then the end of file record.
+*/
+static void writeHex(FILE* out, unsigned int address, const unsigned char* data, int length) {
+  int at;
+  int i;
+
+  for (at = 0; at < length; at += CALFIT_HEX_RECORD) {
+    int count = length - at < CALFIT_HEX_RECORD ? length - at : CALFIT_HEX_RECORD;
+    unsigned int sum = count + ((address + at) >> 8) + ((address + at) & 0xFF);
+
+    fprintf(out, ":%02X%04X00", count, address + at);
+    for (i = 0; i < count; i++) {
+      fprintf(out, "%02X", data[at + i]);
+      sum += data[at + i];
+    }
+    fprintf(out, "%02X\n", (0x100 - (sum & 0xFF)) & 0xFF);
+  }
+  fprintf(out, ":00000001FF\n");
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: calfit [-g still.csv] [-m turning.csv] [-a tumble.csv] [-o calib.hex]\n");
+}
+
+int main(int argc, char** argv) {
+  Points gyro = {0};
+  Points magnet = {0};
+  Points accel = {0};
+  Points unused = {0};
+  unsigned char image[CALIB_IMAGE_BYTES];
+  const char* output = NULL;
+  FILE* out = stdout;
+  double bias[3] = {0, 0, 0};
+  int failed = 0;
+  int i;
+  long n;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 >= argc) {
+      usage();
+      return 2;
+    }
+    if (!strcmp(argv[i], "-g")) {
+      failed |= readCsv(argv[++i], &gyro, &unused);
+    } else if (!strcmp(argv[i], "-m")) {
+      failed |= readCsv(argv[++i], &unused, &magnet);
+    } else if (!strcmp(argv[i], "-a")) {
+      failed |= readCsv(argv[++i], &accel, NULL);
+    } else if (!strcmp(argv[i], "-o")) {
+      output = argv[++i];
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (failed) {
+    return 1;
+  }
+
+  memset(image, 0, sizeof(image));
+  logPut16(image + CALIB_IMG_MAGIC, CALIB_MAGIC);
+
+  for (n = 0; n < gyro.count; n++) {
+    for (i = 0; i < 3; i++) {
+      bias[i] += gyro.p[n][i] / gyro.count;
+    }
+  }
+  putBias(image, CALIB_IMG_GYRO_BIAS, bias);
+  fprintf(stderr, "gyro: %ld points, bias %.1f %.1f %.1f\n", gyro.count, bias[0], bias[1], bias[2]);
+
+  failed |= fitSensor("accel", &accel, 0, CALFIT_ACCEL_1G, image, CALIB_IMG_ACCEL_BIAS, CALIB_IMG_ACCEL_MATRIX,
+                      CALIB_IMG_ACCEL_SHIFT);
+  failed |= fitSensor("magnet", &magnet, 1, 0, image, CALIB_IMG_MAGNET_BIAS, CALIB_IMG_MAGNET_MATRIX,
+                      CALIB_IMG_MAGNET_SHIFT);
+  if (failed) {
+    return 1;
+  }
+  logPut16(image + CALIB_IMG_CRC, logCrc16(image, CALIB_IMG_CRC));
+
+  if (output && !(out = fopen(output, "w"))) {
+    perror(output);
+    return 1;
+  }
+  writeHex(out, CALIB_ADDR, image, CALIB_IMAGE_BYTES);
+  if (output) {
+    fclose(out);
+  }
+  free(gyro.p);
+  free(magnet.p);
+  free(accel.p);
+  free(unused.p);
+  return 0;
+}
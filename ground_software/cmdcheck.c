@@ -0,0 +1,612 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool for the command uplink (main_software/inc/command.h):
+
+      cmdcheck encode <opcode> <sequence> [argument byte ...]   one command frame, as hex, for the ground station
+      cmdcheck record <file> [frames] [seed]                    a command stream as the ground station would send it
+      cmdcheck replay <file>                                    runs a stream through the firmware's parser
+      cmdcheck fuzz [iterations] [seed]                         runs corrupted streams through it
+
+    The parser (command.c) is run as downlink.c runs it: bytes arrive in the 64 byte receive ring a few at a time, as
+    from the UART, and each step parses in place and drops what it used.  The handlers here stand in for the firmware's:
+    they check that they are only called with argument lengths the dispatch table allows and only read inside their
+    arguments, and record what they were called with.
+
+    replay checks that every frame in the stream is run exactly once and in order, and that every frame gets a reply;
+    then times the parser over the whole stream (host time, for comparing changes; the MSP430 figure is in benchmark.c).
+    fuzz mutates the recorded frames (bit flips, lost bytes, repeated bytes, truncation) and puts noise between them
+    (random bytes, lone sync bytes, false headers).  It fails (exit code 1) if a frame that arrived intact is not
+    answered (and run, if the table accepts it), a handler sees a length the table does not allow, a byte is lost to a
+    full ring, or the ring does not empty once the stream stops (the stall timeout must clear any partial frame).  Two
+    things no parser can tell are counted rather than failed: a frame that lost its last byte where the next byte (the
+    sync of the next frame) is the same, which takes that frame with it, and noise that passes the CRC.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o cmdcheck cmdcheck.c ../main_software/command.c \
+        ../main_software/telemetry.c ../main_software/log_format.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "command.h"
+#include "telemetry.h"
+#include "log_format.h"
+
+/* CONSTANTS */
+#define RING_LEN              64 //RADIO_RX_LEN
+#define MAX_ARRIVAL           16 //Bytes per step at most; two replies go down per step, the ground paces its commands
+#define MAX_FRAMES            256 //Per stream, so sequences are unique
+#define STREAM_MAX            (MAX_FRAMES * (COMMAND_FRAME_MAX + 2 * COMMAND_FRAME_MAX))
+#define REPLAY_REPEATS        2000
+
+/* Name: Call_s
+   Type: struct
+   Purpose:
+    A command as sent, or as a handler saw it.
+*/
+struct Call_s {
+  unsigned char opcode;
+  unsigned char sequence;
+  unsigned char length;
+  unsigned char args[COMMAND_ARGS_MAX];
+};
+typedef struct Call_s Call;
+
+static const unsigned char argLimits[COMMAND_OPCODES][2] = {
+#define LIMITS(name, handler, minArgs, maxArgs) {minArgs, maxArgs},
+  COMMAND_LIST(LIMITS)
+};
+
+static Call calls[MAX_FRAMES * 4];
+static int callCount;
+static int handlerErrors;
+static unsigned long replies;
+static char answered[256]; //By sequence
+static long acceptedAt[MAX_FRAMES * 4]; //Stream offsets of the frames that passed their CRC
+static unsigned char acceptedLength[MAX_FRAMES * 4];
+static int acceptedCount;
+
+static TelemetryPacket pool[TELEMETRY_SLOTS];
+static unsigned int seed;
+
+static unsigned int nextRandom(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
+
+/* Name: stubHandler
+   Description:
+    What every handler here does: checks the length against the table, copies the arguments through commandArg8() (so a
+    read outside the frame would show up as a mismatch with what was sent), and records the call.
+*/
+static unsigned char stubHandler(const CommandArgs* args) {
+  Call* call = &calls[callCount < MAX_FRAMES * 4 ? callCount++ : callCount - 1];
+  unsigned char n;
+
+  if (args->opcode >= COMMAND_OPCODES || args->length < argLimits[args->opcode][0] ||
+      args->length > argLimits[args->opcode][1]) {
+    handlerErrors++;
+  }
+  call->opcode = args->opcode;
+  call->sequence = args->sequence;
+  call->length = args->length;
+  for (n = 0; n < args->length && n < COMMAND_ARGS_MAX; n++) {
+    call->args[n] = commandArg8(args, n);
+  }
+  return COMMAND_OK;
+}
+
+unsigned char commandSetRate(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+unsigned char commandSetMode(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+unsigned char commandDumpHealth(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+unsigned char commandDownload(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+unsigned char commandBulkAck(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+unsigned char commandSetConfig(const CommandArgs* args) {
+  return stubHandler(args);
+}
+
+/* Name: encode
+   Return value:
+    int - frame length, written to out
+*/
+static int encode(const Call* call, unsigned char* out) {
+  int n;
+
+  out[0] = COMMAND_SYNC_0;
+  out[1] = COMMAND_SYNC_1;
+  out[2] = call->length;
+  out[3] = call->opcode;
+  out[4] = call->sequence;
+  for (n = 0; n < call->length; n++) {
+    out[COMMAND_HEADER + n] = call->args[n];
+  }
+  logPut16(out + COMMAND_HEADER + n, logCrc16(out, COMMAND_HEADER + n));
+  return COMMAND_OVERHEAD + n;
+}
+
+/* Name: randomCall
+   Description:
+    A command with the lengths the ground station uses, or now and then one the parser must reject.
+*/
+static void randomCall(Call* call, unsigned char sequence) {
+  int n;
+
+  call->sequence = sequence;
+  call->opcode = nextRandom() % 16 ? nextRandom() % COMMAND_OPCODES : COMMAND_OPCODES + nextRandom() % 8;
+  call->length = call->opcode < COMMAND_OPCODES ? argLimits[call->opcode][0] : nextRandom() % 4;
+  if (call->opcode == COMMAND_DOWNLOAD) {
+    call->length = 1 + nextRandom() % 6;
+  }
+  if (nextRandom() % 16 == 0) { //Wrong length
+    call->length = nextRandom() % (COMMAND_ARGS_MAX + 1);
+  }
+  for (n = 0; n < call->length; n++) {
+    call->args[n] = nextRandom() & 0xFF;
+  }
+}
+
+static int accepted(const Call* call) {
+  return call->opcode < COMMAND_OPCODES && call->length >= argLimits[call->opcode][0] &&
+         call->length <= argLimits[call->opcode][1];
+}
+
+/* Name: Link_s
+   Type: struct
+   Purpose:
+    The receive ring and the parser loop of downlinkStep(), fed from a byte stream.
+*/
+struct Link_s {
+  unsigned char ring[RING_LEN];
+  unsigned char head;
+  unsigned char tail;
+  unsigned long tick;
+  unsigned long overruns;
+  long consumed; //Stream offset of the byte at head
+};
+typedef struct Link_s Link;
+
+static void linkInit(Link* link) {
+  memset(link, 0, sizeof(*link));
+  commandReset();
+  telemetryInit(pool, telemetryPolicies);
+  callCount = 0;
+  handlerErrors = 0;
+  replies = 0;
+  memset(answered, 0, sizeof(answered));
+  acceptedCount = 0;
+}
+
+/* Name: linkStep
+   Return value:
+    int - bytes left in the ring, -1 if the parser broke the ring's rules
+*/
+static int linkStep(Link* link, const unsigned char* bytes, int count) {
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  unsigned char available;
+  unsigned char used;
+  int n;
+
+  for (n = 0; n < count; n++) { //As radioServiceRx()
+    unsigned char tail = (link->tail + 1) & (RING_LEN - 1);
+
+    if (tail == link->head) {
+      link->overruns++;
+      continue;
+    }
+    link->ring[link->tail] = bytes[n];
+    link->tail = tail;
+  }
+  do {
+    available = (link->tail - link->head) & (RING_LEN - 1);
+    used = 0;
+    if (telemetryGetFree(TELEMETRY_REPLY)) { //As downlinkStep(), only with room to answer
+      used = commandParse(link->ring, RING_LEN - 1, link->head, available, link->tick);
+    }
+    if (used > available) {
+      printf("FAIL: parser used %u of %u bytes\n", used, available);
+      return -1;
+    }
+    if (used > 1 && acceptedCount < MAX_FRAMES * 4) { //Skips are one byte, frames at least COMMAND_OVERHEAD
+      acceptedAt[acceptedCount] = link->consumed;
+      acceptedLength[acceptedCount++] = used;
+    }
+    link->consumed += used;
+    link->head = (link->head + used) & (RING_LEN - 1);
+  } while (used);
+  while (telemetryDequeue(frame, sizeof(frame), link->tick)) {
+    if (frame[3] == TELEMETRY_REPLY) {
+      replies++;
+      answered[frame[TELEMETRY_FRAME_HEADER + 1]] = 1;
+    }
+  }
+  link->tick++;
+  return (link->tail - link->head) & (RING_LEN - 1);
+}
+
+/* Name: linkRun
+   Return value:
+    int - 0, or -1 if the parser broke the ring's rules or the ring never emptied
+   Description:
+    Feeds the stream in random chunks, then keeps stepping until the ring is empty.
+*/
+static int linkRun(Link* link, const unsigned char* stream, int length) {
+  int left = -1;
+  int at = 0;
+  int idle;
+
+  while (at < length) {
+    int chunk = nextRandom() % (MAX_ARRIVAL + 1);
+
+    if (chunk > length - at) {
+      chunk = length - at;
+    }
+    if ((left = linkStep(link, stream + at, chunk)) < 0) {
+      return -1;
+    }
+    at += chunk;
+  }
+  for (idle = 0; idle <= 2 * COMMAND_STALL_TICKS * COMMAND_FRAME_MAX && left; idle++) {
+    if ((left = linkStep(link, 0, 0)) < 0) {
+      return -1;
+    }
+  }
+  if (left) {
+    printf("FAIL: %d byte(s) never left the ring\n", left);
+    return -1;
+  }
+  if (link->overruns) {
+    printf("FAIL: %lu byte(s) lost to a full ring\n", link->overruns);
+    return -1;
+  }
+  return 0;
+}
+
+static int readStream(const char* path, unsigned char* stream) {
+  FILE* in = fopen(path, "rb");
+  int length;
+
+  if (!in) {
+    perror(path);
+    return -1;
+  }
+  length = (int)fread(stream, 1, STREAM_MAX, in);
+  fclose(in);
+  return length;
+}
+
+/* Name: splitStream
+   Return value:
+    int - frames found in a clean stream, decoded into sent
+*/
+static int splitStream(const unsigned char* stream, int length, Call* sent) {
+  int frames = 0;
+  int at = 0;
+
+  while (at + COMMAND_OVERHEAD <= length && frames < MAX_FRAMES) {
+    Call* call = &sent[frames++];
+    int n;
+
+    call->length = stream[at + 2];
+    call->opcode = stream[at + 3];
+    call->sequence = stream[at + 4];
+    for (n = 0; n < call->length && n < COMMAND_ARGS_MAX; n++) {
+      call->args[n] = stream[at + COMMAND_HEADER + n];
+    }
+    at += call->length + COMMAND_OVERHEAD;
+  }
+  return frames;
+}
+
+static int sameCall(const Call* a, const Call* b) {
+  return a->opcode == b->opcode && a->sequence == b->sequence && a->length == b->length &&
+         !memcmp(a->args, b->args, a->length);
+}
+
+static int commandEncode(int argc, char** argv) {
+  unsigned char frame[COMMAND_FRAME_MAX];
+  Call call;
+  int length;
+  int n;
+
+  call.opcode = (unsigned char)strtol(argv[0], 0, 0);
+  call.sequence = (unsigned char)strtol(argv[1], 0, 0);
+  call.length = (unsigned char)(argc - 2);
+  if (argc - 2 > COMMAND_ARGS_MAX) {
+    fprintf(stderr, "at most %d argument bytes\n", COMMAND_ARGS_MAX);
+    return 2;
+  }
+  for (n = 0; n < call.length; n++) {
+    call.args[n] = (unsigned char)strtol(argv[2 + n], 0, 0);
+  }
+  length = encode(&call, frame);
+  for (n = 0; n < length; n++) {
+    printf("%02X", frame[n]);
+  }
+  printf("\n");
+  return 0;
+}
+
+static int commandRecord(const char* path, int frames, unsigned int initialSeed) {
+  unsigned char frame[COMMAND_FRAME_MAX];
+  FILE* out = fopen(path, "wb");
+  Call call;
+  int n;
+
+  if (!out) {
+    perror(path);
+    return 1;
+  }
+  seed = initialSeed;
+  for (n = 0; n < frames && n < MAX_FRAMES; n++) {
+    randomCall(&call, (unsigned char)n);
+    fwrite(frame, 1, encode(&call, frame), out);
+  }
+  fclose(out);
+  printf("%d frame(s) written to %s\n", n, path);
+  return 0;
+}
+
+static int commandReplay(const char* path) {
+  static unsigned char stream[STREAM_MAX];
+  static Call sent[MAX_FRAMES];
+  Link link;
+  struct timespec start;
+  struct timespec end;
+  double seconds;
+  int length = readStream(path, stream);
+  int frames;
+  int runs = 0;
+  int failed = 0;
+  int expected = 0;
+  int n;
+  int r;
+
+  if (length < 0) {
+    return 1;
+  }
+  frames = splitStream(stream, length, sent);
+  seed = 1;
+  linkInit(&link);
+  if (linkRun(&link, stream, length) < 0) {
+    return 1;
+  }
+  for (n = 0; n < frames; n++) {
+    if (!accepted(&sent[n])) {
+      continue;
+    }
+    if (runs >= callCount || !sameCall(&calls[runs], &sent[n])) {
+      printf("FAIL: frame %d (opcode %u, sequence %u) not run in order\n", n, sent[n].opcode, sent[n].sequence);
+      failed = 1;
+      break;
+    }
+    runs++;
+    expected++;
+  }
+  if (!failed && callCount != expected) {
+    printf("FAIL: %d frame(s) run, %d expected\n", callCount, expected);
+    failed = 1;
+  }
+  if (replies != (unsigned long)frames || handlerErrors) {
+    printf("FAIL: %lu replies to %d frames, %d handler error(s)\n", replies, frames, handlerErrors);
+    failed = 1;
+  }
+  printf("%d bytes, %d frame(s): %d run, %u rejected, %u CRC errors, %lu bytes skipped\n", length, frames, callCount,
+         commandGetStats()->rejected, commandGetStats()->crcErrors, commandGetStats()->skipped);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (r = 0; r < REPLAY_REPEATS; r++) { //The whole stream in one go per step, parsing only
+    int at = 0;
+
+    commandReset();
+    telemetryInit(pool, telemetryPolicies);
+    callCount = 0;
+    while (at < length) {
+      int chunk = length - at < RING_LEN - 1 ? length - at : RING_LEN - 1;
+      unsigned char used;
+
+      memcpy(link.ring, stream + at, chunk);
+      used = commandParse(link.ring, RING_LEN - 1, 0, (unsigned char)chunk, 0); //One frame or byte per call
+      at += used ? used : chunk;
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+  printf("parser: %.1f ns per byte, %.0f ns per frame (host)\n", seconds * 1e9 / ((double)length * REPLAY_REPEATS),
+         seconds * 1e9 / ((double)frames * REPLAY_REPEATS));
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed;
+}
+
+/* Name: corrupt
+   Return value:
+    int - length of the corrupted stream in out
+   Description:
+    Copies the frames of sent into out, mutating about one in four and putting noise before about one in four.  intact
+    is set for each frame that went out unchanged, offsets to where each frame starts in out.
+*/
+static int corrupt(const Call* sent, int frames, unsigned char* out, char* intact, long* offsets) {
+  unsigned char frame[COMMAND_FRAME_MAX];
+  int length = 0;
+  int f;
+  int n;
+
+  for (f = 0; f < frames; f++) {
+    int size = encode(&sent[f], frame);
+    int at;
+
+    if (nextRandom() % 4 == 0) { //Noise
+      int noise = 1 + nextRandom() % (2 * COMMAND_FRAME_MAX);
+
+      for (n = 0; n < noise; n++) {
+        switch (nextRandom() % 8) {
+          case 0:
+            out[length++] = COMMAND_SYNC_0;
+            break;
+          case 1: //False header claiming a long frame
+            out[length++] = COMMAND_SYNC_0;
+            out[length++] = COMMAND_SYNC_1;
+            out[length++] = nextRandom() % (COMMAND_ARGS_MAX + 1);
+            n += 2;
+            break;
+          default:
+            out[length++] = nextRandom() & 0xFF;
+            break;
+        }
+      }
+    }
+
+    intact[f] = 1;
+    if (nextRandom() % 4 == 0) {
+      at = nextRandom() % size;
+      intact[f] = 0;
+      switch (nextRandom() % 4) {
+        case 0: //Bit flip
+          frame[at] ^= 1 << (nextRandom() % 8);
+          break;
+        case 1: //Lost byte
+          memmove(frame + at, frame + at + 1, size - at - 1);
+          size--;
+          break;
+        case 2: //Repeated byte
+          memmove(frame + at + 1, frame + at, size - at);
+          size++;
+          break;
+        default: //Cut short, the rest never came
+          size = at;
+          break;
+      }
+    }
+    offsets[f] = length;
+    memcpy(out + length, frame, size);
+    length += size;
+  }
+  return length;
+}
+
+static int commandFuzz(long iterations, unsigned int initialSeed) {
+  static unsigned char stream[STREAM_MAX];
+  static Call sent[MAX_FRAMES];
+  static char intact[MAX_FRAMES];
+  static char ran[MAX_FRAMES];
+  static long offsets[MAX_FRAMES];
+  unsigned long totalIntact = 0;
+  unsigned long recovered = 0;
+  unsigned long overlapped = 0;
+  unsigned long otherAccepts = 0;
+  unsigned long bytes = 0;
+  unsigned long skipped = 0;
+  unsigned long crcErrors = 0;
+  unsigned long stalls = 0;
+  long i;
+  int failed = 0;
+
+  seed = initialSeed;
+  for (i = 0; i < iterations && !failed; i++) {
+    Link link;
+    int frames = 1 + nextRandom() % 64;
+    int length;
+    int run = 0;
+    int f;
+    int c;
+
+    for (f = 0; f < frames; f++) {
+      randomCall(&sent[f], (unsigned char)f);
+    }
+    length = corrupt(sent, frames, stream, intact, offsets);
+    bytes += length;
+
+    linkInit(&link);
+    if (linkRun(&link, stream, length) < 0 || handlerErrors) {
+      printf("FAIL: iteration %ld, %d handler error(s)\n", i, handlerErrors);
+      failed = 1;
+      break;
+    }
+
+    memset(ran, 0, frames);
+    for (c = 0; c < callCount; c++) { //Calls that match a frame sent, in order
+      for (f = run; f < frames && !sameCall(&calls[c], &sent[f]); f++) {
+      }
+      if (f < frames) {
+        ran[f] = 1;
+        run = f + 1;
+      }
+    }
+    otherAccepts += acceptedCount;
+    for (f = 0; f < frames; f++) {
+      char found = 0;
+      char covered = 0;
+
+      if (!intact[f]) {
+        continue;
+      }
+      totalIntact++;
+      for (c = 0; c < acceptedCount; c++) {
+        found |= acceptedAt[c] == offsets[f];
+        covered |= acceptedAt[c] < offsets[f] && acceptedAt[c] + acceptedLength[c] > offsets[f];
+      }
+      if (found && answered[f] && ran[f] == accepted(&sent[f])) {
+        recovered++;
+        otherAccepts--;
+      } else if (!found && covered) {
+        overlapped++; //Taken in by something before it that passed its CRC
+      } else {
+        printf("FAIL: iteration %ld, intact frame %d (opcode %u) not %s\n", i, f, sent[f].opcode,
+               found ? "answered and run" : "found");
+        failed = 1;
+      }
+    }
+    skipped += commandGetStats()->skipped;
+    crcErrors += commandGetStats()->crcErrors;
+    stalls += commandGetStats()->stalls;
+  }
+
+  printf("%ld stream(s), %lu bytes: %lu of %lu intact frames answered, %lu taken in by a frame before them\n", i,
+         bytes, recovered, totalIntact, overlapped);
+  printf("%lu other frames passed the CRC (damaged frames or noise), %lu CRC errors, %lu stall(s), %lu bytes skipped\n",
+         otherAccepts, crcErrors, stalls, skipped);
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: cmdcheck encode <opcode> <sequence> [argument byte ...]\n"
+                  "       cmdcheck record <file> [frames] [seed]\n"
+                  "       cmdcheck replay <file>\n"
+                  "       cmdcheck fuzz [iterations] [seed]\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 4 && !strcmp(argv[1], "encode")) {
+    return commandEncode(argc - 2, argv + 2);
+  }
+  if (argc >= 3 && !strcmp(argv[1], "record")) {
+    return commandRecord(argv[2], argc >= 4 ? atoi(argv[3]) : MAX_FRAMES,
+                         argc >= 5 ? (unsigned int)atoi(argv[4]) : 1);
+  }
+  if (argc >= 3 && !strcmp(argv[1], "replay")) {
+    return commandReplay(argv[2]);
+  }
+  if (argc >= 2 && !strcmp(argv[1], "fuzz")) {
+    return commandFuzz(argc >= 3 ? atol(argv[2]) : 10000, argc >= 4 ? (unsigned int)atoi(argv[3]) : 1);
+  }
+  usage();
+  return 2;
+}
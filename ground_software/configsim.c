@@ -0,0 +1,306 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the configuration store (main_software/inc/config.h) against a model of the information
+    memory, to check that updates survive resets and to count the erases:
+
+      configsim wear [updates] [seed]    random updates with a reset now and then, erases counted per segment
+      configsim tear [trials] [seed]     power cut at a random point of an update, then a reset
+
+    Defaults are 100000 updates and 300000 trials, seed 1.  The store was checked with "configsim wear 100000 1" and
+    "configsim tear 300000 11".
+
+    The model stands in for flash.c: segments D, C and B of 64 bytes, which read as 0xFF when erased, and where
+    programming only clears bits.  wear sets random keys to random values (a few values per key, so some updates
+    change nothing) and boots the store again every few updates; after each boot every key must read the last value
+    set.  It reports the erases of each segment and the updates per erase, against a store that rewrote its segment
+    on every update.
+
+    tear fills the store with random updates, then cuts the power during one more, after a random number of the
+    flash operations it makes (a byte programmed or a segment erased).  The operation in progress is left half done: a
+    byte partly programmed, or a segment partly erased.  After the reset the key being updated must read its old or
+    its new value, and every other key its last value; the store must then take more updates.  It fails (exit code 1)
+    if any key reads anything else.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o configsim configsim.c ../main_software/config.c \
+        ../main_software/log_format.c
+*/
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "flash.h"
+
+/* CONSTANTS */
+#define MODEL_BASE            FLASH_INFO_D
+#define MODEL_SEGMENTS        3 //D, C and B
+#define MODEL_BYTES           (MODEL_SEGMENTS * FLASH_INFO_SEGMENT_BYTES)
+#define VALUES_PER_KEY        4
+#define RESET_EVERY           7 //Updates between boots, about
+#define TEAR_FILL_MAX         40 //Updates before the one cut short, at most
+#define TEAR_AFTER            3 //Updates after the reset that must go in
+#define NO_CUT                -1L
+
+static unsigned char flash[MODEL_BYTES];
+static unsigned long erases[MODEL_SEGMENTS];
+static unsigned long programmed;
+static long operationsLeft; //Until the power is cut, NO_CUT for never
+static jmp_buf powerCut;
+static int cutErasing; //The cut came during an erase
+static unsigned int seed;
+
+static unsigned int nextRandom(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
+
+/* Name: modelCut
+   Return value:
+    int - 1 if the power goes with this operation
+*/
+static int modelCut(void) {
+  if (operationsLeft == NO_CUT) {
+    return 0;
+  }
+  return operationsLeft-- == 0;
+}
+
+static int modelInside(unsigned int address, unsigned int length) {
+  return address >= MODEL_BASE && address + length <= MODEL_BASE + MODEL_BYTES;
+}
+
+/* The firmware's flash.h, on the model */
+
+char flashEraseSegment(unsigned int address) {
+  unsigned int segment;
+  unsigned int n;
+
+  if (!modelInside(address, 1)) {
+    return 0;
+  }
+  segment = (address - MODEL_BASE) / FLASH_INFO_SEGMENT_BYTES;
+  erases[segment]++;
+  if (modelCut()) { //Bits part way to 1
+    cutErasing = 1;
+    for (n = 0; n < FLASH_INFO_SEGMENT_BYTES; n++) {
+      flash[segment * FLASH_INFO_SEGMENT_BYTES + n] |= (unsigned char)nextRandom();
+    }
+    longjmp(powerCut, 1);
+  }
+  memset(flash + segment * FLASH_INFO_SEGMENT_BYTES, 0xFF, FLASH_INFO_SEGMENT_BYTES);
+  return 1;
+}
+
+void flashRead(unsigned int address, unsigned char* data, unsigned int length) {
+  if (modelInside(address, length)) {
+    memcpy(data, flash + address - MODEL_BASE, length);
+  } else {
+    memset(data, 0xFF, length);
+  }
+}
+
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length) {
+  unsigned int n;
+
+  if (!modelInside(address, length)) {
+    return 0;
+  }
+  for (n = 0; n < length; n++) {
+    unsigned char* cell = &flash[address - MODEL_BASE + n];
+
+    programmed++;
+    if (modelCut()) { //Some of the bits cleared
+      *cell &= data[n] | (unsigned char)nextRandom();
+      longjmp(powerCut, 1);
+    }
+    *cell &= data[n];
+  }
+  return memcmp(flash + address - MODEL_BASE, data, length) == 0;
+}
+
+/* Name: modelReset
+   Description:
+    A blank information memory.
+*/
+static void modelReset(void) {
+  memset(flash, 0xFF, sizeof(flash));
+  memset(erases, 0, sizeof(erases));
+  programmed = 0;
+  operationsLeft = NO_CUT;
+}
+
+static unsigned int randomValue(unsigned char key) {
+  return key * 100 + nextRandom() % VALUES_PER_KEY;
+}
+
+/* Name: checkKeys
+   Return value:
+    int - keys that do not read as expected (any of two values for key changing, which may be CONFIG_KEYS for none)
+*/
+static int checkKeys(const unsigned int* expected, const char* set, unsigned char changing, unsigned int newValue) {
+  int bad = 0;
+  unsigned char key;
+
+  for (key = 0; key < CONFIG_KEYS; key++) {
+    unsigned int value = configGet(key, 0xFFFF);
+    unsigned int old = set[key] ? expected[key] : 0xFFFF;
+
+    if (value != old && !(key == changing && value == newValue)) {
+      bad++;
+    }
+  }
+  return bad;
+}
+
+static int commandWear(long updates, unsigned int initialSeed) {
+  unsigned int expected[CONFIG_KEYS];
+  char set[CONFIG_KEYS];
+  unsigned long changes = 0;
+  unsigned long boots = 1;
+  unsigned long skipped = 0;
+  long bad = 0;
+  long failed = 0;
+  long n;
+
+  seed = initialSeed;
+  modelReset();
+  memset(set, 0, sizeof(set));
+  configInit();
+  for (n = 0; n < updates; n++) {
+    unsigned char key = nextRandom() % CONFIG_KEYS;
+    unsigned int value = randomValue(key);
+
+    if (!set[key] || expected[key] != value) {
+      changes++;
+    }
+    if (!configSet(key, value)) {
+      failed++;
+      continue;
+    }
+    expected[key] = value;
+    set[key] = 1;
+    if (nextRandom() % RESET_EVERY == 0) {
+      configInit();
+      boots++;
+      skipped += configGetStats() -> skipped;
+      bad += checkKeys(expected, set, CONFIG_KEYS, 0);
+    }
+  }
+  configInit();
+  bad += checkKeys(expected, set, CONFIG_KEYS, 0);
+
+  printf("%ld updates (%lu changing a value), %lu boots, %lu bytes programmed\n", updates, changes, boots, programmed);
+  printf("erases: segment D %lu, segment C %lu, segment B %lu\n", erases[0], erases[1], erases[2]);
+  if (erases[0] + erases[1]) {
+    printf("%.1f updates per erase, %.1f changes per erase; a segment rewritten per change: 1 change per erase\n",
+           (double)updates / (erases[0] + erases[1]), (double)changes / (erases[0] + erases[1]));
+  }
+  printf("generation %u, %u records in use\n", configGetStats() -> generation, configGetStats() -> records);
+  printf("failed updates %ld, records skipped at boot %lu, keys wrong after a boot %ld\n", failed, skipped, bad);
+  return (bad || failed || skipped || erases[2]) ? 1 : 0;
+}
+
+/* Name: cutUpdate
+   Return value:
+    int - 0 if the update ran to the end, 1 if the power was cut in it, 2 if during an erase
+*/
+static int cutUpdate(unsigned char key, unsigned int value, long operations) {
+  cutErasing = 0;
+  operationsLeft = operations;
+  if (setjmp(powerCut)) {
+    operationsLeft = NO_CUT;
+    return cutErasing ? 2 : 1;
+  }
+  configSet(key, value);
+  operationsLeft = NO_CUT;
+  return 0;
+}
+
+static int commandTear(long trials, unsigned int initialSeed) {
+  unsigned int expected[CONFIG_KEYS];
+  char set[CONFIG_KEYS];
+  unsigned long cutInErase = 0;
+  unsigned long tookOld = 0;
+  unsigned long tookNew = 0;
+  unsigned long skipped = 0;
+  long bad = 0;
+  long trial;
+
+  seed = initialSeed;
+  for (trial = 0; trial < trials; trial++) {
+    unsigned char key;
+    unsigned int value;
+    int fill = nextRandom() % TEAR_FILL_MAX;
+    int n;
+
+    modelReset();
+    memset(set, 0, sizeof(set));
+    configInit();
+    for (n = 0; n < fill; n++) {
+      key = nextRandom() % CONFIG_KEYS;
+      value = randomValue(key);
+      configSet(key, value);
+      expected[key] = value;
+      set[key] = 1;
+    }
+
+    key = nextRandom() % CONFIG_KEYS;
+    value = randomValue(key);
+    if (cutUpdate(key, value, nextRandom() % (2 * CONFIG_SEGMENT_BYTES)) == 2) { //Sometimes past the end: no cut
+      cutInErase++;
+    }
+
+    configInit();
+    skipped += configGetStats() -> skipped;
+    if (checkKeys(expected, set, key, value)) {
+      bad++;
+      continue;
+    }
+    if (configGet(key, 0xFFFF) == value) {
+      tookNew++;
+    } else {
+      tookOld++;
+    }
+    expected[key] = configGet(key, 0xFFFF);
+    set[key] = expected[key] != 0xFFFF;
+
+    for (n = 0; n < TEAR_AFTER; n++) {
+      key = nextRandom() % CONFIG_KEYS;
+      value = randomValue(key);
+      if (!configSet(key, value)) {
+        bad++;
+        break;
+      }
+      expected[key] = value;
+      set[key] = 1;
+    }
+    configInit();
+    if (checkKeys(expected, set, CONFIG_KEYS, 0)) {
+      bad++;
+    }
+  }
+
+  printf("%ld trials: update kept %lu, update lost %lu, cut during an erase %lu, torn records skipped %lu\n", trials,
+         tookNew, tookOld, cutInErase, skipped);
+  printf("trials with a key read wrong or a later update refused: %ld\n", bad);
+  return bad ? 1 : 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: configsim wear [updates] [seed]\n"
+                  "       configsim tear [trials] [seed]\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "wear")) {
+    return commandWear(argc >= 3 ? atol(argv[2]) : 100000, argc >= 4 ? (unsigned int)atoi(argv[3]) : 1);
+  }
+  if (argc >= 2 && !strcmp(argv[1], "tear")) {
+    return commandTear(argc >= 3 ? atol(argv[2]) : 300000, argc >= 4 ? (unsigned int)atoi(argv[3]) : 1);
+  }
+  usage();
+  return 2;
+}
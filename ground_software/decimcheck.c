@@ -0,0 +1,231 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool for the firmware's decimation filter (main_software/inc/decim.h):
+
+      decimcheck design <ratio>   taps for that ratio as C source, to paste into decimCoefficients in decim.c
+      decimcheck check            checks the taps and the filter code of decim.c built with DECIM_RATIO (default in
+                                  decim.h): frequency response, aliasing, and decim.c itself run on test tones
+
+    The taps are a Hamming windowed sinc cut off at DECIMCHECK_CUTOFF of the output rate, in Q15 and adjusted to sum to exactly 32768.
+    The check prints the response against frequency in units of the output rate, then fails (exit code 1) if
+      - the gain at DC is not exactly one
+      - the passband (up to DECIMCHECK_PASS of the output rate) droops more than DECIMCHECK_MAX_DROOP_DB
+      - anything that folds into the passband is attenuated less than DECIMCHECK_MIN_ALIAS_DB
+      - decim.c's output for a test tone differs from the response by more than DECIMCHECK_TOLERANCE_DB (or one count
+        RMS, for tones that are filtered out)
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o decimcheck decimcheck.c ../main_software/decim.c -lm
+    (add -DDECIM_RATIO=n to check another ratio)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "decim.h"
+
+/* CONSTANTS */
+#define DECIMCHECK_CUTOFF         0.45 //Of the output rate: a little under half trades droop for alias rejection
+#define DECIMCHECK_PASS           0.2 //Passband edge, fraction of the output rate
+#define DECIMCHECK_MAX_DROOP_DB   1.0
+#define DECIMCHECK_MIN_ALIAS_DB   25.0 //Ratio 2 has the fewest taps and reaches about 27 dB
+#define DECIMCHECK_TOLERANCE_DB   0.2
+#define DECIMCHECK_STEPS          200 //Frequencies per output rate in the response scan
+#define DECIMCHECK_AMPLITUDE      16000.0 //Test tone, counts
+#define DECIMCHECK_OUTPUTS        4000 //Outputs per test tone, after settling
+
+/* Name: gainAt
+   Parameters:
+    const double* taps - filter taps, unity gain at DC
+    int count - number of taps
+    double f - frequency in cycles per input sample
+   Return value:
+    double - magnitude of the response at f
+*/
+static double gainAt(const double* taps, int count, double f) {
+  double re = 0;
+  double im = 0;
+  int k;
+
+  for (k = 0; k < count; k++) {
+    re += taps[k] * cos(2 * M_PI * f * k);
+    im -= taps[k] * sin(2 * M_PI * f * k);
+  }
+  return sqrt(re * re + im * im);
+}
+
+static double toDb(double gain) {
+  return 20 * log10(gain > 1e-12 ? gain : 1e-12);
+}
+
+static int commandDesign(int ratio) {
+  int count = ratio * DECIM_PHASE_TAPS;
+  double* ideal = malloc(count * sizeof(double));
+  int* q15 = malloc(count * sizeof(int));
+  double centre = (count - 1) / 2.0;
+  double cutoff = DECIMCHECK_CUTOFF / ratio; //Cycles per input sample
+  double sum = 0;
+  int total = 0;
+  int k;
+
+  if (ratio < 2 || !ideal || !q15) {
+    fprintf(stderr, "ratio must be 2 or more (1 needs no taps)\n");
+    return 2;
+  }
+  for (k = 0; k < count; k++) {
+    double t = k - centre;
+    double sinc = t == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+
+    ideal[k] = sinc * (0.54 - 0.46 * cos(2 * M_PI * k / (count - 1)));
+    sum += ideal[k];
+  }
+  for (k = 0; k < count; k++) {
+    q15[k] = (int)lround(ideal[k] / sum * 32768);
+    total += q15[k];
+  }
+  if (count % 2) { //Rounding error on the middle taps, so they stay symmetric to within one count
+    q15[count / 2] += 32768 - total;
+  } else {
+    q15[count / 2 - 1] += (32768 - total) / 2;
+    q15[count / 2] += (32768 - total) - (32768 - total) / 2;
+  }
+
+  printf("#elif DECIM_RATIO == %d\nconst int decimCoefficients[DECIM_TAPS] = {", ratio);
+  for (k = 0; k < count; k++) {
+    printf("%s%d", k ? (k % 10 ? ", " : ",\n                                            ") : "", q15[k]);
+  }
+  printf("};\n");
+  free(ideal);
+  free(q15);
+  return 0;
+}
+
+/* Name: runTone
+   Return value:
+    double - RMS of decim.c's output for a tone at f (cycles per input sample), x axis
+   Description:
+    The y and z axes get the same tone shifted in phase, so all three sums are exercised.
+*/
+static double runTone(double f) {
+  Decimator decimator;
+  int in[DECIM_AXES];
+  int out[DECIM_AXES];
+  double squares = 0;
+  long outputs = 0;
+  long n;
+  int axis;
+
+  decimInit(&decimator);
+  for (n = 0; outputs < DECIMCHECK_OUTPUTS + DECIM_PHASE_TAPS; n++) {
+    for (axis = 0; axis < DECIM_AXES; axis++) {
+      in[axis] = (int)lround(DECIMCHECK_AMPLITUDE * sin(2 * M_PI * f * n + axis));
+    }
+    if (decimPush(&decimator, in, out)) {
+      if (++outputs > DECIM_PHASE_TAPS) { //Settled
+        squares += (double)out[0] * out[0];
+      }
+    }
+  }
+  return sqrt(squares / DECIMCHECK_OUTPUTS);
+}
+
+static int commandCheck(void) {
+  static const double tones[] = {0.0371, 0.113, 0.19, 0.31, 0.47, 0.83, 1.17, 1.9, 2.13, 3.89};
+  double taps[DECIM_TAPS];
+  double worstDroop = 0;
+  double worstAlias = -1000;
+  double worstAliasAt = 0;
+  long sum = 0;
+  int failed = 0;
+  int step;
+  int k;
+
+  if (DECIM_RATIO == 1) {
+    printf("ratio 1 passes samples straight through, nothing to check\n");
+    return 0;
+  }
+  for (k = 0; k < DECIM_TAPS; k++) {
+    taps[k] = decimCoefficients[k] / 32768.0;
+    sum += decimCoefficients[k];
+  }
+  printf("ratio %d, %d taps, %d per phase, taps sum to %ld\n", DECIM_RATIO, DECIM_TAPS, DECIM_PHASE_TAPS, sum);
+  if (sum != 32768) {
+    printf("FAIL: gain at DC is not one\n");
+    failed = 1;
+  }
+
+  printf("\n%10s %10s  %s\n", "f/f_out", "gain dB", "");
+  for (step = 0; step <= DECIMCHECK_STEPS * DECIM_RATIO / 2; step++) {
+    double f = (double)step / DECIMCHECK_STEPS; //Output rates
+    double db = toDb(gainAt(taps, DECIM_TAPS, f / DECIM_RATIO));
+    double folded = fmod(f, 1.0); //Where it lands after decimation
+    const char* note = "";
+
+    if (folded > 0.5) {
+      folded = 1 - folded;
+    }
+    if (f <= DECIMCHECK_PASS) {
+      note = "pass";
+      if (-db > worstDroop) {
+        worstDroop = -db;
+      }
+    } else if (f >= 1 - DECIMCHECK_PASS && folded <= DECIMCHECK_PASS) {
+      note = "folds into pass";
+      if (db > worstAlias) {
+        worstAlias = db;
+        worstAliasAt = f;
+      }
+    }
+    if (step % (DECIMCHECK_STEPS / 20) == 0) {
+      printf("%10.2f %10.2f  %s\n", f, db, note);
+    }
+  }
+
+  printf("\npassband droop %.2f dB (limit %.2f)\n", worstDroop, DECIMCHECK_MAX_DROOP_DB);
+  if (worstDroop > DECIMCHECK_MAX_DROOP_DB) {
+    printf("FAIL: passband droop\n");
+    failed = 1;
+  }
+  printf("alias rejection %.1f dB at %.2f f_out (limit %.1f)\n", -worstAlias, worstAliasAt, DECIMCHECK_MIN_ALIAS_DB);
+  if (-worstAlias < DECIMCHECK_MIN_ALIAS_DB) {
+    printf("FAIL: alias rejection\n");
+    failed = 1;
+  }
+
+  printf("\n%10s %10s %10s %10s\n", "tone f_out", "expect dB", "decim dB", "");
+  for (k = 0; k < (int)(sizeof(tones) / sizeof(tones[0])); k++) {
+    double f = tones[k];
+    double expected = DECIMCHECK_AMPLITUDE / sqrt(2) * gainAt(taps, DECIM_TAPS, f / DECIM_RATIO);
+    double measured;
+    int bad;
+
+    if (f >= DECIM_RATIO / 2.0) {
+      continue;
+    }
+    measured = runTone(f / DECIM_RATIO);
+    bad = fabs(measured - expected) > 1 && fabs(toDb(measured / expected)) > DECIMCHECK_TOLERANCE_DB;
+    printf("%10.4f %10.2f %10.2f %10s\n", f, toDb(expected / DECIMCHECK_AMPLITUDE * sqrt(2)),
+           toDb(measured / DECIMCHECK_AMPLITUDE * sqrt(2)), bad ? "FAIL" : "ok");
+    failed |= bad;
+  }
+  printf("\n%s\n", failed ? "FAILED" : "passed");
+  return failed;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: decimcheck design <ratio>\n"
+                  "       decimcheck check\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "design")) {
+    return commandDesign(atoi(argv[2]));
+  }
+  if (argc >= 2 && !strcmp(argv[1], "check")) {
+    return commandCheck();
+  }
+  usage();
+  return 2;
+}
@@ -0,0 +1,263 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's antenna deployment (main_software/antenna.c) beside its IMU acquisition
+    (sampler.c and drdy.c) on the host, to get the jitter of the IMU sample period while the burn wires are on:
+
+      deploysim [-b burn seconds per antenna] [-d IMU clock drift ppm]
+
+    The modules and the I2C driver run against host/msp430.h: the ISIS antenna controller of host/isis.c answers on
+    the PRIMARY interface, the MPU-9250 and AK8963 of host/imu.c on the SECONDARY one, so the two share the CPU and its
+    interrupts as on the board.  The controller brings the antennas out one after the other once armed and deploying,
+    each the burn time after the one before it: the seconds sent with the deploy command, or -b.
+
+    The tool schedules the two as tasks.c does: at each tick samplerStep() and the ring drained with drdyNext(), as
+    task_getIMUData, then antennaStep() once its delay is over, as task_deployAntenna, run again after a pass (PASS_US)
+    while it returns 0 with a transfer in flight.  The antenna starts QUIET_SECONDS in, and the run goes on
+    QUIET_SECONDS after the sequence ends.  Between them the model's time runs on, with the interrupt routines taken as
+    they come due.
+
+    The period of the samples is taken between the INT edge times (DrdySample.edgeUs) of samples in a row, and its mean,
+    spread and extremes printed for before, during and after the deployment; drdyReport() follows.  The antenna's
+    transfers are on the other bus, so what they do to the period is the edge waiting behind a PRIMARY interrupt
+    routine: the model takes a bit time at each register access, up to 80 us a routine at 100 kHz.  It fails (exit code
+    1) if the antennas did not deploy, if a sample was missed, overrun or failed, or if a period during deployment is
+    further than JITTER_LIMIT_US from the mean of the periods before it.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o deploysim deploysim.c host/msp430.c host/imu.c \
+        host/isis.c ../main_software/antenna.c ../main_software/drdy.c ../main_software/sampler.c \
+        ../main_software/i2c_driver.c ../main_software/clock.c -lm
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "imu.h"
+#include "isis.h"
+#include "os.h"
+#include "tasks.h"
+#include "clock.h"
+#include "antenna.h"
+#include "sampler.h"
+#include "drdy.h"
+#include "arena.h"
+#include "config.h"
+#include "watchdog.h"
+#include "i2c_driver.h"
+#include "i2c_peripherals.h"
+
+/* CONSTANTS */
+#define TICK_US               (1000000UL / OS_TICK_HZ)
+#define PASS_US               100 //Round the other tasks between two runs of a yielding task
+#define QUIET_SECONDS         5
+#define DRIFT_PPM             1000 //As drdysim, so the edges come at every point of the tick
+#define JITTER_LIMIT_US       100 //One antenna interrupt routine, under a byte at ANTENNA_I2C_MAX_HZ here, and a count
+
+enum Phase_e {PHASE_BEFORE = 0,
+              PHASE_DEPLOYING,
+              PHASE_AFTER,
+              PHASES};
+
+static const char* const phaseName[PHASES] = {"before", "deploying", "after"};
+
+/* Name: Period_s
+   Type: struct
+   Parameters:
+    unsigned long count - periods taken
+    double sum - of them, microseconds
+    double squares - of their squares
+    unsigned long min
+    unsigned long max
+*/
+struct Period_s {
+  unsigned long count;
+  double sum;
+  double squares;
+  unsigned long min;
+  unsigned long max;
+};
+typedef struct Period_s Period;
+
+static Period period[PHASES];
+
+/* The buses, for host/msp430.c */
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  return usci == SECONDARY ? hostImuAddress(address, read) : hostIsisAddress(address, read);
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  return usci == SECONDARY ? hostImuWrite(data) : hostIsisWrite(data);
+}
+
+unsigned char hostI2cRead(int usci) {
+  return usci == SECONDARY ? hostImuRead() : hostIsisRead();
+}
+
+void hostI2cStop(int usci) {
+  if (usci == SECONDARY) {
+    hostImuStop();
+  } else {
+    hostIsisStop();
+  }
+}
+
+/* The rest of the firmware the modules link against */
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return calloc(1, size);
+}
+
+unsigned int configGet(ConfigKey key, unsigned int fallback) {
+  return fallback;
+}
+
+const WatchdogKept* watchdogGetKept(void) {
+  return 0;
+}
+
+void OSTimer(void) {
+}
+
+void radioSetSourceClock(unsigned long smclkHz) {
+}
+
+void radioServiceTx(void) {
+}
+
+void radioServiceRx(void) {
+}
+
+/* The run */
+
+/* Name: take
+   Parameters:
+    unsigned long us - period between two samples in a row
+    int phase - Phase_e it was taken in
+*/
+static void take(unsigned long us, int phase) {
+  Period* p = &period[phase];
+
+  if (!p->count || us < p->min) {
+    p->min = us;
+  }
+  if (!p->count || us > p->max) {
+    p->max = us;
+  }
+  p->count++;
+  p->sum += us;
+  p->squares += (double)us * us;
+}
+
+static double mean(const Period* p) {
+  return p->count ? p->sum / p->count : 0;
+}
+
+int main(int argc, char** argv) {
+  const AntennaHealth* health = antennaGetHealth();
+  const DrdyStats* stats = drdyGetStats();
+  const DrdySample* sample;
+  const HostIsisStats* isis = hostIsisGetStats();
+  long drift = DRIFT_PPM;
+  long burnOverride = -1;
+  unsigned long lastTick = (unsigned long)-1;
+  unsigned long antennaDue = QUIET_SECONDS * OS_TICK_HZ;
+  unsigned long lastEdge = 0;
+  unsigned long long endNs = 0;
+  unsigned long long deployNs = 0;
+  char started = 0;
+  char haveEdge = 0;
+  double quiet;
+  int failures = 0;
+  int n;
+
+  for (n = 1; n < argc; n++) {
+    if (n + 1 < argc && !strcmp(argv[n], "-b")) {
+      burnOverride = strtol(argv[++n], NULL, 0);
+    } else if (n + 1 < argc && !strcmp(argv[n], "-d")) {
+      drift = strtol(argv[++n], NULL, 0);
+    } else {
+      fprintf(stderr, "usage: deploysim [-b burn seconds per antenna] [-d IMU clock drift ppm]\n");
+      return 2;
+    }
+  }
+
+  hostImuPowerOn(drift);
+  hostIsisPowerOn(burnOverride);
+  InitializeClock(1);
+  __enable_interrupt();
+  if (!samplerInit()) {
+    printf("FAIL: samplerInit()\nFAILED\n");
+    return 1;
+  }
+  while (!endNs || hostGetNanoseconds() < endNs) {
+    unsigned long tick = clockGetTicks();
+    int phase = !started ? PHASE_BEFORE : endNs ? PHASE_AFTER : PHASE_DEPLOYING;
+
+    if (tick != lastTick) { //task_getIMUData
+      lastTick = tick;
+      samplerStep();
+      while ((sample = drdyNext())) {
+        if (haveEdge) {
+          take(sample->edgeUs - lastEdge, phase);
+        }
+        lastEdge = sample->edgeUs;
+        haveEdge = 1;
+        drdyRelease();
+      }
+    }
+    if (!endNs && tick >= antennaDue) { //task_deployAntenna
+      unsigned char delay;
+
+      if (!started) {
+        antennaInit();
+        started = 1;
+        deployNs = hostGetNanoseconds();
+      }
+      delay = antennaStep();
+      if (health->state == ANT_DEPLOYED || health->state == ANT_FAILED) {
+        endNs = hostGetNanoseconds() + QUIET_SECONDS * 1000000000ULL;
+      } else if (!delay) {
+        hostElapse(PASS_US);
+        continue;
+      }
+      antennaDue = tick + delay;
+    }
+    hostElapse(TICK_US - clockGetMicroseconds() % TICK_US);
+  }
+
+  printf("Antennas %s in %.1f s (%lu s burns), %lu attempts, %u faults; IMU at %u Hz, %ld ppm fast\n",
+         health->state == ANT_DEPLOYED ? "deployed" : "FAILED", (endNs - deployNs) / 1e9 - QUIET_SECONDS,
+         isis->burnSeconds, (unsigned long)health->attempts, (unsigned int)health->faults, SAMPLER_IMU_HZ, drift);
+  printf("\nPhase        Periods   mean us  stddev us  min us  max us\n");
+  for (n = 0; n < PHASES; n++) {
+    const Period* p = &period[n];
+    double m = mean(p);
+    double variance = p->count ? p->squares / p->count - m * m : 0;
+
+    printf("%-10s %9lu %9.2f %10.2f %7lu %7lu\n", phaseName[n], p->count, m, sqrt(variance > 0 ? variance : 0),
+           p->min, p->max);
+  }
+  printf("\n");
+  drdyReport();
+
+  quiet = mean(&period[PHASE_BEFORE]);
+  if (health->state != ANT_DEPLOYED) {
+    printf("FAIL: antennas not deployed\n");
+    failures++;
+  }
+  if (stats->missed || stats->overruns || stats->errors) {
+    printf("FAIL: samples missed, overrun or failed\n");
+    failures++;
+  }
+  if (!period[PHASE_DEPLOYING].count || period[PHASE_DEPLOYING].min + JITTER_LIMIT_US < quiet ||
+      period[PHASE_DEPLOYING].max > quiet + JITTER_LIMIT_US) {
+    printf("FAIL: sample period during deployment more than %d us off %.2f us\n", JITTER_LIMIT_US, quiet);
+    failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
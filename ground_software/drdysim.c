@@ -0,0 +1,145 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's interrupt-driven IMU acquisition (main_software/drdy.c) on the host, to get its
+    sample-to-ring latency distribution with the bus time in it:
+
+      drdysim [-s simulated seconds] [-d IMU clock drift ppm]
+
+    drdy.c, sampler.c, i2c_driver.c and clock.c run against host/msp430.h, with the MPU-9250 and AK8963 of host/imu.c
+    on the SECONDARY interface.  The MPU-9250 pulses its INT line at SAMPLER_IMU_HZ on its own clock, DRIFT_PPM fast
+    unless -d says otherwise, so its edges come at every point of the tick in turn.  The Port 2 routine calls
+    drdyEdge() at the edge, whatever the firmware is doing, and the burst read goes over the modelled bus at the rate
+    samplerInit() sets; an edge during a magnetometer poll waits for it.  The tool does what task_getIMUData does with
+    the samples: samplerStep() every TASK_IMU_PERIOD_TICKS, which polls the magnetometer on the same bus, then
+    drdyNext() and drdyRelease() until the ring is empty.  Between them the model's time runs to the next tick, with
+    the Timer A, Port 2 and USCI routines taken as they come due.
+
+    It prints drdyReport(), the latency histogram among it.  It fails (exit code 1) if a sample was missed, overrun or
+    failed, if a pulse did not come out as a sample, or if a latency is shorter than the burst read takes on the bus.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o drdysim drdysim.c host/msp430.c host/imu.c \
+        ../main_software/drdy.c ../main_software/sampler.c ../main_software/i2c_driver.c ../main_software/clock.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "imu.h"
+#include "os.h"
+#include "tasks.h"
+#include "clock.h"
+#include "sampler.h"
+#include "drdy.h"
+#include "arena.h"
+#include "config.h"
+#include "i2c_driver.h"
+
+/* CONSTANTS */
+#define TICK_US               (1000000UL / OS_TICK_HZ)
+#define RUN_SECONDS           60
+#define DRIFT_PPM             1000 //An edge 5 us later each period, all the way round a tick in 10 s
+#define BURST_BITS            ((4 + DRDY_READ_LEN) * 9) //Address, register, address again, the data, each acknowledged
+
+/* The bus, for host/msp430.c */
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  return usci == SECONDARY ? hostImuAddress(address, read) : 0;
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  return usci == SECONDARY ? hostImuWrite(data) : 0;
+}
+
+unsigned char hostI2cRead(int usci) {
+  return usci == SECONDARY ? hostImuRead() : 0xFF;
+}
+
+void hostI2cStop(int usci) {
+  if (usci == SECONDARY) {
+    hostImuStop();
+  }
+}
+
+/* The rest of the firmware the modules link against */
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return calloc(1, size);
+}
+
+unsigned int configGet(ConfigKey key, unsigned int fallback) {
+  return fallback;
+}
+
+void OSTimer(void) {
+}
+
+void radioSetSourceClock(unsigned long smclkHz) {
+}
+
+void radioServiceTx(void) {
+}
+
+void radioServiceRx(void) {
+}
+
+int main(int argc, char** argv) {
+  unsigned long seconds = RUN_SECONDS;
+  long drift = DRIFT_PPM;
+  unsigned long taken = 0;
+  unsigned long minUs = BURST_BITS * 1000000UL / IMU_I2C_MAX_HZ;
+  const DrdyStats* stats = drdyGetStats();
+  const HostImuStats* imu = hostImuGetStats();
+  int failures = 0;
+  int n;
+
+  for (n = 1; n < argc; n++) {
+    if (n + 1 < argc && !strcmp(argv[n], "-s")) {
+      seconds = strtoul(argv[++n], NULL, 0);
+    } else if (n + 1 < argc && !strcmp(argv[n], "-d")) {
+      drift = strtol(argv[++n], NULL, 0);
+    } else {
+      fprintf(stderr, "usage: drdysim [-s simulated seconds] [-d IMU clock drift ppm]\n");
+      return 2;
+    }
+  }
+
+  hostImuPowerOn(drift);
+  InitializeClock(1);
+  __enable_interrupt();
+  if (!samplerInit()) {
+    printf("FAIL: samplerInit()\nFAILED\n");
+    return 1;
+  }
+  while (hostGetNanoseconds() < seconds * 1000000000ULL) {
+    samplerStep();
+    while (drdyNext()) {
+      drdyRelease();
+      taken++;
+    }
+    hostElapse(TASK_IMU_PERIOD_TICKS * TICK_US - clockGetMicroseconds() % TICK_US);
+  }
+
+  printf("%lu s at %u Hz, bus at %lu Hz: %lu INT pulses, %lu burst reads, %lu samples taken\n", seconds,
+         SAMPLER_IMU_HZ, hostSmclkHz() / hostUsciDivider(SECONDARY), imu->pulses, imu->bursts, taken);
+  drdyReport();
+
+  if (stats->missed || stats->overruns || stats->errors) {
+    printf("FAIL: samples missed, overrun or failed\n");
+    failures++;
+  }
+  if (stats->edges != imu->pulses || stats->samples + 1 < stats->edges) {
+    printf("FAIL: %lu pulses gave %lu edges and %lu samples\n", imu->pulses, stats->edges, stats->samples);
+    failures++;
+  }
+  for (n = 0; n < DRDY_LATENCY_BUCKETS - 1 && (n + 1) * DRDY_LATENCY_BUCKET_US <= minUs; n++) {
+    if (stats->latency[n]) {
+      printf("FAIL: latency under %d us, the burst read alone takes %lu us\n", (n + 1) * DRDY_LATENCY_BUCKET_US, minUs);
+      failures++;
+    }
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
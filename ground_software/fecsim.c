@@ -0,0 +1,500 @@
+/* Author: John Walnut
+   Purpose:
+    Ground decoder for coded downlink frames (main_software/inc/fec.h), and a model of what the coding buys:
+
+      fecsim decode <in> <out>                          coded frames from a recorded radio stream, as telemetry frames
+      fecsim [-n frames] [-b baud] [-s seed] [ber ...]  goodput with and without coding at simulated bit error rates
+
+    The decoder looks for the sync allowing FEC_SYNC_ERRORS bit errors, takes the payload length from its Hamming code,
+    corrects the frame with the Reed-Solomon parity (Berlekamp-Massey, Chien search, Forney) and keeps it if the
+    frame's own CRC then checks.  decode writes what it kept as plain telemetry frames (telemetry.h), so the other
+    ground tools can read them.
+
+    The model makes a stream of telemetry frames with the firmware's queue (telemetry.c) in the flight mix of sizes
+    (health, IMU, snapshot, bulk chunk), once as they are and once through the firmware's encoder (fec.c), and flips
+    bits of each at random with the given probability (default 0, 1e-5, 1e-4, 3e-4, 1e-3, 3e-3 and 1e-2).  Plain frames
+    are received the way the ground does without coding: exact sync, length, CRC.  It reports the share of frames
+    delivered and the goodput (payload bytes delivered per second of link time at the given baud) of each, then the
+    encoder's host time per byte (for comparing changes; the MSP430 cycles are in benchmark.c).  Goodput counts frames
+    as they arrive: with a protocol that sends lost frames again (bulk.h) it is the most that gets through.  Frames
+    that pass every check and still are not the frame sent are counted ("wrong"): at the highest rates the CRC-16 lets
+    through about one damaged frame in 65536 it checks, with or without coding.  It fails (exit code 1) if a clean
+    stream loses a frame or delivers a wrong one.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o fecsim fecsim.c ../main_software/fec.c ../main_software/telemetry.c \
+        ../main_software/log_format.c -lm
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "fec.h"
+#include "telemetry.h"
+#include "log_format.h"
+
+/* CONSTANTS */
+#define FEC_SYNC_ERRORS       2 //Of the 16 sync bits
+#define STREAM_FRAMES_MAX     200000
+#define ENCODE_REPEATS        200
+
+/* Name: Decoded_s
+   Type: struct
+   Purpose:
+    Counters of one run of the decoder.
+*/
+struct Decoded_s {
+  unsigned long frames; //Kept
+  unsigned long corrected; //Bytes put right
+  unsigned long failed; //Syncs found that did not decode
+};
+typedef struct Decoded_s Decoded;
+
+static TelemetryPacket pool[TELEMETRY_SLOTS];
+static unsigned long long randomState;
+
+static unsigned long long nextRandom(void) { //xorshift64*
+  randomState ^= randomState >> 12;
+  randomState ^= randomState << 25;
+  randomState ^= randomState >> 27;
+  return randomState * 2685821657736338717ULL;
+}
+
+static double nextUniform(void) {
+  return ((nextRandom() >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static unsigned char gfMul(unsigned char a, unsigned char b) {
+  return a && b ? fecExp[fecLog[a] + fecLog[b]] : 0;
+}
+
+static unsigned char gfDiv(unsigned char a, unsigned char b) {
+  return a ? fecExp[fecLog[a] + 255 - fecLog[b]] : 0;
+}
+
+static unsigned char gfPow(int n) { //alpha^n, any n
+  n %= 255;
+  return fecExp[n < 0 ? n + 255 : n];
+}
+
+static int bitCount(unsigned int value) {
+  int count = 0;
+
+  for (; value; value &= value - 1) {
+    count++;
+  }
+  return count;
+}
+
+/* Name: hammingDecode
+   Return value:
+    int - the nibble whose codeword is within one bit of the byte, -1 if none is
+*/
+static int hammingDecode(unsigned char byte) {
+  int n;
+
+  for (n = 0; n < 16; n++) {
+    if (bitCount(byte ^ fecHamming[n]) <= 1) {
+      return n;
+    }
+  }
+  return -1;
+}
+
+/* Name: rsDecode
+   Parameters:
+    unsigned char* code - codeword of length bytes, corrected in place
+   Return value:
+    int - bytes corrected, -1 if there are more errors than the parity can correct (as far as it can tell)
+*/
+static int rsDecode(unsigned char* code, int length) {
+  unsigned char syndromes[FEC_PARITY];
+  unsigned char lambda[FEC_PARITY + 1];
+  unsigned char previous[FEC_PARITY + 1];
+  unsigned char temp[FEC_PARITY + 1];
+  unsigned char omega[FEC_PARITY];
+  unsigned char lastDiscrepancy = 1;
+  unsigned char discrepancy;
+  int degree = 0;
+  int shift = 1;
+  int errors = 0;
+  char any = 0;
+  int i;
+  int j;
+
+  for (j = 0; j < FEC_PARITY; j++) { //code(alpha^j)
+    unsigned char root = gfPow(j);
+
+    syndromes[j] = 0;
+    for (i = 0; i < length; i++) {
+      syndromes[j] = gfMul(syndromes[j], root) ^ code[i];
+    }
+    any |= syndromes[j] != 0;
+  }
+  if (!any) {
+    return 0;
+  }
+
+  memset(lambda, 0, sizeof(lambda));
+  memset(previous, 0, sizeof(previous));
+  lambda[0] = previous[0] = 1;
+  for (j = 0; j < FEC_PARITY; j++) { //Berlekamp-Massey: the shortest error locator giving these syndromes
+    discrepancy = syndromes[j];
+    for (i = 1; i <= degree; i++) {
+      discrepancy ^= gfMul(lambda[i], syndromes[j - i]);
+    }
+    if (!discrepancy) {
+      shift++;
+      continue;
+    }
+    memcpy(temp, lambda, sizeof(lambda));
+    for (i = 0; i + shift <= FEC_PARITY; i++) {
+      lambda[i + shift] ^= gfMul(gfDiv(discrepancy, lastDiscrepancy), previous[i]);
+    }
+    if (2 * degree <= j) {
+      degree = j + 1 - degree;
+      memcpy(previous, temp, sizeof(previous));
+      lastDiscrepancy = discrepancy;
+      shift = 1;
+    } else {
+      shift++;
+    }
+  }
+  if (degree > FEC_PARITY / 2) {
+    return -1;
+  }
+
+  for (i = 0; i < FEC_PARITY; i++) { //Error evaluator, syndromes times locator, mod x^FEC_PARITY
+    omega[i] = 0;
+    for (j = 0; j <= i && j <= degree; j++) {
+      omega[i] ^= gfMul(lambda[j], syndromes[i - j]);
+    }
+  }
+
+  for (i = 0; i < length; i++) { //Chien search: is byte i, at x^(length - 1 - i), in error?
+    unsigned char inverse = gfPow(-(length - 1 - i));
+    unsigned char value = 0;
+    unsigned char derivative = 0;
+    unsigned char numerator = 0;
+    unsigned char power = 1;
+
+    for (j = 0; j <= degree; j++) {
+      value ^= gfMul(lambda[j], power);
+      if (j & 1) {
+        derivative ^= gfMul(lambda[j], gfDiv(power, inverse)); //Formal derivative, odd terms
+      }
+      power = gfMul(power, inverse);
+    }
+    if (value) {
+      continue;
+    }
+    power = 1;
+    for (j = 0; j < FEC_PARITY; j++) {
+      numerator ^= gfMul(omega[j], power);
+      power = gfMul(power, inverse);
+    }
+    if (!derivative) {
+      return -1;
+    }
+    code[i] ^= gfMul(gfPow(length - 1 - i), gfDiv(numerator, derivative)); //Forney, first root alpha^0
+    errors++;
+  }
+  return errors == degree ? errors : -1; //Fewer roots than the degree: the locator is wrong
+}
+
+/* Name: decodeStream
+   Parameters:
+    const unsigned char* stream, long length - received bytes
+    void (*keep)(const unsigned char* frame, int length, void* context) - called with each frame decoded, as a
+                                                                          plain telemetry frame
+   Return value:
+    Decoded - counters
+*/
+static Decoded decodeStream(const unsigned char* stream, long length,
+                            void (*keep)(const unsigned char* frame, int length, void* context), void* context) {
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  unsigned char code[FEC_FRAME_MAX];
+  Decoded decoded;
+  long at = 0;
+
+  memset(&decoded, 0, sizeof(decoded));
+  while (at + 2 + FEC_LENGTH_BYTES <= length) {
+    int high;
+    int low;
+    int payload;
+    int bytes;
+    int corrected;
+
+    if (bitCount(((stream[at] << 8) | stream[at + 1]) ^ ((FEC_SYNC_0 << 8) | FEC_SYNC_1)) > FEC_SYNC_ERRORS) {
+      at++;
+      continue;
+    }
+    high = hammingDecode(stream[at + 2]);
+    low = hammingDecode(stream[at + 3]);
+    payload = (high << 4) | low;
+    bytes = payload + TELEMETRY_FRAME_OVERHEAD - 2 + FEC_PARITY; //Coded: length byte to the last parity byte
+    if (high < 0 || low < 0 || payload > TELEMETRY_PAYLOAD_MAX) {
+      at++;
+      continue;
+    }
+    if (at + 2 + FEC_LENGTH_BYTES + bytes > length) {
+      break;
+    }
+    memcpy(code, stream + at + 2 + FEC_LENGTH_BYTES, bytes);
+    corrected = rsDecode(code, bytes);
+    frame[0] = TELEMETRY_SYNC_0;
+    frame[1] = TELEMETRY_SYNC_1;
+    memcpy(frame + 2, code, bytes - FEC_PARITY);
+    bytes = payload + TELEMETRY_FRAME_OVERHEAD; //Now the telemetry frame's
+    if (corrected < 0 || code[0] != payload || logGet16(frame + bytes - 2) != logCrc16(frame, bytes - 2)) {
+      decoded.failed++;
+      at++;
+      continue;
+    }
+    keep(frame, bytes, context);
+    decoded.frames++;
+    decoded.corrected += corrected;
+    at += bytes + FEC_OVERHEAD;
+  }
+  return decoded;
+}
+
+/* Name: plainStream
+   Description:
+    The uncoded receiver: exact sync, a possible length, and the CRC.
+*/
+static unsigned long plainStream(const unsigned char* stream, long length,
+                                 void (*keep)(const unsigned char* frame, int length, void* context), void* context) {
+  unsigned long frames = 0;
+  long at = 0;
+
+  while (at + TELEMETRY_FRAME_OVERHEAD <= length) {
+    int bytes = stream[at + 2] + TELEMETRY_FRAME_OVERHEAD;
+
+    if (stream[at] != TELEMETRY_SYNC_0 || stream[at + 1] != TELEMETRY_SYNC_1 ||
+        stream[at + 2] > TELEMETRY_PAYLOAD_MAX || at + bytes > length ||
+        logGet16(stream + at + bytes - 2) != logCrc16(stream + at, bytes - 2)) {
+      at++;
+      continue;
+    }
+    keep(stream + at, bytes, context);
+    frames++;
+    at += bytes;
+  }
+  return frames;
+}
+
+static void writeFrame(const unsigned char* frame, int length, void* context) {
+  fwrite(frame, 1, length, (FILE*)context);
+}
+
+static int decodeFile(const char* in, const char* out) {
+  FILE* input = fopen(in, "rb");
+  FILE* output;
+  unsigned char* stream;
+  long length;
+  Decoded decoded;
+
+  if (!input) {
+    perror(in);
+    return 2;
+  }
+  fseek(input, 0, SEEK_END);
+  length = ftell(input);
+  fseek(input, 0, SEEK_SET);
+  stream = malloc(length ? length : 1);
+  if (fread(stream, 1, length, input) != (size_t)length) {
+    perror(in);
+    return 2;
+  }
+  fclose(input);
+  output = fopen(out, "wb");
+  if (!output) {
+    perror(out);
+    return 2;
+  }
+  decoded = decodeStream(stream, length, writeFrame, output);
+  fclose(output);
+  printf("%ld bytes: %lu frame(s) decoded, %lu byte(s) corrected, %lu frame(s) past correcting\n", length,
+         decoded.frames, decoded.corrected, decoded.failed);
+  free(stream);
+  return 0;
+}
+
+/* Name: Sent_s
+   Type: struct
+   Purpose:
+    The frames of the model as sent, and how many of them came through.
+*/
+struct Sent_s {
+  unsigned char (*frames)[TELEMETRY_FRAME_MAX];
+  unsigned char* lengths;
+  long count;
+  long next; //First frame not yet matched
+  unsigned long delivered;
+  unsigned long payloadBytes;
+  unsigned long wrong; //Passed every check and still not a frame that was sent
+};
+typedef struct Sent_s Sent;
+
+static void matchFrame(const unsigned char* frame, int length, void* context) {
+  Sent* sent = context;
+  long n;
+
+  for (n = sent->next; n < sent->count; n++) { //Frames come out in order, some missing
+    if (sent->lengths[n] == length && !memcmp(sent->frames[n], frame, length)) {
+      sent -> delivered++;
+      sent -> payloadBytes += length - TELEMETRY_FRAME_OVERHEAD;
+      sent -> next = n + 1;
+      return;
+    }
+  }
+  sent -> wrong++;
+}
+
+static void flipBits(unsigned char* stream, long length, double ber) {
+  double position;
+
+  if (ber <= 0) {
+    return;
+  }
+  position = floor(log(nextUniform()) / log(1 - ber)); //Gap to the next error
+  while (position < length * 8.0) {
+    long bit = (long)position;
+
+    stream[bit / 8] ^= 1 << (bit % 8);
+    position += 1 + floor(log(nextUniform()) / log(1 - ber));
+  }
+}
+
+int main(int argc, char** argv) {
+  static const double defaultRates[] = {0, 1e-5, 1e-4, 3e-4, 1e-3, 3e-3, 1e-2};
+  static const unsigned char mix[][2] = {{TELEMETRY_HEALTH, 44}, {TELEMETRY_IMU, 22}, {TELEMETRY_SNAPSHOT, 46},
+                                         {TELEMETRY_BULK, TELEMETRY_PAYLOAD_MAX}, {TELEMETRY_BULK,
+                                         TELEMETRY_PAYLOAD_MAX}};
+  double rates[16];
+  int rateCount = 0;
+  long frameCount = 20000;
+  long baud = 9600;
+  unsigned long long initialSeed = 1;
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+  unsigned char coded[FEC_FRAME_MAX];
+  unsigned char *plain, *plainSent, *fec, *fecSent;
+  long plainLength = 0;
+  long fecLength = 0;
+  struct timespec start;
+  struct timespec end;
+  double seconds;
+  Sent sent;
+  int failed = 0;
+  long n;
+  int r;
+
+  if (argc == 4 && !strcmp(argv[1], "decode")) {
+    return decodeFile(argv[2], argv[3]);
+  }
+  for (n = 1; n < argc; n++) {
+    if (!strcmp(argv[n], "-n") && n + 1 < argc) {
+      frameCount = atol(argv[++n]);
+    } else if (!strcmp(argv[n], "-b") && n + 1 < argc) {
+      baud = atol(argv[++n]);
+    } else if (!strcmp(argv[n], "-s") && n + 1 < argc) {
+      initialSeed = strtoull(argv[++n], 0, 0);
+    } else if (argv[n][0] != '-' && rateCount < 16) {
+      rates[rateCount++] = atof(argv[n]);
+    } else {
+      fprintf(stderr, "usage: fecsim decode <in> <out>\n       fecsim [-n frames] [-b baud] [-s seed] [ber ...]\n");
+      return 2;
+    }
+  }
+  if (frameCount < 1 || frameCount > STREAM_FRAMES_MAX || baud < 300) {
+    fprintf(stderr, "frames 1 to %d, baud 300 or more\n", STREAM_FRAMES_MAX);
+    return 2;
+  }
+  if (!rateCount) {
+    memcpy(rates, defaultRates, sizeof(defaultRates));
+    rateCount = sizeof(defaultRates) / sizeof(defaultRates[0]);
+  }
+
+  randomState = initialSeed * 0x9E3779B97F4A7C15ULL + 1;
+  sent.frames = malloc(frameCount * sizeof(*sent.frames));
+  sent.lengths = malloc(frameCount);
+  sent.count = frameCount;
+  plainSent = malloc(frameCount * TELEMETRY_FRAME_MAX);
+  fecSent = malloc(frameCount * FEC_FRAME_MAX);
+  plain = malloc(frameCount * TELEMETRY_FRAME_MAX);
+  fec = malloc(frameCount * FEC_FRAME_MAX);
+  telemetryInit(pool, telemetryPolicies);
+  for (n = 0; n < frameCount; n++) { //Through the firmware's queue and encoder
+    const unsigned char* kind = mix[n % (sizeof(mix) / sizeof(mix[0]))];
+    int i;
+
+    for (i = 0; i < kind[1]; i++) {
+      payload[i] = (unsigned char)nextRandom();
+    }
+    telemetryPut(kind[0], payload, kind[1], n);
+    telemetryBeginPass();
+    sent.lengths[n] = telemetryDequeue(sent.frames[n], TELEMETRY_FRAME_MAX, n);
+    memcpy(plainSent + plainLength, sent.frames[n], sent.lengths[n]);
+    plainLength += sent.lengths[n];
+    memcpy(coded, sent.frames[n], sent.lengths[n]);
+    fecLength += fecEncode(coded, sent.lengths[n]);
+    memcpy(fecSent + fecLength - (sent.lengths[n] + FEC_OVERHEAD), coded, sent.lengths[n] + FEC_OVERHEAD);
+  }
+
+  printf("%ld frames, %ld bytes plain, %ld bytes coded (%.1f%% more), %ld baud\n", frameCount, plainLength, fecLength,
+         100.0 * (fecLength - plainLength) / plainLength, baud);
+  printf("%9s %10s %8s %6s %10s %8s %6s %10s %8s\n", "ber", "plain %", "B/s", "wrong", "coded %", "B/s", "wrong",
+         "corrected", "failed");
+  for (r = 0; r < rateCount; r++) {
+    double plainSeconds = plainLength / (baud / 10.0);
+    double fecSeconds = fecLength / (baud / 10.0);
+    unsigned long plainDelivered;
+    unsigned long plainPayload;
+    unsigned long plainWrong;
+    Decoded decoded;
+
+    memcpy(plain, plainSent, plainLength);
+    memcpy(fec, fecSent, fecLength);
+    flipBits(plain, plainLength, rates[r]);
+    flipBits(fec, fecLength, rates[r]);
+
+    sent.next = sent.delivered = sent.payloadBytes = sent.wrong = 0;
+    plainStream(plain, plainLength, matchFrame, &sent);
+    plainDelivered = sent.delivered;
+    plainPayload = sent.payloadBytes;
+    plainWrong = sent.wrong;
+    failed |= rates[r] == 0 && (sent.wrong || sent.delivered != (unsigned long)frameCount);
+
+    sent.next = sent.delivered = sent.payloadBytes = sent.wrong = 0;
+    decoded = decodeStream(fec, fecLength, matchFrame, &sent);
+    failed |= rates[r] == 0 && (sent.wrong || sent.delivered != (unsigned long)frameCount);
+
+    printf("%9.0e %9.2f%% %8.1f %6lu %9.2f%% %8.1f %6lu %10lu %8lu\n", rates[r], 100.0 * plainDelivered / frameCount,
+           plainPayload / plainSeconds, plainWrong, 100.0 * sent.delivered / frameCount, sent.payloadBytes / fecSeconds,
+           sent.wrong, decoded.corrected, decoded.failed);
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (r = 0; r < ENCODE_REPEATS; r++) {
+    for (n = 0; n < (frameCount < 1000 ? frameCount : 1000); n++) {
+      memcpy(coded, sent.frames[n], sent.lengths[n]);
+      fecEncode(coded, sent.lengths[n]);
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("encoder: %.1f ns per byte (host)\n", seconds * 1e9 / ((double)ENCODE_REPEATS *
+         (plainLength / frameCount) * (frameCount < 1000 ? frameCount : 1000)));
+  printf("%s\n", failed ? "FAILED" : "passed");
+  free(sent.frames);
+  free(sent.lengths);
+  free(plainSent);
+  free(fecSent);
+  free(plain);
+  free(fec);
+  return failed;
+}
@@ -0,0 +1,530 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool for SD card images written by the flight recorder (format in main_software/inc/log_format.h).  The image
+    is memory mapped and only the blocks that are needed are touched:
+
+      flightlog info <image>                       where the log starts and ends, and the boot segments in it
+      flightlog extract <image> <from> <to> [seg]  decoded samples with from <= tick < to, as CSV (segment defaults to
+                                                   the newest one)
+      flightlog synth <image> <blocks> [seed]      writes a synthetic image with that many log blocks (sparse file)
+      flightlog bench <image>                      times locating, indexing and a full decode of the image
+      flightlog trace <image> <first> <blocks>     log blocks first to first + blocks - 1 (0 = oldest) as C source, for
+                                                   the firmware's replay mode (see main_software/inc/replay.h)
+
+    -n <blocks> before the command overrides the size of the log area (LOG_BLOCK_COUNT), for firmware built with a
+    different size or for large synthetic images.
+
+    The end of the log is found by the same binary search the firmware uses at boot (recsim runs the firmware's own
+    recovery on an image and checks it).  The time index is sparse: one
+    header every INDEX_STRIDE blocks, with the exact block found by binary search inside a stride.  Ticks restart at 0
+    after a reset, so the index is split into boot segments wherever the tick goes backwards (one reset per stride is
+    located exactly; more than that inside one stride are merged).
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o flightlog flightlog.c ../main_software/log_format.c
+*/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "log_format.h"
+
+/* CONSTANTS */
+#define INDEX_STRIDE          256 //Blocks between index entries, 128 KB of card
+#define MAX_SEGMENTS          1024
+
+static unsigned long long logAreaBlocks = LOG_BLOCK_COUNT;
+
+/* DATATYPES */
+
+/* Name: FlightLog_s
+   Type: struct
+   Parameters:
+    const unsigned char* base - mapped image
+    unsigned long long blocks - blocks in the log area (LOG_BLOCK_COUNT, or less if the image is smaller)
+    unsigned long long oldest - offset of the oldest block in the log
+    unsigned long long length - number of blocks in the log, 0 if empty
+    unsigned long firstSequence - sequence number of the oldest block
+   Purpose:
+    An opened image.  Blocks are addressed by their position in the log (0 = oldest), see logBlock().
+*/
+struct FlightLog_s {
+  const unsigned char* base;
+  size_t size;
+  unsigned long long blocks;
+  unsigned long long oldest;
+  unsigned long long length;
+  unsigned long firstSequence;
+};
+typedef struct FlightLog_s FlightLog;
+
+/* Name: Segment_s
+   Type: struct
+   Parameters:
+    unsigned long long first - position of the segment's first block
+    unsigned long long count - blocks in the segment
+   Purpose:
+    Run of blocks between two resets, ticks only go up inside one.
+*/
+struct Segment_s {
+  unsigned long long first;
+  unsigned long long count;
+};
+typedef struct Segment_s Segment;
+
+/* Name: logBlockAt
+   Description:
+    Block at offset (from LOG_FIRST_BLOCK) in the image.
+*/
+static const unsigned char* logBlockAt(const FlightLog* log, unsigned long long offset) {
+  return log->base + (LOG_FIRST_BLOCK + offset) * LOG_BLOCK_SIZE;
+}
+
+/* Name: logBlock
+   Description:
+    Block at position (0 = oldest) in the log.
+*/
+static const unsigned char* logBlock(const FlightLog* log, unsigned long long position) {
+  return logBlockAt(log, (log->oldest + position) % log->blocks);
+}
+
+static unsigned long blockTick(const FlightLog* log, unsigned long long position) {
+  return logGet32(logBlock(log, position) + LOG_HDR_FIRST_TICK);
+}
+
+/* Name: holdsSequence
+   Description:
+    1 if the block at offset is valid and carries the given sequence number.
+*/
+static int holdsSequence(const FlightLog* log, unsigned long long offset, unsigned long sequence) {
+  const unsigned char* block = logBlockAt(log, offset);
+
+  return logBlockIsValid(block) && logGet32(block + LOG_HDR_SEQUENCE) == sequence;
+}
+
+/* Name: logOpen
+   Return value:
+    int - 0 on success, -1 if the image cannot be mapped or is too small
+   Description:
+    Maps the image and finds the oldest and newest blocks.  Same binary search as recorderRecover() in the firmware,
+    plus one more read to see whether the log has wrapped.
+*/
+static int logOpen(FlightLog* log, const char* path) {
+  struct stat info;
+  unsigned long first;
+  unsigned long long good = 0;
+  unsigned long long bad;
+  unsigned long long next;
+  int fd;
+
+  memset(log, 0, sizeof(*log));
+  fd = open(path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &info) < 0) {
+    perror(path);
+    return -1;
+  }
+  if ((unsigned long long)info.st_size < (LOG_FIRST_BLOCK + 1) * LOG_BLOCK_SIZE) {
+    fprintf(stderr, "%s: too small for a log\n", path);
+    close(fd);
+    return -1;
+  }
+
+  log->size = info.st_size;
+  log->base = mmap(NULL, log->size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (log->base == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+  madvise((void*)log->base, log->size, MADV_RANDOM); //Only headers are read until extraction
+
+  log->blocks = log->size / LOG_BLOCK_SIZE - LOG_FIRST_BLOCK;
+  if (log->blocks > logAreaBlocks) {
+    log->blocks = logAreaBlocks;
+  }
+
+  if (!logBlockIsValid(logBlockAt(log, 0))) { //Empty
+    return 0;
+  }
+  first = logGet32(logBlockAt(log, 0) + LOG_HDR_SEQUENCE);
+
+  bad = log->blocks;
+  while (bad - good > 1) {
+    unsigned long long mid = good + (bad - good) / 2;
+
+    if (holdsSequence(log, mid, first + mid)) {
+      good = mid;
+    } else {
+      bad = mid;
+    }
+  }
+
+  //Newest block is at good.  If the block after it belongs to the previous pass, the log has wrapped and that is the oldest.
+  next = (good + 1) % log->blocks;
+  if (next != 0 && holdsSequence(log, next, first + good + 1 - log->blocks)) {
+    log->oldest = next;
+    log->length = log->blocks;
+    log->firstSequence = first + good + 1 - log->blocks;
+  } else {
+    log->oldest = 0;
+    log->length = good + 1;
+    log->firstSequence = first;
+  }
+  return 0;
+}
+
+static void logClose(FlightLog* log) {
+  if (log->base && log->base != MAP_FAILED) {
+    munmap((void*)log->base, log->size);
+  }
+}
+
+/* Name: findReset
+   Description:
+    Given positions lo < hi with tick(lo) > tick(hi), returns the first position after lo whose tick is below tick(lo).
+    Blocks before the reset have ticks >= tick(lo) and blocks after it start again from 0, so this is a binary search.
+*/
+static unsigned long long findReset(const FlightLog* log, unsigned long long lo, unsigned long long hi) {
+  unsigned long before = blockTick(log, lo);
+
+  while (hi - lo > 1) {
+    unsigned long long mid = lo + (hi - lo) / 2;
+
+    if (blockTick(log, mid) >= before) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return hi;
+}
+
+/* Name: buildSegments
+   Return value:
+    int - number of boot segments written to segments
+   Description:
+    Reads one header per INDEX_STRIDE blocks, and splits the log wherever the tick goes backwards.
+*/
+static int buildSegments(const FlightLog* log, Segment* segments, int maxSegments) {
+  unsigned long long position;
+  unsigned long long previous = 0;
+  int count = 0;
+
+  if (log->length == 0) {
+    return 0;
+  }
+
+  segments[0].first = 0;
+  for (position = INDEX_STRIDE; ; position += INDEX_STRIDE) {
+    if (position >= log->length) {
+      position = log->length - 1; //Always look at the newest block too
+    }
+    if (position > previous && blockTick(log, position) < blockTick(log, previous) && count + 1 < maxSegments) {
+      unsigned long long reset = findReset(log, previous, position);
+
+      segments[count].count = reset - segments[count].first;
+      count++;
+      segments[count].first = reset;
+    }
+    previous = position;
+    if (position == log->length - 1) {
+      break;
+    }
+  }
+  segments[count].count = log->length - segments[count].first;
+  return count + 1;
+}
+
+/* Name: findTick
+   Description:
+    Position of the last block in the segment whose first tick is <= tick (or the segment's first block).
+*/
+static unsigned long long findTick(const FlightLog* log, const Segment* segment, unsigned long tick) {
+  unsigned long long lo = segment->first;
+  unsigned long long hi = segment->first + segment->count;
+
+  while (hi - lo > 1) {
+    unsigned long long mid = lo + (hi - lo) / 2;
+
+    if (blockTick(log, mid) <= tick) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static int toAxis(unsigned char high, unsigned char low) {
+  return (short)((high << 8) | low);
+}
+
+/* Name: decodeRange
+   Return value:
+    unsigned long long - samples decoded
+   Description:
+    Decodes samples with from <= tick < to in one segment.  Prints them as CSV if out is not NULL.
+*/
+static unsigned long long decodeRange(const FlightLog* log, const Segment* segment, unsigned long from, unsigned long to,
+                                      FILE* out) {
+  unsigned long long position = findTick(log, segment, from);
+  unsigned long long end = segment->first + segment->count;
+  unsigned long long decoded = 0;
+  volatile long sink = 0; //Keeps the decode alive when benchmarking without output
+
+  for (; position < end; position++) {
+    const unsigned char* block = logBlock(log, position);
+    unsigned long first = logGet32(block + LOG_HDR_FIRST_TICK);
+    int count = block[LOG_HDR_COUNT];
+    int n;
+
+    if (first >= to) {
+      break;
+    }
+    if (!logBlockIsValid(block)) {
+      continue;
+    }
+
+    for (n = 0; n < count; n++) {
+      const unsigned char* sample = block + LOG_HDR_SIZE + n * LOG_SAMPLE_SIZE;
+      const unsigned char* gyro = sample + LOG_SAMPLE_GYRO;
+      const unsigned char* magnet = sample + LOG_SAMPLE_MAGNET;
+      unsigned long tick = first + logGet16(sample + LOG_SAMPLE_TICK);
+
+      if (tick < from || tick >= to) {
+        continue;
+      }
+      decoded++;
+      if (out) { //Gyroscope registers are big endian, magnetometer registers little endian
+        fprintf(out, "%lu,%lu,%d,%d,%d,%d,%d,%d\n", logGet32(block + LOG_HDR_SEQUENCE), tick,
+                toAxis(gyro[0], gyro[1]), toAxis(gyro[2], gyro[3]), toAxis(gyro[4], gyro[5]),
+                toAxis(magnet[1], magnet[0]), toAxis(magnet[3], magnet[2]), toAxis(magnet[5], magnet[4]));
+      } else {
+        sink += toAxis(gyro[0], gyro[1]) + toAxis(magnet[1], magnet[0]);
+      }
+    }
+  }
+  return decoded;
+}
+
+static double now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int commandInfo(const char* path) {
+  FlightLog log;
+  Segment segments[MAX_SEGMENTS];
+  int count;
+  int i;
+
+  if (logOpen(&log, path) < 0) {
+    return 1;
+  }
+  printf("log area: %llu blocks\n", log.blocks);
+  printf("log: %llu blocks, oldest at offset %llu, sequence %lu to %lu\n", log.length, log.oldest, log.firstSequence,
+         log.length ? log.firstSequence + (unsigned long)(log.length - 1) : log.firstSequence);
+
+  count = buildSegments(&log, segments, MAX_SEGMENTS);
+  for (i = 0; i < count; i++) {
+    unsigned long long last = segments[i].first + segments[i].count - 1;
+
+    printf("segment %d: blocks %llu to %llu, ticks %lu to %lu\n", i, segments[i].first, last,
+           blockTick(&log, segments[i].first), blockTick(&log, last));
+  }
+  logClose(&log);
+  return 0;
+}
+
+static int commandExtract(const char* path, unsigned long from, unsigned long to, int segment) {
+  FlightLog log;
+  Segment segments[MAX_SEGMENTS];
+  int count;
+
+  if (logOpen(&log, path) < 0) {
+    return 1;
+  }
+  count = buildSegments(&log, segments, MAX_SEGMENTS);
+  if (count == 0) {
+    fprintf(stderr, "%s: empty log\n", path);
+    logClose(&log);
+    return 1;
+  }
+  if (segment < 0 || segment >= count) {
+    segment = count - 1;
+  }
+
+  printf("sequence,tick,gyro_x,gyro_y,gyro_z,magnet_x,magnet_y,magnet_z\n");
+  decodeRange(&log, &segments[segment], from, to, stdout);
+  logClose(&log);
+  return 0;
+}
+
+/* Name: commandSynth
+   Description:
+    Writes a log of the given length as the firmware would, one sample per tick, with a reset every 2^20 blocks so the
+    segment search has something to find.  Only the log blocks are written, the rest of the file stays sparse.
+*/
+static int commandSynth(const char* path, unsigned long long length, unsigned int seed) {
+  unsigned char block[LOG_BLOCK_SIZE];
+  unsigned long tick = 0;
+  unsigned long long position;
+  FILE* out = fopen(path, "wb");
+
+  if (!out) {
+    perror(path);
+    return 1;
+  }
+  srand(seed);
+  if (fseeko(out, (off_t)LOG_FIRST_BLOCK * LOG_BLOCK_SIZE, SEEK_SET) < 0) {
+    perror("fseeko");
+    fclose(out);
+    return 1;
+  }
+
+  for (position = 0; position < length; position++) {
+    int n;
+
+    if (position % (1UL << 20) == 0) {
+      tick = 0; //Reset
+    }
+    memset(block, 0, sizeof(block));
+    logPut16(block + LOG_HDR_MAGIC, LOG_MAGIC);
+    block[LOG_HDR_VERSION] = LOG_VERSION;
+    block[LOG_HDR_COUNT] = LOG_SAMPLES_PER_BLOCK;
+    logPut32(block + LOG_HDR_SEQUENCE, (unsigned long)position);
+    logPut32(block + LOG_HDR_FIRST_TICK, tick);
+
+    for (n = 0; n < LOG_SAMPLES_PER_BLOCK; n++) {
+      unsigned char* sample = block + LOG_HDR_SIZE + n * LOG_SAMPLE_SIZE;
+      int i;
+
+      logPut16(sample + LOG_SAMPLE_TICK, n);
+      for (i = 0; i < 2 * LOG_AXIS_BYTES; i++) {
+        sample[LOG_SAMPLE_GYRO + i] = rand() & 0xFF;
+      }
+    }
+    tick += LOG_SAMPLES_PER_BLOCK;
+    logPut16(block + LOG_CRC_OFFSET, logCrc16(block, LOG_CRC_OFFSET));
+
+    if (fwrite(block, sizeof(block), 1, out) != 1) {
+      perror("fwrite");
+      fclose(out);
+      return 1;
+    }
+  }
+  fclose(out);
+  return 0;
+}
+
+static int commandBench(const char* path) {
+  FlightLog log;
+  Segment segments[MAX_SEGMENTS];
+  double start, opened, indexed, finished;
+  unsigned long long samples = 0;
+  int count;
+  int i;
+
+  start = now();
+  if (logOpen(&log, path) < 0) {
+    return 1;
+  }
+  opened = now();
+  count = buildSegments(&log, segments, MAX_SEGMENTS);
+  indexed = now();
+
+  madvise((void*)log.base, log.size, MADV_SEQUENTIAL);
+  for (i = 0; i < count; i++) {
+    samples += decodeRange(&log, &segments[i], 0, 0xFFFFFFFFUL, NULL);
+  }
+  finished = now();
+
+  printf("blocks: %llu, segments: %d, samples: %llu\n", log.length, count, samples);
+  printf("locate end of log: %.3f ms\n", (opened - start) * 1e3);
+  printf("build index: %.3f ms\n", (indexed - opened) * 1e3);
+  printf("decode all: %.3f s, %.1f MB/s, %.1f Msamples/s\n", finished - indexed,
+         log.length * (double)LOG_BLOCK_SIZE / (finished - indexed) / 1e6, samples / (finished - indexed) / 1e6);
+  logClose(&log);
+  return 0;
+}
+
+/* Name: commandTrace
+   Description:
+    Prints log blocks as the replayTrace array.  Each block costs 512 bytes of flash, so keep traces to a few dozen blocks.
+*/
+static int commandTrace(const char* path, unsigned long long first, unsigned long long count) {
+  FlightLog log;
+  unsigned long long position;
+  int i;
+
+  if (logOpen(&log, path) < 0) {
+    return 1;
+  }
+  if (first >= log.length) {
+    fprintf(stderr, "%s: log has only %llu blocks\n", path, log.length);
+    logClose(&log);
+    return 1;
+  }
+  if (first + count > log.length) {
+    count = log.length - first;
+  }
+
+  printf("/* Generated by flightlog trace from %s, log blocks %llu to %llu */\n\n", path, first, first + count - 1);
+  printf("#include \"replay.h\"\n\n");
+  printf("const unsigned long replayTraceBlocks = %llu;\n\n", count);
+  printf("const unsigned char replayTrace[%llu] = {\n", count * LOG_BLOCK_SIZE);
+  for (position = first; position < first + count; position++) {
+    const unsigned char* block = logBlock(&log, position);
+
+    for (i = 0; i < LOG_BLOCK_SIZE; i++) {
+      printf("%s0x%02X%s", (i % 16) ? "" : "  ", block[i], (i % 16 == 15) ? ",\n" : ", ");
+    }
+  }
+  printf("};\n");
+  logClose(&log);
+  return 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: flightlog [-n blocks] info <image>\n"
+                  "       flightlog [-n blocks] extract <image> <from tick> <to tick> [segment]\n"
+                  "       flightlog synth <image> <blocks> [seed]\n"
+                  "       flightlog [-n blocks] bench <image>\n"
+                  "       flightlog [-n blocks] trace <image> <first> <blocks>\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 3 && !strcmp(argv[1], "-n")) {
+    logAreaBlocks = strtoull(argv[2], NULL, 0);
+    argc -= 2;
+    argv += 2;
+  }
+  if (argc >= 3 && !strcmp(argv[1], "info")) {
+    return commandInfo(argv[2]);
+  }
+  if (argc >= 5 && !strcmp(argv[1], "extract")) {
+    return commandExtract(argv[2], strtoul(argv[3], NULL, 0), strtoul(argv[4], NULL, 0),
+                          argc >= 6 ? atoi(argv[5]) : -1);
+  }
+  if (argc >= 4 && !strcmp(argv[1], "synth")) {
+    return commandSynth(argv[2], strtoull(argv[3], NULL, 0), argc >= 5 ? (unsigned int)atoi(argv[4]) : 1);
+  }
+  if (argc >= 3 && !strcmp(argv[1], "bench")) {
+    return commandBench(argv[2]);
+  }
+  if (argc >= 5 && !strcmp(argv[1], "trace")) {
+    return commandTrace(argv[2], strtoull(argv[3], NULL, 0), strtoull(argv[4], NULL, 0));
+  }
+  usage();
+  return 2;
+}
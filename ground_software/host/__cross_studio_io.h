@@ -0,0 +1,16 @@
+/* Author: John Walnut
+   Purpose:
+    Stand-in for the CrossWorks debug I/O header, so firmware modules that report through it build on the ground: the
+    output goes to stdout.
+*/
+
+#ifndef HOST_CROSS_STUDIO_IO_H
+#define HOST_CROSS_STUDIO_IO_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define debug_printf          printf
+#define debug_exit            exit
+
+#endif
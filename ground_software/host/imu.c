@@ -0,0 +1,179 @@
+/* Author: John Walnut
+   Purpose:
+    The MPU-9250 and AK8963 models of host/imu.h.
+*/
+
+#include <string.h>
+
+#include "msp430.h"
+#include "imu.h"
+#include "i2c_peripherals.h"
+#include "drdy.h"
+
+/* CONSTANTS */
+#define DEVICE_REGISTERS      128
+#define MAGNET_ST2_REG        (MAGNET_START + MAGNET_DATA_LEN - 1)
+#define IMU_AXES              7 //Accelerometer, temperature, gyroscope
+
+/* Name: Device_s
+   Type: struct
+   Parameters:
+    unsigned char registers[] - the bank
+    unsigned char pointer - register the next byte goes to or comes from
+    char addressed - 1 while in a transfer, 2 once the register pointer has been written in it
+*/
+struct Device_s {
+  unsigned char registers[DEVICE_REGISTERS];
+  unsigned char pointer;
+  char addressed;
+};
+typedef struct Device_s Device;
+
+static Device imu;
+static Device magnet;
+static Device* current; //In the transfer on the bus
+static unsigned long long nextNs; //Next conversion of the MPU-9250
+static unsigned long long magnetSeen; //AK8963 measurement last read through ST2
+static long drift; //Parts per million fast
+static HostImuStats stats;
+
+/* Name: imuPeriodNs
+   Return value:
+    unsigned long long - MPU-9250 conversion period from SMPLRT_DIV, on its clock
+*/
+static unsigned long long imuPeriodNs(void) {
+  return (1 + imu.registers[IMU_SMPLRT_DIV_REG]) * (1000000000ULL / IMU_INTERNAL_HZ) * 1000000ULL /
+         (1000000L + drift);
+}
+
+/* Name: magnetPeriodNs
+   Return value:
+    unsigned long long - AK8963 measurement period from CNTL1, 0 powered down
+*/
+static unsigned long long magnetPeriodNs(void) {
+  switch (magnet.registers[MAGNET_CNTL1_REG]) {
+    case MAGNET_MODE_CONT_8HZ:
+      return 125000000ULL;
+    case MAGNET_MODE_CONT_100HZ:
+      return 10000000ULL;
+    default:
+      return 0;
+  }
+}
+
+/* Name: magnetUpdate
+   Description:
+    Sets DRDY in ST1 if a measurement has been made since the data was last read through ST2.
+*/
+static void magnetUpdate(void) {
+  unsigned long long period = magnetPeriodNs();
+
+  if (period && hostGetNanoseconds() / period != magnetSeen) {
+    magnet.registers[MAGNET_ST1_REG] |= MAGNET_ST1_DRDY;
+  }
+}
+
+/* Name: imuAlarm
+   Description:
+    Ends the INT pulse, or makes the conversion that is due.  Either way sets the alarm for what comes next.
+*/
+static void imuAlarm(void) {
+  unsigned long long now = hostGetNanoseconds();
+  int n;
+
+  if (P2IN & DRDY_PIN) {
+    hostPort2Input(P2IN & ~DRDY_PIN);
+  }
+  if (now >= nextNs) {
+    stats.conversions++;
+    stats.lastNs = nextNs;
+    for (n = 0; n < IMU_AXES; n++) { //Big endian
+      imu.registers[ACCEL_START + 2 * n] = (unsigned char)(stats.conversions >> 8);
+      imu.registers[ACCEL_START + 2 * n + 1] = (unsigned char)stats.conversions;
+    }
+    imu.registers[IMU_INT_STATUS_REG] |= IMU_RAW_DATA_RDY;
+    nextNs += imuPeriodNs();
+    if (imu.registers[IMU_INT_ENABLE_REG] & IMU_RAW_DATA_RDY) {
+      stats.pulses++;
+      hostAlarm(now + HOST_IMU_INT_US * 1000ULL, imuAlarm);
+      hostPort2Input(P2IN | DRDY_PIN);
+      return;
+    }
+  }
+  hostAlarm(nextNs, imuAlarm);
+}
+
+void hostImuPowerOn(long driftPpm) {
+  drift = driftPpm;
+  memset(&imu, 0, sizeof(imu));
+  memset(&magnet, 0, sizeof(magnet));
+  memset(&stats, 0, sizeof(stats));
+  current = 0;
+  magnetSeen = 0;
+  nextNs = hostGetNanoseconds() + imuPeriodNs();
+  hostAlarm(nextNs, imuAlarm);
+}
+
+int hostImuAddress(unsigned int address, int read) {
+  current = 0;
+  if (address == IMU_I2C_ADDR) {
+    current = &imu;
+  } else if (address == MAGNET_I2C_ADDR) {
+    if (!(imu.registers[IMU_INT_PIN_CFG_REG] & IMU_BYPASS_EN)) { //Behind the MPU-9250
+      stats.magnetNacks++;
+      return 0;
+    }
+    current = &magnet;
+    magnetUpdate();
+  } else {
+    return 0;
+  }
+  if (!current->addressed) {
+    current->addressed = 1;
+  }
+  if (read && current == &imu && imu.pointer == ACCEL_START) {
+    stats.bursts++;
+  }
+  return 1;
+}
+
+int hostImuWrite(unsigned char data) {
+  if (!current) {
+    return 0;
+  }
+  if (current->addressed == 1) {
+    current->pointer = data % DEVICE_REGISTERS;
+    current->addressed = 2;
+  } else {
+    current->registers[current->pointer] = data;
+    current->pointer = (current->pointer + 1) % DEVICE_REGISTERS;
+  }
+  return 1;
+}
+
+unsigned char hostImuRead(void) {
+  unsigned char data;
+
+  if (!current) {
+    return 0xFF;
+  }
+  data = current->registers[current->pointer];
+  if (current == &imu && current->pointer == IMU_INT_STATUS_REG) {
+    imu.registers[IMU_INT_STATUS_REG] = 0;
+  } else if (current == &magnet && current->pointer == MAGNET_ST2_REG && magnetPeriodNs()) {
+    magnetSeen = hostGetNanoseconds() / magnetPeriodNs();
+    magnet.registers[MAGNET_ST1_REG] &= ~MAGNET_ST1_DRDY;
+  }
+  current->pointer = (current->pointer + 1) % DEVICE_REGISTERS;
+  return data;
+}
+
+void hostImuStop(void) {
+  imu.addressed = 0;
+  magnet.addressed = 0;
+  current = 0;
+}
+
+const HostImuStats* hostImuGetStats(void) {
+  return &stats;
+}
@@ -0,0 +1,72 @@
+/* Author: John Walnut
+   Purpose:
+    MPU-9250 and its AK8963 on the SECONDARY interface, for tools that run the firmware's sampler.c and drdy.c on
+    host/msp430.h.  The tool's hostI2cAddress(), hostI2cWrite(), hostI2cRead() and hostI2cStop() hand the SECONDARY
+    bus to the hostImu*() functions of the same names:
+
+      gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM ... host/msp430.c host/imu.c ../main_software/drdy.c
+
+    Both devices are banks of registers: a write sets the register pointer and stores any bytes after it, a read returns
+    bytes from the pointer on.  The AK8963 is on the MPU-9250's auxiliary bus, as on the board, so it only answers
+    while BYPASS_EN is set in INT_PIN_CFG.
+
+    The MPU-9250 converts every (1 + SMPLRT_DIV) ms from hostImuPowerOn(), on its own clock, which is off the model's
+    by the drift given there, so its conversions slide past the MCU's ticks as on the board: each
+    conversion loads the accelerometer and gyroscope registers with the conversion's number (every axis), sets
+    RAW_DATA_RDY in INT_STATUS, which reading it clears, and with RAW_DATA_RDY set in INT_ENABLE pulses INT (DRDY_PIN,
+    through hostPort2Input()) high for HOST_IMU_INT_US.  It keeps the model's one alarm (hostAlarm()) for it.  The
+    AK8963 converts at the rate CNTL1 sets and sets DRDY in ST1 until the data is read through ST2.
+*/
+
+#ifndef HOST_IMU_H
+#define HOST_IMU_H
+
+/* CONSTANTS */
+#define HOST_IMU_INT_US       50 //INT pulse, INT_PIN_CFG at reset
+
+/* DATATYPES */
+
+/* Name: HostImuStats_s
+   Type: struct
+   Parameters:
+    unsigned long conversions - MPU-9250 conversions since hostImuPowerOn()
+    unsigned long pulses - INT pulses
+    unsigned long long lastNs - time of the last conversion
+    unsigned long bursts - reads from ACCEL_START through the gyroscope
+    unsigned long magnetNacks - AK8963 addressed with the bypass off
+*/
+struct HostImuStats_s {
+  unsigned long conversions;
+  unsigned long pulses;
+  unsigned long long lastNs;
+  unsigned long bursts;
+  unsigned long magnetNacks;
+};
+typedef struct HostImuStats_s HostImuStats;
+
+/* FUNCTIONS */
+
+/* Name: hostImuPowerOn
+   Parameters:
+    long driftPpm - MPU-9250 clock against the model's, parts per million fast (the datasheet allows 10000 either way)
+   Description:
+    Both devices at their reset values, the MPU-9250 converting at 1 kHz from now.
+*/
+void hostImuPowerOn(long driftPpm);
+
+/* Name: hostImuAddress, hostImuWrite, hostImuRead, hostImuStop
+   Description:
+    The SECONDARY bus, as the model's hostI2c*() functions (host/msp430.h).
+*/
+int hostImuAddress(unsigned int address, int read);
+int hostImuWrite(unsigned char data);
+unsigned char hostImuRead(void);
+void hostImuStop(void);
+
+/* Name: hostImuGetStats
+   Return value:
+    const HostImuStats* - what the devices have done since hostImuPowerOn()
+*/
+const HostImuStats* hostImuGetStats(void);
+
+#endif
@@ -0,0 +1,133 @@
+/* Author: John Walnut
+   Purpose:
+    The antenna deployment controller model of host/isis.h.
+*/
+
+#include <string.h>
+
+#include "msp430.h"
+#include "isis.h"
+#include "i2c_peripherals.h"
+
+static const unsigned int stowedBit[ANTENNA_COUNT] = {0x8000, 0x0800, 0x0080, 0x0008}; //Antennas 1-4
+
+static HostIsisStats controller;
+static long burnOverride; //Seconds, -1 for the command's
+static unsigned char command[2]; //Bytes written in this transfer, written of them
+static int written;
+static int sent; //Status bytes read in this transfer
+static char addressed; //In a transfer with the controller
+
+/* Name: isisBurn
+   Description:
+    Brings the antennas out that the burn has got to by now, one burn time apart.
+*/
+static void isisBurn(void) {
+  unsigned long long now = hostGetNanoseconds();
+  unsigned long long burnNs = controller.burnSeconds * 1000000000ULL;
+  int n;
+
+  if (!controller.burning) {
+    return;
+  }
+  for (n = 0; n < ANTENNA_COUNT; n++) {
+    unsigned long long at = controller.burnNs + (n + 1) * burnNs;
+
+    if (!controller.outNs[n] && at <= now) {
+      controller.outNs[n] = at;
+    }
+  }
+}
+
+static unsigned int isisStatus(void) {
+  unsigned int status = controller.armed ? ANTENNA_STATUS_ARMED : 0;
+  int n;
+
+  isisBurn();
+  for (n = 0; n < ANTENNA_COUNT; n++) {
+    if (!controller.outNs[n]) {
+      status |= stowedBit[n];
+    }
+  }
+  return status;
+}
+
+/* Name: isisCommand
+   Description:
+    Carries out the command written in the transfer, once it ends or turns round to a read.
+*/
+static void isisCommand(void) {
+  if (!written) {
+    return;
+  }
+  isisBurn();
+  switch (command[0]) {
+    case ANTENNA_CMD_ARM:
+      controller.armed = 1;
+      break;
+    case ANTENNA_CMD_DISARM:
+      controller.armed = 0;
+      controller.burning = 0;
+      break;
+    case ANTENNA_CMD_DEPLOY_AUTO:
+      if (controller.armed && written == 2) {
+        controller.burning = 1;
+        controller.burnNs = hostGetNanoseconds();
+        controller.burnSeconds = burnOverride >= 0 ? (unsigned long)burnOverride : command[1];
+      }
+      break;
+  }
+  written = 0;
+}
+
+void hostIsisPowerOn(long burnSeconds) {
+  memset(&controller, 0, sizeof(controller));
+  burnOverride = burnSeconds;
+  written = 0;
+  sent = 0;
+  addressed = 0;
+}
+
+int hostIsisAddress(unsigned int address, int read) {
+  if (address != ANTENNA_I2C_ADDR) {
+    return 0;
+  }
+  if (read) { //Repeated start after the command
+    isisCommand();
+  } else {
+    written = 0;
+  }
+  addressed = 1;
+  sent = 0;
+  return 1;
+}
+
+int hostIsisWrite(unsigned char data) {
+  if (!addressed) {
+    return 0;
+  }
+  if (written < (int)sizeof(command)) {
+    command[written++] = data;
+  }
+  return 1;
+}
+
+unsigned char hostIsisRead(void) {
+  unsigned int status;
+
+  if (!addressed) {
+    return 0xFF;
+  }
+  status = isisStatus(); //LSB first
+  return (unsigned char)(sent++ ? status >> 8 : status);
+}
+
+void hostIsisStop(void) {
+  isisCommand();
+  addressed = 0;
+}
+
+const HostIsisStats* hostIsisGetStats(void) {
+  isisBurn();
+  return &controller;
+}
@@ -0,0 +1,65 @@
+/* Author: John Walnut
+   Purpose:
+    ISIS antenna deployment controller on the PRIMARY interface, for tools that run the firmware's antenna.c on
+    host/msp430.h.  The tool's hostI2c*() functions hand the PRIMARY bus to the hostIsis*() functions of the same names:
+
+      gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM ... host/msp430.c host/isis.c ../main_software/antenna.c
+
+    It answers at ANTENNA_I2C_ADDR and takes ANTENNA_CMD_ARM, ANTENNA_CMD_DEPLOY_AUTO, ANTENNA_CMD_DISARM and
+    ANTENNA_CMD_GET_STATUS (two bytes, LSB first, after a repeated start).  Once armed and deploying it brings the
+    antennas out one after the other, each the burn time after the one before it: the seconds sent with the deploy
+    command, or the ones given to hostIsisPowerOn().  A command is carried out as its transfer ends or turns round to
+    a read; a transfer the master gives up on without a stop (an MCU reset) is dropped at the next address.
+*/
+
+#ifndef HOST_ISIS_H
+#define HOST_ISIS_H
+
+#include "antenna.h"
+
+/* DATATYPES */
+
+/* Name: HostIsisStats_s
+   Type: struct
+   Parameters:
+    char armed - ANTENNA_CMD_ARM received since the last disarm
+    char burning - deploying, from burnNs on
+    unsigned long long burnNs - when the deploy command came in
+    unsigned long burnSeconds - each antenna's burn
+    unsigned long long outNs[] - when each antenna came out, 0 while stowed
+*/
+struct HostIsisStats_s {
+  char armed;
+  char burning;
+  unsigned long long burnNs;
+  unsigned long burnSeconds;
+  unsigned long long outNs[ANTENNA_COUNT];
+};
+typedef struct HostIsisStats_s HostIsisStats;
+
+/* FUNCTIONS */
+
+/* Name: hostIsisPowerOn
+   Parameters:
+    long burnSeconds - each antenna's burn, -1 for the seconds the deploy command sends
+   Description:
+    The controller disarmed, every antenna stowed.
+*/
+void hostIsisPowerOn(long burnSeconds);
+
+/* Name: hostIsisAddress, hostIsisWrite, hostIsisRead, hostIsisStop
+   Description:
+    The PRIMARY bus, as the model's hostI2c*() functions (host/msp430.h).
+*/
+int hostIsisAddress(unsigned int address, int read);
+int hostIsisWrite(unsigned char data);
+unsigned char hostIsisRead(void);
+void hostIsisStop(void);
+
+/* Name: hostIsisGetStats
+   Return value:
+    const HostIsisStats* - the controller's state, with the antennas out that the burn has got to by now
+*/
+const HostIsisStats* hostIsisGetStats(void);
+
+#endif
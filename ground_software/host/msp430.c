@@ -0,0 +1,855 @@
+/* Author: John Walnut
+   Purpose:
+    Registers, interrupt state and the USCI_B I2C master model behind host/msp430.h.
+
+    The model follows the MSP430x2xx family guide.  Setting UCTXSTT sends a start and the address; in transmit mode
+    UCBxTXIFG is set at the start and again each time the byte in UCBxTXBUF moves to the shift register, and with the
+    buffer empty the clock is held until a byte, UCTXSTP or UCTXSTT is written.  A NACK sets UCNACKIFG, throws away
+    UCBxTXBUF and holds the bus for a stop or a repeated start.  In receive mode each byte sets UCBxRXIFG; if
+    UCBxRXBUF has not been read by the end of the next byte the clock is held before its last bit, and a stop
+    requested then goes out at once, losing that byte.  A stop requested during a byte NACKs it and follows it.
+    UCSWRST clears the flags and the interrupt enables, as the hardware does.  Each step is about a bit time.
+
+    In SPI mode (UCMODE_0 to UCMODE_2) UCBxTXIFG is set while UCBxTXBUF is empty; a byte written there moves to the
+    shift register, takes eight steps, and UCBxRXIFG is set with the byte hostSpiExchange() returned.
+
+    The UART (USCI_A) has one byte in the shift register and one in UCAxTXBUF, as the hardware: a byte written there
+    moves to the shift register once it is empty, setting UCAxTXIFG again, and takes ten bit times.  Setting UCSWRST
+    clears the receive flag and both interrupt enables and sets UCAxTXIFG.  Its register accesses take no time.
+
+    A step takes UCBxBR0 and UCBxBR1 SMCLK cycles.  Time is counted in cycles and kept in picoseconds, which is exact
+    for every SMCLK the calibrations and dividers give.  A USCI with nothing to do on the bus is not stepped as time
+    passes, so long idle stretches cost nothing.  Setting the interrupt state takes HOST_GIE_CYCLES, so code spinning on
+    a critical section (i2cClaim() failing while a transfer is in flight) lets the transfer finish, and taking an
+    interrupt takes HOST_INTERRUPT_CYCLES, so a routine never runs in the same timer count as the one before it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "msp430.h"
+
+/* CONSTANTS */
+#define HOST_USCIS            2
+#define HOST_BYTE_STEPS       9 //Eight bits and the acknowledge
+#define HOST_SPI_BYTE_STEPS   8
+#define HOST_TXIFG            0x08 //UCBxTXIFG, same place in IFG2 and UC1IFG
+#define HOST_RXIFG            0x04
+#define HOST_UART_TXIFG       0x02 //UCAxTXIFG
+#define HOST_UART_RXIFG       0x01
+#define HOST_UART_BITS        10 //Start, eight data bits, stop
+#define HOST_PS_PER_SECOND    1000000000000ULL
+#define HOST_ACLK_HZ          32768ULL //The watch crystal
+#define HOST_CALIBRATIONS     4
+#define HOST_GIE_CYCLES       2 //DINT or EINT and the NOP after it
+#define HOST_INTERRUPT_CYCLES 11 //Six to take an interrupt, five for the RETI
+
+enum HostPhase_e {HOST_IDLE = 0,
+                  HOST_ADDRESS,
+                  HOST_TRANSMIT,
+                  HOST_RECEIVE,
+                  HOST_HELD,
+                  HOST_STOP};
+
+/* Name: HostUsci_s
+   Type: struct
+   Parameters:
+    unsigned char registers[] - by HostUsciRegister
+    unsigned int address - UCBxI2CSA
+    int phase - HostPhase_e
+    int wait - steps left in the byte or condition on the bus
+    char loaded - UCBxTXBUF written since it last moved to the shift register
+    char shifting - a byte is going out
+    unsigned char shift - that byte
+    char stalled - clock held for UCBxRXBUF to be read
+    unsigned long cycles - SMCLK cycles toward its next step, as time passes
+    char uartLoaded - UCAxTXBUF written since it last moved to the UART's shift register
+    unsigned char uartShift - byte going out of the UART
+    unsigned long uartCycles - SMCLK cycles left in that byte, 0 with none going out
+*/
+struct HostUsci_s {
+  unsigned char registers[HOST_USCI_REGISTERS];
+  unsigned int address;
+  int phase;
+  int wait;
+  char loaded;
+  char shifting;
+  unsigned char shift;
+  char stalled;
+  unsigned long cycles;
+  char uartLoaded;
+  unsigned char uartShift;
+  unsigned long uartCycles;
+};
+typedef struct HostUsci_s HostUsci;
+
+volatile unsigned int WDTCTL = 0x6900; //As read after a reset: 0x69 in the upper byte, running
+volatile unsigned char IFG1 = PORIFG;
+volatile unsigned char DCOCTL = 0x60; //Reset values
+volatile unsigned char BCSCTL1 = 0x87;
+volatile unsigned char BCSCTL2;
+volatile unsigned char BCSCTL3 = 0x05;
+const volatile unsigned char CALDCO_1MHZ = 0xB5, CALBC1_1MHZ = 0x86; //As read from a part, any distinct values would do
+const volatile unsigned char CALDCO_8MHZ = 0x92, CALBC1_8MHZ = 0x8D;
+const volatile unsigned char CALDCO_12MHZ = 0x9E, CALBC1_12MHZ = 0x8E;
+const volatile unsigned char CALDCO_16MHZ = 0x95, CALBC1_16MHZ = 0x8F;
+volatile unsigned int FCTL1 = 0x9600, FCTL2 = 0x9642, FCTL3 = 0x9658; //Read with the key as after a reset
+volatile unsigned int TA0CTL, TA0R, TA0IV;
+volatile unsigned int TA0CCTL0, TA0CCTL1, TA0CCTL2, TA0CCR0, TA0CCR1, TA0CCR2;
+volatile unsigned int TBCTL;
+volatile unsigned char P1IN, P1OUT, P1DIR, P1SEL, P1SEL2, P1IE, P1IES, P1IFG, P1REN;
+volatile unsigned char P2IN, P2OUT, P2DIR, P2SEL, P2SEL2, P2IE, P2IES, P2IFG, P2REN;
+volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL, P3REN;
+volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL, P4REN;
+volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL, P5REN;
+volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL, P6REN;
+
+//UCSWRST set after a reset, and UCAxTXIFG with it
+#define HOST_USCI_RESET \
+  {{[HOST_UCB_CTL0] = 0x01, [HOST_UCB_CTL1] = 0x01, [HOST_UC_IFG] = HOST_UART_TXIFG, [HOST_UCA_CTL1] = 0x01}}
+
+static HostUsci hostUsci[HOST_USCIS] = {HOST_USCI_RESET, HOST_USCI_RESET};
+static unsigned int hostStatus; //GIE, nothing else kept
+static int hostInInterrupt;
+static unsigned long hostStepsLeft; //Before the tool is stopped, 0 for no limit
+static unsigned long long hostPicoseconds; //Since the tool started
+static unsigned long hostTimerCycles; //SMCLK cycles toward the next count of Timer A0
+static unsigned long long hostSmclkCycles; //Since the tool started
+static unsigned long long hostTimerBStart; //Picoseconds or SMCLK cycles at the last TBCLR, as TBSSEL selects
+static unsigned int hostTimerBHeld; //TBR while it does not count
+static unsigned long long hostAlarmPicoseconds;
+static void (*hostAlarmFunction)(void);
+static unsigned long long hostWatchdogStart; //Picoseconds at the last WDTCNTCL or reset
+static void (*hostWatchdogFunction)(void);
+
+static const volatile unsigned char* const hostCalDco[HOST_CALIBRATIONS] = {&CALDCO_1MHZ, &CALDCO_8MHZ, &CALDCO_12MHZ,
+                                                                           &CALDCO_16MHZ};
+static const volatile unsigned char* const hostCalBc1[HOST_CALIBRATIONS] = {&CALBC1_1MHZ, &CALBC1_8MHZ, &CALBC1_12MHZ,
+                                                                           &CALBC1_16MHZ};
+static const unsigned long hostDcoHz[HOST_CALIBRATIONS] = {1000000UL, 8000000UL, 12000000UL, 16000000UL};
+
+//The firmware's interrupt routines, where the tool links them
+void USCIAB0TX_routine(void) __attribute__((weak));
+void USCIAB0RX_routine(void) __attribute__((weak));
+void USCIAB1TX_routine(void) __attribute__((weak));
+void USCIAB1RX_routine(void) __attribute__((weak));
+void Timer0_A0_routine(void) __attribute__((weak));
+void Timer0_A1_routine(void) __attribute__((weak));
+void Port2_routine(void) __attribute__((weak));
+
+/* An empty bus, for tools with no slaves */
+
+__attribute__((weak)) int hostI2cAddress(int usci, unsigned int address, int read) {
+  return 0;
+}
+
+__attribute__((weak)) int hostI2cWrite(int usci, unsigned char data) {
+  return 0;
+}
+
+__attribute__((weak)) unsigned char hostI2cRead(int usci) {
+  return 0xFF;
+}
+
+__attribute__((weak)) void hostI2cStop(int usci) {
+}
+
+__attribute__((weak)) unsigned char hostSpiExchange(int usci, unsigned char out) {
+  return 0xFF;
+}
+
+__attribute__((weak)) void hostUartTransmit(int usci, unsigned char byte) {
+}
+
+/* Name: hostStart
+   Description:
+    Start condition and address byte.
+*/
+static void hostStart(HostUsci* usci) {
+  usci->phase = HOST_ADDRESS;
+  usci->wait = HOST_BYTE_STEPS + 1;
+  usci->loaded = 0;
+  usci->shifting = 0;
+  usci->stalled = 0;
+  if (usci->registers[HOST_UCB_CTL1] & UCTR) {
+    usci->registers[HOST_UC_IFG] |= HOST_TXIFG;
+  }
+}
+
+static void hostStop(HostUsci* usci) {
+  usci->phase = HOST_STOP;
+  usci->wait = 1;
+}
+
+/* Name: hostTransmitNext
+   Description:
+    Transmit mode, shift register empty: the next byte, the stop or the repeated start, or the clock held.
+*/
+static void hostTransmitNext(HostUsci* usci) {
+  if (usci->loaded) {
+    usci->shift = usci->registers[HOST_UCB_TXBUF];
+    usci->loaded = 0;
+    usci->shifting = 1;
+    usci->registers[HOST_UC_IFG] |= HOST_TXIFG;
+    usci->wait = HOST_BYTE_STEPS;
+  } else if (usci->registers[HOST_UCB_CTL1] & UCTXSTP) {
+    hostStop(usci);
+  } else if (usci->registers[HOST_UCB_CTL1] & UCTXSTT) {
+    hostStart(usci);
+  }
+}
+
+/* Name: hostNack
+   Description:
+    Address or data byte not acknowledged.
+*/
+static void hostNack(HostUsci* usci) {
+  usci->registers[HOST_UCB_STAT] |= UCNACKIFG;
+  usci->registers[HOST_UCB_CTL1] &= ~UCTXSTT;
+  usci->loaded = 0;
+  usci->phase = HOST_HELD;
+}
+
+/* Name: hostSpiStep
+   Description:
+    SPI master: the byte shifted in at the end of the byte, the next one loaded from UCBxTXBUF.
+*/
+static void hostSpiStep(int n, HostUsci* usci) {
+  if (usci->shifting) {
+    usci->shifting = 0;
+    usci->registers[HOST_UCB_RXBUF] = hostSpiExchange(n, usci->shift);
+    usci->registers[HOST_UC_IFG] |= HOST_RXIFG;
+  }
+  if (usci->loaded) {
+    usci->shift = usci->registers[HOST_UCB_TXBUF];
+    usci->loaded = 0;
+    usci->shifting = 1;
+    usci->wait = HOST_SPI_BYTE_STEPS - 1;
+  }
+  usci->registers[HOST_UC_IFG] |= HOST_TXIFG;
+}
+
+static void hostStep(int n) {
+  HostUsci* usci = &hostUsci[n];
+  unsigned char* ctl1 = &usci->registers[HOST_UCB_CTL1];
+
+  if (hostStepsLeft && !--hostStepsLeft) {
+    printf("FAIL: USCI model stopped after the step limit, firmware waiting on a flag that never changes\n");
+    exit(1);
+  }
+  if (*ctl1 & UCSWRST) {
+    *ctl1 &= ~(UCTXSTT + UCTXSTP);
+    usci->registers[HOST_UCB_STAT] = 0;
+    usci->registers[HOST_UCB_I2CIE] = 0;
+    usci->registers[HOST_UC_IE] &= ~(HOST_TXIFG + HOST_RXIFG);
+    usci->registers[HOST_UC_IFG] &= ~(HOST_TXIFG + HOST_RXIFG);
+    usci->phase = HOST_IDLE;
+    usci->wait = 0;
+    usci->loaded = 0;
+    usci->shifting = 0;
+    return;
+  }
+  if (usci->wait > 0) {
+    usci->wait--;
+    return;
+  }
+  if ((usci->registers[HOST_UCB_CTL0] & UCMODE_3) != UCMODE_3) {
+    hostSpiStep(n, usci);
+    return;
+  }
+
+  switch (usci->phase) {
+    case HOST_IDLE:
+      if (*ctl1 & UCTXSTT) {
+        hostStart(usci);
+      }
+      break;
+    case HOST_HELD:
+      if (*ctl1 & UCTXSTT) {
+        hostStart(usci);
+      } else if (*ctl1 & UCTXSTP) {
+        hostStop(usci);
+      }
+      break;
+    case HOST_ADDRESS:
+      if (!hostI2cAddress(n, usci->address, !(*ctl1 & UCTR))) {
+        hostNack(usci);
+        break;
+      }
+      *ctl1 &= ~UCTXSTT;
+      if (*ctl1 & UCTR) {
+        usci->phase = HOST_TRANSMIT;
+        hostTransmitNext(usci);
+      } else {
+        usci->phase = HOST_RECEIVE;
+        usci->wait = HOST_BYTE_STEPS;
+      }
+      break;
+    case HOST_TRANSMIT:
+      if (usci->shifting) {
+        usci->shifting = 0;
+        if (!hostI2cWrite(n, usci->shift)) {
+          hostNack(usci);
+          break;
+        }
+      }
+      hostTransmitNext(usci);
+      break;
+    case HOST_RECEIVE:
+      if (usci->registers[HOST_UC_IFG] & HOST_RXIFG) { //Last one not read yet
+        usci->stalled = 1;
+        if (*ctl1 & UCTXSTP) { //NACK and stop at once, the byte is lost
+          hostStop(usci);
+        }
+        break;
+      }
+      if (usci->stalled) { //Read at last, the held bit goes out
+        usci->stalled = 0;
+        usci->wait = 1;
+        break;
+      }
+      usci->registers[HOST_UCB_RXBUF] = hostI2cRead(n);
+      usci->registers[HOST_UC_IFG] |= HOST_RXIFG;
+      if (*ctl1 & UCTXSTP) { //NACKed, the last one
+        hostStop(usci);
+      } else if (*ctl1 & UCTXSTT) {
+        hostStart(usci);
+      } else {
+        usci->wait = HOST_BYTE_STEPS;
+      }
+      break;
+    case HOST_STOP:
+      *ctl1 &= ~UCTXSTP;
+      usci->phase = HOST_IDLE;
+      hostI2cStop(n);
+      break;
+  }
+}
+
+/* Name: hostIdle
+   Return value:
+    int - 1 if a step would leave the USCI as it is: held in reset, or waiting on the firmware with nothing to send
+*/
+static int hostIdle(HostUsci* usci) {
+  unsigned char ctl1 = usci->registers[HOST_UCB_CTL1];
+
+  if (ctl1 & UCSWRST) {
+    return 1;
+  }
+  if (usci->wait > 0) {
+    return 0;
+  }
+  if ((usci->registers[HOST_UCB_CTL0] & UCMODE_3) != UCMODE_3) {
+    return !usci->loaded && !usci->shifting && (usci->registers[HOST_UC_IFG] & HOST_TXIFG);
+  }
+  return (usci->phase == HOST_IDLE || usci->phase == HOST_HELD) && !(ctl1 & (UCTXSTT + UCTXSTP));
+}
+
+static unsigned long hostBitCycles(int n) {
+  unsigned int divider = hostUsciDivider(n);
+
+  return divider ? divider : 1;
+}
+
+/* Name: hostUartReset
+   Return value:
+    int - 1 while the UART is held in reset (UCSWRST), with its flags and enables as the reset leaves them
+*/
+static int hostUartReset(HostUsci* usci) {
+  if (!(usci->registers[HOST_UCA_CTL1] & UCSWRST)) {
+    return 0;
+  }
+  usci->registers[HOST_UC_IE] &= ~(HOST_UART_TXIFG + HOST_UART_RXIFG);
+  usci->registers[HOST_UC_IFG] &= ~HOST_UART_RXIFG;
+  usci->registers[HOST_UC_IFG] |= HOST_UART_TXIFG;
+  usci->registers[HOST_UCA_STAT] = 0;
+  usci->uartLoaded = 0;
+  usci->uartCycles = 0;
+  return 1;
+}
+
+/* Name: hostUartBitCycles
+   Return value:
+    unsigned long - SMCLK cycles per bit: UCAxBR0 and UCAxBR1, times 16 plus UCBRFx when oversampling (UCOS16)
+*/
+static unsigned long hostUartBitCycles(HostUsci* usci) {
+  unsigned long divider = usci->registers[HOST_UCA_BR0] | usci->registers[HOST_UCA_BR1] << 8;
+
+  if (usci->registers[HOST_UCA_MCTL] & UCOS16) {
+    divider = divider * 16 + (usci->registers[HOST_UCA_MCTL] >> 4);
+  }
+  return divider ? divider : 1;
+}
+
+/* Name: hostUartLoad
+   Description:
+    Shift register empty: the byte in UCAxTXBUF, if there is one, moves to it.
+*/
+static void hostUartLoad(HostUsci* usci) {
+  if (usci->uartCycles || !usci->uartLoaded || hostUartReset(usci)) {
+    return;
+  }
+  usci->uartShift = usci->registers[HOST_UCA_TXBUF];
+  usci->uartLoaded = 0;
+  usci->uartCycles = HOST_UART_BITS * hostUartBitCycles(usci);
+  usci->registers[HOST_UC_IFG] |= HOST_UART_TXIFG;
+}
+
+/* Name: hostUartRun
+   Parameters:
+    unsigned long cycles - SMCLK cycles gone by
+   Description:
+    The UART's transmitter on by that much, handing each byte that finishes to hostUartTransmit().
+*/
+static void hostUartRun(int n, unsigned long cycles) {
+  HostUsci* usci = &hostUsci[n];
+
+  hostUartLoad(usci);
+  while (usci->uartCycles) {
+    if (cycles < usci->uartCycles) {
+      usci->uartCycles -= cycles;
+      return;
+    }
+    cycles -= usci->uartCycles;
+    usci->uartCycles = 0;
+    hostUartTransmit(n, usci->uartShift);
+    hostUartLoad(usci);
+  }
+}
+
+/* Name: hostTimerRunning
+   Return value:
+    int - 1 if Timer A0 counts SMCLK in up or continuous mode.  A TACLR written since it last ran is carried out here.
+*/
+static int hostTimerRunning(void) {
+  if (TA0CTL & TACLR) {
+    TA0R = 0;
+    hostTimerCycles = 0;
+    TA0CTL &= ~TACLR;
+  }
+  return (TA0CTL & TASSEL_3) == TASSEL_2 && ((TA0CTL & MC_3) == MC_1 || (TA0CTL & MC_3) == MC_2);
+}
+
+static unsigned long hostTimerDivider(void) {
+  return 1UL << ((TA0CTL & ID_3) >> 6);
+}
+
+/* Name: hostTimerCounts
+   Return value:
+    unsigned long - counts until TA0R next gets to a compare register or goes back to 0
+*/
+static unsigned long hostTimerCounts(void) {
+  unsigned int top = ((TA0CTL & MC_3) == MC_1) ? TA0CCR0 : 0xFFFF;
+  unsigned long counts = (TA0R >= top) ? 1 : top - TA0R;
+
+  if (TA0CCR0 > TA0R && TA0CCR0 - TA0R < counts) {
+    counts = TA0CCR0 - TA0R;
+  }
+  if (TA0CCR1 > TA0R && TA0CCR1 - TA0R < counts) {
+    counts = TA0CCR1 - TA0R;
+  }
+  if (TA0CCR2 > TA0R && TA0CCR2 - TA0R < counts) {
+    counts = TA0CCR2 - TA0R;
+  }
+  return counts;
+}
+
+/* Name: hostTimerRun
+   Parameters:
+    unsigned long cycles - SMCLK cycles gone by
+   Description:
+    Counts Timer A0 on, setting CCIFG as TA0R gets to each compare register and TAIFG as it goes back to 0.
+*/
+static void hostTimerRun(unsigned long cycles) {
+  unsigned long divider;
+
+  if (!hostTimerRunning()) {
+    return;
+  }
+  divider = hostTimerDivider();
+  hostTimerCycles += cycles;
+  while (hostTimerCycles >= divider) {
+    unsigned long counts = hostTimerCounts();
+    unsigned int top = ((TA0CTL & MC_3) == MC_1) ? TA0CCR0 : 0xFFFF;
+
+    if (counts > hostTimerCycles / divider) {
+      counts = hostTimerCycles / divider;
+    }
+    hostTimerCycles -= counts * divider;
+    if (TA0R >= top) {
+      TA0R = 0;
+      TA0CTL |= TAIFG;
+    } else {
+      TA0R += counts;
+    }
+    if (TA0R == TA0CCR0) {
+      TA0CCTL0 |= CCIFG;
+    }
+    if (TA0R == TA0CCR1) {
+      TA0CCTL1 |= CCIFG;
+    }
+    if (TA0R == TA0CCR2) {
+      TA0CCTL2 |= CCIFG;
+    }
+  }
+}
+
+/* Name: hostWatchdogInterval
+   Return value:
+    unsigned long long - picoseconds from a clear to the watchdog running out: 32768, 8192, 512 or 64 clocks of ACLK
+    (WDTSSEL) or SMCLK, as WDTIS selects
+*/
+static unsigned long long hostWatchdogInterval(void) {
+  static const unsigned long counts[4] = {32768UL, 8192UL, 512UL, 64UL};
+  unsigned long long hz = (WDTCTL & WDTSSEL) ? HOST_ACLK_HZ : hostSmclkHz();
+
+  return counts[WDTCTL & (WDTIS1 + WDTIS0)] * (HOST_PS_PER_SECOND / hz);
+}
+
+/* Name: hostWatchdogRunning
+   Return value:
+    int - 1 if the tool runs the watchdog and WDTCTL has it counting in watchdog mode.  A WDTCNTCL written since the
+    model last looked starts the count over, and reads back as 0 from then on.
+*/
+static int hostWatchdogRunning(void) {
+  if (WDTCTL & WDTCNTCL) {
+    hostWatchdogStart = hostPicoseconds;
+    WDTCTL &= ~WDTCNTCL;
+  }
+  return hostWatchdogFunction && !(WDTCTL & (WDTHOLD + WDTTMSEL));
+}
+
+/* Name: hostClock
+   Parameters:
+    unsigned long cycles - SMCLK cycles gone by
+   Description:
+    The time and Timer A0 on by that much.
+*/
+static void hostClock(unsigned long cycles) {
+  hostWatchdogRunning(); //A clear before the time passes counts from before it
+  hostPicoseconds += cycles * (HOST_PS_PER_SECOND / hostSmclkHz());
+  hostSmclkCycles += cycles;
+  hostTimerRun(cycles);
+}
+
+/* Name: hostTime
+   Parameters:
+    unsigned long cycles - SMCLK cycles gone by
+    int stepped - USCI whose step they were, -1 for none
+   Description:
+    The time, Timer A0 and every other USCI on by that much.
+*/
+static void hostTime(unsigned long cycles, int stepped) {
+  int n;
+
+  hostClock(cycles);
+  for (n = 0; n < HOST_USCIS; n++) {
+    HostUsci* usci = &hostUsci[n];
+    unsigned long bit = hostBitCycles(n);
+
+    hostUartRun(n, cycles);
+    if (n == stepped) {
+      continue;
+    }
+    usci->cycles += cycles;
+    while (usci->cycles >= bit) {
+      if (hostIdle(usci)) {
+        usci->cycles %= bit;
+        break;
+      }
+      usci->cycles -= bit;
+      hostStep(n);
+    }
+  }
+}
+
+/* Name: hostEvents
+   Description:
+    Calls the tool's alarm if its time has come, and its watchdog function, with WDTIFG set, if the watchdog has run
+    out.  Only where the time has finished passing, the interrupts next.
+*/
+static void hostEvents(void) {
+  void (*alarm)(void) = hostAlarmFunction;
+
+  if (alarm && hostPicoseconds >= hostAlarmPicoseconds) {
+    hostAlarmFunction = 0;
+    alarm();
+  }
+  if (hostWatchdogRunning() && hostPicoseconds >= hostWatchdogStart + hostWatchdogInterval()) {
+    IFG1 |= WDTIFG;
+    hostWatchdogStart = hostPicoseconds; //Counting from here again if the function returns
+    hostWatchdogFunction();
+  }
+}
+
+/* Name: hostTake
+   Parameters:
+    void (*routine)(void) - interrupt routine
+   Description:
+    Calls it, after the time the CPU takes to get into and out of it.  The routine's own code takes none, as elsewhere.
+*/
+static void hostTake(void (*routine)(void)) {
+  hostTime(HOST_INTERRUPT_CYCLES, -1);
+  routine();
+}
+
+/* Name: hostInterrupts
+   Description:
+    Calls the interrupt routine of every USCI, Timer A0 and Port 2 flag that is set and enabled, with GIE cleared as
+    the hardware does.
+*/
+static void hostInterrupts(void) {
+  int n;
+
+  if (!(hostStatus & GIE) || hostInInterrupt) {
+    return;
+  }
+  for (n = 0; n < HOST_USCIS; n++) {
+    HostUsci* usci = &hostUsci[n];
+    void (*tx)(void) = n ? USCIAB1TX_routine : USCIAB0TX_routine;
+    void (*rx)(void) = n ? USCIAB1RX_routine : USCIAB0RX_routine;
+
+    hostInInterrupt = 1;
+    if ((usci->registers[HOST_UC_IE] & usci->registers[HOST_UC_IFG] & (HOST_TXIFG + HOST_RXIFG + HOST_UART_TXIFG)) &&
+        tx) {
+      hostTake(tx);
+    }
+    if ((((usci->registers[HOST_UCB_I2CIE] & UCNACKIE) && (usci->registers[HOST_UCB_STAT] & UCNACKIFG)) ||
+         (usci->registers[HOST_UC_IE] & usci->registers[HOST_UC_IFG] & HOST_UART_RXIFG)) && rx) {
+      hostTake(rx);
+    }
+    hostInInterrupt = 0;
+  }
+
+  hostInInterrupt = 1;
+  if ((TA0CCTL0 & (CCIE + CCIFG)) == CCIE + CCIFG && Timer0_A0_routine) {
+    TA0CCTL0 &= ~CCIFG; //Cleared as the interrupt is taken
+    hostTake(Timer0_A0_routine);
+  }
+  if ((TA0CCTL1 & (CCIE + CCIFG)) == CCIE + CCIFG && Timer0_A1_routine) {
+    TA0CCTL1 &= ~CCIFG; //Cleared by the routine reading TA0IV
+    TA0IV = TA0IV_TACCR1;
+    hostTake(Timer0_A1_routine);
+  }
+  if ((P2IE & P2IFG) && Port2_routine) {
+    hostTake(Port2_routine);
+  }
+  hostInInterrupt = 0;
+}
+
+volatile unsigned char* hostUsciRegister(int usci, HostUsciRegister name) {
+  HostUsci* model = &hostUsci[usci];
+
+  if (name >= HOST_UCA_CTL0) { //The UART
+    hostUartReset(model);
+    if (name == HOST_UCA_TXBUF) {
+      model->uartLoaded = 1;
+      model->registers[HOST_UC_IFG] &= ~HOST_UART_TXIFG;
+    } else if (name == HOST_UCA_RXBUF) {
+      model->registers[HOST_UC_IFG] &= ~HOST_UART_RXIFG;
+    }
+    return &model->registers[name];
+  }
+  hostStep(usci);
+  hostTime(hostBitCycles(usci), usci);
+  hostEvents();
+  hostInterrupts();
+  if (name == HOST_UCB_TXBUF) { //Only ever written: the buffer is full until it moves to the shift register
+    model->loaded = 1;
+    model->registers[HOST_UC_IFG] &= ~HOST_TXIFG;
+  } else if (name == HOST_UCB_RXBUF) { //Only ever read
+    model->registers[HOST_UC_IFG] &= ~HOST_RXIFG;
+  }
+  return &model->registers[name];
+}
+
+unsigned int hostUsciDivider(int usci) {
+  return hostUsci[usci].registers[HOST_UCB_BR0] | hostUsci[usci].registers[HOST_UCB_BR1] << 8;
+}
+
+volatile unsigned int* hostUsciAddress(int usci) {
+  hostStep(usci);
+  hostTime(hostBitCycles(usci), usci);
+  return &hostUsci[usci].address;
+}
+
+unsigned int hostGetInterruptState(void) {
+  return hostStatus;
+}
+
+void hostSetInterruptState(unsigned int state) {
+  hostStatus = state & GIE;
+  hostTime(HOST_GIE_CYCLES, -1);
+  hostEvents();
+  hostInterrupts();
+}
+
+void hostSetStepLimit(unsigned long steps) {
+  hostStepsLeft = steps;
+}
+
+void hostRun(unsigned long steps) {
+  int n;
+
+  while (steps--) {
+    unsigned long bit = 1;
+
+    for (n = 0; n < HOST_USCIS; n++) {
+      hostStep(n);
+      if (hostBitCycles(n) > bit) {
+        bit = hostBitCycles(n);
+      }
+    }
+    hostClock(bit);
+    hostEvents();
+    hostInterrupts();
+  }
+}
+
+void hostElapse(unsigned long microseconds) {
+  unsigned long long cycles = (unsigned long long)microseconds * hostSmclkHz() / 1000000UL;
+  int n;
+
+  while (cycles > 0) {
+    unsigned long chunk = (cycles > 0xFFFFFFFFUL) ? 0xFFFFFFFFUL : (unsigned long)cycles;
+
+    if (hostTimerRunning()) { //To the next flag, so its interrupt comes on time
+      unsigned long due = hostTimerCounts() * hostTimerDivider() - hostTimerCycles;
+
+      if (due < chunk) {
+        chunk = due;
+      }
+    }
+    for (n = 0; n < HOST_USCIS; n++) { //To the next step of a USCI with work to do, or the end of a UART byte
+      HostUsci* usci = &hostUsci[n];
+
+      if (!hostIdle(usci) && hostBitCycles(n) - usci->cycles < chunk) {
+        chunk = hostBitCycles(n) - usci->cycles;
+      }
+      hostUartLoad(usci);
+      if (usci->uartCycles && usci->uartCycles < chunk) {
+        chunk = usci->uartCycles;
+      }
+    }
+    if (hostAlarmFunction) { //To the alarm, so it is called on time
+      unsigned long long psPerCycle = HOST_PS_PER_SECOND / hostSmclkHz();
+      unsigned long long due = (hostAlarmPicoseconds > hostPicoseconds) ?
+                               (hostAlarmPicoseconds - hostPicoseconds + psPerCycle - 1) / psPerCycle : 0;
+
+      if (due < chunk) {
+        chunk = (unsigned long)due;
+      }
+    }
+    if (hostWatchdogRunning()) { //To the watchdog running out, likewise
+      unsigned long long psPerCycle = HOST_PS_PER_SECOND / hostSmclkHz();
+      unsigned long long end = hostWatchdogStart + hostWatchdogInterval();
+      unsigned long long due = (end > hostPicoseconds) ? (end - hostPicoseconds + psPerCycle - 1) / psPerCycle : 0;
+
+      if (due < chunk) {
+        chunk = (unsigned long)due;
+      }
+    }
+    hostTime(chunk, -1);
+    hostEvents();
+    hostInterrupts();
+    cycles -= chunk;
+  }
+}
+
+void hostUartReceive(int usci, unsigned char byte) {
+  HostUsci* model = &hostUsci[usci];
+
+  if (hostUartReset(model)) {
+    return;
+  }
+  if (model->registers[HOST_UC_IFG] & HOST_UART_RXIFG) {
+    model->registers[HOST_UCA_STAT] |= UCOE;
+  }
+  model->registers[HOST_UCA_RXBUF] = byte;
+  model->registers[HOST_UC_IFG] |= HOST_UART_RXIFG;
+  hostInterrupts();
+}
+
+void hostAlarm(unsigned long long nanoseconds, void (*alarm)(void)) {
+  hostAlarmPicoseconds = nanoseconds * 1000;
+  hostAlarmFunction = alarm;
+}
+
+void hostWatchdog(void (*expired)(void)) {
+  hostWatchdogStart = hostPicoseconds;
+  hostWatchdogFunction = expired;
+}
+
+void hostReset(void) {
+  static const HostUsci usci = HOST_USCI_RESET;
+  int n;
+
+  WDTCTL = 0x6900;
+  DCOCTL = 0x60;
+  BCSCTL1 = 0x87;
+  BCSCTL2 = 0;
+  BCSCTL3 = 0x05;
+  FCTL1 = 0x9600;
+  FCTL2 = 0x9642;
+  FCTL3 = 0x9658;
+  TA0CTL = TA0R = TA0IV = 0;
+  TA0CCTL0 = TA0CCTL1 = TA0CCTL2 = TA0CCR0 = TA0CCR1 = TA0CCR2 = 0;
+  TBCTL = 0;
+  P1DIR = P1SEL = P1SEL2 = P1IE = P1IES = P1IFG = P1REN = 0; //PxOUT is undefined after a reset, left as it was
+  P2DIR = P2SEL = P2SEL2 = P2IE = P2IES = P2IFG = P2REN = 0;
+  P3DIR = P3SEL = P3REN = 0;
+  P4DIR = P4SEL = P4REN = 0;
+  P5DIR = P5SEL = P5REN = 0;
+  P6DIR = P6SEL = P6REN = 0;
+  for (n = 0; n < HOST_USCIS; n++) {
+    hostUsci[n] = usci;
+  }
+  hostStatus = 0;
+  hostInInterrupt = 0;
+  hostTimerCycles = 0;
+  hostTimerBHeld = 0;
+  hostWatchdogStart = hostPicoseconds;
+}
+
+void hostPort2Input(unsigned char in) {
+  unsigned char rising = in & ~P2IN;
+  unsigned char falling = P2IN & ~in;
+
+  P2IN = in;
+  P2IFG |= (rising & ~P2IES) | (falling & P2IES);
+  hostInterrupts();
+}
+
+unsigned long long hostGetNanoseconds(void) {
+  return hostPicoseconds / 1000;
+}
+
+unsigned int hostTimerB(void) {
+  int smclk = (TBCTL & TBSSEL_3) == TBSSEL_2;
+  unsigned long long now = smclk ? hostSmclkCycles : hostPicoseconds;
+  unsigned long long counts;
+
+  if (TBCTL & TBCLR) {
+    hostTimerBStart = now;
+    hostTimerBHeld = 0;
+    TBCTL &= ~TBCLR;
+  }
+  if ((TBCTL & MC_3) != MC_2) {
+    return hostTimerBHeld;
+  }
+  counts = smclk ? now - hostTimerBStart : (now - hostTimerBStart) / (HOST_PS_PER_SECOND / HOST_ACLK_HZ);
+  hostTimerBHeld = (unsigned int)(counts >> ((TBCTL & ID_3) >> 6));
+  return hostTimerBHeld;
+}
+
+unsigned long hostSmclkHz(void) {
+  unsigned long hz = 1000000UL; //The DCO after a reset
+  int n;
+
+  for (n = 0; n < HOST_CALIBRATIONS; n++) {
+    if (BCSCTL1 == *hostCalBc1[n] && DCOCTL == *hostCalDco[n]) {
+      hz = hostDcoHz[n];
+    }
+  }
+  return hz >> ((BCSCTL2 & DIVS_3) >> 1);
+}
@@ -0,0 +1,432 @@
+/* Author: John Walnut
+   Purpose:
+    Stand-in for the compiler's msp430.h, so firmware modules build and run on the ground with gcc.  Tools that link
+    firmware code put this directory ahead of main_software/inc:
+
+      gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM ... host/msp430.c ../main_software/<module>.c
+
+    Bit names and values are the MSP430x2xx ones, for both the F2618 and the G2553 (-D__MSP430G2553__).  Registers that
+    only hold values are plain variables in msp430.c.  The USCI_B registers, and the IE/IFG registers they share with
+    USCI_A, go through hostUsciRegister() instead: each access runs a model of the module in I2C master mode one step
+    on (about a bit time), so code that waits on a flag sees it change, and once the model sets a flag whose interrupt
+    is enabled, with GIE set, the firmware's interrupt routine for it is called from there.  The slaves on the bus
+    are the tool's, through the hostI2c*() functions below.  With UCMODE_3 cleared the module is an SPI master
+    instead, and the byte it clocks out goes to the tool's hostSpiExchange().  UCA1 is a UART: a byte written to
+    UCA1TXBUF goes out in ten bit times and then to the tool's hostUartTransmit(), and the tool's hostUartReceive()
+    puts a byte in UCA1RXBUF.
+
+    WDTCTL and IFG1 are plain variables: the tool sets the reset flags in IFG1 before it boots the firmware.  The
+    watchdog only runs for a tool that asks (hostWatchdog()): it counts the interval WDTCTL selects from the last
+    WDTCNTCL, which reads back as 0, and running out sets WDTIFG and calls the tool, which resets the MCU
+    (hostReset()).  The flash controller's registers are plain variables too: flash.c builds, but it writes through
+    pointers into information memory, so tools that run code calling it stub it instead.
+
+    The model keeps time in SMCLK cycles, at the rate the clock registers give: the DCO at one of its calibrations
+    (CALBC1_xMHZ and CALDCO_xMHZ, loaded into BCSCTL1 and DCOCTL), or 1 MHz as after a reset, over DIVS in BCSCTL2.
+    Time passes a bit time of the USCI at each of its register accesses, two cycles at each change of the interrupt
+    state, eleven to get into and out of an interrupt routine, and in hostRun() and hostElapse(); the code in between
+    takes none.  Timer A0 counts it from SMCLK in up and continuous mode, sets the CCIFG flags as it gets to
+    TA0CCR0 and TA0CCR1, and calls the firmware's Timer0_A0_routine() and Timer0_A1_routine() (with TA0IV set) as for
+    the USCI flags.  The other USCI runs on as the time passes, at its own bit rate.  Timer B only counts, in continuous
+    mode, from ACLK (the 32768 Hz crystal) or SMCLK: TBR is worked out from the time when it is read (hostTimerB()),
+    from the first read after TBCLR was written.
+
+    Port 2 takes its inputs from the tool (hostPort2Input()): an edge in the direction P2IES selects sets the pin's
+    P2IFG bit, and the firmware's Port2_routine() is called while it is set in P2IE.  A device that pulls a pin at a
+    given time does it from an alarm (hostAlarm()), called as the model's time gets there.
+
+    #pragma vector and the other CrossWorks pragmas are accepted and ignored.
+*/
+
+#ifndef HOST_MSP430_H
+#define HOST_MSP430_H
+
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+
+/* CONSTANTS */
+#define BIT0                  0x0001
+#define BIT1                  0x0002
+#define BIT2                  0x0004
+#define BIT3                  0x0008
+#define BIT4                  0x0010
+#define BIT5                  0x0020
+#define BIT6                  0x0040
+#define BIT7                  0x0080
+
+#define GIE                   0x0008
+
+//WDTCTL
+#define WDTPW                 0x5A00
+#define WDTHOLD               0x0080
+#define WDTNMIES              0x0040
+#define WDTNMI                0x0020
+#define WDTTMSEL              0x0010
+#define WDTCNTCL              0x0008
+#define WDTSSEL               0x0004
+#define WDTIS1                0x0002
+#define WDTIS0                0x0001
+#define WDT_ARST_1000         (WDTPW + WDTCNTCL + WDTSSEL)
+
+//IFG1
+#define WDTIFG                0x01
+#define OFIFG                 0x02
+#define PORIFG                0x04
+#define RSTIFG                0x08
+#define NMIIFG                0x10
+
+//FCTL1, FCTL2, FCTL3
+#define FWKEY                 0xA500
+#define ERASE                 0x0002
+#define WRT                   0x0040
+#define FSSEL_0               0x0000
+#define FSSEL_1               0x0040
+#define FSSEL_2               0x0080
+#define FSSEL_3               0x00C0
+#define BUSY                  0x0001
+#define LOCK                  0x0010
+#define LOCKA                 0x0040
+
+//BCSCTL2
+#define DIVS_0                0x00
+#define DIVS_1                0x02
+#define DIVS_2                0x04
+#define DIVS_3                0x06
+
+//TA0CTL
+#define TASSEL_0              0x0000
+#define TASSEL_1              0x0100
+#define TASSEL_2              0x0200
+#define TASSEL_3              0x0300
+#define ID_0                  0x0000
+#define ID_1                  0x0040
+#define ID_2                  0x0080
+#define ID_3                  0x00C0
+#define MC_0                  0x0000
+#define MC_1                  0x0010
+#define MC_2                  0x0020
+#define MC_3                  0x0030
+#define TACLR                 0x0004
+#define TAIE                  0x0002
+#define TAIFG                 0x0001
+
+//TBCTL, the mode bits (MC_x, ID_x) as TA0CTL
+#define TBSSEL_0              0x0000
+#define TBSSEL_1              0x0100
+#define TBSSEL_2              0x0200
+#define TBSSEL_3              0x0300
+#define TBCLR                 0x0004
+
+//TA0CCTLx
+#define CCIE                  0x0010
+#define CCIFG                 0x0001
+
+//TA0IV
+#define TA0IV_NONE            0x0000
+#define TA0IV_TACCR1          0x0002
+#define TA0IV_TACCR2          0x0004
+#define TA0IV_TAIFG           0x000A
+
+//Interrupt vectors, only named by #pragma vector
+#define PORT2_VECTOR          3
+#define TIMER0_A1_VECTOR      8
+#define TIMER0_A0_VECTOR      9
+#define USCIAB0TX_VECTOR      6
+#define USCIAB0RX_VECTOR      7
+#define USCIAB1TX_VECTOR      16
+#define USCIAB1RX_VECTOR      17
+
+//UCBxCTL0
+#define UCA10                 0x80
+#define UCSLA10               0x40
+#define UCMM                  0x20
+#define UCCKPH                0x80 //SPI mode
+#define UCCKPL                0x40
+#define UCMSB                 0x20
+#define UC7BIT                0x10
+#define UCMST                 0x08
+#define UCMODE_0              0x00
+#define UCMODE_1              0x02
+#define UCMODE_2              0x04
+#define UCMODE_3              0x06
+#define UCSYNC                0x01
+
+//UCAxMCTL
+#define UCOS16                0x01
+
+//UCAxSTAT
+#define UCOE                  0x20
+
+//UCBxCTL1
+#define UCSSEL_0              0x00
+#define UCSSEL_1              0x40
+#define UCSSEL_2              0x80
+#define UCSSEL_3              0xC0
+#define UCTR                  0x10
+#define UCTXNACK              0x08
+#define UCTXSTP               0x04
+#define UCTXSTT               0x02
+#define UCSWRST               0x01
+
+//UCBxSTAT
+#define UCSCLLOW              0x40
+#define UCGC                  0x20
+#define UCBBUSY               0x10
+#define UCNACKIFG             0x08
+#define UCSTPIFG              0x04
+#define UCSTTIFG              0x02
+#define UCALIFG               0x01
+
+//UCBxI2CIE
+#define UCNACKIE              0x08
+#define UCSTPIE               0x04
+#define UCSTTIE               0x02
+#define UCALIE                0x01
+
+//IE2, IFG2 (USCI 0) and UC1IE, UC1IFG (USCI 1)
+#define UCA0RXIE              0x01
+#define UCA0TXIE              0x02
+#define UCB0RXIE              0x04
+#define UCB0TXIE              0x08
+#define UCA0RXIFG             0x01
+#define UCA0TXIFG             0x02
+#define UCB0RXIFG             0x04
+#define UCB0TXIFG             0x08
+#define UCA1RXIE              0x01
+#define UCA1TXIE              0x02
+#define UCB1RXIE              0x04
+#define UCB1TXIE              0x08
+#define UCA1RXIFG             0x01
+#define UCA1TXIFG             0x02
+#define UCB1RXIFG             0x04
+#define UCB1TXIFG             0x08
+
+/* DATATYPES */
+
+/* Name: HostUsciRegister_e
+   Type: enum
+   Values:
+    One per USCI_B register of the model, the shared IE and IFG registers, and the USCI_A registers of the UART
+*/
+enum HostUsciRegister_e {HOST_UCB_CTL0 = 0,
+                         HOST_UCB_CTL1,
+                         HOST_UCB_BR0,
+                         HOST_UCB_BR1,
+                         HOST_UCB_STAT,
+                         HOST_UCB_I2CIE,
+                         HOST_UCB_TXBUF,
+                         HOST_UCB_RXBUF,
+                         HOST_UC_IE,
+                         HOST_UC_IFG,
+                         HOST_UCA_CTL0,
+                         HOST_UCA_CTL1,
+                         HOST_UCA_BR0,
+                         HOST_UCA_BR1,
+                         HOST_UCA_MCTL,
+                         HOST_UCA_STAT,
+                         HOST_UCA_TXBUF,
+                         HOST_UCA_RXBUF,
+                         HOST_USCI_REGISTERS};
+typedef enum HostUsciRegister_e HostUsciRegister;
+
+/* REGISTERS */
+volatile unsigned char* hostUsciRegister(int usci, HostUsciRegister name);
+volatile unsigned int* hostUsciAddress(int usci);
+
+#define UCB0CTL0              (*hostUsciRegister(0, HOST_UCB_CTL0))
+#define UCB0CTL1              (*hostUsciRegister(0, HOST_UCB_CTL1))
+#define UCB0BR0               (*hostUsciRegister(0, HOST_UCB_BR0))
+#define UCB0BR1               (*hostUsciRegister(0, HOST_UCB_BR1))
+#define UCB0STAT              (*hostUsciRegister(0, HOST_UCB_STAT))
+#define UCB0I2CIE             (*hostUsciRegister(0, HOST_UCB_I2CIE))
+#define UCB0TXBUF             (*hostUsciRegister(0, HOST_UCB_TXBUF))
+#define UCB0RXBUF             (*hostUsciRegister(0, HOST_UCB_RXBUF))
+#define UCB0I2CSA             (*hostUsciAddress(0))
+#define IE2                   (*hostUsciRegister(0, HOST_UC_IE))
+#define IFG2                  (*hostUsciRegister(0, HOST_UC_IFG))
+
+#ifndef __MSP430G2553__
+#define UCB1CTL0              (*hostUsciRegister(1, HOST_UCB_CTL0))
+#define UCB1CTL1              (*hostUsciRegister(1, HOST_UCB_CTL1))
+#define UCB1BR0               (*hostUsciRegister(1, HOST_UCB_BR0))
+#define UCB1BR1               (*hostUsciRegister(1, HOST_UCB_BR1))
+#define UCB1STAT              (*hostUsciRegister(1, HOST_UCB_STAT))
+#define UCB1I2CIE             (*hostUsciRegister(1, HOST_UCB_I2CIE))
+#define UCB1TXBUF             (*hostUsciRegister(1, HOST_UCB_TXBUF))
+#define UCB1RXBUF             (*hostUsciRegister(1, HOST_UCB_RXBUF))
+#define UCB1I2CSA             (*hostUsciAddress(1))
+#define UC1IE                 (*hostUsciRegister(1, HOST_UC_IE))
+#define UC1IFG                (*hostUsciRegister(1, HOST_UC_IFG))
+#define UCA1CTL0              (*hostUsciRegister(1, HOST_UCA_CTL0))
+#define UCA1CTL1              (*hostUsciRegister(1, HOST_UCA_CTL1))
+#define UCA1BR0               (*hostUsciRegister(1, HOST_UCA_BR0))
+#define UCA1BR1               (*hostUsciRegister(1, HOST_UCA_BR1))
+#define UCA1MCTL              (*hostUsciRegister(1, HOST_UCA_MCTL))
+#define UCA1STAT              (*hostUsciRegister(1, HOST_UCA_STAT))
+#define UCA1TXBUF             (*hostUsciRegister(1, HOST_UCA_TXBUF))
+#define UCA1RXBUF             (*hostUsciRegister(1, HOST_UCA_RXBUF))
+#endif
+
+extern volatile unsigned int WDTCTL;
+extern volatile unsigned char IFG1;
+extern volatile unsigned char DCOCTL, BCSCTL1, BCSCTL2, BCSCTL3;
+extern const volatile unsigned char CALDCO_1MHZ, CALBC1_1MHZ, CALDCO_8MHZ, CALBC1_8MHZ;
+extern const volatile unsigned char CALDCO_12MHZ, CALBC1_12MHZ, CALDCO_16MHZ, CALBC1_16MHZ;
+extern volatile unsigned int FCTL1, FCTL2, FCTL3;
+extern volatile unsigned int TA0CTL, TA0R, TA0IV;
+extern volatile unsigned int TA0CCTL0, TA0CCTL1, TA0CCTL2, TA0CCR0, TA0CCR1, TA0CCR2;
+extern volatile unsigned int TBCTL;
+#define TBR                   hostTimerB()
+extern volatile unsigned char P1IN, P1OUT, P1DIR, P1SEL, P1SEL2, P1IE, P1IES, P1IFG, P1REN;
+extern volatile unsigned char P2IN, P2OUT, P2DIR, P2SEL, P2SEL2, P2IE, P2IES, P2IFG, P2REN;
+extern volatile unsigned char P3IN, P3OUT, P3DIR, P3SEL, P3REN;
+extern volatile unsigned char P4IN, P4OUT, P4DIR, P4SEL, P4REN;
+extern volatile unsigned char P5IN, P5OUT, P5DIR, P5SEL, P5REN;
+extern volatile unsigned char P6IN, P6OUT, P6DIR, P6SEL, P6REN;
+
+/* INTRINSICS */
+unsigned int hostGetInterruptState(void);
+void hostSetInterruptState(unsigned int state);
+
+#define __interrupt
+#define __get_interrupt_state()         hostGetInterruptState()
+#define __set_interrupt_state(state)    hostSetInterruptState(state)
+#define __disable_interrupt()           hostSetInterruptState(0)
+#define __enable_interrupt()            hostSetInterruptState(GIE)
+#define __no_operation()
+
+/* HOST FUNCTIONS */
+
+/* Name: hostRun
+   Parameters:
+    unsigned long steps - bit times to let pass
+   Description:
+    Runs the USCI models on, with interrupts taken as above.  For tools waiting on work done by interrupt routines.
+    Each step is a bit time of whichever USCI is slower.
+*/
+void hostRun(unsigned long steps);
+
+/* Name: hostElapse
+   Parameters:
+    unsigned long microseconds - time to let pass
+   Description:
+    Runs the USCI models and Timer A0 on for that long, each at its own rate, taking interrupts as they come due.  For
+    tools standing in for the time the firmware spends computing or idle.
+*/
+void hostElapse(unsigned long microseconds);
+
+/* Name: hostGetNanoseconds
+   Return value:
+    unsigned long long - time the model has run since the tool started
+*/
+unsigned long long hostGetNanoseconds(void);
+
+/* Name: hostAlarm
+   Parameters:
+    unsigned long long nanoseconds - model time to call it at
+    void (*alarm)(void) - the tool's, 0 for none
+   Description:
+    Calls alarm once, as the time first passes nanoseconds: from a register access (within a bit time), hostRun() or
+    hostElapse() (on the dot), just before the interrupts due are taken.  There is one alarm; setting it again,
+    including from alarm, replaces it.
+*/
+void hostAlarm(unsigned long long nanoseconds, void (*alarm)(void));
+
+/* Name: hostWatchdog
+   Parameters:
+    void (*expired)(void) - the tool's, 0 (as at the start) to leave the watchdog stopped
+   Description:
+    Runs the watchdog timer in watchdog mode, from now: unless WDTHOLD is set, it runs out the interval WDTCTL selects
+    after the last WDTCNTCL, as the model's time passes, whatever the firmware is doing.  Then WDTIFG is set in IFG1 and
+    expired is called, from a register access or hostElapse() as for the alarm; on the board the MCU resets there, so
+    expired is meant to hostReset() the model and not return (longjmp() back to the tool's boot).
+*/
+void hostWatchdog(void (*expired)(void));
+
+/* Name: hostReset
+   Description:
+    The MCU reset: the clock, Timer A0, Timer B, the flash controller, the port directions, selections and interrupts
+    and the watchdog (running) back to their reset values, every USCI held in UCSWRST, GIE cleared and any interrupt
+    routine left.  The time, IFG1, the alarm and RAM (the firmware's statics) are left as they were; the tool sets the
+    reset flags and does crt0's work.
+*/
+void hostReset(void);
+
+/* Name: hostPort2Input
+   Parameters:
+    unsigned char in - levels on the Port 2 pins from now on
+   Description:
+    Sets P2IN, and the P2IFG bits of the pins that changed in the direction P2IES selects (0 rising, 1 falling), then
+    takes the Port 2 interrupt if it is enabled and not held off.
+*/
+void hostPort2Input(unsigned char in);
+
+/* Name: hostTimerB
+   Return value:
+    unsigned int - TBR, the counts of the clock TBSSEL selects, over ID, since TBCLR; it holds while MC is not MC_2
+*/
+unsigned int hostTimerB(void);
+
+/* Name: hostSmclkHz
+   Return value:
+    unsigned long - SMCLK from the clock registers, see above
+*/
+unsigned long hostSmclkHz(void);
+
+/* Name: hostSetStepLimit
+   Parameters:
+    unsigned long steps - steps of the USCI models before the tool is stopped (exit code 1), 0 for no limit
+   Description:
+    So a tool fails, rather than hangs, if the firmware waits on a flag the model never sets.
+*/
+void hostSetStepLimit(unsigned long steps);
+
+/* Name: hostI2cAddress, hostI2cWrite, hostI2cRead, hostI2cStop
+   Description:
+    The slaves on USCI usci, called by the model as the master moves on the bus: an address byte (1 to ACK it), a data
+    byte written to the slave (1 to ACK it), a data byte read from it, and the stop.  The tool defines them; the
+    default ones in msp430.c are an empty bus that NACKs every address.
+*/
+int hostI2cAddress(int usci, unsigned int address, int read);
+int hostI2cWrite(int usci, unsigned char data);
+unsigned char hostI2cRead(int usci);
+void hostI2cStop(int usci);
+
+/* Name: hostSpiExchange
+   Parameters:
+    int usci - USCI_B in SPI mode
+    unsigned char out - byte the master clocked out
+   Return value:
+    unsigned char - byte clocked in at the same time
+   Description:
+    The slave on an SPI bus, called once per byte as it finishes shifting.  The default one in msp430.c is an empty
+    bus that always returns 0xFF.
+*/
+unsigned char hostSpiExchange(int usci, unsigned char out);
+
+/* Name: hostUartTransmit
+   Parameters:
+    int usci - USCI_A in UART mode
+    unsigned char byte - byte that has just gone out, stop bit and all
+   Description:
+    The far end of the UART.  The tool defines it; the default one in msp430.c drops the byte.
+*/
+void hostUartTransmit(int usci, unsigned char byte);
+
+/* Name: hostUartReceive
+   Parameters:
+    int usci - USCI_A in UART mode
+    unsigned char byte - byte that has just come in
+   Description:
+    Puts the byte in UCAxRXBUF and sets UCAxRXIFG, or UCOE if the last one was not read, and takes the interrupt.
+*/
+void hostUartReceive(int usci, unsigned char byte);
+
+/* Name: hostUsciDivider
+   Parameters:
+    int usci - USCI_B
+   Return value:
+    unsigned int - UCBxBR0 and UCBxBR1, the bit clock divider, read without stepping the model
+*/
+unsigned int hostUsciDivider(int usci);
+
+#endif
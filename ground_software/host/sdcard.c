@@ -0,0 +1,299 @@
+/* Author: John Walnut
+   Purpose:
+    The SD card model of host/sdcard.h.
+
+    A command frame is taken whole, whatever was left unread before it, and answered one byte after it (R1, then the
+    rest of R3 or R7).  A read's data token comes HOST_CARD_ACCESS_US after CMD17, then the block and two CRC bytes.
+    In a CMD25 write each block is answered with a data response, then the card reads busy (0x00) for
+    HOST_CARD_PROGRAM_US; STOP_TRAN is busy as long.  Blocks read from the log are valid, with sequence number and first
+    tick from their offset; blocks past its end read as zeros.
+*/
+
+#include <string.h>
+
+#include "msp430.h"
+#include "sdcard.h"
+#include "sd_card.h"
+#include "log_format.h"
+
+/* CONSTANTS */
+#define CARD_QUEUE_LEN        (SD_BLOCK_SIZE + 8)
+
+/* DATATYPES */
+
+/* Name: HostCard_s
+   Type: struct
+   Parameters:
+    unsigned long initUs - init time from the first ACMD41
+    long long initStartUs - first ACMD41 since CMD0, -1 before it
+    long long readyUs - a read's data token goes out from here, -1 with no read pending
+    long long busyUntilUs - programming a block until here
+    char idle - in the idle state, from CMD0 until ACMD41 completes
+    char ready - initialized, takes block commands
+    char app - last command was CMD55
+    char writing - in a CMD25 write: 1 waiting for a token, 2 taking a block
+    unsigned char frame[6] - command frame coming in, framed bytes of it so far
+    int framed
+    unsigned char queue[] - bytes to send back, from queueHead to queueLen
+    int queueHead
+    int queueLen
+    unsigned long readBlock - block of the pending read
+    unsigned long writeBlock - block the next data token goes to
+    unsigned char data[] - block being written, taken bytes of it (data and CRC)
+    int taken
+    char respond - data response owed on the next byte
+*/
+struct HostCard_s {
+  unsigned long initUs;
+  long long initStartUs;
+  long long readyUs;
+  long long busyUntilUs;
+  char idle;
+  char ready;
+  char app;
+  char writing;
+  unsigned char frame[6];
+  int framed;
+  unsigned char queue[CARD_QUEUE_LEN];
+  int queueHead;
+  int queueLen;
+  unsigned long readBlock;
+  unsigned long writeBlock;
+  unsigned char data[SD_BLOCK_SIZE + 2];
+  int taken;
+  char respond;
+};
+typedef struct HostCard_s HostCard;
+
+static HostCard card = {.initStartUs = -1, .readyUs = -1};
+static HostCardStats stats;
+
+/* Name: cardNow
+   Return value:
+    long long - microseconds of the model's time
+*/
+static long long cardNow(void) {
+  return (long long)(hostGetNanoseconds() / 1000);
+}
+
+/* Name: cardLogBlock
+   Description:
+    The block at offset in the log: valid, sequence number offset, if it is before the end of the log, all zeros
+    (never written) if not.
+*/
+static void cardLogBlock(unsigned long offset, unsigned char* block) {
+  memset(block, 0, SD_BLOCK_SIZE);
+  if (offset >= stats.logEnd) {
+    return;
+  }
+  logPut16(block + LOG_HDR_MAGIC, LOG_MAGIC);
+  block[LOG_HDR_VERSION] = LOG_VERSION;
+  block[LOG_HDR_COUNT] = LOG_SAMPLES_PER_BLOCK;
+  logPut32(block + LOG_HDR_SEQUENCE, offset);
+  logPut32(block + LOG_HDR_FIRST_TICK, offset * LOG_SAMPLES_PER_BLOCK);
+  logPut16(block + LOG_CRC_OFFSET, logCrc16(block, LOG_CRC_OFFSET));
+}
+
+static void cardQueue(unsigned char byte) {
+  if (card.queueLen < CARD_QUEUE_LEN) {
+    card.queue[card.queueLen++] = byte;
+  }
+}
+
+/* Name: cardCommand
+   Description:
+    A whole command frame in: the R1 response, one byte after the frame, and what follows it.
+*/
+static void cardCommand(void) {
+  unsigned char command = card.frame[0] & 0x3F;
+  unsigned long argument = (unsigned long)card.frame[1] << 24 | (unsigned long)card.frame[2] << 16 |
+                           (unsigned long)card.frame[3] << 8 | card.frame[4];
+  char app = card.app;
+  unsigned char idle;
+
+  card.app = 0;
+  card.queueHead = 0;
+  card.queueLen = 0;
+  cardQueue(0xFF);
+  if (command == SD_CMD0) {
+    card.idle = 1;
+    card.ready = 0;
+    card.initStartUs = -1;
+    stats.resets++;
+  }
+  idle = card.idle ? SD_R1_IDLE : 0;
+
+  switch (command) {
+    case SD_CMD0:
+    case SD_CMD16:
+      cardQueue(idle);
+      break;
+    case SD_CMD8:
+      cardQueue(idle);
+      cardQueue(0x00);
+      cardQueue(0x00);
+      cardQueue((argument >> 8) & 0x0F);
+      cardQueue(argument & 0xFF);
+      break;
+    case SD_CMD55:
+      card.app = 1;
+      cardQueue(idle);
+      break;
+    case SD_CMD58:
+      cardQueue(idle);
+      cardQueue(card.ready ? 0x80 | SD_OCR_CCS : 0x00);
+      cardQueue(0xFF);
+      cardQueue(0x80);
+      cardQueue(0x00);
+      break;
+    case SD_CMD41:
+      if (!app) {
+        cardQueue(idle | SD_R1_ILLEGAL_CMD);
+        break;
+      }
+      if (card.initStartUs < 0) {
+        card.initStartUs = cardNow();
+      }
+      if (card.idle && cardNow() - card.initStartUs >= (long long)card.initUs) {
+        card.idle = 0;
+        card.ready = 1;
+      }
+      cardQueue(card.idle ? SD_R1_IDLE : 0);
+      break;
+    case SD_CMD23:
+      cardQueue(app ? idle : idle | SD_R1_ILLEGAL_CMD);
+      break;
+    case SD_CMD17:
+      if (!card.ready) {
+        cardQueue(idle | SD_R1_ILLEGAL_CMD);
+        break;
+      }
+      cardQueue(0);
+      card.readBlock = argument;
+      card.readyUs = cardNow() + HOST_CARD_ACCESS_US;
+      stats.reads++;
+      break;
+    case SD_CMD25:
+      if (!card.ready) {
+        cardQueue(idle | SD_R1_ILLEGAL_CMD);
+        break;
+      }
+      cardQueue(0);
+      card.writeBlock = argument;
+      card.writing = 1;
+      break;
+    default:
+      cardQueue(idle | SD_R1_ILLEGAL_CMD);
+      break;
+  }
+}
+
+/* Name: cardWritten
+   Description:
+    A data block in: it is meant to be a valid log block, at the end of the log and carrying it on.
+*/
+static void cardWritten(void) {
+  unsigned long offset = card.writeBlock - LOG_FIRST_BLOCK;
+
+  if (card.writeBlock < LOG_FIRST_BLOCK || offset != stats.logEnd || !logBlockIsValid(card.data) ||
+      logGet32(card.data + LOG_HDR_SEQUENCE) != offset) {
+    stats.misplaced++;
+  }
+  if (card.writeBlock >= LOG_FIRST_BLOCK && offset == stats.logEnd) {
+    stats.logEnd++;
+  }
+  card.writeBlock++;
+  stats.writes++;
+}
+
+unsigned char hostSpiExchange(int usci, unsigned char out) {
+  long long now = cardNow();
+
+  if (usci != 0 || (PRIMARY_I2C_OUT & SD_I2C_ISOL)) { //Deselected, the isolator has the lines
+    return 0xFF;
+  }
+
+  if (card.writing) {
+    if (card.respond) {
+      card.respond = 0;
+      card.busyUntilUs = now + HOST_CARD_PROGRAM_US;
+      return 0xE0 | SD_DATA_ACCEPTED;
+    }
+    if (now < card.busyUntilUs) {
+      return 0x00;
+    }
+    if (card.writing == 2) {
+      card.data[card.taken++] = out;
+      if (card.taken == SD_BLOCK_SIZE + 2) {
+        cardWritten();
+        card.writing = 1;
+        card.respond = 1;
+      }
+      return 0xFF;
+    }
+    if (card.queueHead < card.queueLen) { //R1 of CMD25
+      return card.queue[card.queueHead++];
+    }
+    if (out == SD_TOKEN_MULTI_WRITE) {
+      card.writing = 2;
+      card.taken = 0;
+    } else if (out == SD_TOKEN_STOP_TRAN) {
+      card.writing = 0;
+      card.busyUntilUs = now + HOST_CARD_PROGRAM_US;
+    }
+    return 0xFF;
+  }
+
+  if (now < card.busyUntilUs) {
+    return 0x00;
+  }
+  if (card.framed || (out & 0xC0) == 0x40) { //Command frame, whatever was left unread
+    card.frame[card.framed++] = out;
+    if (card.framed == sizeof(card.frame)) {
+      card.framed = 0;
+      cardCommand();
+    }
+    return 0xFF;
+  }
+  if (card.queueHead < card.queueLen) {
+    return card.queue[card.queueHead++];
+  }
+  if (card.readyUs >= 0 && now >= card.readyUs) { //Read: token, block, CRC
+    card.readyUs = -1;
+    card.queueHead = 0;
+    card.queueLen = 0;
+    cardQueue(SD_TOKEN_READ);
+    cardLogBlock(card.readBlock - LOG_FIRST_BLOCK, card.queue + card.queueLen);
+    card.queueLen += SD_BLOCK_SIZE;
+    cardQueue(0xFF);
+    cardQueue(0xFF);
+    return card.queue[card.queueHead++];
+  }
+  return 0xFF;
+}
+
+void hostCardPowerOn(unsigned long initUs) {
+  memset(&card, 0, sizeof(card));
+  card.initUs = initUs;
+  card.initStartUs = -1;
+  card.readyUs = -1;
+}
+
+void hostCardReset(unsigned long initUs) {
+  card.initUs = initUs;
+  if (!card.ready) { //Starting over from CMD0
+    card.initStartUs = -1;
+  }
+  card.busyUntilUs = 0;
+  card.framed = 0;
+  card.queueHead = 0;
+  card.queueLen = 0;
+  card.readyUs = -1;
+  card.writing = 0;
+  card.respond = 0;
+  card.app = 0;
+}
+
+HostCardStats* hostCardGetStats(void) {
+  return &stats;
+}
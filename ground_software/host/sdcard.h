@@ -0,0 +1,68 @@
+/* Author: John Walnut
+   Purpose:
+    SD card on UCB0 in SPI mode, for tools that run the firmware's sd_card.c and recorder.c on host/msp430.h.  Linking
+    host/sdcard.c puts the card behind hostSpiExchange(); it answers while the isolator (SD_I2C_ISOL) is selected:
+
+      gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM ... host/msp430.c host/sdcard.c ../main_software/sd_card.c
+
+    The card takes CMD0, 8, 55, 41, 58, 16, 17, 23 and 25, timed by hostGetNanoseconds().  It is ready its init time
+    after the first ACMD41 since CMD0 and stays initialized until hostCardPowerOn().  Its log (log_format.h) holds
+    logEnd valid blocks from LOG_FIRST_BLOCK, sequence numbers from 0, and every block written is meant to be the next
+    one: a block written anywhere else, or not carrying the log on, is counted in misplaced.
+*/
+
+#ifndef HOST_SDCARD_H
+#define HOST_SDCARD_H
+
+/* CONSTANTS */
+#define HOST_CARD_ACCESS_US   1000UL //CMD17 to the data token
+#define HOST_CARD_PROGRAM_US  2000UL //Busy after each block of a write
+
+/* DATATYPES */
+
+/* Name: HostCardStats_s
+   Type: struct
+   Parameters:
+    unsigned long logEnd - offset of the first block not yet in the log
+    unsigned long reads - CMD17 taken
+    unsigned long writes - blocks written
+    unsigned long resets - CMD0 taken
+    unsigned long misplaced - blocks written anywhere but the end of the log, or not the next block of it
+   Purpose:
+    What the card has seen.  The tool sets logEnd before the firmware first looks, and may clear the counts.
+*/
+struct HostCardStats_s {
+  unsigned long logEnd;
+  unsigned long reads;
+  unsigned long writes;
+  unsigned long resets;
+  unsigned long misplaced;
+};
+typedef struct HostCardStats_s HostCardStats;
+
+/* FUNCTIONS */
+
+/* Name: hostCardPowerOn
+   Parameters:
+    unsigned long initUs - time from the first ACMD41 to the card being ready
+   Description:
+    The card as it powers up, not initialized.  The log and the counts are kept.
+*/
+void hostCardPowerOn(unsigned long initUs);
+
+/* Name: hostCardReset
+   Parameters:
+    unsigned long initUs - init time from here on
+   Description:
+    The MCU reset under the card: a command half sent and a read or write under way are dropped, and programming has
+    finished by the time the firmware is back.  The card stays initialized.
+*/
+void hostCardReset(unsigned long initUs);
+
+/* Name: hostCardGetStats
+   Return value:
+    HostCardStats* - the card's log end and counts
+*/
+HostCardStats* hostCardGetStats(void);
+
+#endif
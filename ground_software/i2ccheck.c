@@ -0,0 +1,430 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's I2C driver (main_software/i2c_driver.c) against the USCI model of host/msp430.c,
+    once for each target it is compiled for:
+
+      i2ccheck            F2618: PRIMARY on UCB0, SECONDARY on UCB1
+      i2ccheck_g2553      G2553: PRIMARY on UCB0 only
+
+    Each interface has a slave at SLAVE_ADDRESS on it, a bank of registers as the sensors have: a write sets the
+    register pointer and stores any bytes after it, a read returns bytes from the pointer on, and both move the pointer
+    on.  The two banks hold different bytes, so a message that goes out on the wrong interface reads back wrong.
+
+    For every interface it checks i2cInit() (pins selected, divider programmed), writes and reads of 1, 2 and 6 bytes,
+    blocking and interrupt driven, that the slave was asked for exactly the bytes the message wanted (one more for an
+    interrupt driven single byte read, whose stop comes from the RX interrupt) and that the next read does not see the
+    byte dropped, retries after the address is NACKed, giving up with I2CERR_NACK_LIMIT_REACHED after MAX_NACK of them
+    and then working again, I2CERR_BUS_BUSY while a message is in progress, the idle hook, and i2cAcquireInterface()
+    refusing while the last stop goes out and keeping messages off until i2cReleaseInterface().  On the G2553 it also
+    checks that SECONDARY is refused.
+
+    Then it measures the payload rate (bytes/s) of each device's usual transaction on the model, interrupt driven and
+    back to back, THROUGHPUT_MESSAGES of them, with SMCLK on the 1 MHz and the 16 MHz calibrations and the interface
+    configured for I2C_FAST_HZ: at standard mode, at the device's own limit (i2cSetMessageRate()), and the IMU and
+    antenna transactions taking turns, so the divider changes before every message.  The model takes a bit time at each
+    register access and none for the code between them, so the rates are of the bus and the driver's register traffic,
+    not of the CPU.  It checks that a device is never run faster than its limit, that its own limit is no slower than
+    standard mode, and that no rate beats what the bus can carry.
+
+    It fails (exit code 1) if any check does, or if the driver waits for a flag that never comes.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o i2ccheck i2ccheck.c host/msp430.c \
+        ../main_software/i2c_driver.c
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -D__MSP430G2553__ -o i2ccheck_g2553 i2ccheck.c \
+        host/msp430.c ../main_software/i2c_driver.c
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "i2c_driver.h"
+#include "i2c_peripherals.h"
+#include "data.h"
+
+/* CONSTANTS */
+#define SLAVE_ADDRESS         0x68
+#define SLAVE_REGISTERS       64
+#define RUN_LIMIT             100000UL //Steps an interrupt driven message may take
+#define STEP_LIMIT            10000000UL //Steps of the whole run, far more than it takes
+#define THROUGHPUT_MESSAGES   200
+#define BYTE_BITS             9 //Eight and the acknowledge
+#define FRAME_BITS            (2 * BYTE_BITS + 3) //Address twice, start, repeated start and stop
+
+/* Name: Slave_s
+   Type: struct
+   Parameters:
+    unsigned char registers[] - the bank
+    unsigned char pointer - register the next byte goes to or comes from
+    char addressed - 1 while the slave is in a transfer, 2 once the register pointer has been written in it
+    int nacks - addresses to NACK before answering
+    int reads - bytes read from the slave since the last stop
+    int readTotal - bytes read in the last transfer that ended with a stop
+*/
+struct Slave_s {
+  unsigned char registers[SLAVE_REGISTERS];
+  unsigned char pointer;
+  char addressed;
+  int nacks;
+  int reads;
+  int readTotal;
+};
+typedef struct Slave_s Slave;
+
+/* Name: Device_s
+   Type: struct
+   Parameters:
+    const char* name
+    int txBytes - register and any data written
+    int rxBytes - read back
+    unsigned long limitHz - fastest rate it takes, i2c_peripherals.h
+*/
+struct Device_s {
+  const char* name;
+  int txBytes;
+  int rxBytes;
+  unsigned long limitHz;
+};
+typedef struct Device_s Device;
+
+static const Device devices[] = {{"gyro read", IMU_DATA_MSG_LEN, IMU_DATA_RESP_LEN, IMU_I2C_MAX_HZ},
+                                 {"magnet read", IMU_DATA_MSG_LEN, IMU_DATA_RESP_LEN, MAGNET_I2C_MAX_HZ},
+                                 {"antenna status", 1, 2, ANTENNA_I2C_MAX_HZ}};
+
+static Slave slaves[I2C_INTERFACE_COUNT];
+static int failures;
+static int hookCalls[I2C_INTERFACE_COUNT];
+
+/* The bus, for host/msp430.c */
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  Slave* slave = &slaves[usci];
+
+  if (address != SLAVE_ADDRESS) {
+    return 0;
+  }
+  if (slave->nacks > 0) {
+    slave->nacks--;
+    return 0;
+  }
+  slave->addressed = 1;
+  return 1;
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  Slave* slave = &slaves[usci];
+
+  if (slave->addressed == 1) {
+    slave->pointer = data % SLAVE_REGISTERS;
+    slave->addressed = 2;
+  } else {
+    slave->registers[slave->pointer] = data;
+    slave->pointer = (slave->pointer + 1) % SLAVE_REGISTERS;
+  }
+  return 1;
+}
+
+unsigned char hostI2cRead(int usci) {
+  Slave* slave = &slaves[usci];
+  unsigned char data = slave->registers[slave->pointer];
+
+  slave->pointer = (slave->pointer + 1) % SLAVE_REGISTERS;
+  slave->reads++;
+  return data;
+}
+
+void hostI2cStop(int usci) {
+  slaves[usci].addressed = 0;
+  slaves[usci].readTotal = slaves[usci].reads;
+  slaves[usci].reads = 0;
+}
+
+/* The firmware's radio.h, whose UCA1 shares the USCI 1 vectors */
+
+void radioServiceTx(void) {
+}
+
+void radioServiceRx(void) {
+}
+
+static void countHook(char i2cInterface) {
+  hookCalls[(int)i2cInterface]++;
+}
+
+static int divider(char interface) {
+#if I2C_INTERFACE_COUNT > 1
+  if (interface) {
+    return UCB1BR0 | UCB1BR1 << 8;
+  }
+#endif
+  return UCB0BR0 | UCB0BR1 << 8;
+}
+
+static volatile unsigned char* control(char interface) {
+#if I2C_INTERFACE_COUNT > 1
+  if (interface) {
+    return &UCB1CTL1;
+  }
+#endif
+  return &UCB0CTL1;
+}
+
+static void check(int passed, const char* what, int interface) {
+  if (!passed) {
+    printf("FAIL: interface %d: %s\n", interface, what);
+    failures++;
+  }
+}
+
+/* Name: transfer
+   Parameters:
+    char interface - PRIMARY or SECONDARY
+    char async - 1 for i2cStartMessage(), 0 for i2cSendMessage()
+    char* tx, int txLen - bytes to write (register first)
+    char* rx, int rxLen - bytes to read after them, 0 for a write
+   Return value:
+    I2CError - result of the message
+*/
+static I2CError transfer(char interface, char async, char* tx, int txLen, char* rx, int rxLen) {
+  I2CMessage message;
+  unsigned long steps = 0;
+
+  i2cInitializeMessage(&message, tx, txLen, SLAVE_ADDRESS, rxLen ? RX_MODE : TX_MODE, rxLen, rx, interface);
+  if (message.error != I2CERR_NO_ERROR) {
+    return message.error;
+  }
+  if (!async) {
+    i2cSendMessage(&message);
+    return message.error;
+  }
+  i2cStartMessage(&message);
+  while (message.error == I2CERR_IN_PROGRESS && steps++ < RUN_LIMIT) {
+    hostRun(1);
+  }
+  hostRun(2 * 9); //Let the stop go out
+  return message.error;
+}
+
+static void checkInterface(char interface) {
+  static const int lengths[] = {1, 2, 6};
+  Slave* slave = &slaves[(int)interface];
+  I2CConfig config;
+  char tx[8];
+  char rx[8];
+  int async;
+  int n;
+  int i;
+
+  for (n = 0; n < SLAVE_REGISTERS; n++) {
+    slave->registers[n] = (unsigned char)(n * 7 + 0x40 * interface + 1);
+  }
+
+  i2cInitializeConfigRate(&config, interface, I2C_STANDARD_HZ);
+  i2cInit(&config);
+  check(config.error == I2CERR_NO_ERROR, "i2cInit() failed", interface);
+#if defined(__MSP430G2553__)
+  check((P1SEL & (BIT6 + BIT7)) == BIT6 + BIT7 && (P1SEL2 & (BIT6 + BIT7)) == BIT6 + BIT7, "P1.6/P1.7 not selected",
+        interface);
+#else
+  check(((interface ? P5SEL : P3SEL) & (BIT1 + BIT2)) == BIT1 + BIT2, "SCL/SDA not selected", interface);
+#endif
+  check(divider(interface) == i2cBaudDivider(I2C_STANDARD_HZ), "divider not programmed", interface);
+
+  for (async = 0; async <= 1; async++) {
+    for (n = 0; n < (int)(sizeof(lengths) / sizeof(lengths[0])); n++) {
+      int length = lengths[n];
+      char what[80];
+
+      //Write length bytes from register 8 on, then read them back
+      tx[0] = 8;
+      for (i = 0; i < length; i++) {
+        tx[i + 1] = (char)(0xA0 + 16 * async + i + interface);
+      }
+      sprintf(what, "%s write of %d byte(s)", async ? "interrupt driven" : "blocking", length);
+      check(transfer(interface, async, tx, length + 1, 0, 0) == I2CERR_NO_ERROR, what, interface);
+      check(!memcmp(slave->registers + 8, tx + 1, length), what, interface);
+
+      memset(rx, 0, sizeof(rx));
+      sprintf(what, "%s read of %d byte(s)", async ? "interrupt driven" : "blocking", length);
+      check(transfer(interface, async, tx, 1, rx, length) == I2CERR_NO_ERROR, what, interface);
+      check(!memcmp(rx, tx + 1, length), what, interface);
+      sprintf(what, "%s read of %d byte(s) took %d from the slave", async ? "interrupt driven" : "blocking", length,
+              slave->readTotal);
+      check(slave->readTotal == length + (async && length == 1), what, interface); //One more for the stop, dropped
+    }
+
+    //A single byte read, then a blocking one that must not see the byte dropped
+    tx[0] = 20;
+    check(transfer(interface, async, tx, 1, rx, 1) == I2CERR_NO_ERROR && (unsigned char)rx[0] == slave->registers[20],
+          async ? "interrupt driven single byte read" : "blocking single byte read", interface);
+    tx[0] = 30;
+    check(transfer(interface, 0, tx, 1, rx, 2) == I2CERR_NO_ERROR && (unsigned char)rx[0] == slave->registers[30] &&
+          (unsigned char)rx[1] == slave->registers[31], "blocking read after a single byte read", interface);
+
+    //NACKed twice, then answered
+    slave->nacks = 2;
+    tx[0] = 0;
+    check(transfer(interface, async, tx, 1, rx, 2) == I2CERR_NO_ERROR && (unsigned char)rx[1] == slave->registers[1],
+          async ? "interrupt driven retry after NACK" : "blocking retry after NACK", interface);
+
+    //Never answered, then the slave is back
+    slave->nacks = MAX_NACK;
+    check(transfer(interface, async, tx, 1, rx, 2) == I2CERR_NACK_LIMIT_REACHED,
+          async ? "interrupt driven NACK limit" : "blocking NACK limit", interface);
+    slave->nacks = 0;
+    check(transfer(interface, async, tx, 1, rx, 2) == I2CERR_NO_ERROR,
+          async ? "interrupt driven message after NACK limit" : "blocking message after NACK limit", interface);
+  }
+
+  //A second message while one is in progress, and the hook once it ends
+  {
+    I2CMessage first;
+    I2CMessage second;
+    unsigned long steps = 0;
+
+    hookCalls[(int)interface] = 0;
+    i2cSetIdleHook(interface, countHook);
+    tx[0] = 0;
+    i2cInitializeMessage(&first, tx, 1, SLAVE_ADDRESS, RX_MODE, 6, rx, interface);
+    i2cInitializeMessage(&second, tx, 1, SLAVE_ADDRESS, RX_MODE, 1, rx + 6, interface);
+    i2cStartMessage(&first);
+    i2cStartMessage(&second);
+    check(second.error == I2CERR_BUS_BUSY && i2cIsBusy(interface), "second message not refused", interface);
+    i2cSendMessage(&second);
+    check(second.error == I2CERR_BUS_BUSY, "blocking message not refused", interface);
+    while (first.error == I2CERR_IN_PROGRESS && steps++ < RUN_LIMIT) {
+      hostRun(1);
+    }
+    check(first.error == I2CERR_NO_ERROR && !i2cIsBusy(interface), "message under a refused one", interface);
+    check(hookCalls[(int)interface] == 1, "idle hook not run once", interface);
+
+    //Taken for the SD card: not while a stop goes out (held here, the model only ends one after a transfer), then no
+    //message until it is given back
+    hostRun(2 * 9);
+    *control(interface) |= UCTXSTP;
+    check(!i2cAcquireInterface(interface) && i2cIsBusy(interface), "interface taken while the stop goes out",
+          interface);
+    *control(interface) &= ~UCTXSTP;
+    check(i2cAcquireInterface(interface), "idle interface not taken", interface);
+    check(!i2cAcquireInterface(interface), "interface taken twice", interface);
+    i2cSendMessage(&second);
+    check(second.error == I2CERR_BUS_BUSY, "message on a taken interface", interface);
+    i2cReleaseInterface(interface);
+    check(hookCalls[(int)interface] == 2 && !i2cIsBusy(interface), "interface not given back", interface);
+    i2cSetIdleHook(interface, 0);
+  }
+}
+
+/* Name: throughput
+   Parameters:
+    char interface - PRIMARY or SECONDARY
+    const Device* first, const Device* second - transactions taking turns, the same one twice for one device
+    char limited - 1 at each device's limitHz, 0 at I2C_STANDARD_HZ
+   Return value:
+    unsigned long - payload bytes/s over THROUGHPUT_MESSAGES messages, 0 if one failed
+*/
+static unsigned long throughput(char interface, const Device* first, const Device* second, char limited) {
+  I2CMessage message;
+  char tx[8] = {0};
+  char rx[8];
+  unsigned long long start = hostGetNanoseconds();
+  unsigned long bytes = 0;
+  int n;
+
+  for (n = 0; n < THROUGHPUT_MESSAGES; n++) {
+    const Device* device = (n & 1) ? second : first;
+    unsigned long steps = 0;
+
+    i2cInitializeMessage(&message, tx, device->txBytes, SLAVE_ADDRESS, RX_MODE, device->rxBytes, rx, interface);
+    i2cSetMessageRate(&message, limited ? device->limitHz : I2C_STANDARD_HZ);
+    do { //The last stop may still be going out
+      i2cStartMessage(&message);
+      if (message.error == I2CERR_BUS_BUSY) {
+        hostElapse(1);
+      }
+    } while (message.error == I2CERR_BUS_BUSY && steps++ < RUN_LIMIT);
+    while (message.error == I2CERR_IN_PROGRESS && steps++ < RUN_LIMIT) {
+      hostElapse(1);
+    }
+    if (message.error != I2CERR_NO_ERROR) {
+      return 0;
+    }
+    bytes += device->rxBytes;
+  }
+  return (unsigned long)(bytes * 1000000000ULL / (hostGetNanoseconds() - start));
+}
+
+/* Name: checkThroughput
+   Parameters:
+    char interface - PRIMARY or SECONDARY
+    int calibration - 1 or 16, the DCO calibration SMCLK runs on
+   Description:
+    Prints each device's rate at standard mode and at its limit, and the bus rate it was given.
+*/
+static void checkThroughput(char interface, int calibration) {
+  I2CConfig config;
+  char what[80];
+  int n;
+
+  if (calibration == 16) {
+    BCSCTL1 = CALBC1_16MHZ;
+    DCOCTL = CALDCO_16MHZ;
+  } else {
+    BCSCTL1 = CALBC1_1MHZ;
+    DCOCTL = CALDCO_1MHZ;
+  }
+  i2cSetSourceClock(hostSmclkHz());
+  i2cInitializeConfigRate(&config, interface, I2C_FAST_HZ);
+  i2cInit(&config);
+
+  printf("\nInterface %d, SMCLK %lu Hz\n%-18s %7s %7s %9s %9s\n", interface, hostSmclkHz(), "bytes/s (model)", "kHz",
+         "bus Hz", "100kHz", "limit");
+  for (n = 0; n < (int)(sizeof(devices) / sizeof(devices[0])); n++) {
+    const Device* device = &devices[n];
+    unsigned long standard = throughput(interface, device, device, 0);
+    unsigned long limit = throughput(interface, device, device, 1);
+    unsigned long busHz = hostSmclkHz() / divider(interface); //Of the last message, at the limit
+    unsigned long carried = busHz / BYTE_BITS * device->rxBytes /
+                            (device->txBytes + device->rxBytes + FRAME_BITS / BYTE_BITS);
+
+    printf("%-18s %7lu %7lu %9lu %9lu\n", device->name, device->limitHz / 1000, busHz, standard, limit);
+    sprintf(what, "%s: run at %lu Hz, over its %lu Hz", device->name, busHz, device->limitHz);
+    check(busHz <= device->limitHz, what, interface);
+    sprintf(what, "%s: %lu bytes/s at its limit, %lu at standard mode", device->name, limit, standard);
+    check(standard && limit >= standard, what, interface);
+    sprintf(what, "%s: %lu bytes/s, the bus carries %lu", device->name, limit, carried);
+    check(limit <= carried, what, interface);
+  }
+  {
+    unsigned long mixed = throughput(interface, &devices[0], &devices[2], 1);
+
+    printf("%-18s %7s %7s %9s %9lu\n", "gyro + antenna", "", "", "", mixed);
+    check(mixed != 0, "gyro and antenna taking turns", interface);
+  }
+}
+
+int main(void) {
+  int interface;
+
+  hostSetStepLimit(STEP_LIMIT);
+  __enable_interrupt();
+  for (interface = 0; interface < I2C_INTERFACE_COUNT; interface++) {
+    checkInterface((char)interface);
+  }
+#if I2C_INTERFACE_COUNT == 1
+  {
+    I2CConfig config;
+
+    i2cInitializeConfigRate(&config, SECONDARY, I2C_STANDARD_HZ);
+    check(config.error == I2CERR_BAD_PARAMETERS, "SECONDARY accepted on a one interface target", SECONDARY);
+  }
+#endif
+  for (interface = 0; interface < I2C_INTERFACE_COUNT; interface++) {
+    checkThroughput((char)interface, 1);
+    checkThroughput((char)interface, 16);
+  }
+
+  printf("\n%d interface(s) checked\n%s\n", I2C_INTERFACE_COUNT, failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
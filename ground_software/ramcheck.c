@@ -0,0 +1,539 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that checks the firmware's RAM budget (main_software/inc/arena.h) against the statics the modules
+    actually declare:
+
+      ramcheck <object>
+
+    The object is the flight modules built for the host with debug information and linked into one relocatable file
+    (the second Build line).  ramcheck reads its DWARF through readelf and lays out every static it finds, in each
+    module, with the MSP430's sizes instead of the host's: char 1 byte, short, int, enums and pointers 2, long 4,
+    long long and double 8, everything but char aligned to 2.  Only variables with a fixed address count, and not
+    the const ones, which the MSP430 keeps in flash.  os_shim.c stands in for Salvo's control blocks.
+
+    The arena's pools (pool and keptPool in arena.c) are sized from arena.h with host sizes in that build, so they are
+    left out and the budgets worked out again from the buffer depths, with the MSP430's sizes of the types in them.
+    The same sums with the host's sizes have to give arena.h's ARENA_*_BYTES, so a budget that changes in arena.h
+    without changing here is caught.
+
+    It prints the statics of each module and the largest of them, then the budget: the arena, the statics outside it
+    against RAM_STATIC_RESERVE, RAM_STACK_BUDGET, and their total against RAM_BYTES.  It fails (exit code 1) if the
+    statics overrun the reserve or the total overruns the RAM, or if the sums no longer match arena.h.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o ramcheck ramcheck.c
+    gcc -g -O0 -w -r -nostdlib -Ihost -I../main_software/inc -DOS_SHIM -o ramcheck_fw.o ../main_software/antenna.c \
+        ../main_software/arena.c ../main_software/boot.c ../main_software/bulk.c ../main_software/calib.c \
+        ../main_software/clock.c ../main_software/command.c ../main_software/config.c ../main_software/data.c \
+        ../main_software/decim.c ../main_software/downlink.c ../main_software/drdy.c ../main_software/fec.c \
+        ../main_software/flash.c ../main_software/i2c_driver.c ../main_software/log_format.c ../main_software/main.c \
+        ../main_software/os_shim.c ../main_software/periodic.c ../main_software/profile.c ../main_software/radio.c \
+        ../main_software/recorder.c ../main_software/sampler.c ../main_software/sd_card.c \
+        ../main_software/snapshot.c ../main_software/tasks.c ../main_software/telemetry.c ../main_software/watchdog.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+/* CONSTANTS */
+#define NAME_LEN              64
+#define LINE_LEN              512
+#define MODULES               40
+#define READELF               "readelf --debug-dump=info --wide "
+
+enum Tag_e {TAG_OTHER = 0,
+            TAG_COMPILE_UNIT,
+            TAG_BASE,
+            TAG_POINTER,
+            TAG_TYPEDEF,
+            TAG_CONST,
+            TAG_VOLATILE,
+            TAG_ARRAY,
+            TAG_SUBRANGE,
+            TAG_STRUCTURE,
+            TAG_UNION,
+            TAG_MEMBER,
+            TAG_ENUMERATION,
+            TAG_VARIABLE,
+            TAG_SUBROUTINE};
+
+static const char* const tagName[] = {"", "DW_TAG_compile_unit", "DW_TAG_base_type", "DW_TAG_pointer_type",
+                                      "DW_TAG_typedef", "DW_TAG_const_type", "DW_TAG_volatile_type",
+                                      "DW_TAG_array_type", "DW_TAG_subrange_type", "DW_TAG_structure_type",
+                                      "DW_TAG_union_type", "DW_TAG_member", "DW_TAG_enumeration_type",
+                                      "DW_TAG_variable", "DW_TAG_subroutine_type"};
+
+/* Name: Die_s
+   Type: struct
+   Parameters:
+    unsigned long offset - in .debug_info, what DW_AT_type and the like refer to
+    int depth - 0 for a compile unit, its children 1, ...
+    int tag - Tag_e
+    char name[]
+    unsigned long type - DIE of its type, 0 for none (void)
+    long hostSize - DW_AT_byte_size, -1 if it has none
+    long count - elements of a subrange, -1 if unbounded
+    char fixed - has a DW_OP_addr location: a static, or a global defined here
+    char declaration - DW_AT_declaration, defined elsewhere
+    unsigned long origin - DW_AT_specification or DW_AT_abstract_origin, 0 for none
+    int module - index of its compile unit's module
+    long size - MSP430 size once worked out, -1 before
+    char counted - already in a module's total
+*/
+struct Die_s {
+  unsigned long offset;
+  int depth;
+  int tag;
+  char name[NAME_LEN];
+  unsigned long type;
+  long hostSize;
+  long count;
+  char fixed;
+  char declaration;
+  unsigned long origin;
+  int module;
+  long size;
+  char counted;
+};
+typedef struct Die_s Die;
+
+/* Name: Module_s
+   Type: struct
+   Parameters:
+    char name[] - source file, without its directory
+    long bytes - statics, MSP430 sizes
+    long arena - of them, the arena's pools
+    char largest[] - largest static, and its size
+    long largestBytes
+*/
+struct Module_s {
+  char name[NAME_LEN];
+  long bytes;
+  long arena;
+  char largest[NAME_LEN];
+  long largestBytes;
+};
+typedef struct Module_s Module;
+
+static Die* dies;
+static int dieCount;
+static Module modules[MODULES];
+static int moduleCount;
+static int failures;
+
+/* Reading the DWARF */
+
+/* Name: attributeValue
+   Return value:
+    char* - what follows the attribute's name and colon, less the form readelf puts first ("(data1) 4")
+*/
+static char* attributeValue(char* line) {
+  char* value = strstr(line, ": ");
+
+  if (!value) {
+    return line + strlen(line);
+  }
+  value += 2;
+  while (*value == ' ') {
+    value++;
+  }
+  if (*value == '(' && strncmp(value, "(indirect", 9) && strncmp(value, "(offset", 7)) { //The form
+    char* end = strchr(value, ')');
+
+    if (end) {
+      value = end + 1;
+      while (*value == ' ') {
+        value++;
+      }
+    }
+  }
+  value[strcspn(value, "\r\n")] = 0;
+  return value;
+}
+
+/* Name: attributeName
+   Description:
+    Copies a name, which readelf gives after "(offset: 0x...): " when it is in a string table.
+*/
+static void attributeName(char* value, char* name) {
+  char* last = value;
+  char* p;
+
+  while ((p = strstr(last, "): "))) {
+    last = p + 3;
+  }
+  strncpy(name, last, NAME_LEN - 1);
+  name[NAME_LEN - 1] = 0;
+}
+
+static unsigned long attributeReference(char* value) {
+  char* p = strstr(value, "<0x");
+
+  return p ? strtoul(p + 1, NULL, 16) : 0;
+}
+
+/* Name: readDies
+   Return value:
+    int - 1 if readelf gave any DIEs
+   Description:
+    Reads every DIE with the attributes the layout needs.  readelf lists them in offset order.
+*/
+static int readDies(const char* object) {
+  char command[LINE_LEN];
+  char line[LINE_LEN];
+  int allocated = 0;
+  int module = -1;
+  FILE* in;
+
+  snprintf(command, sizeof(command), READELF "'%s' 2>/dev/null", object);
+  in = popen(command, "r");
+  if (!in) {
+    return 0;
+  }
+  while (fgets(line, sizeof(line), in)) {
+    int depth;
+    unsigned long offset;
+    char tag[NAME_LEN];
+    Die* die = dieCount ? &dies[dieCount - 1] : 0;
+    char* value;
+
+    if (sscanf(line, " <%d><%lx>: Abbrev Number: %*d (%63[^)])", &depth, &offset, tag) == 3) {
+      int n;
+
+      if (dieCount == allocated) {
+        allocated = allocated ? 2 * allocated : 4096;
+        dies = realloc(dies, allocated * sizeof(Die));
+      }
+      die = &dies[dieCount++];
+      memset(die, 0, sizeof(*die));
+      die->offset = offset;
+      die->depth = depth;
+      die->hostSize = -1;
+      die->count = -1;
+      die->size = -1;
+      for (n = 1; n < (int)(sizeof(tagName) / sizeof(tagName[0])); n++) {
+        if (!strcmp(tag, tagName[n])) {
+          die->tag = n;
+        }
+      }
+      if (die->tag == TAG_COMPILE_UNIT && moduleCount < MODULES) {
+        module = moduleCount++;
+      }
+      die->module = module;
+      continue;
+    }
+    if (!die || !strstr(line, "DW_AT_")) {
+      continue;
+    }
+    value = attributeValue(line);
+    if (strstr(line, "DW_AT_name ") || strstr(line, "DW_AT_name:")) {
+      attributeName(value, die->name);
+      if (die->tag == TAG_COMPILE_UNIT && module >= 0) {
+        char* base = strrchr(die->name, '/');
+
+        strcpy(modules[module].name, base ? base + 1 : die->name);
+      }
+    } else if (strstr(line, "DW_AT_type ") || strstr(line, "DW_AT_type:")) {
+      die->type = attributeReference(value);
+    } else if (strstr(line, "DW_AT_byte_size")) {
+      die->hostSize = strtol(value, NULL, 0);
+    } else if (strstr(line, "DW_AT_upper_bound")) {
+      die->count = strtol(value, NULL, 0) + 1;
+    } else if (strstr(line, "DW_AT_count")) {
+      die->count = strtol(value, NULL, 0);
+    } else if (strstr(line, "DW_AT_location") && strstr(value, "DW_OP_addr")) {
+      die->fixed = 1;
+    } else if (strstr(line, "DW_AT_declaration")) {
+      die->declaration = 1;
+    } else if (strstr(line, "DW_AT_specification") || strstr(line, "DW_AT_abstract_origin")) {
+      die->origin = attributeReference(value);
+    }
+  }
+  pclose(in);
+  return dieCount > 0;
+}
+
+static Die* findDie(unsigned long offset) {
+  int low = 0;
+  int high = dieCount - 1;
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+
+    if (dies[middle].offset == offset) {
+      return &dies[middle];
+    }
+    if (dies[middle].offset < offset) {
+      low = middle + 1;
+    } else {
+      high = middle - 1;
+    }
+  }
+  return 0;
+}
+
+/* The MSP430's layout */
+
+static long roundUp(long n, long align) {
+  return (n + align - 1) / align * align;
+}
+
+/* Name: baseSize
+   Return value:
+    long - MSP430 size of a base type, by its name
+*/
+static long baseSize(const Die* die) {
+  if (die->hostSize <= 1) {
+    return die->hostSize < 0 ? 0 : die->hostSize;
+  }
+  if (strstr(die->name, "long long") || strstr(die->name, "double")) {
+    return 8;
+  }
+  if (strstr(die->name, "long") || strstr(die->name, "float")) {
+    return 4;
+  }
+  return 2; //short, int
+}
+
+/* Name: typeSize
+   Parameters:
+    unsigned long offset - DIE of the type
+    long* align - its alignment, 1 or 2
+   Return value:
+    long - its size on the MSP430
+*/
+static long typeSize(unsigned long offset, long* align) {
+  Die* die = findDie(offset);
+  long size = 0;
+  long memberAlign;
+  int n;
+
+  *align = 1;
+  if (!die) {
+    return 0;
+  }
+  switch (die->tag) {
+    case TAG_BASE:
+      size = baseSize(die);
+      break;
+    case TAG_POINTER:
+    case TAG_ENUMERATION:
+    case TAG_SUBROUTINE:
+      size = 2;
+      break;
+    case TAG_TYPEDEF:
+    case TAG_CONST:
+    case TAG_VOLATILE:
+      return typeSize(die->type, align);
+    case TAG_ARRAY:
+      size = typeSize(die->type, align);
+      for (n = die - dies + 1; n < dieCount && dies[n].depth > die->depth; n++) {
+        if (dies[n].depth == die->depth + 1 && dies[n].tag == TAG_SUBRANGE) {
+          size *= dies[n].count < 0 ? 0 : dies[n].count;
+        }
+      }
+      return size;
+    case TAG_STRUCTURE:
+    case TAG_UNION:
+      for (n = die - dies + 1; n < dieCount && dies[n].depth > die->depth; n++) {
+        if (dies[n].depth == die->depth + 1 && dies[n].tag == TAG_MEMBER) {
+          long member = typeSize(dies[n].type, &memberAlign);
+
+          if (memberAlign > *align) {
+            *align = memberAlign;
+          }
+          if (die->tag == TAG_UNION) {
+            size = member > size ? member : size;
+          } else {
+            size = roundUp(size, memberAlign) + member;
+          }
+        }
+      }
+      return roundUp(size, *align);
+    default:
+      return 0;
+  }
+  *align = size > 1 ? 2 : 1;
+  return size;
+}
+
+/* Name: typeIsConst
+   Description:
+    1 for a const object, which is in flash: const at the top, under typedefs, or an array of const.
+*/
+static int typeIsConst(unsigned long offset) {
+  Die* die = findDie(offset);
+
+  while (die && (die->tag == TAG_TYPEDEF || die->tag == TAG_VOLATILE || die->tag == TAG_ARRAY)) {
+    die = findDie(die->type);
+  }
+  return die && die->tag == TAG_CONST;
+}
+
+/* Name: namedTypeSize
+   Return value:
+    long - MSP430 size of the typedef of that name, -1 if no module has it
+*/
+static long namedTypeSize(const char* name) {
+  long align;
+  int n;
+
+  for (n = 0; n < dieCount; n++) {
+    if (dies[n].tag == TAG_TYPEDEF && !strcmp(dies[n].name, name)) {
+      return typeSize(dies[n].offset, &align);
+    }
+  }
+  return -1;
+}
+
+/* Name: countStatics
+   Description:
+    Adds every static with a fixed address to its module, each once: a definition carries on from its declaration,
+    an inlined copy from the original.
+*/
+static void countStatics(void) {
+  int n;
+
+  for (n = 0; n < dieCount; n++) {
+    Die* die = &dies[n];
+    Die* first = die;
+    Module* module;
+    long align;
+    const char* name;
+    unsigned long type;
+
+    if (die->tag != TAG_VARIABLE || !die->fixed || die->declaration || die->module < 0) {
+      continue;
+    }
+    while (first->origin && findDie(first->origin)) {
+      first = findDie(first->origin);
+    }
+    if (first->counted) {
+      continue;
+    }
+    first->counted = 1;
+    name = die->name[0] ? die->name : first->name;
+    type = die->type ? die->type : first->type;
+    if (typeIsConst(type)) {
+      continue;
+    }
+
+    module = &modules[die->module];
+    die->size = typeSize(type, &align);
+    if (!strcmp(module->name, "arena.c") && (!strcmp(name, "pool") || !strcmp(name, "keptPool"))) {
+      module->arena += die->size;
+      continue;
+    }
+    module->bytes += roundUp(die->size, align);
+    if (die->size > module->largestBytes) {
+      module->largestBytes = die->size;
+      snprintf(module->largest, NAME_LEN, "%s", name);
+    }
+  }
+}
+
+/* The budget */
+
+/* Name: Budget_s
+   Type: struct
+   Parameters:
+    unsigned long owner[] - each owner's budget, arena.h's sums
+    unsigned long total
+*/
+struct Budget_s {
+  unsigned long owner[ARENA_OWNERS];
+  unsigned long total;
+};
+typedef struct Budget_s Budget;
+
+/* Name: budgetFor
+   Parameters:
+    long intSize, long messageSize, long packetSize, long snapshotSize - sizes of int, I2CMessage, TelemetryPacket and
+                                                                        Snapshot
+   Description:
+    arena.h's budgets, as it sums them.
+*/
+static void budgetFor(Budget* budget, long intSize, long messageSize, long packetSize, long snapshotSize) {
+  int n;
+
+  budget->owner[ARENA_SAMPLES] = 3 * ARENA_ROUND(DATA_AXES * DATA_BUFFER_LEN * intSize);
+  budget->owner[ARENA_RECORDER] = ARENA_ROUND(RECORDER_BLOCK_BUFFERS * LOG_BLOCK_SIZE);
+  budget->owner[ARENA_I2C] = ARENA_I2C_DESCRIPTORS * (ARENA_ROUND(messageSize) + ARENA_ROUND(ARENA_I2C_BUFFER_BYTES));
+  budget->owner[ARENA_TELEMETRY] = ARENA_ROUND(TELEMETRY_SLOTS * packetSize);
+  budget->owner[ARENA_SNAPSHOTS] = ARENA_ROUND(SNAPSHOT_BUFFERS * snapshotSize);
+  budget->total = 0;
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    budget->total += budget->owner[n];
+  }
+}
+
+int main(int argc, char** argv) {
+  static const char* const ownerName[ARENA_OWNERS] = {"samples", "recorder", "i2c", "telemetry", "snapshots"};
+  static const unsigned long hostOwner[ARENA_OWNERS] = {ARENA_SAMPLES_BYTES, ARENA_RECORDER_BYTES, ARENA_I2C_BYTES,
+                                                        ARENA_TELEMETRY_BYTES, ARENA_SNAPSHOT_BYTES};
+  Budget host;
+  Budget target;
+  long statics = 0;
+  long pools = 0;
+  long total;
+  int n;
+
+  if (argc != 2) {
+    fprintf(stderr, "usage: ramcheck <object>\n");
+    return 2;
+  }
+  if (!readDies(argv[1])) {
+    fprintf(stderr, "ramcheck: no debug information from %s (readelf, and the object built with -g?)\n", argv[1]);
+    return 2;
+  }
+  countStatics();
+
+  printf("%-14s %6s  %s\n", "statics", "bytes", "largest");
+  for (n = 0; n < moduleCount; n++) {
+    Module* module = &modules[n];
+
+    if (module->bytes) {
+      printf("%-14s %6ld  %s (%ld)\n", module->name, module->bytes, module->largest, module->largestBytes);
+    }
+    statics += module->bytes;
+    pools += module->arena;
+  }
+
+  budgetFor(&host, sizeof(int), sizeof(I2CMessage), sizeof(TelemetryPacket), sizeof(Snapshot));
+  budgetFor(&target, 2, namedTypeSize("I2CMessage"), namedTypeSize("TelemetryPacket"), namedTypeSize("Snapshot"));
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    if (host.owner[n] != hostOwner[n]) {
+      printf("FAIL: %s budget summed to %lu, arena.h has %lu\n", ownerName[n], host.owner[n], hostOwner[n]);
+      failures++;
+    }
+  }
+  if (host.total != ARENA_BYTES || pools != (long)ARENA_BYTES) {
+    printf("FAIL: arena summed to %lu and the pools take %ld, arena.h has %lu\n", host.total, pools,
+           (unsigned long)ARENA_BYTES);
+    failures++;
+  }
+
+  total = target.total + statics + RAM_STACK_BUDGET;
+  printf("\n%-14s %6s %6s\n", "ram", "budget", "need");
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    printf("%-14s %6s %6lu\n", ownerName[n], "", target.owner[n]);
+  }
+  printf("%-14s %6s %6lu\n", "arena", "", target.total);
+  printf("%-14s %6u %6ld\n", "statics", RAM_STATIC_RESERVE, statics);
+  printf("%-14s %6u %6u\n", "stack", RAM_STACK_BUDGET, RAM_STACK_BUDGET);
+  printf("%-14s %6u %6ld\n", "total", RAM_BYTES, total);
+
+  if (statics > RAM_STATIC_RESERVE) {
+    printf("FAIL: statics outside the arena take %ld bytes, RAM_STATIC_RESERVE is %d\n", statics, RAM_STATIC_RESERVE);
+    failures++;
+  }
+  if (total > RAM_BYTES || target.total + RAM_STATIC_RESERVE + RAM_STACK_BUDGET > RAM_BYTES) {
+    printf("FAIL: %ld bytes of RAM needed, %d on the part\n", total, RAM_BYTES);
+    failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's black-box recorder (main_software/recorder.c and log_format.c) on an SD card
+    image, in place of the card:
+
+      recsim <image> [samples] [seed]
+
+    The image is the card from block 0, as flightlog reads it; it is created (sparse, the full log area) if it does not
+    exist.  sdReadBlock(), sdWriteBlocks() and sdReadRange() read and write it, the card starts at once, and the bus is
+    always free.  A cold boot is run three times over:
+
+      - recovery: recorderInit(), then recorderStep() until REC_RUNNING, as task_recordData does at boot.  The end of the
+        log it found is checked against a plain scan of the image, block by block from the start (not the firmware's
+        binary search), and it reports the block reads and the time they take here and on the card
+      - append: samples (default 100000) go in with recorderAddSample(), with recorderStep() after each as the task
+        would, and it reports the sustained samples/s.  The blocks written are read back from the image and checked: CRC,
+        sequence numbers, ticks and sample bytes
+      - recovery again, which must land where the append left off
+
+    Appending to an image made with "flightlog synth" close to LOG_BLOCK_COUNT blocks checks the wrap.  It fails (exit
+    code 1) if any check does.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o recsim recsim.c \
+        ../main_software/recorder.c ../main_software/log_format.c
+*/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "recorder.h"
+#include "arena.h"
+#include "watchdog.h"
+#include "boot.h"
+
+/* CONSTANTS */
+#define SPI_HZ                (1000000UL / SD_RUN_DIVIDER) //SMCLK at CLOCK_1MHZ, the boot profile
+#define READ_BYTES            (6 + 2 + 1 + SD_BLOCK_SIZE + 2) //CMD17, R1, token, data, CRC
+#define ACCESS_US             1000 //Typical card read latency, the spec allows 100 ms
+#define STEP_LIMIT            1000 //recorderStep() calls for a recovery, log2(LOG_BLOCK_COUNT) reads take 21
+
+static int image = -1;
+static unsigned long reads;
+static unsigned long writes;
+static int failures;
+
+static void check(int passed, const char* what) {
+  if (!passed) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+static double now(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* The card (sd_card.h) on the image */
+
+char sdAcquireBus(SDCard* card) {
+  card->hasBus = 1;
+  return 1;
+}
+
+void sdReleaseBus(SDCard* card) {
+  card->hasBus = 0;
+}
+
+void sdInitStart(SDCard* card) {
+  card->isInitialized = IS_INITIALIZED;
+  card->isHighCapacity = 1;
+  card->error = SDERR_NO_ERROR;
+}
+
+char sdInitPoll(SDCard* card) {
+  return 1;
+}
+
+char sdIsReady(SDCard* card) {
+  return 1;
+}
+
+void sdReadRange(SDCard* card, unsigned long block, unsigned int start, unsigned char* buffer, unsigned int length) {
+  reads++;
+  memset(buffer, 0, length); //Past the end of the image: never written
+  card->error = pread(image, buffer, length, (off_t)block * SD_BLOCK_SIZE + start) < 0 ? SDERR_READ_FAILED :
+                SDERR_NO_ERROR;
+}
+
+void sdReadBlock(SDCard* card, unsigned long block, unsigned char* buffer) {
+  sdReadRange(card, block, 0, buffer, SD_BLOCK_SIZE);
+}
+
+void sdWriteBlocks(SDCard* card, unsigned long block, unsigned char* const* buffers, int count) {
+  int n;
+
+  card->error = SDERR_NO_ERROR;
+  for (n = 0; n < count; n++) {
+    if (pwrite(image, buffers[n], SD_BLOCK_SIZE, (off_t)(block + n) * SD_BLOCK_SIZE) != SD_BLOCK_SIZE) {
+      card->error = SDERR_WRITE_REJECTED;
+      return;
+    }
+    writes++;
+  }
+}
+
+/* The rest of the firmware recorder.c links against: a cold boot with the card started */
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return malloc(size);
+}
+
+const WatchdogKept* watchdogGetKept(void) {
+  return 0;
+}
+
+unsigned char bootWait(BootDevice device) {
+  return 0;
+}
+
+void bootMark(BootEvent event) {
+}
+
+/* The checks */
+
+/* Name: readLogBlock
+   Return value:
+    int - 1 if the block at offset (from LOG_FIRST_BLOCK) is a valid log block, its sequence number in *sequence
+*/
+static int readLogBlock(unsigned long offset, unsigned char* block, unsigned long* sequence) {
+  memset(block, 0, LOG_BLOCK_SIZE);
+  if (pread(image, block, LOG_BLOCK_SIZE, (off_t)(LOG_FIRST_BLOCK + offset) * LOG_BLOCK_SIZE) < 0 ||
+      !logBlockIsValid(block)) {
+    return 0;
+  }
+  *sequence = logGet32(block + LOG_HDR_SEQUENCE);
+  return 1;
+}
+
+/* Name: scanEnd
+   Description:
+    End of the log by reading the image from the first block on until a block does not follow on from it.
+*/
+static void scanEnd(unsigned long* offset, unsigned long* sequence) {
+  unsigned char block[LOG_BLOCK_SIZE];
+  unsigned long first;
+  unsigned long found;
+  unsigned long n;
+
+  *offset = 0;
+  *sequence = 0;
+  if (!readLogBlock(0, block, &first)) {
+    return;
+  }
+  for (n = 1; n < LOG_BLOCK_COUNT && readLogBlock(n, block, &found) && found == first + n; n++);
+  *offset = n % LOG_BLOCK_COUNT;
+  *sequence = first + n;
+}
+
+/* Name: recover
+   Description:
+    Cold boot of the recorder up to REC_RUNNING, checked against scanEnd().
+*/
+static void recover(const char* what) {
+  const RecorderHealth* health = recorderGetHealth();
+  unsigned long offset;
+  unsigned long sequence;
+  unsigned long steps = 0;
+  double start;
+  double host;
+
+  reads = 0;
+  start = now();
+  recorderInit();
+  while (health->state != REC_RUNNING && health->state != REC_FAILED && steps++ < STEP_LIMIT) {
+    recorderStep();
+  }
+  host = now() - start;
+
+  check(health->state == REC_RUNNING, "recorder not running after recovery");
+  scanEnd(&offset, &sequence);
+  check(health->nextOffset == offset && health->nextSequence == sequence, "recovery disagrees with a scan of the image");
+  printf("%s: next block %lu, sequence %lu: %lu steps, %lu block reads, %.1f us here, %.1f ms on the card\n", what,
+         health->nextOffset, health->nextSequence, steps, reads, host * 1e6,
+         reads * (READ_BYTES * 8e3 / SPI_HZ + ACCESS_US / 1e3));
+}
+
+/* Name: sampleByte
+   Description:
+    Byte i of the gyroscope (0 to 5) or magnetometer (6 to 11) sample at tick, different for every sample and seed.
+*/
+static unsigned char sampleByte(unsigned long tick, int i, unsigned int seed) {
+  unsigned long x = (tick * 12 + i) * 2654435761UL + seed;
+
+  return (unsigned char)(x >> 13);
+}
+
+/* Name: checkAppended
+   Description:
+    Reads back the blocks written from offset on, with sequence numbers from sequence on, and compares them with the
+    samples that went in from tick 0.
+*/
+static void checkAppended(unsigned long offset, unsigned long sequence, unsigned long count, unsigned int seed) {
+  unsigned char block[LOG_BLOCK_SIZE];
+  unsigned long expectedTick = 0;
+  unsigned long found;
+  unsigned long n;
+  int bad = 0;
+
+  for (n = 0; n < count && !bad; n++) {
+    unsigned long at = (offset + n) % LOG_BLOCK_COUNT;
+    unsigned long first;
+    int s;
+
+    if (!readLogBlock(at, block, &found) || found != sequence + n) {
+      check(0, "block written is not valid, or out of sequence");
+      bad = 1;
+      break;
+    }
+    first = logGet32(block + LOG_HDR_FIRST_TICK);
+    check(first == expectedTick && block[LOG_HDR_COUNT] == LOG_SAMPLES_PER_BLOCK, "block header wrong");
+    for (s = 0; s < block[LOG_HDR_COUNT] && !bad; s++) {
+      const unsigned char* sample = block + LOG_HDR_SIZE + s * LOG_SAMPLE_SIZE;
+      unsigned long tick = first + logGet16(sample + LOG_SAMPLE_TICK);
+      int i;
+
+      bad |= tick != expectedTick;
+      for (i = 0; i < LOG_AXIS_BYTES; i++) {
+        bad |= sample[LOG_SAMPLE_GYRO + i] != sampleByte(tick, i, seed);
+        bad |= sample[LOG_SAMPLE_MAGNET + i] != sampleByte(tick, LOG_AXIS_BYTES + i, seed);
+      }
+      expectedTick++;
+    }
+    check(!bad, "samples read back differ from the ones that went in");
+  }
+}
+
+int main(int argc, char** argv) {
+  const RecorderHealth* health = recorderGetHealth();
+  unsigned long samples = argc > 2 ? strtoul(argv[2], NULL, 0) : 100000UL;
+  unsigned int seed = argc > 3 ? (unsigned int)strtoul(argv[3], NULL, 0) : 1;
+  unsigned long startOffset;
+  unsigned long startSequence;
+  unsigned long tick;
+  double start;
+  double host;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: recsim <image> [samples] [seed]\n");
+    return 2;
+  }
+  image = open(argv[1], O_RDWR | O_CREAT, 0644);
+  if (image < 0) {
+    perror(argv[1]);
+    return 1;
+  }
+  if (lseek(image, 0, SEEK_END) == 0 && ftruncate(image, (off_t)(LOG_FIRST_BLOCK + LOG_BLOCK_COUNT) * SD_BLOCK_SIZE)) {
+    perror("ftruncate");
+    return 1;
+  }
+
+  recover("recovery");
+  startOffset = health->nextOffset;
+  startSequence = health->nextSequence;
+
+  writes = 0;
+  start = now();
+  for (tick = 0; tick < samples; tick++) {
+    char gyro[LOG_AXIS_BYTES];
+    char magnet[LOG_AXIS_BYTES];
+    int i;
+
+    for (i = 0; i < LOG_AXIS_BYTES; i++) {
+      gyro[i] = (char)sampleByte(tick, i, seed);
+      magnet[i] = (char)sampleByte(tick, LOG_AXIS_BYTES + i, seed);
+    }
+    recorderAddSample(tick, gyro, magnet);
+    recorderStep();
+  }
+  host = now() - start;
+  check(health->droppedSamples == 0, "samples dropped");
+  check(health->blocksWritten == writes && health->blocksWritten >= samples / LOG_SAMPLES_PER_BLOCK -
+        RECORDER_BLOCK_BUFFERS, "blocks held back");
+  printf("append: %lu samples, %lu blocks, %u dropped: %.0f samples/s, %.1f MB/s\n", samples, health->blocksWritten,
+         health->droppedSamples, samples / host, health->blocksWritten * (double)LOG_BLOCK_SIZE / host / 1e6);
+  checkAppended(startOffset, startSequence, health->blocksWritten, seed);
+
+  recover("recovery after the append");
+  check(health->nextOffset == (startOffset + writes) % LOG_BLOCK_COUNT && health->nextSequence == startSequence + writes,
+        "recovery did not land where the append left off");
+
+  close(image);
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,536 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's replay build (main_software/inc/replay.h) on the host, as a regression
+    benchmark of the acquisition, filter and telemetry pipeline:
+
+      replaysim [-s simulated seconds] [-i <image> <first> <blocks>]
+
+    The firmware is built with I2C_REPLAY and OS_SHIM against host/msp430.h, and the real tasks.c runs on os_shim.c:
+    main()'s set-up, its four tasks and its loop of OSSched() and watchdogService().  The sensors are played back by
+    replay.c from a trace, log blocks first to first + blocks - 1 of an SD card image (from LOG_FIRST_BLOCK, in card
+    order), or by default TRACE_BLOCKS blocks made up as flightlog synth makes them.  Timer A, the clock, the radio's
+    UART and the SD card on UCB0 (host/sdcard.c) are the models'; the tool stubs only the arena (calloc) and the
+    information flash (RAM, erased).  It plays the ground station too: a DUMP_HEALTH command every UPLINK_TICKS, at
+    RADIO_BAUD, keeps the downlink in contact so the telemetry goes out; what the radio sends is counted and dropped.
+
+    Simulated time is the model's.  It passes at each USCI register access, as the SD card and the radio are driven,
+    and the tool charges PASS_US for each pass of main()'s loop that dispatched a task; when no task is eligible it
+    lets time run to the next tick, with the Timer A routines (the OS tick and replay.c's INT line) called as they come
+    due.  The simulated run is the same on every host: the same trace gives the same counts.
+
+    Each stage of the pipeline is wrapped (-Wl,--wrap) and timed on the host clock (CLOCK_MONOTONIC) while it runs,
+    exclusive of any stage it calls or any interrupt routine's stage that runs inside it, less the cost of an empty
+    measurement.  The report gives calls, ns per call and share of the host time for each stage, the rest (scheduler,
+    the other modules and the models) as one line, the simulated time against the host time, and the throughput.  It
+    fails (exit code 1) if no samples came through the pipeline, a sample was lost on the way or the recorder wrote
+    anywhere but the end of the log.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -DI2C_REPLAY -o replaysim replaysim.c host/msp430.c \
+        host/sdcard.c ../main_software/tasks.c ../main_software/os_shim.c ../main_software/clock.c \
+        ../main_software/replay.c ../main_software/i2c_driver.c ../main_software/sampler.c ../main_software/drdy.c \
+        ../main_software/calib.c ../main_software/decim.c ../main_software/data.c ../main_software/snapshot.c \
+        ../main_software/recorder.c ../main_software/sd_card.c ../main_software/antenna.c ../main_software/downlink.c \
+        ../main_software/telemetry.c ../main_software/command.c ../main_software/bulk.c ../main_software/fec.c \
+        ../main_software/config.c ../main_software/boot.c ../main_software/watchdog.c ../main_software/periodic.c \
+        ../main_software/radio.c ../main_software/log_format.c -Wl,--wrap=samplerStep,--wrap=drdyEdge \
+        -Wl,--wrap=drdyNext,--wrap=calibApply,--wrap=decimPush,--wrap=dataStoreSample,--wrap=snapshotSample \
+        -Wl,--wrap=recorderAddSample,--wrap=recorderStep,--wrap=downlinkStep
+*/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msp430.h"
+#include "sdcard.h"
+#include "os.h"
+#include "tasks.h"
+#include "clock.h"
+#include "config.h"
+#include "data.h"
+#include "watchdog.h"
+#include "boot.h"
+#include "arena.h"
+#include "flash.h"
+#include "replay.h"
+#include "sampler.h"
+#include "drdy.h"
+#include "calib.h"
+#include "decim.h"
+#include "snapshot.h"
+#include "recorder.h"
+#include "downlink.h"
+#include "radio.h"
+#include "command.h"
+
+/* CONSTANTS */
+#define TICK_US               (1000000UL / OS_TICK_HZ)
+#define RUN_SECONDS           60
+#define TRACE_BLOCKS          64
+#define TRACE_SEED            1
+#define PASS_US               100UL //A pass of main()'s loop that dispatched a task, at 1 MHz
+#define CARD_INIT_US          50000UL
+#define UPLINK_TICKS          OS_TICK_HZ //Well inside DOWNLINK_CONTACT_TICKS
+#define UPLINK_BYTE_NS        (1000000000ULL / RADIO_BYTES_PER_SECOND)
+#define EMPTY_RUNS            1000 //Empty measurements, the least of them taken
+#define FLASH_BASE            FLASH_INFO_D
+#define FLASH_BYTES           (4 * FLASH_INFO_SEGMENT_BYTES) //Segments D to A
+
+enum Stage_e {STAGE_SAMPLER = 0,
+              STAGE_DRDY_EDGE,
+              STAGE_DRDY_NEXT,
+              STAGE_CALIB,
+              STAGE_DECIM,
+              STAGE_DATA,
+              STAGE_SNAPSHOT,
+              STAGE_RECORDER_ADD,
+              STAGE_RECORDER_STEP,
+              STAGE_DOWNLINK,
+              STAGES};
+
+/* DATATYPES */
+
+/* Name: Stage_s
+   Type: struct
+   Parameters:
+    const char* name - function wrapped
+    unsigned long calls
+    long long ns - host time inside it, less what ran nested in it
+*/
+struct Stage_s {
+  const char* name;
+  unsigned long calls;
+  long long ns;
+};
+typedef struct Stage_s Stage;
+
+static Stage stages[STAGES] = {{"samplerStep"}, {"drdyEdge"}, {"drdyNext"}, {"calibApply"}, {"decimPush"},
+                               {"dataStoreSample"}, {"snapshotSample"}, {"recorderAddSample"}, {"recorderStep"},
+                               {"downlinkStep"}};
+static int running[STAGES]; //Stages under way, innermost last
+static int depth;
+static long long resumed; //Host time the innermost stage last started or came back to
+static long long emptyNs;
+static unsigned char flash[FLASH_BYTES];
+static unsigned long uartBytes;
+static unsigned char uplink[COMMAND_OVERHEAD];
+static unsigned long uplinkFrames;
+static int uplinkSent = COMMAND_OVERHEAD; //Bytes of the frame in uplink received so far
+
+static long long hostNow(void) {
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (long long)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+/* Name: stageEnter, stageLeave
+   Description:
+    Charge the host time since the last change to the innermost stage, then start or end one.
+*/
+static void stageEnter(int stage) {
+  long long now = hostNow();
+
+  if (depth > 0) {
+    stages[running[depth - 1]].ns += now - resumed;
+  }
+  running[depth++] = stage;
+  resumed = now;
+}
+
+static void stageLeave(void) {
+  long long now = hostNow();
+  Stage* stage = &stages[running[--depth]];
+
+  stage->ns += now - resumed - emptyNs;
+  stage->calls++;
+  resumed = now;
+}
+
+/* Name: stageCalibrate
+   Description:
+    Finds emptyNs, the cost of an empty measurement, the least of EMPTY_RUNS.
+*/
+static void stageCalibrate(void) {
+  long long least = 0;
+  int n;
+
+  emptyNs = 0;
+  for (n = 0; n < EMPTY_RUNS; n++) {
+    long long before = stages[0].ns;
+
+    stageEnter(0);
+    stageLeave();
+    if (n == 0 || stages[0].ns - before < least) {
+      least = stages[0].ns - before;
+    }
+  }
+  emptyNs = least;
+  stages[0].ns = 0;
+  stages[0].calls = 0;
+}
+
+/* The stages, wrapped */
+
+unsigned char __real_samplerStep(void);
+void __real_drdyEdge(unsigned long edgeUs);
+const DrdySample* __real_drdyNext(void);
+void __real_calibApply(CalibSensor sensor, const char* raw, int* out);
+char __real_decimPush(Decimator* decimator, const int* in, int* out);
+void __real_dataStoreSample(const int* gyro, const int* accel, const int* magnet);
+void __real_snapshotSample(const int* gyro, const int* accel, unsigned long tick);
+void __real_recorderAddSample(unsigned long tick, const char* gyro, const char* magnet);
+unsigned char __real_recorderStep(void);
+unsigned char __real_downlinkStep(void);
+
+unsigned char __wrap_samplerStep(void) {
+  unsigned char fresh;
+
+  stageEnter(STAGE_SAMPLER);
+  fresh = __real_samplerStep();
+  stageLeave();
+  return fresh;
+}
+
+void __wrap_drdyEdge(unsigned long edgeUs) {
+  stageEnter(STAGE_DRDY_EDGE);
+  __real_drdyEdge(edgeUs);
+  stageLeave();
+}
+
+const DrdySample* __wrap_drdyNext(void) {
+  const DrdySample* sample;
+
+  stageEnter(STAGE_DRDY_NEXT);
+  sample = __real_drdyNext();
+  stageLeave();
+  return sample;
+}
+
+void __wrap_calibApply(CalibSensor sensor, const char* raw, int* out) {
+  stageEnter(STAGE_CALIB);
+  __real_calibApply(sensor, raw, out);
+  stageLeave();
+}
+
+char __wrap_decimPush(Decimator* decimator, const int* in, int* out) {
+  char ready;
+
+  stageEnter(STAGE_DECIM);
+  ready = __real_decimPush(decimator, in, out);
+  stageLeave();
+  return ready;
+}
+
+void __wrap_dataStoreSample(const int* gyro, const int* accel, const int* magnet) {
+  stageEnter(STAGE_DATA);
+  __real_dataStoreSample(gyro, accel, magnet);
+  stageLeave();
+}
+
+void __wrap_snapshotSample(const int* gyro, const int* accel, unsigned long tick) {
+  stageEnter(STAGE_SNAPSHOT);
+  __real_snapshotSample(gyro, accel, tick);
+  stageLeave();
+}
+
+void __wrap_recorderAddSample(unsigned long tick, const char* gyro, const char* magnet) {
+  stageEnter(STAGE_RECORDER_ADD);
+  __real_recorderAddSample(tick, gyro, magnet);
+  stageLeave();
+}
+
+unsigned char __wrap_recorderStep(void) {
+  unsigned char delay;
+
+  stageEnter(STAGE_RECORDER_STEP);
+  delay = __real_recorderStep();
+  stageLeave();
+  return delay;
+}
+
+unsigned char __wrap_downlinkStep(void) {
+  unsigned char delay;
+
+  stageEnter(STAGE_DOWNLINK);
+  delay = __real_downlinkStep();
+  stageLeave();
+  return delay;
+}
+
+/* The rest of the firmware: the arena, the information flash and the far end of the radio */
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return calloc(1, size);
+}
+
+static int flashInside(unsigned int address, unsigned int length) {
+  return address >= FLASH_BASE && address + length <= FLASH_BASE + FLASH_BYTES;
+}
+
+char flashEraseSegment(unsigned int address) {
+  if (!flashInside(address, 1)) {
+    return 0;
+  }
+  memset(flash + (address - FLASH_BASE) / FLASH_INFO_SEGMENT_BYTES * FLASH_INFO_SEGMENT_BYTES, 0xFF,
+         FLASH_INFO_SEGMENT_BYTES);
+  return 1;
+}
+
+void flashRead(unsigned int address, unsigned char* data, unsigned int length) {
+  if (flashInside(address, length)) {
+    memcpy(data, flash + address - FLASH_BASE, length);
+  } else {
+    memset(data, 0xFF, length);
+  }
+}
+
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length) {
+  unsigned int n;
+
+  if (!flashInside(address, length)) {
+    return 0;
+  }
+  for (n = 0; n < length; n++) {
+    flash[address - FLASH_BASE + n] &= data[n];
+  }
+  return memcmp(flash + address - FLASH_BASE, data, length) == 0;
+}
+
+void hostUartTransmit(int usci, unsigned char byte) {
+  uartBytes++;
+}
+
+/* Name: groundStation
+   Description:
+    Hands the radio the uplink bytes that have come in by now: a DUMP_HEALTH frame starting every UPLINK_TICKS, a byte
+    time apart.  They are taken as the tool gets to them, up to a tick late, which the receive interrupt keeps up with.
+*/
+static void groundStation(void) {
+  unsigned long long now = hostGetNanoseconds();
+
+  while (1) {
+    if (uplinkSent == COMMAND_OVERHEAD) {
+      if (now < uplinkFrames * UPLINK_TICKS * TICK_US * 1000ULL) { //Next frame not started
+        return;
+      }
+      uplink[0] = COMMAND_SYNC_0;
+      uplink[1] = COMMAND_SYNC_1;
+      uplink[2] = 0;
+      uplink[3] = COMMAND_DUMP_HEALTH;
+      uplink[4] = (unsigned char)uplinkFrames;
+      logPut16(uplink + COMMAND_HEADER, logCrc16(uplink, COMMAND_HEADER));
+      uplinkSent = 0;
+      uplinkFrames++;
+    }
+    if (now < (uplinkFrames - 1) * UPLINK_TICKS * TICK_US * 1000ULL + uplinkSent * UPLINK_BYTE_NS) {
+      return;
+    }
+    hostUartReceive(1, uplink[uplinkSent++]);
+  }
+}
+
+/* Name: traceSynth
+   Description:
+    blocks log blocks as flightlog synth writes them: one sample per tick, random gyroscope and magnetometer bytes.
+*/
+static unsigned char* traceSynth(unsigned long blocks) {
+  unsigned char* trace = calloc(blocks, LOG_BLOCK_SIZE);
+  unsigned long position;
+
+  srand(TRACE_SEED);
+  for (position = 0; trace && position < blocks; position++) {
+    unsigned char* block = trace + position * LOG_BLOCK_SIZE;
+    int n;
+
+    logPut16(block + LOG_HDR_MAGIC, LOG_MAGIC);
+    block[LOG_HDR_VERSION] = LOG_VERSION;
+    block[LOG_HDR_COUNT] = LOG_SAMPLES_PER_BLOCK;
+    logPut32(block + LOG_HDR_SEQUENCE, position);
+    logPut32(block + LOG_HDR_FIRST_TICK, position * LOG_SAMPLES_PER_BLOCK);
+    for (n = 0; n < LOG_SAMPLES_PER_BLOCK; n++) {
+      unsigned char* sample = block + LOG_HDR_SIZE + n * LOG_SAMPLE_SIZE;
+      int i;
+
+      logPut16(sample + LOG_SAMPLE_TICK, n);
+      for (i = 0; i < 2 * LOG_AXIS_BYTES; i++) {
+        sample[LOG_SAMPLE_GYRO + i] = rand() & 0xFF;
+      }
+    }
+    logPut16(block + LOG_CRC_OFFSET, logCrc16(block, LOG_CRC_OFFSET));
+  }
+  return trace;
+}
+
+/* Name: traceLoad
+   Description:
+    Log blocks first to first + blocks - 1 of an SD card image, 0 if they are not all there.
+*/
+static unsigned char* traceLoad(const char* path, unsigned long first, unsigned long blocks) {
+  unsigned char* trace = calloc(blocks, LOG_BLOCK_SIZE);
+  FILE* in = fopen(path, "rb");
+  int ok;
+
+  if (!in || !trace) {
+    perror(path);
+    free(trace);
+    if (in) {
+      fclose(in);
+    }
+    return 0;
+  }
+  ok = fseeko(in, (off_t)(LOG_FIRST_BLOCK + first) * LOG_BLOCK_SIZE, SEEK_SET) == 0 &&
+       fread(trace, LOG_BLOCK_SIZE, blocks, in) == blocks;
+  fclose(in);
+  if (!ok) {
+    fprintf(stderr, "%s: blocks %lu to %lu are not in the image\n", path, first, first + blocks - 1);
+    free(trace);
+    return 0;
+  }
+  return trace;
+}
+
+/* Name: eligible
+   Return value:
+    int - 1 if OSSched() has a task to dispatch
+*/
+static int eligible(void) {
+  int n;
+
+  for (n = 0; n < OSTASKS; n++) {
+    if (osShimTcbs[n].state == OSTCB_ELIGIBLE) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Name: boot
+   Description:
+    main()'s set-up, as a power on.
+*/
+static void boot(const unsigned char* trace, unsigned long blocks) {
+  IFG1 = PORIFG;
+  OSInit();
+  watchdogInit();
+  InitializeClock(1);
+  configInit();
+  clockSetProfile(configGet(CONFIG_CLOCK, CLOCK_1MHZ));
+  dataInit();
+  replayInit(trace, blocks);
+
+  OSCreateTask(task_getIMUData, TASK_GET_IMU_DATA, TASK_PRIO_GET_IMU_DATA);
+  OSCreateTask(task_deployAntenna, TASK_DEPLOY_ANTENNA, TASK_PRIO_DEPLOY_ANTENNA);
+  OSCreateTask(task_recordData, TASK_RECORD_DATA, TASK_PRIO_RECORD_DATA);
+  OSCreateTask(task_sendData, TASK_SEND_DATA, TASK_PRIO_SEND_DATA);
+
+  watchdogStart();
+  bootStart(1);
+  __enable_interrupt();
+}
+
+int main(int argc, char** argv) {
+  unsigned long seconds = RUN_SECONDS;
+  unsigned long blocks = TRACE_BLOCKS;
+  unsigned char* trace = 0;
+  const char* source = "synthesized";
+  const ReplayStats* replay;
+  const DrdyStats* drdy;
+  const RecorderHealth* recorder;
+  const HostCardStats* card;
+  long long started;
+  long long hostNs;
+  long long stagesNs = 0;
+  double simulated;
+  int failures = 0;
+  int i;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 < argc && !strcmp(argv[i], "-s")) {
+      seconds = strtoul(argv[++i], NULL, 0);
+    } else if (i + 3 < argc && !strcmp(argv[i], "-i")) {
+      blocks = strtoul(argv[i + 3], NULL, 0);
+      trace = blocks ? traceLoad(argv[i + 1], strtoul(argv[i + 2], NULL, 0), blocks) : 0;
+      if (!trace) {
+        return 2;
+      }
+      source = argv[i + 1];
+      i += 3;
+    } else {
+      fprintf(stderr, "usage: replaysim [-s simulated seconds] [-i <image> <first> <blocks>]\n");
+      return 2;
+    }
+  }
+  if (!trace && !(trace = traceSynth(blocks))) {
+    return 2;
+  }
+  memset(flash, 0xFF, sizeof(flash));
+  hostCardGetStats() -> logEnd = 0;
+  hostCardPowerOn(CARD_INIT_US);
+  stageCalibrate();
+
+  started = hostNow();
+  boot(trace, blocks);
+  while (hostGetNanoseconds() < seconds * 1000000000ULL) {
+    groundStation();
+    OSSched();
+    watchdogService();
+    if (eligible()) {
+      hostElapse(PASS_US);
+    } else { //Idle to the next tick, the INT line and the UARTs running
+      hostElapse(TICK_US - clockGetMicroseconds() % TICK_US);
+    }
+  }
+  hostNs = hostNow() - started;
+  simulated = hostGetNanoseconds() / 1e9;
+
+  replay = replayGetStats();
+  drdy = drdyGetStats();
+  recorder = recorderGetHealth();
+  card = hostCardGetStats();
+  printf("Replay of %lu blocks (%s): %.1f s simulated in %.3f s on the host, %.0f times real time\n\n", blocks, source,
+         simulated, hostNs / 1e9, simulated * 1e9 / hostNs);
+  printf("%-18s %10s %10s %7s\n", "Stage", "Calls", "ns/call", "Share");
+  for (i = 0; i < STAGES; i++) {
+    Stage* stage = &stages[i];
+
+    printf("%-18s %10lu %10.1f %6.1f%%\n", stage->name, stage->calls, stage->calls ? (double)stage->ns / stage->calls : 0,
+           100.0 * stage->ns / hostNs);
+    stagesNs += stage->ns;
+  }
+  printf("%-18s %10s %10s %6.1f%%\n\n", "rest", "", "", 100.0 * (hostNs - stagesNs) / hostNs);
+
+  printf("Gyroscope samples %lu (%.1f/s simulated, %.0f/s host), magnetometer %lu, wraps %u\n", replay->gyroSamples,
+         replay->gyroSamples / simulated, replay->gyroSamples * 1e9 / hostNs, replay->magnetSamples,
+         replay->gyroWraps);
+  printf("Data-ready edges %lu, samples %lu, missed %u, overruns %u, errors %u\n", drdy->edges, drdy->samples,
+         drdy->missed, drdy->overruns, drdy->errors);
+  printf("Log blocks written %lu (%lu on the card), samples dropped %u\n", recorder->blocksWritten, card->writes,
+         recorder->droppedSamples);
+  printf("Radio bytes %lu (%.1f/s), %u frames; commands %lu\n", uartBytes, uartBytes / simulated,
+         radioGetHealth() -> txFrames, uplinkFrames);
+
+  if (!replay->gyroSamples || !drdy->samples) {
+    printf("FAIL: no samples through the pipeline\n");
+    failures++;
+  }
+  if (drdy->missed || drdy->overruns || drdy->errors || recorder->droppedSamples) {
+    printf("FAIL: samples lost\n");
+    failures++;
+  }
+  if (!uartBytes) {
+    printf("FAIL: no telemetry sent\n");
+    failures++;
+  }
+  if (card->misplaced) {
+    printf("FAIL: %lu blocks written anywhere but the end of the log\n", card->misplaced);
+    failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  free(trace);
+  return failures ? 1 : 0;
+}
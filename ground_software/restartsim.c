@@ -0,0 +1,562 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's boot and restart on the host, to measure the boot sequencer
+    (main_software/inc/boot.h) and check the warm restart and the supervisor (main_software/inc/watchdog.h):
+
+      restartsim [-c card power on ms] [-r card reset ms] [-t horizon ms]
+
+    The firmware is built with OS_SHIM against host/msp430.h, and the real tasks.c runs on os_shim.c: main()'s set-up,
+    its four tasks and its loop of OSSched() and watchdogService(), as replaysim runs them.  The devices are models:
+
+      - watchdog timer: host/msp430.c's (hostWatchdog()).  Unless WDTHOLD is set it runs out one interval after the
+        last WDTCNTCL, whatever the firmware is doing, and sets WDTIFG; the tool resets the MCU there (hostReset(),
+        longjmp() back to boot()) and starts main() over with crt0's work redone: the arena cleared but for its kept
+        pool, the tick count back to 0.  The other module statics keep their values, so each init has to set what it
+        uses, as it does on the board
+      - SD card: host/sdcard.c on UCB0.  Ready its init time after its first ACMD41 since CMD0, longer from power on
+        (-c) than after a reset (-r), and it stays initialized through an MCU reset.  Its log holds LOG_PREFILL blocks
+        from sequence 0, and every block written has to be the next one
+      - IMU: host/imu.c's MPU-9250 and AK8963 on UCB1, data-ready on DRDY_PIN; powered with the board, so it keeps
+        converting through an MCU reset.  The model answers from power on: the gyroscope start-up is the boot
+        sequencer's own BOOT_IMU_SETTLE_MS
+      - antenna controller: host/isis.c on UCB0, burning the seconds the deploy command sends
+      - modem: what the radio sends is dropped; the information flash is RAM, erased at power on
+
+    Time is the model's: the bus, the interrupt routines and idle time to the next tick, as in replaysim, PASS_US for
+    each pass of main()'s loop that dispatched a task, and from the reset CRT0_US, MAIN_US and, on a cold boot,
+    CLEAR_US for the work the tool does not run.  The antenna task is made to go wrong by wrapping (-Wl,--wrap) the two
+    functions of its loop: watchdogCheckIn() drops its check ins, or antennaStep() holds the CPU, from its first step
+    after HANG_MS.
+
+    The same satellite boots seven times, each boot running to the horizon (on past it until the log is running)
+    unless the watchdog resets it first:
+
+      - power on: everything cold, the log found by its search
+      - reset: warm, the recorder carries on at the kept place and the sample history is kept
+      - reset with the kept block's CRC broken, as by a reset in the middle of a checkpoint: cold, the log found again
+      - the antenna task stops checking in from its first step after HANG_MS: the watchdog resets once its deadline
+        has passed, and the log carries on at its end through the reset
+      - the warm boot after it, which reports the antenna as the late task
+      - the antenna task holds the CPU from its first step after HANG_MS: the watchdog resets one interval after the
+        last kick
+      - the warm boot after it, with no late task
+
+    For each it reports the time from reset to the first sample in the history (time-to-first-sample), to the card
+    ready and the log being appended, the longest task pass (OSSched() in model time) and the samples lost; then each
+    boot's timeline (bootGetTime(), from reset).  It fails (exit code 1) if a boot is not warm or cold as it should be,
+    the history or the log place is not kept by a warm boot, a block goes anywhere but the end of the log, a warm boot
+    is not first to its first sample, or the watchdog does not reset as above.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o restartsim restartsim.c host/msp430.c host/sdcard.c \
+        host/imu.c host/isis.c ../main_software/tasks.c ../main_software/os_shim.c ../main_software/clock.c \
+        ../main_software/i2c_driver.c ../main_software/sampler.c ../main_software/drdy.c ../main_software/calib.c \
+        ../main_software/decim.c ../main_software/data.c ../main_software/snapshot.c ../main_software/recorder.c \
+        ../main_software/sd_card.c ../main_software/antenna.c ../main_software/downlink.c \
+        ../main_software/telemetry.c ../main_software/command.c ../main_software/bulk.c ../main_software/fec.c \
+        ../main_software/config.c ../main_software/boot.c ../main_software/watchdog.c ../main_software/periodic.c \
+        ../main_software/radio.c ../main_software/log_format.c -Wl,--wrap=watchdogCheckIn,--wrap=antennaStep
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include "msp430.h"
+#include "sdcard.h"
+#include "imu.h"
+#include "isis.h"
+#include "os.h"
+#include "tasks.h"
+#include "clock.h"
+#include "config.h"
+#include "data.h"
+#include "watchdog.h"
+#include "boot.h"
+#include "arena.h"
+#include "flash.h"
+#include "recorder.h"
+#include "drdy.h"
+
+/* CONSTANTS */
+#define TICK_US               (1000000UL / OS_TICK_HZ)
+#define PASS_US               100UL //A pass of main()'s loop that dispatched a task, at 1 MHz
+#define FLASH_BASE            FLASH_INFO_D
+#define FLASH_BYTES           (4 * FLASH_INFO_SEGMENT_BYTES) //Segments D to A
+
+//CPU time of the work the tool does not run (us at 1 MHz)
+#define CRT0_US               3500UL //.bss cleared, .data copied: the statics and the arena less the kept pool
+#define MAIN_US               3600UL //arenaPaintStack() over RAM_STACK_BUDGET, InitializeClock(), configInit()
+#define CLEAR_US              2700UL //dataInit() clearing the kept sample history, cold boots only
+
+//Scenarios
+#define LOG_PREFILL           5000UL //Blocks in the log before the first boot
+#define HANG_MS               500L //Into the boot, when the antenna task goes wrong
+#define LOG_WAIT_MS           10000L //A boot runs on past the horizon until the log is running, up to here
+#define HANG_HORIZON_MS       (HANG_MS + 2000L * (WATCHDOG_ANTENNA_TICKS / OS_TICK_HZ + 1)) //Well past the reset
+#define BOOT_COUNT            7
+
+/* DATATYPES */
+
+/* Name: Hang_e
+   Type: enum
+   Values:
+    HANG_NONE (0) - antenna task runs as it should
+    HANG_LATE (1) - stops checking in from its first step after HANG_MS, running on otherwise
+    HANG_HELD (2) - holds the CPU from its first step after HANG_MS
+*/
+enum Hang_e {HANG_NONE = 0,
+             HANG_LATE = 1,
+             HANG_HELD = 2};
+typedef enum Hang_e Hang;
+
+/* Name: Run_s
+   Type: struct
+   Parameters:
+    const char* name - for the report
+    unsigned char cause - IFG1 reset flags the boot started with
+    char warm - watchdogInit() said warm
+    char historyKept - sample history as it was at the reset after dataInit(), not cleared
+    char historyCleared - sample history all zeros after dataInit()
+    long schedulerUs - bootStart() from reset
+    long timeline[] - bootGetTime() from reset, -1 for events that did not happen
+    long longestUs - longest task pass
+    long dropped - data-ready samples missed or overrun, and samples the recorder dropped
+    long hangUs - antenna task went wrong, -1 if it did not
+    long lateUs - watchdogService() found a task late, -1 if none did
+    long resetUs - the watchdog reset, -1 if the boot ran to the horizon
+    unsigned char lateTask - watchdogGetStats() at the end
+    unsigned char lastLate
+    unsigned int watchdogResets
+    unsigned long logOffset - recorderGetHealth() at the end
+    unsigned long cardResets - CMD0 the card saw
+    unsigned long cardReads - CMD17 the card saw
+    unsigned long blocksWritten
+*/
+struct Run_s {
+  const char* name;
+  unsigned char cause;
+  char warm;
+  char historyKept;
+  char historyCleared;
+  long schedulerUs;
+  long timeline[BOOT_EVENTS];
+  long longestUs;
+  long dropped;
+  long hangUs;
+  long lateUs;
+  long resetUs;
+  unsigned char lateTask;
+  unsigned char lastLate;
+  unsigned int watchdogResets;
+  unsigned long logOffset;
+  unsigned long cardResets;
+  unsigned long cardReads;
+  unsigned long blocksWritten;
+};
+typedef struct Run_s Run;
+
+static unsigned long long resetNs; //Model time of the reset
+static jmp_buf resetJump;
+static unsigned long cardResetUs; //-r
+static Hang hang;
+static long hangUs; //Antenna task went wrong, -1 until it has
+static int history[DATA_AXES][DATA_BUFFER_LEN]; //Gyroscope history at the last reset
+static unsigned char flash[FLASH_BYTES];
+static unsigned char* pools[ARENA_OWNERS];
+static unsigned int used[ARENA_OWNERS];
+static Run* run; //Boot under way
+static int failures;
+
+static const unsigned int poolBytes[ARENA_OWNERS] = {ARENA_SAMPLES_BYTES, ARENA_RECORDER_BYTES, ARENA_I2C_BYTES,
+                                                     ARENA_TELEMETRY_BYTES, ARENA_SNAPSHOT_BYTES};
+
+static void check(int passed, const char* what) {
+  if (!passed) {
+    printf("FAIL: %s: %s\n", run ? run->name : "start", what);
+    failures++;
+  }
+}
+
+/* Name: sinceReset
+   Return value:
+    long - microseconds of model time from the reset
+*/
+static long sinceReset(void) {
+  return (long)((hostGetNanoseconds() - resetNs) / 1000);
+}
+
+/* Name: watchdogExpired
+   Description:
+    The watchdog ran out: the MCU resets, the boot ends there, wherever the firmware was.
+*/
+static void watchdogExpired(void) {
+  longjmp(resetJump, 1);
+}
+
+/* The buses, for host/msp430.c: the antenna controller on PRIMARY, the IMU on SECONDARY.  The SD card (host/sdcard.c)
+   takes UCB0 in SPI mode. */
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  return usci == SECONDARY ? hostImuAddress(address, read) : hostIsisAddress(address, read);
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  return usci == SECONDARY ? hostImuWrite(data) : hostIsisWrite(data);
+}
+
+unsigned char hostI2cRead(int usci) {
+  return usci == SECONDARY ? hostImuRead() : hostIsisRead();
+}
+
+void hostI2cStop(int usci) {
+  if (usci == SECONDARY) {
+    hostImuStop();
+  } else {
+    hostIsisStop();
+  }
+}
+
+/* The antenna task going wrong */
+
+void __real_watchdogCheckIn(unsigned char task);
+unsigned char __real_antennaStep(void);
+
+void __wrap_watchdogCheckIn(unsigned char task) {
+  if (task == TASK_ID_DEPLOY_ANTENNA && hangUs >= 0) { //Stopped checking in
+    return;
+  }
+  __real_watchdogCheckIn(task);
+}
+
+unsigned char __wrap_antennaStep(void) {
+  if (hang != HANG_NONE && hangUs < 0 && sinceReset() >= HANG_MS * 1000L) {
+    hangUs = sinceReset();
+  }
+  if (hang == HANG_HELD && hangUs >= 0) {
+    while (1) { //Stuck in a loop, the interrupts still taken: only the watchdog gets out of it
+      hostElapse(TICK_US);
+    }
+  }
+  return __real_antennaStep();
+}
+
+/* The rest of the firmware: the arena, a pool per owner cleared by crt0 but the kept ones, and the information flash */
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  void* buffer;
+
+  size = ARENA_ROUND(size);
+  if (owner >= ARENA_OWNERS || used[owner] + size > poolBytes[owner]) {
+    return 0;
+  }
+  buffer = pools[owner] + used[owner];
+  used[owner] += size;
+  return buffer;
+}
+
+static int flashInside(unsigned int address, unsigned int length) {
+  return address >= FLASH_BASE && address + length <= FLASH_BASE + FLASH_BYTES;
+}
+
+char flashEraseSegment(unsigned int address) {
+  if (!flashInside(address, 1)) {
+    return 0;
+  }
+  memset(flash + (address - FLASH_BASE) / FLASH_INFO_SEGMENT_BYTES * FLASH_INFO_SEGMENT_BYTES, 0xFF,
+         FLASH_INFO_SEGMENT_BYTES);
+  return 1;
+}
+
+void flashRead(unsigned int address, unsigned char* data, unsigned int length) {
+  if (flashInside(address, length)) {
+    memcpy(data, flash + address - FLASH_BASE, length);
+  } else {
+    memset(data, 0xFF, length);
+  }
+}
+
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length) {
+  unsigned int n;
+
+  if (!flashInside(address, length)) {
+    return 0;
+  }
+  for (n = 0; n < length; n++) {
+    flash[address - FLASH_BASE + n] &= data[n];
+  }
+  return memcmp(flash + address - FLASH_BASE, data, length) == 0;
+}
+
+/* The boots */
+
+/* Name: eligible
+   Return value:
+    int - 1 if OSSched() has a task to dispatch
+*/
+static int eligible(void) {
+  int n;
+
+  for (n = 0; n < OSTASKS; n++) {
+    if (osShimTcbs[n].state == OSTCB_ELIGIBLE) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Name: reset
+   Description:
+    What the reset and crt0 do: the registers to their reset values, the card's transfer dropped unless the board
+    powered up, the arena cleared but for its kept pool and the tick count cleared.  The card's state, the kept block
+    and the sample history keep what they had.
+*/
+static void reset(void) {
+  int n;
+
+  hostReset();
+  resetNs = hostGetNanoseconds();
+  if (!(IFG1 & PORIFG)) {
+    hostCardReset(cardResetUs);
+  }
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    used[n] = 0;
+    if (n >= ARENA_KEPT_OWNERS) {
+      memset(pools[n], 0, poolBytes[n]);
+    }
+  }
+  clockSetTicks(0);
+  hostCardGetStats() -> reads = 0;
+  hostCardGetStats() -> resets = 0;
+  hangUs = -1;
+}
+
+/* Name: boot
+   Description:
+    One boot with the reset flags in IFG1: main() as in main.c, then its loop to the horizon and the log running, or
+    until the watchdog resets the MCU.
+*/
+static void boot(Run* r, const char* name, long horizonUs) {
+  const WatchdogStats* stats = watchdogGetStats();
+  const RecorderHealth* recorder = recorderGetHealth();
+  const DrdyStats* drdy = drdyGetStats();
+  int n;
+
+  memset(r, 0, sizeof(*r));
+  r->name = name;
+  r->cause = IFG1;
+  r->lateUs = -1;
+  r->resetUs = -1;
+  run = r;
+  reset();
+
+  if (setjmp(resetJump)) {
+    r->resetUs = sinceReset();
+  } else {
+    hostElapse(CRT0_US); //The watchdog running from the reset meanwhile
+    OSInit();
+    r->warm = watchdogInit();
+    hostElapse(MAIN_US);
+    InitializeClock(1);
+    configInit();
+    clockSetProfile(configGet(CONFIG_CLOCK, CLOCK_1MHZ));
+    dataInit();
+    r->historyKept = !memcmp(history, gyroscopeBuffer, sizeof(history));
+    r->historyCleared = 1;
+    for (n = 0; n < DATA_AXES * DATA_BUFFER_LEN; n++) {
+      r->historyCleared &= gyroscopeBuffer[n / DATA_BUFFER_LEN][n % DATA_BUFFER_LEN] == 0;
+    }
+    if (!r->warm) {
+      hostElapse(CLEAR_US);
+    }
+
+    OSCreateTask(task_getIMUData, TASK_GET_IMU_DATA, TASK_PRIO_GET_IMU_DATA);
+    OSCreateTask(task_deployAntenna, TASK_DEPLOY_ANTENNA, TASK_PRIO_DEPLOY_ANTENNA);
+    OSCreateTask(task_recordData, TASK_RECORD_DATA, TASK_PRIO_RECORD_DATA);
+    OSCreateTask(task_sendData, TASK_SEND_DATA, TASK_PRIO_SEND_DATA);
+
+    watchdogStart();
+    r->schedulerUs = sinceReset();
+    bootStart((stats->resetCause & PORIFG) != 0);
+    __enable_interrupt();
+
+    while (sinceReset() < horizonUs || (recorder->state != REC_RUNNING && sinceReset() < LOG_WAIT_MS * 1000L)) {
+      long start = sinceReset();
+
+      OSSched();
+      if (sinceReset() - start > r->longestUs) {
+        r->longestUs = sinceReset() - start;
+      }
+      watchdogService();
+      if (stats->lateTask != WATCHDOG_NONE && r->lateUs < 0) {
+        r->lateUs = sinceReset();
+      }
+      if (eligible()) {
+        hostElapse(PASS_US);
+      } else { //Idle to the next tick
+        hostElapse(TICK_US - clockGetMicroseconds() % TICK_US);
+      }
+    }
+  }
+
+  for (n = 0; n < BOOT_EVENTS; n++) {
+    unsigned long time = bootGetTime((BootEvent)n);
+
+    r->timeline[n] = (time == BOOT_NOT_YET) ? -1 : r->schedulerUs + (long)time;
+  }
+  r->dropped = recorder->droppedSamples;
+  if (r->timeline[BOOT_IMU_CONFIGURED] >= 0) { //drdyInit() cleared the counts in this boot
+    r->dropped += drdy->missed + drdy->overruns;
+  }
+  r->hangUs = hangUs;
+  r->lateTask = stats->lateTask;
+  r->lastLate = stats->lastLate;
+  r->watchdogResets = stats->watchdogResets;
+  r->logOffset = recorder->nextOffset;
+  r->cardResets = hostCardGetStats() -> resets;
+  r->cardReads = hostCardGetStats() -> reads;
+  r->blocksWritten = recorder->blocksWritten;
+  check(hostCardGetStats() -> misplaced == 0, "block written anywhere but the end of the log");
+  memcpy(history, gyroscopeBuffer, sizeof(history));
+}
+
+static void printMs(long us) {
+  if (us >= 0) {
+    printf(" %8.1f", us / 1000.0);
+  } else {
+    printf(" %8s", "never");
+  }
+}
+
+int main(int argc, char** argv) {
+  static const char* const eventName[BOOT_EVENTS] = {"scheduler", "imu configured", "first sample", "card ready",
+                                                     "log running", "antenna", "radio"};
+  static const char* const shortName[BOOT_COUNT] = {"power", "reset", "lost", "late", "wdt", "held", "wdt"};
+  Run runs[BOOT_COUNT];
+  Run* r;
+  long cardPowerMs = 250;
+  long cardResetMs = 20;
+  long horizonMs = 2000;
+  int i;
+  int n;
+
+  for (i = 1; i < argc; i++) {
+    if (i + 1 < argc && !strcmp(argv[i], "-c")) {
+      cardPowerMs = atol(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "-r")) {
+      cardResetMs = atol(argv[++i]);
+    } else if (i + 1 < argc && !strcmp(argv[i], "-t")) {
+      horizonMs = atol(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: restartsim [-c card power on ms] [-r card reset ms] [-t horizon ms]\n");
+      return 2;
+    }
+  }
+  if (cardPowerMs < 0 || cardResetMs < 0 || horizonMs <= HANG_MS) {
+    fprintf(stderr, "restartsim: times must be positive, the horizon over %ld ms\n", HANG_MS);
+    return 2;
+  }
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    pools[n] = calloc(1, poolBytes[n]);
+  }
+  cardResetUs = cardResetMs * 1000UL;
+  memset(flash, 0xFF, sizeof(flash));
+  hostWatchdog(watchdogExpired);
+
+  //Power on: the card, the IMU and the antenna controller power up with the MCU
+  hostCardGetStats() -> logEnd = LOG_PREFILL;
+  hostCardPowerOn(cardPowerMs * 1000UL);
+  hostImuPowerOn(0);
+  hostIsisPowerOn(-1);
+  IFG1 = PORIFG;
+  boot(&runs[0], "power on", horizonMs * 1000L);
+  check(!runs[0].warm && runs[0].historyCleared, "not a cold boot");
+  check(runs[0].cardResets == 1 && runs[0].timeline[BOOT_LOG_RUNNING] >= 0, "log not found by the search");
+
+  //Reset: warm
+  IFG1 = RSTIFG;
+  n = (int)hostCardGetStats() -> logEnd;
+  boot(&runs[1], "reset", horizonMs * 1000L);
+  check(runs[1].warm && runs[1].historyKept, "warm boot did not keep the sample history");
+  check(runs[1].cardResets == 0 && runs[1].cardReads == 0, "warm boot initialized the card or searched the log");
+  check(runs[1].logOffset == (unsigned long)n + runs[1].blocksWritten, "warm boot lost the log place");
+  check(runs[1].timeline[BOOT_LOG_RUNNING] >= 0, "warm boot did not carry on the log");
+
+  //Reset in the middle of a checkpoint: the kept block fails its CRC
+  ((WatchdogKept*)watchdogGetKept()) -> crc ^= 0xFFFF;
+  IFG1 = RSTIFG;
+  boot(&runs[2], "reset, kept block lost", horizonMs * 1000L);
+  check(!runs[2].warm && runs[2].historyCleared, "boot with a broken kept block was not cold");
+  check(runs[2].cardResets == 1 && runs[2].cardReads > 0, "cold boot did not find the log again");
+  check(runs[0].timeline[BOOT_FIRST_SAMPLE] >= 0 && runs[1].timeline[BOOT_FIRST_SAMPLE] >= 0 &&
+        runs[2].timeline[BOOT_FIRST_SAMPLE] > runs[1].timeline[BOOT_FIRST_SAMPLE],
+        "warm boot not first to its first sample");
+
+  //The antenna task stops checking in, then holds the CPU; each time the boot after it is warm, IFG1 as the watchdog
+  //left it
+  IFG1 = RSTIFG;
+  hang = HANG_LATE;
+  boot(&runs[3], "antenna late", HANG_HORIZON_MS * 1000L);
+  hang = HANG_NONE;
+  check(runs[3].lateTask == TASK_ID_DEPLOY_ANTENNA && runs[3].resetUs >= 0, "late antenna task did not reset the MCU");
+  check(runs[3].resetUs - runs[3].hangUs <= (WATCHDOG_ANTENNA_TICKS + 2) * (long)TICK_US + WATCHDOG_INTERVAL_MS * 1000L,
+        "watchdog reset later than the antenna's deadline and an interval");
+  boot(&runs[4], "after the watchdog", horizonMs * 1000L);
+  check(runs[4].warm && (runs[4].cause & WDTIFG) && runs[4].historyKept, "watchdog reset did not boot warm");
+  check(runs[4].lastLate == TASK_ID_DEPLOY_ANTENNA && runs[4].watchdogResets == 1, "late task not reported");
+
+  IFG1 = RSTIFG;
+  hang = HANG_HELD;
+  boot(&runs[5], "antenna holds the CPU", HANG_HORIZON_MS * 1000L);
+  hang = HANG_NONE;
+  check(runs[5].resetUs >= 0 && runs[5].hangUs >= 0 && runs[5].resetUs - runs[5].hangUs <= WATCHDOG_INTERVAL_MS * 1000L,
+        "watchdog did not reset within an interval of the CPU being held");
+  boot(&runs[6], "after the watchdog", horizonMs * 1000L);
+  check(runs[6].warm && (runs[6].cause & WDTIFG) && runs[6].historyKept, "watchdog reset did not boot warm");
+  check(runs[6].lastLate == WATCHDOG_NONE && runs[6].watchdogResets == 2, "held CPU reported as a late task");
+  run = 0;
+
+  printf("card init %ld ms from power on, %ld ms after a reset; log of %lu blocks\n", cardPowerMs, cardResetMs,
+         LOG_PREFILL);
+  printf("%-22s %-5s %8s %8s %8s %8s %8s %8s\n", "boot", "kept", "sample", "card", "log", "hold", "reset", "dropped");
+  for (i = 0; i < BOOT_COUNT; i++) {
+    r = &runs[i];
+    printf("%-22s %-5s", r->name, r->warm ? "warm" : "cold");
+    printMs(r->timeline[BOOT_FIRST_SAMPLE]);
+    printMs(r->timeline[BOOT_CARD_READY]);
+    printMs(r->timeline[BOOT_LOG_RUNNING]);
+    printf(" %8.1f", r->longestUs / 1000.0);
+    printMs(r->resetUs);
+    printf(" %8ld\n", r->dropped);
+  }
+
+  printf("\nboot timeline (ms from reset)\n%-15s", "event");
+  for (i = 0; i < BOOT_COUNT; i++) {
+    printf(" %8s", shortName[i]);
+  }
+  printf("\n");
+  for (n = 0; n < BOOT_EVENTS; n++) {
+    printf("%-15s", eventName[n]);
+    for (i = 0; i < BOOT_COUNT; i++) {
+      if (runs[i].timeline[n] >= 0) {
+        printf(" %8.1f", runs[i].timeline[n] / 1000.0);
+      } else {
+        printf(" %8s", "-");
+      }
+    }
+    printf("\n");
+  }
+
+  printf("\nantenna stopped checking in at %.1f ms: late at %.1f ms, watchdog reset at %.1f ms\n",
+         runs[3].hangUs / 1000.0, runs[3].lateUs / 1000.0, runs[3].resetUs / 1000.0);
+  printf("antenna held the CPU from %.1f ms: watchdog reset at %.1f ms\n", runs[5].hangUs / 1000.0,
+         runs[5].resetUs / 1000.0);
+  if (runs[1].timeline[BOOT_FIRST_SAMPLE] > 0 && runs[2].timeline[BOOT_FIRST_SAMPLE] > 0) {
+    printf("warm restart: first sample %.1fx sooner than a cold boot after a reset, log %.1fx sooner\n",
+           (double)runs[2].timeline[BOOT_FIRST_SAMPLE] / runs[1].timeline[BOOT_FIRST_SAMPLE],
+           (double)runs[2].timeline[BOOT_LOG_RUNNING] / runs[1].timeline[BOOT_LOG_RUNNING]);
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
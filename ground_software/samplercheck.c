@@ -0,0 +1,200 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's sampler (main_software/sampler.c) and I2C driver against the USCI model of
+    host/msp430.c, with the MPU-9250 and its AK8963 on the SECONDARY interface:
+
+      samplercheck
+
+    The AK8963 is wired to the MPU-9250's auxiliary bus, as on the board, so it only answers at MAGNET_I2C_ADDR while
+    the MPU-9250 has BYPASS_EN set in INT_PIN_CFG; until then its address is NACKed.  Both devices are banks of
+    registers: a write sets the register pointer and stores any bytes after it, a read returns bytes from the pointer on.
+
+    It checks that samplerInit() turns the bypass on before the first magnetometer transfer, that the magnetometer is
+    then set to SAMPLER_MAGNET_MODE and polled by samplerStep(), and that samplerInit() fails when the MPU-9250 does
+    not answer or does not take the bypass.  It fails (exit code 1) if any check does.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -o samplercheck samplercheck.c \
+        host/msp430.c ../main_software/sampler.c ../main_software/i2c_driver.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "sampler.h"
+#include "arena.h"
+#include "config.h"
+#include "drdy.h"
+
+/* CONSTANTS */
+#define DEVICE_REGISTERS      128
+#define STEP_LIMIT            10000000UL //Steps of the whole run, far more than it takes
+
+/* Name: Device_s
+   Type: struct
+   Parameters:
+    unsigned int address - on the bus
+    unsigned char registers[] - the bank
+    unsigned char pointer - register the next byte goes to or comes from
+    char addressed - 1 while in a transfer, 2 once the register pointer has been written in it
+    char answering - 0 to NACK every address
+    char readOnly - 1 to ACK writes and keep nothing (an MPU-9250 that does not take the bypass)
+    int transfers - addresses ACKed
+*/
+struct Device_s {
+  unsigned int address;
+  unsigned char registers[DEVICE_REGISTERS];
+  unsigned char pointer;
+  char addressed;
+  char answering;
+  char readOnly;
+  int transfers;
+};
+typedef struct Device_s Device;
+
+static Device imu;
+static Device magnet;
+static Device* current; //In the transfer on the bus
+static int magnetNacks; //Magnetometer addresses NACKed because the bypass was off
+static int failures;
+
+static void check(int passed, const char* what) {
+  if (!passed) {
+    printf("FAIL: %s\n", what);
+    failures++;
+  }
+}
+
+/* The bus, for host/msp430.c */
+
+int hostI2cAddress(int usci, unsigned int address, int read) {
+  current = 0;
+  if (usci != SECONDARY) {
+    return 0;
+  }
+  if (address == imu.address && imu.answering) {
+    current = &imu;
+  } else if (address == magnet.address) {
+    if (!(imu.registers[IMU_INT_PIN_CFG_REG] & IMU_BYPASS_EN)) { //Behind the MPU-9250
+      magnetNacks++;
+      return 0;
+    }
+    current = &magnet;
+  } else {
+    return 0;
+  }
+  if (!current->addressed) {
+    current->addressed = 1;
+  }
+  current->transfers++;
+  return 1;
+}
+
+int hostI2cWrite(int usci, unsigned char data) {
+  if (!current) {
+    return 0;
+  }
+  if (current->addressed == 1) {
+    current->pointer = data % DEVICE_REGISTERS;
+    current->addressed = 2;
+  } else {
+    if (!current->readOnly) {
+      current->registers[current->pointer] = data;
+    }
+    current->pointer = (current->pointer + 1) % DEVICE_REGISTERS;
+  }
+  return 1;
+}
+
+unsigned char hostI2cRead(int usci) {
+  unsigned char data;
+
+  if (!current) {
+    return 0xFF;
+  }
+  data = current->registers[current->pointer];
+  current->pointer = (current->pointer + 1) % DEVICE_REGISTERS;
+  return data;
+}
+
+void hostI2cStop(int usci) {
+  imu.addressed = 0;
+  magnet.addressed = 0;
+  current = 0;
+}
+
+/* The rest of the firmware sampler.c links against */
+
+void radioServiceTx(void) {
+}
+
+void radioServiceRx(void) {
+}
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  return calloc(1, size);
+}
+
+unsigned int configGet(ConfigKey key, unsigned int fallback) {
+  return fallback;
+}
+
+char drdyInit(void) {
+  return 1;
+}
+
+/* Name: reset
+   Description:
+    Both devices at their reset values, answering.
+*/
+static void reset(void) {
+  memset(&imu, 0, sizeof(imu));
+  memset(&magnet, 0, sizeof(magnet));
+  imu.address = IMU_I2C_ADDR;
+  imu.answering = 1;
+  magnet.address = MAGNET_I2C_ADDR;
+  magnet.answering = 1;
+  magnetNacks = 0;
+}
+
+int main(void) {
+  unsigned char fresh;
+  int n;
+
+  hostSetStepLimit(STEP_LIMIT);
+  __enable_interrupt();
+
+  //A good IMU: bypass on before the magnetometer is ever addressed
+  reset();
+  check(samplerInit() == 1, "samplerInit() failed with both devices answering");
+  check(imu.registers[IMU_INT_PIN_CFG_REG] == IMU_BYPASS_EN, "INT_PIN_CFG not BYPASS_EN");
+  check(magnetNacks == 0, "magnetometer addressed before the bypass was on");
+  check(magnet.registers[MAGNET_CNTL1_REG] == SAMPLER_MAGNET_MODE, "magnetometer mode not set");
+  check(imu.registers[IMU_INT_ENABLE_REG] == IMU_RAW_DATA_RDY, "data-ready interrupt not enabled");
+
+  //A magnetometer sample
+  for (n = 0; n < 6; n++) {
+    magnet.registers[MAGNET_START + n] = (unsigned char)(0x11 * (n + 1));
+  }
+  magnet.registers[MAGNET_ST1_REG] = MAGNET_ST1_DRDY;
+  fresh = samplerStep();
+  check((fresh & SAMPLER_NEW(SENSOR_MAGNET)) != 0, "magnetometer sample not read");
+  check(!memcmp(samplerGetData(SENSOR_MAGNET), magnet.registers + MAGNET_START, SAMPLER_DATA_BYTES),
+        "magnetometer sample wrong");
+  check(samplerGetStats(SENSOR_MAGNET)->errors == 0, "magnetometer poll failed");
+
+  //No IMU on the bus
+  reset();
+  imu.answering = 0;
+  check(samplerInit() == 0, "samplerInit() passed with the MPU-9250 not answering");
+
+  //An IMU that ACKs the bypass write but does not keep it
+  reset();
+  imu.readOnly = 1;
+  check(samplerInit() == 0, "samplerInit() passed with the bypass not taken");
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,237 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs tasks on the firmware's cooperative scheduler (main_software/os_shim.c), built for the host
+    with OS_SHIM_HOST, so no msp430.h and no interrupt lock:
+
+      shimcheck
+
+    The tasks are shaped like the firmware's, at its priorities (tasks.h): an acquisition task released every tick that
+    signals a semaphore every fourth release, a recorder waiting on that semaphore with a timeout, an antenna task
+    delaying between steps and yielding while a transfer is in progress, two downlink tasks of equal priority that yield
+    once per tick, and a start-up task that returns.  OSTimer() is called once per tick between dispatches, and
+    OSSched() is called until nothing is eligible.
+
+    It checks that the highest priority eligible task always runs first, that the recorder gets the semaphore on the
+    release that signals it and times out once signals stop, that delays last the ticks asked for, that tasks of equal
+    priority take turns, that a task returning without a context switch is never dispatched again, and the tick count.
+    It fails (exit code 1) if any check does.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -DOS_SHIM -DOS_SHIM_HOST -o shimcheck shimcheck.c \
+        ../main_software/os_shim.c
+*/
+
+#include <stdio.h>
+
+#include "os.h"
+
+/* CONSTANTS */
+#define PRIO_IMU              10 //TASK_PRIO_* of tasks.h
+#define PRIO_RECORD           11
+#define PRIO_ANTENNA          12
+#define PRIO_SEND             13
+#define RECORD_TIMEOUT        6 //Ticks the recorder waits for a signal
+#define SIGNAL_EVERY          4 //Releases of the acquisition task per signal
+#define SIGNAL_UNTIL          40 //Tick the signals stop at
+#define ANTENNA_STEP_TICKS    5
+#define ANTENNA_BUSY_YIELDS   2 //Yields per step, a transfer in progress
+#define RUN_TICKS             60
+#define SCHED_LIMIT           100 //Dispatches in one tick, far more than the tasks take
+
+enum Task_e {TASK_IMU = 0,
+             TASK_RECORD,
+             TASK_ANTENNA,
+             TASK_SEND_A,
+             TASK_SEND_B,
+             TASK_ONCE,
+             TASK_COUNT};
+
+static const OStypePrio prios[TASK_COUNT] = {PRIO_IMU, PRIO_RECORD, PRIO_ANTENNA, PRIO_SEND, PRIO_SEND, PRIO_IMU};
+
+static unsigned long tick;
+static int dispatches[TASK_COUNT];
+static int trace[SCHED_LIMIT]; //Tasks dispatched this tick, in order
+static int traced;
+static int releases; //Of the acquisition task
+static int signals;
+static int taken; //Semaphore taken by the recorder
+static int timeouts;
+static unsigned long lastTaken;
+static unsigned long antennaSteps[RUN_TICKS];
+static int antennaStepCount;
+static int antennaYields;
+static int failures;
+
+static void check(int passed, const char* what, unsigned long when) {
+  if (!passed) {
+    printf("FAIL: tick %lu: %s\n", when, what);
+    failures++;
+  }
+}
+
+static void dispatched(int task) {
+  dispatches[task]++;
+  if (traced < SCHED_LIMIT) {
+    trace[traced++] = task;
+  }
+}
+
+/* The tasks: nothing kept in locals across a context switch, as under Salvo */
+
+static void taskImu(void) {
+  OS_TASK_BEGIN();
+  while (1) {
+    dispatched(TASK_IMU);
+    releases++;
+    if (releases % SIGNAL_EVERY == 0 && tick < SIGNAL_UNTIL) {
+      check(OSSignalBinSem(OSECBP(1)) == OSNO_ERR, "semaphore signaled while full", tick);
+      signals++;
+    }
+    OS_Delay(1);
+  }
+  OS_TASK_END();
+}
+
+static void taskRecord(void) {
+  OS_TASK_BEGIN();
+  while (1) {
+    dispatched(TASK_RECORD);
+    OS_WaitBinSem(OSECBP(1), RECORD_TIMEOUT);
+    dispatched(TASK_RECORD);
+    if (OSTimedOut()) {
+      timeouts++;
+    } else {
+      taken++;
+      lastTaken = tick;
+    }
+  }
+  OS_TASK_END();
+}
+
+static void taskAntenna(void) {
+  static int yields;
+
+  OS_TASK_BEGIN();
+  while (1) {
+    dispatched(TASK_ANTENNA);
+    if (antennaStepCount < RUN_TICKS) {
+      antennaSteps[antennaStepCount++] = tick;
+    }
+    for (yields = 0; yields < ANTENNA_BUSY_YIELDS; yields++) {
+      OS_Yield();
+      dispatched(TASK_ANTENNA);
+      antennaYields++;
+    }
+    OS_Delay(ANTENNA_STEP_TICKS);
+  }
+  OS_TASK_END();
+}
+
+static void taskSendA(void) {
+  OS_TASK_BEGIN();
+  while (1) {
+    dispatched(TASK_SEND_A);
+    OS_Yield();
+    dispatched(TASK_SEND_A);
+    OS_Delay(1);
+  }
+  OS_TASK_END();
+}
+
+static void taskSendB(void) {
+  OS_TASK_BEGIN();
+  while (1) {
+    dispatched(TASK_SEND_B);
+    OS_Yield();
+    dispatched(TASK_SEND_B);
+    OS_Delay(1);
+  }
+  OS_TASK_END();
+}
+
+static void taskOnce(void) {
+  OS_TASK_BEGIN();
+  dispatched(TASK_ONCE);
+  OS_TASK_END();
+}
+
+/* Name: checkOrder
+   Description:
+    Nothing in the tick's trace ran while a higher priority task was still to run in the same tick, except where that
+    task only became eligible from the lower one (the recorder after the acquisition task signals).
+*/
+static void checkOrder(void) {
+  int n;
+  int m;
+
+  for (n = 0; n < traced; n++) {
+    for (m = n + 1; m < traced; m++) {
+      if (prios[trace[m]] < prios[trace[n]] && trace[m] != TASK_RECORD) {
+        check(0, "lower priority task ran first", tick);
+      }
+    }
+  }
+}
+
+int main(void) {
+  static OStypeTFP functions[TASK_COUNT] = {taskImu, taskRecord, taskAntenna, taskSendA, taskSendB, taskOnce};
+  int n;
+
+  OSInit();
+  for (n = 0; n < TASK_COUNT; n++) {
+    check(OSCreateTask(functions[n], OSTCBP(n + 1), prios[n]) == OSNO_ERR, "task not created", 0);
+  }
+  check(OSCreateBinSem(OSECBP(1), 0) == OSNO_ERR, "semaphore not created", 0);
+  check(OSCreateTask(taskOnce, OSTCBP(OSTASKS + 1), 0) == OSERR_BAD_P, "task past OSTASKS created", 0);
+
+  for (tick = 0; tick < RUN_TICKS; tick++) {
+    int sends = 0;
+    int lastSend = -1;
+    int before;
+
+    if (tick) {
+      OSTimer();
+    }
+    traced = 0;
+    do {
+      before = traced;
+      OSSched();
+    } while (traced != before && traced < SCHED_LIMIT);
+
+    check(traced < SCHED_LIMIT, "scheduler never idle", tick);
+    check(traced > 0 && trace[0] == TASK_IMU, "acquisition task not first", tick);
+    checkOrder();
+    check(dispatches[TASK_IMU] == (int)tick + 1, "acquisition task not released every tick", tick);
+    for (n = 0; n < traced; n++) { //Equal priorities: A, B, A, B
+      if (trace[n] == TASK_SEND_A || trace[n] == TASK_SEND_B) {
+        check(trace[n] != lastSend, "tasks of equal priority did not take turns", tick);
+        lastSend = trace[n];
+        sends++;
+      }
+    }
+    check(sends == 4, "tasks of equal priority not run twice each", tick);
+    check(OSGetTicks() == tick, "tick count", tick);
+  }
+
+  //Start-up task: once, then destroyed
+  check(dispatches[TASK_ONCE] == 1, "returning task dispatched again", tick);
+
+  //Recorder: every signal taken on the release that gave it, timeouts only after the signals stopped
+  check(taken == signals && signals == (SIGNAL_UNTIL + SIGNAL_EVERY - 1) / SIGNAL_EVERY, "signals not all taken", tick);
+  check(lastTaken < SIGNAL_UNTIL, "semaphore taken after the last signal", tick);
+  check(timeouts == (RUN_TICKS - 1 - (int)lastTaken) / RECORD_TIMEOUT, "recorder did not time out every RECORD_TIMEOUT",
+        tick);
+
+  //Antenna: one step every ANTENNA_STEP_TICKS, each with its yields
+  for (n = 1; n < antennaStepCount; n++) {
+    check(antennaSteps[n] - antennaSteps[n - 1] == ANTENNA_STEP_TICKS, "antenna delay not ANTENNA_STEP_TICKS",
+          antennaSteps[n]);
+  }
+  check(antennaYields == antennaStepCount * ANTENNA_BUSY_YIELDS, "antenna yields lost", tick);
+
+  printf("%lu ticks: %d acquisition releases, %d signals taken, %d timeouts, %d antenna steps, %d + %d downlink turns\n",
+         tick, dispatches[TASK_IMU], taken, timeouts, antennaStepCount, dispatches[TASK_SEND_A],
+         dispatches[TASK_SEND_B]);
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,296 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's event snapshots (main_software/inc/snapshot.h) on the host:
+
+      snapcheck synth [seed]    synthetic trace with known events; checks that each snapshot fires on the right sample,
+                                with the right causes, and holds exactly the samples around it (exit code 1 if not)
+      snapcheck replay <csv>    runs a "flightlog extract" CSV through the trigger rules and lists the snapshots; the log
+                                holds the gyroscope only, raw, so the accelerometer is taken as zero and the gyroscope
+                                as calibrated
+
+    In both, snapshots are released as soon as they freeze, as the downlink would, except where the synthetic trace
+    checks what happens when every snapshot is waiting.
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o snapcheck snapcheck.c ../main_software/snapshot.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+/* CONSTANTS */
+#define SYNTH_SAMPLES         6000
+#define SYNTH_NOISE           200 //Counts, well under every trigger level
+
+/* DATATYPES */
+
+/* Name: Event_s
+   Type: struct
+   Parameters:
+    long at - sample the event starts on
+    int kind - EVENT_* below
+    unsigned char cause - causes the snapshot must end up with, 0 if the event must not start one
+    int keep - 1 to leave the snapshot frozen (until SYNTH_RELEASE_AT), 0 to release it as soon as it freezes
+    int pre - samples before the trigger the snapshot must hold
+   Purpose:
+    One event injected into the synthetic trace, and what the snapshots should make of it.
+*/
+#define EVENT_TUMBLE    0 //Gyroscope x ramps to 60 deg/s over 40 samples, holds for 60 and ramps back down
+#define EVENT_SHOCK     1 //One sample 1.5 g off on the accelerometer
+#define EVENT_COMMAND   2 //snapshotTrigger(SNAPSHOT_CAUSE_COMMAND)
+#define EVENT_JOLT      3 //Gyroscope z 23 deg/s off for one sample
+
+struct Event_s {
+  long at;
+  int kind;
+  unsigned char cause;
+  int keep;
+  int pre;
+};
+typedef struct Event_s Event;
+
+#define SYNTH_RELEASE_AT  3990 //Kept snapshots are released here
+
+//Spaced so every snapshot is frozen before the next event, except where two fall into one post-trigger window
+static const Event events[] = {
+  {400, EVENT_TUMBLE, SNAPSHOT_CAUSE_TUMBLE, 0, SNAPSHOT_PRE},
+  {1000, EVENT_SHOCK, SNAPSHOT_CAUSE_SHOCK, 0, SNAPSHOT_PRE},
+  {1600, EVENT_SHOCK, SNAPSHOT_CAUSE_SHOCK | SNAPSHOT_CAUSE_GYRO_STEP, 0, SNAPSHOT_PRE},
+  {1610, EVENT_JOLT, 0, 0, 0}, //Inside the window above: adds its cause, starts nothing
+  {2200, EVENT_COMMAND, SNAPSHOT_CAUSE_COMMAND, 1, SNAPSHOT_PRE},
+  {2800, EVENT_SHOCK, SNAPSHOT_CAUSE_SHOCK, 1, SNAPSHOT_PRE}, //Every snapshot is frozen after this one
+  {3400, EVENT_SHOCK, 0, 0, 0}, //Dropped
+  {4000, EVENT_SHOCK, SNAPSHOT_CAUSE_SHOCK, 0, 4000 - SYNTH_RELEASE_AT}, //Armed 10 samples before
+};
+#define EVENTS            ((int)(sizeof(events) / sizeof(events[0])))
+
+static SnapshotSample trace[SYNTH_SAMPLES];
+static Snapshot storage[SNAPSHOT_BUFFERS];
+
+static unsigned int seed;
+
+static int noise(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (int)((seed >> 16) % (2 * SYNTH_NOISE + 1)) - SYNTH_NOISE;
+}
+
+/* Name: synthTrace
+   Description:
+    Noise around 1 g on z, plus the events.
+*/
+static void synthTrace(void) {
+  long n;
+  int e;
+  int k;
+  int axis;
+
+  for (n = 0; n < SYNTH_SAMPLES; n++) {
+    for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+      trace[n].gyro[axis] = noise();
+      trace[n].accel[axis] = noise() + (axis == 2 ? 16384 : 0);
+    }
+  }
+  for (e = 0; e < EVENTS; e++) {
+    long at = events[e].at;
+
+    switch (events[e].kind) {
+      case EVENT_TUMBLE: //196 counts per sample, well under the step level
+        for (k = 0; k < 140; k++) {
+          trace[at + k].gyro[0] += (k < 40 ? k : (k < 100 ? 40 : 140 - k)) * 7860 / 40;
+        }
+        break;
+      case EVENT_SHOCK:
+        trace[at].accel[1] += 24576;
+        break;
+      case EVENT_JOLT:
+        trace[at].gyro[2] += 3000;
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+/* Name: expectedTrigger
+   Return value:
+    long - sample the event's snapshot should trigger on: where the ramp crosses the tumble level, or the event itself
+*/
+static long expectedTrigger(const Event* event) {
+  long n = event->at;
+
+  if (event->kind == EVENT_TUMBLE) {
+    while (trace[n].gyro[0] < SNAPSHOT_TUMBLE_LEVEL) {
+      n++;
+    }
+  }
+  return n;
+}
+
+/* Name: checkSnapshot
+   Return value:
+    int - 0 if the snapshot holds trace[trigger - pre] to trace[trigger + SNAPSHOT_POST - 1] in order
+*/
+static int checkSnapshot(const Snapshot* snapshot) {
+  long trigger = (long)snapshot->triggerTick;
+  int n;
+
+  for (n = 0; n < snapshot->pre + SNAPSHOT_POST; n++) {
+    const SnapshotSample* sample = snapshotGetSample(snapshot, (unsigned char)n);
+
+    if (!sample || memcmp(sample, &trace[trigger - snapshot->pre + n], sizeof(*sample))) {
+      printf("  FAIL: sample %d is not trace sample %ld\n", n, trigger - snapshot->pre + n);
+      return -1;
+    }
+  }
+  if (snapshotGetSample(snapshot, (unsigned char)n)) {
+    printf("  FAIL: more than %d samples\n", n);
+    return -1;
+  }
+  return 0;
+}
+
+/* Name: checkFrozen
+   Return value:
+    int - 0 if the snapshot matches an event
+   Description:
+    Releases the snapshot unless its event keeps it.
+*/
+static int checkFrozen(Snapshot* snapshot) {
+  const Event* event = 0;
+  int failed = 0;
+  int e;
+
+  for (e = 0; e < EVENTS; e++) {
+    if (events[e].cause && expectedTrigger(&events[e]) == (long)snapshot->triggerTick) {
+      event = &events[e];
+    }
+  }
+  printf("snapshot %u: trigger at %lu, causes 0x%02X, %u before\n", snapshot->sequence, snapshot->triggerTick,
+         snapshot->cause, snapshot->pre);
+  if (!event) {
+    printf("  FAIL: no event triggers there\n");
+    failed = 1;
+  } else if (snapshot->cause != event->cause || snapshot->pre != event->pre) {
+    printf("  FAIL: expected causes 0x%02X, %d before\n", event->cause, event->pre);
+    failed = 1;
+  }
+  if (checkSnapshot(snapshot) < 0) {
+    failed = 1;
+  }
+  if (!event || !event->keep) {
+    snapshotRelease(snapshot);
+  }
+  return failed;
+}
+
+static int commandSynth(unsigned int initialSeed) {
+  unsigned int checked = 0;
+  int expected = 0;
+  int failed = 0;
+  long n;
+  int e;
+
+  seed = initialSeed;
+  synthTrace();
+  snapshotInit(storage);
+
+  for (n = 0; n < SYNTH_SAMPLES; n++) {
+    Snapshot* snapshot;
+    int b;
+
+    if (n == SYNTH_RELEASE_AT) {
+      while ((snapshot = snapshotNext())) {
+        snapshotRelease(snapshot);
+      }
+    }
+    for (e = 0; e < EVENTS; e++) {
+      if (events[e].at == n && events[e].kind == EVENT_COMMAND) {
+        snapshotTrigger(SNAPSHOT_CAUSE_COMMAND);
+      }
+    }
+    snapshotSample(trace[n].gyro, trace[n].accel, (unsigned long)n);
+
+    for (b = 0; b < SNAPSHOT_BUFFERS; b++) { //Each snapshot once, when it freezes
+      if (storage[b].state == SNAPSHOT_FROZEN && storage[b].sequence == checked) {
+        failed |= checkFrozen(&storage[b]);
+        checked++;
+      }
+    }
+  }
+
+  for (e = 0; e < EVENTS; e++) {
+    expected += events[e].cause != 0;
+  }
+  printf("%u snapshot(s) of %d expected, %u trigger(s), %u sample(s) dropped\n", checked, expected,
+         snapshotGetStats()->triggers, snapshotGetStats()->dropped);
+  if (checked != (unsigned int)expected || snapshotGetStats()->dropped != 2) { //The dropped shock and its return
+    printf("FAIL: expected %d snapshots and 2 drops\n", expected);
+    failed = 1;
+  }
+  printf("%s\n", failed ? "FAILED" : "passed");
+  return failed;
+}
+
+static int commandReplay(const char* path) {
+  char line[256];
+  FILE* in = fopen(path, "r");
+  int accel[SNAPSHOT_AXES] = {0, 0, 0};
+  unsigned long samples = 0;
+
+  if (!in) {
+    perror(path);
+    return 1;
+  }
+  snapshotInit(storage);
+  while (fgets(line, sizeof(line), in)) {
+    unsigned long tick;
+    int gyro[SNAPSHOT_AXES];
+    Snapshot* snapshot;
+
+    if (sscanf(line, "%*u,%lu,%d,%d,%d", &tick, &gyro[0], &gyro[1], &gyro[2]) != 4) {
+      continue; //Header
+    }
+    snapshotSample(gyro, accel, tick);
+    samples++;
+
+    while ((snapshot = snapshotNext())) {
+      int peak = 0;
+      int n;
+      int axis;
+      const SnapshotSample* sample;
+
+      for (n = 0; (sample = snapshotGetSample(snapshot, (unsigned char)n)); n++) {
+        for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+          int value = abs(sample->gyro[axis]);
+
+          peak = value > peak ? value : peak;
+        }
+      }
+      printf("snapshot %u: trigger at tick %lu, causes 0x%02X, %u before, peak gyro %d\n", snapshot->sequence,
+             snapshot->triggerTick, snapshot->cause, snapshot->pre, peak);
+      snapshotRelease(snapshot);
+    }
+  }
+  fclose(in);
+  printf("%lu samples, %u snapshot(s)\n", samples, snapshotGetStats()->frozen);
+  return 0;
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: snapcheck synth [seed]\n"
+                  "       snapcheck replay <csv>\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "synth")) {
+    return commandSynth(argc >= 3 ? (unsigned int)atoi(argv[2]) : 1);
+  }
+  if (argc >= 3 && !strcmp(argv[1], "replay")) {
+    return commandReplay(argv[2]);
+  }
+  usage();
+  return 2;
+}
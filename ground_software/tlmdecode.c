@@ -0,0 +1,338 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that decodes the downlink (frames in main_software/inc/telemetry.h, payloads in downlink.h):
+
+      tlmdecode frames <file>   frames as received from the radio, one line each; health packets and the task profiles
+                                of PROFILE builds (profile.h) in full, the other classes by their header
+      tlmdecode synth [file]    runs the firmware's profiler (profile.c) on the host model, with tasks of known run
+                                times, and queues its packets through telemetry.c as downlink.c does; then decodes the
+                                frames and checks the profiles against the firmware's.  Writes the frames to file if
+                                one is given, for the frames command
+
+    The decoder hunts for the sync bytes, so it can start anywhere in a capture, and drops frames whose CRC fails.  In
+    the health class a packet of DOWNLINK_HEALTH_BYTES is a health packet and one of PROFILE_PACKED_BYTES a task
+    profile, which it also keeps to print a table of the latest profile of each task at the end.
+
+    synth fails (exit code 1) if a profile does not come back as profileGet() has it, if run times or counts are not
+    what the tasks did, or if a frame with a byte flipped in it is not dropped.
+
+   Build:
+    gcc -O2 -Wall -Ihost -I../main_software/inc -DOS_SHIM -DPROFILE -o tlmdecode tlmdecode.c host/msp430.c \
+        ../main_software/profile.c ../main_software/telemetry.c ../main_software/log_format.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "msp430.h"
+#include "telemetry.h"
+#include "downlink.h"
+#include "profile.h"
+#include "tasks.h"
+#include "log_format.h"
+
+/* CONSTANTS */
+#define TICK_US               (1000000UL / OS_TICK_HZ)
+#define STREAM_BYTES          65536
+#define RUN_SECONDS           120
+#define PROFILE_SLACK         1 //Timer B counts either side of a run, from where it falls between two counts
+
+static const char* const className[TELEMETRY_CLASSES] = {"health", "snapshot", "imu", "reply", "bulk"};
+
+/* Name: SynthTask_s
+   Type: struct
+   Parameters:
+    unsigned long runUs - time each run takes
+    unsigned char delay - OS ticks it waits after each run, 0 to yield
+*/
+struct SynthTask_s {
+  unsigned long runUs;
+  unsigned char delay;
+};
+typedef struct SynthTask_s SynthTask;
+
+static const SynthTask synthTasks[PROFILE_TASKS] = {
+  {450, 1}, //TASK_ID_GET_IMU_DATA
+  {1200, 2}, //TASK_ID_RUN_KALMAN_FILTER
+  {300, 0}, //TASK_ID_GET_HEALTH_INFO
+  {2500, 10}, //TASK_ID_SEND_DATA
+  {90, 0}, //TASK_ID_DEPLOY_ANTENNA
+  {700, 5} //TASK_ID_RECORD_DATA
+};
+
+static TaskProfile decoded[PROFILE_TASKS]; //Latest profile of each task from the frames
+static char decodedSeen[PROFILE_TASKS];
+
+/* Decoding */
+
+/* Name: decodeHealth
+   Description:
+    Prints a health packet, layout in downlink.h.
+*/
+static void decodeHealth(const unsigned char* p) {
+  int n;
+
+  printf("tick %lu antenna state %u attempts %u faults %u, imu overruns %u skipped %u, snapshots %u dropped %u, radio "
+         "rx overruns %u tx refused %u, commands %u rejected %u crc errors %u, bulk %u state %u base %u, restarts %u "
+         "watchdog %u late %u, lost", logGet32(p), p[4], p[5], p[6], logGet16(p + 7), logGet16(p + 9),
+         logGet16(p + 11), logGet16(p + 13), logGet16(p + 15), logGet16(p + 17), logGet16(p + 19), logGet16(p + 21),
+         logGet16(p + 23), p[25], p[26], logGet16(p + 27), logGet16(p + 29), logGet16(p + 31), p[33]);
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    printf(" %u", logGet16(p + 34 + 2 * n));
+  }
+  printf("\n");
+}
+
+/* Name: decodeProfile
+   Parameters:
+    int quiet - 1 to keep it without printing it
+   Description:
+    Prints a task profile, layout in profile.h, and keeps it for the table.
+*/
+static void decodeProfile(const unsigned char* p, int quiet) {
+  TaskProfile profile;
+
+  profile.runs = logGet32(p + 5);
+  profile.runTime = logGet32(p + 9);
+  profile.longestRun = logGet16(p + 13);
+  profile.longestYieldWait = logGet16(p + 15);
+  profile.longestDelayLate = logGet16(p + 17);
+  profile.yields = logGet16(p + 19);
+  profile.delays = logGet16(p + 21);
+  if (!quiet) {
+    printf("tick %lu profile of task %u: runs %lu, %lu counts running\n", logGet32(p), p[4], profile.runs,
+           profile.runTime);
+  }
+  if (p[4] < PROFILE_TASKS) {
+    decoded[p[4]] = profile;
+    decodedSeen[p[4]] = 1;
+  }
+}
+
+/* Name: decodeFrames
+   Parameters:
+    const unsigned char* data, unsigned long length - received bytes
+    int quiet - 1 to count the frames and keep the profiles without printing anything
+   Return value:
+    unsigned long - good frames
+*/
+static unsigned long decodeFrames(const unsigned char* data, unsigned long length, int quiet) {
+  unsigned long good = 0;
+  unsigned long bad = 0;
+  unsigned long at = 0;
+
+  while (at + TELEMETRY_FRAME_OVERHEAD <= length) {
+    const unsigned char* frame = data + at;
+    unsigned int payloadLength = frame[2];
+    unsigned int frameLength = TELEMETRY_FRAME_HEADER + payloadLength;
+    const unsigned char* payload = frame + TELEMETRY_FRAME_HEADER;
+
+    if (frame[0] != TELEMETRY_SYNC_0 || frame[1] != TELEMETRY_SYNC_1 || payloadLength > TELEMETRY_PAYLOAD_MAX ||
+        frame[3] >= TELEMETRY_CLASSES || at + frameLength + 2 > length ||
+        logCrc16(frame, frameLength) != logGet16(frame + frameLength)) {
+      if (frame[0] == TELEMETRY_SYNC_0 && frame[1] == TELEMETRY_SYNC_1) {
+        bad++;
+      }
+      at++;
+      continue;
+    }
+    good++;
+    at += frameLength + 2;
+    if (frame[3] == TELEMETRY_HEALTH && payloadLength == PROFILE_PACKED_BYTES) {
+      if (!quiet) {
+        printf("%-8s %5u  ", className[frame[3]], logGet16(frame + 4));
+      }
+      decodeProfile(payload, quiet);
+      continue;
+    }
+    if (quiet) {
+      continue;
+    }
+    printf("%-8s %5u  ", className[frame[3]], logGet16(frame + 4));
+    if (frame[3] == TELEMETRY_HEALTH && payloadLength == DOWNLINK_HEALTH_BYTES) {
+      decodeHealth(payload);
+    } else if (frame[3] == TELEMETRY_SNAPSHOT && payloadLength >= DOWNLINK_SNAPSHOT_HEADER) {
+      printf("snapshot %u trigger tick %lu cause 0x%02X pre %u from sample %u, %u samples\n", logGet16(payload),
+             logGet32(payload + 2), payload[6], payload[7], payload[8], payload[9]);
+    } else if (frame[3] == TELEMETRY_IMU && payloadLength == DOWNLINK_IMU_BYTES) {
+      printf("tick %lu gyroscope %d %d %d\n", logGet32(payload), (short)logGet16(payload + 4),
+             (short)logGet16(payload + 6), (short)logGet16(payload + 8));
+    } else {
+      printf("%u bytes\n", payloadLength);
+    }
+  }
+  if (bad && !quiet) {
+    printf("%lu frame(s) failed their CRC\n", bad);
+  }
+  return good;
+}
+
+/* Name: printProfiles
+   Description:
+    The latest profile of each task from the frames, as profileReport() prints them.
+*/
+static void printProfiles(void) {
+  int n;
+
+  printf("%4s %8s %10s %8s %8s %6s %6s %6s\n", "task", "runs", "run us", "max us", "wait us", "late", "yields",
+         "delays");
+  for (n = 0; n < PROFILE_TASKS; n++) {
+    if (decodedSeen[n]) {
+      printf("%4d %8lu %10llu %8llu %8llu %6u %6u %6u\n", n, decoded[n].runs,
+             decoded[n].runTime * 1000000ULL / PROFILE_TIMER_HZ, decoded[n].longestRun * 1000000ULL / PROFILE_TIMER_HZ,
+             decoded[n].longestYieldWait * 1000000ULL / PROFILE_TIMER_HZ, decoded[n].longestDelayLate,
+             decoded[n].yields, decoded[n].delays);
+    }
+  }
+}
+
+static int decodeFile(const char* name) {
+  static unsigned char data[1 << 20];
+  unsigned long length;
+  FILE* in = fopen(name, "rb");
+
+  if (!in) {
+    perror(name);
+    return 2;
+  }
+  length = fread(data, 1, sizeof(data), in);
+  fclose(in);
+  printf("%lu frame(s)\n", decodeFrames(data, length, 0));
+  printProfiles();
+  return 0;
+}
+
+/* The synthetic run */
+
+/* Name: clockGetTicks
+   Description:
+    The OS tick from the model's time, for profile.c.
+*/
+unsigned long clockGetTicks(void) {
+  return (unsigned long)(hostGetNanoseconds() / (TICK_US * 1000ULL));
+}
+
+static unsigned char stream[STREAM_BYTES];
+static unsigned long streamLength;
+
+/* Name: synthSend
+   Description:
+    What downlink.c does each step in contact: a pass of the queue into the stream.
+*/
+static void synthSend(unsigned long tick) {
+  unsigned char length;
+
+  telemetryBeginPass();
+  while (streamLength + TELEMETRY_FRAME_MAX <= STREAM_BYTES &&
+         (length = telemetryDequeue(stream + streamLength, TELEMETRY_FRAME_MAX, tick))) {
+    streamLength += length;
+  }
+}
+
+/* Name: synthQueueProfile
+   Description:
+    What downlink.c's downlinkQueueProfile() does.
+*/
+static void synthQueueProfile(char id, unsigned long tick) {
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+
+  if (profilePack(id, tick, payload)) {
+    telemetryPut(TELEMETRY_HEALTH, payload, PROFILE_PACKED_BYTES, tick);
+  }
+}
+
+static int synth(const char* name) {
+  static TelemetryPacket pool[TELEMETRY_SLOTS];
+  unsigned long wake[PROFILE_TASKS] = {0};
+  unsigned long runs[PROFILE_TASKS] = {0};
+  unsigned long tick;
+  unsigned long good;
+  char next = 0;
+  int failures = 0;
+  int n;
+
+  telemetryInit(pool, telemetryPolicies);
+  profileInit();
+  for (tick = 0; tick < RUN_SECONDS * OS_TICK_HZ; tick++) {
+    hostElapse(TICK_US - (unsigned long)(hostGetNanoseconds() / 1000 % TICK_US));
+    for (n = 0; n < PROFILE_TASKS; n++) { //In priority order, as the scheduler would
+      if (clockGetTicks() < wake[n]) {
+        continue;
+      }
+      profileResume(n);
+      hostElapse(synthTasks[n].runUs);
+      profileSuspend(n, synthTasks[n].delay);
+      runs[n]++;
+      wake[n] = clockGetTicks() + synthTasks[n].delay;
+    }
+    if (tick % DOWNLINK_HEALTH_TICKS == 0) {
+      synthQueueProfile(next, clockGetTicks());
+      next = (next + 1) % PROFILE_TASKS;
+    }
+    if (tick % DOWNLINK_PASS_TICKS == 0) {
+      synthSend(clockGetTicks());
+    }
+  }
+  for (n = 0; n < PROFILE_TASKS; n++) { //The last of each, one per pass so none is dropped for the next
+    synthQueueProfile(n, clockGetTicks());
+    synthSend(clockGetTicks());
+  }
+
+  if (name) {
+    FILE* out = fopen(name, "wb");
+
+    if (!out || fwrite(stream, 1, streamLength, out) != streamLength) {
+      perror(name);
+      return 2;
+    }
+    fclose(out);
+  }
+  printf("%lu s, %lu frame bytes, %lu frame(s) decoded\n", (unsigned long)RUN_SECONDS, streamLength,
+         decodeFrames(stream, streamLength, 1));
+  printProfiles();
+  for (n = 0; n < PROFILE_TASKS; n++) {
+    const TaskProfile* profile = profileGet(n);
+    unsigned long long counts = synthTasks[n].runUs * (unsigned long long)PROFILE_TIMER_HZ / 1000000ULL;
+
+    if (!decodedSeen[n] || memcmp(&decoded[n], profile, sizeof(TaskProfile))) {
+      printf("FAIL: task %d's profile did not come back as the firmware has it\n", n);
+      failures++;
+    }
+    if (profile->runs != runs[n] || (synthTasks[n].delay ? profile->delays : profile->yields) != runs[n]) {
+      printf("FAIL: task %d ran %lu times, the profile has %lu runs, %u yields, %u delays\n", n, runs[n],
+             profile->runs, profile->yields, profile->delays);
+      failures++;
+    }
+    if (profile->longestRun > counts + PROFILE_SLACK || profile->longestRun + PROFILE_SLACK < counts ||
+        profile->runTime > (counts + PROFILE_SLACK) * runs[n] || profile->runTime + PROFILE_SLACK * runs[n] <
+        counts * runs[n]) {
+      printf("FAIL: task %d ran %lu us at a time, the profile has %u counts longest and %lu in all\n", n,
+             synthTasks[n].runUs, profile->longestRun, profile->runTime);
+      failures++;
+    }
+  }
+  if (telemetryGetStats(TELEMETRY_HEALTH) -> dropped) {
+    printf("FAIL: %u profile packet(s) dropped\n", telemetryGetStats(TELEMETRY_HEALTH) -> dropped);
+    failures++;
+  }
+  good = decodeFrames(stream, streamLength, 1);
+  stream[TELEMETRY_FRAME_HEADER + 2] ^= 0x10; //In the first frame's payload
+  if (decodeFrames(stream, streamLength, 1) + 1 != good) {
+    printf("FAIL: a frame with a byte flipped was not dropped\n");
+    failures++;
+  }
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc == 3 && !strcmp(argv[1], "frames")) {
+    return decodeFile(argv[2]);
+  }
+  if ((argc == 2 || argc == 3) && !strcmp(argv[1], "synth")) {
+    return synth(argc == 3 ? argv[2] : 0);
+  }
+  fprintf(stderr, "usage: tlmdecode frames <file>\n       tlmdecode synth [file]\n");
+  return 2;
+}
@@ -0,0 +1,278 @@
+/* Author: John Walnut
+   Purpose:
+    Ground tool that runs the firmware's telemetry queue (main_software/inc/telemetry.h) through simulated orbits:
+
+      tlmsim [-o orbits] [-c contact s] [-e snapshots per orbit] [-s seed] [baud ...]
+
+    Every DOWNLINK_PASS_TICKS the producers of downlink.c run at their flight rates and sizes (a health packet every 5 s,
+    an IMU frame every second and in contact whenever the last one is out, snapshot packets as fast as their queue
+    takes them, from events at random times), and
+    during the contact window of each orbit the queue is emptied into a model of the radio's transmit ring, which
+    drains at the baud rate.  Each baud rate (default 1200, 2400 and 9600) is run twice: with the flight policy
+    (telemetryPolicies) and with every class weighted alike and nothing strict or aged, for comparison.
+
+    Per class it reports packets offered, sent, lost to a full queue, aged out, the mean and longest queue latency,
+    and the share of the bytes sent; then the link use during contacts (bytes the ring drained while in contact, not
+    those still in it when the contact ends), how many snapshots reached the ground whole, and how long each took once
+    both it and the link were there (from freezing or from the start of the contact).
+
+   Build:
+    gcc -O2 -Wall -I../main_software/inc -o tlmsim tlmsim.c ../main_software/telemetry.c ../main_software/log_format.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry.h"
+
+/* CONSTANTS */
+#define TICK_HZ               100 //OS_TICK_HZ
+#define PASS_TICKS            10 //DOWNLINK_PASS_TICKS
+#define HEALTH_TICKS          500 //DOWNLINK_HEALTH_TICKS
+#define IMU_TICKS             100 //DOWNLINK_IMU_TICKS
+#define HEALTH_BYTES          (34 + 2 * TELEMETRY_CLASSES) //DOWNLINK_HEALTH_BYTES
+#define IMU_BYTES             22 //DOWNLINK_IMU_BYTES
+#define SNAPSHOT_HEADER       10 //DOWNLINK_SNAPSHOT_HEADER
+#define SNAPSHOT_SAMPLES      3 //DOWNLINK_SNAPSHOT_SAMPLES
+#define SNAPSHOT_LEN          32 //SNAPSHOT_LEN
+#define SNAPSHOT_BUFFERS      2 //SNAPSHOT_BUFFERS
+#define TX_RING               127 //RADIO_TX_LEN, less the byte kept free
+
+#define ORBIT_S               5400 //90 minute orbit
+#define MAX_SNAPSHOTS         1000
+
+/* Name: Pending_s
+   Type: struct
+   Parameters:
+    unsigned long trigger - tick of the event
+    int queued - samples queued so far
+    int delivered - samples sent so far
+    long done - ticks from the snapshot being frozen or the contact starting, whichever is later, to its last byte
+                being sent; -1 until then
+   Purpose:
+    One simulated snapshot, from its event to the ground.
+*/
+struct Pending_s {
+  unsigned long trigger;
+  int queued;
+  int delivered;
+  long done;
+};
+typedef struct Pending_s Pending;
+
+static TelemetryPacket pool[TELEMETRY_SLOTS];
+static Pending snapshots[MAX_SNAPSHOTS];
+static int snapshotCount;
+static int snapshotSending; //Oldest snapshot not yet fully queued
+static unsigned long offered[TELEMETRY_CLASSES];
+
+static unsigned int seed;
+
+static unsigned int nextRandom(void) {
+  seed = seed * 1103515245u + 12345u;
+  return (seed >> 16) & 0x7FFF;
+}
+
+/* Name: queueSnapshots
+   Description:
+    As downlinkQueueSnapshots(): fills the free snapshot slots from the oldest frozen snapshot on.  The payload carries
+    the snapshot's index where the firmware puts its sequence, so the sender can follow it to the ground.
+*/
+static void queueSnapshots(unsigned long tick) {
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+
+  while (telemetryGetFree(TELEMETRY_SNAPSHOT) && snapshotSending < snapshotCount &&
+         snapshots[snapshotSending].trigger + SNAPSHOT_LEN / 2 <= tick) { //Frozen once the post-trigger half is in
+    Pending* snapshot = &snapshots[snapshotSending];
+    int samples = SNAPSHOT_LEN - snapshot->queued;
+
+    if (samples > SNAPSHOT_SAMPLES) {
+      samples = SNAPSHOT_SAMPLES;
+    }
+    memset(payload, 0, sizeof(payload));
+    payload[0] = snapshotSending & 0xFF;
+    payload[1] = snapshotSending >> 8;
+    payload[8] = (unsigned char)snapshot->queued;
+    payload[9] = (unsigned char)samples;
+    offered[TELEMETRY_SNAPSHOT]++;
+    telemetryPut(TELEMETRY_SNAPSHOT, payload, (unsigned char)(SNAPSHOT_HEADER + 12 * samples), tick);
+    snapshot->queued += samples;
+    if (snapshot->queued == SNAPSHOT_LEN) {
+      snapshotSending++;
+    }
+  }
+}
+
+/* Name: simulate
+   Parameters:
+    const TelemetryPolicy* policies - policy to run
+    long baud - link rate
+    int orbits, contactSeconds, eventsPerOrbit - the scenario
+*/
+static void simulate(const TelemetryPolicy* policies, const char* name, long baud, int orbits, int contactSeconds,
+                     int eventsPerOrbit, unsigned int initialSeed) {
+  static const char* const className[TELEMETRY_CLASSES] = {"health", "snapshot", "imu", "reply", "bulk"};
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  unsigned long end = (unsigned long)orbits * ORBIT_S * TICK_HZ;
+  unsigned long contactTicks = 0;
+  unsigned long sentBytes = 0; //Queued into the ring in contacts
+  double linkBytes = 0; //Drained from the ring in contacts
+  double ring = 0; //Bytes in the transmit ring
+  double drain = baud / 10.0 / TICK_HZ * PASS_TICKS; //Bytes the UART sends per pass
+  unsigned long nextImu = 0;
+  unsigned long contactStart = 0;
+  unsigned long tick;
+  int whole = 0;
+  double wholeLatency = 0;
+  long wholeMax = 0;
+  int n;
+
+  seed = initialSeed;
+  telemetryInit(pool, policies);
+  memset(offered, 0, sizeof(offered));
+  memset(payload, 0, sizeof(payload));
+  snapshotCount = 0;
+  snapshotSending = 0;
+
+  for (tick = 0; tick < end; tick += PASS_TICKS) {
+    unsigned long inOrbit = tick % ((unsigned long)ORBIT_S * TICK_HZ);
+    int contact = inOrbit >= (unsigned long)(ORBIT_S - contactSeconds) * TICK_HZ; //At the end of each orbit
+    unsigned char length;
+
+    //Events at random, as many per orbit on average as asked, while both snapshots might still be waiting
+    if (eventsPerOrbit && nextRandom() % (ORBIT_S * TICK_HZ / PASS_TICKS / eventsPerOrbit) == 0 &&
+        snapshotCount < MAX_SNAPSHOTS) {
+      if (snapshotCount - snapshotSending < SNAPSHOT_BUFFERS) {
+        snapshots[snapshotCount].trigger = tick;
+        snapshots[snapshotCount].queued = 0;
+        snapshots[snapshotCount].delivered = 0;
+        snapshots[snapshotCount].done = -1;
+        snapshotCount++;
+      }
+    }
+
+    if (tick % HEALTH_TICKS == 0) {
+      offered[TELEMETRY_HEALTH]++;
+      telemetryPut(TELEMETRY_HEALTH, payload, HEALTH_BYTES, tick);
+    }
+    if (tick >= nextImu || (contact && telemetryGetFree(TELEMETRY_IMU) == policies[TELEMETRY_IMU].slots)) {
+      offered[TELEMETRY_IMU]++;
+      telemetryPut(TELEMETRY_IMU, payload, IMU_BYTES, tick);
+      nextImu = tick + IMU_TICKS;
+    }
+    queueSnapshots(tick);
+
+    if (contact) { //Bytes still in the ring when the contact ends are not counted
+      linkBytes += ring < drain ? ring : drain;
+    }
+    ring -= drain;
+    if (ring < 0) {
+      ring = 0;
+    }
+    if (!contact) {
+      continue;
+    }
+    if (inOrbit == (unsigned long)(ORBIT_S - contactSeconds) * TICK_HZ) {
+      contactStart = tick;
+    }
+    contactTicks += PASS_TICKS;
+    telemetryBeginPass();
+    while ((length = telemetryDequeue(frame, (unsigned int)(TX_RING - ring), tick))) {
+      ring += length;
+      sentBytes += length;
+      if (frame[3] == TELEMETRY_SNAPSHOT) {
+        Pending* snapshot = &snapshots[frame[TELEMETRY_FRAME_HEADER] | frame[TELEMETRY_FRAME_HEADER + 1] << 8];
+
+        snapshot->delivered += frame[TELEMETRY_FRAME_HEADER + 9];
+        if (snapshot->delivered == SNAPSHOT_LEN) {
+          unsigned long ready = snapshot->trigger + SNAPSHOT_LEN / 2;
+
+          ready = ready > contactStart ? ready : contactStart;
+          snapshot->done = (long)(tick - ready) + (long)(ring / drain * PASS_TICKS); //When the last byte is out
+        }
+      }
+    }
+  }
+
+  printf("\n%ld baud, %s policy\n", baud, name);
+  printf("%-9s %8s %8s %8s %8s %10s %10s %7s\n", "class", "offered", "sent", "full", "aged", "mean lat s",
+         "max lat s", "bytes%");
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    const TelemetryStats* stats = telemetryGetStats(n);
+
+    printf("%-9s %8lu %8u %8u %8u %10.1f %10.1f %6.1f%%\n", className[n], offered[n], stats->sent,
+           stats->dropped, stats->aged, stats->sent ? (double)stats->latencyTotal / stats->sent / TICK_HZ : 0.0,
+           (double)stats->latencyMax / TICK_HZ, sentBytes ? 100.0 * stats->bytes / sentBytes : 0.0);
+  }
+  for (n = 0; n < snapshotCount; n++) {
+    if (snapshots[n].done >= 0) {
+      long latency = snapshots[n].done;
+
+      whole++;
+      wholeLatency += latency;
+      wholeMax = latency > wholeMax ? latency : wholeMax;
+    }
+  }
+  printf("link use in contact %.1f%%, snapshots whole on the ground %d of %d, in contact after %.1f s (max %.1f s)\n",
+         contactTicks ? 100.0 * linkBytes / (baud / 10.0 * contactTicks / TICK_HZ) : 0.0, whole, snapshotCount,
+         whole ? wholeLatency / whole / TICK_HZ : 0.0, (double)wholeMax / TICK_HZ);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: tlmsim [-o orbits] [-c contact s] [-e snapshots per orbit] [-s seed] [baud ...]\n");
+}
+
+int main(int argc, char** argv) {
+  static const long defaultBauds[] = {1200, 2400, 9600};
+  TelemetryPolicy equal[TELEMETRY_CLASSES];
+  long bauds[16];
+  int baudCount = 0;
+  int orbits = 3;
+  int contactSeconds = 480;
+  int eventsPerOrbit = 6;
+  unsigned int initialSeed = 1;
+  int n;
+
+  for (n = 1; n < argc; n++) {
+    if (!strcmp(argv[n], "-o") && n + 1 < argc) {
+      orbits = atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-c") && n + 1 < argc) {
+      contactSeconds = atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-e") && n + 1 < argc) {
+      eventsPerOrbit = atoi(argv[++n]);
+    } else if (!strcmp(argv[n], "-s") && n + 1 < argc) {
+      initialSeed = (unsigned int)atoi(argv[++n]);
+    } else if (argv[n][0] != '-' && baudCount < 16) {
+      bauds[baudCount++] = atol(argv[n]);
+    } else {
+      usage();
+      return 2;
+    }
+  }
+  if (orbits < 1 || contactSeconds < 0 || contactSeconds > ORBIT_S || eventsPerOrbit < 0) {
+    usage();
+    return 2;
+  }
+  if (!baudCount) {
+    memcpy(bauds, defaultBauds, sizeof(defaultBauds));
+    baudCount = sizeof(defaultBauds) / sizeof(defaultBauds[0]);
+  }
+
+  for (n = 0; n < TELEMETRY_CLASSES; n++) { //Same slots, same drop rule, no priority and no age limit
+    equal[n] = telemetryPolicies[n];
+    equal[n].strict = 0;
+    equal[n].quantum = TELEMETRY_FRAME_MAX;
+    equal[n].passBytes = 0;
+    equal[n].maxAgeTicks = 0;
+  }
+
+  printf("%d orbit(s) of %d s, %d s contact each, %d snapshot event(s) per orbit on average\n", orbits, ORBIT_S,
+         contactSeconds, eventsPerOrbit);
+  for (n = 0; n < baudCount; n++) {
+    simulate(telemetryPolicies, "flight", bauds[n], orbits, contactSeconds, eventsPerOrbit, initialSeed);
+    simulate(equal, "equal", bauds[n], orbits, contactSeconds, eventsPerOrbit, initialSeed);
+  }
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in antenna.h
+*/
+
+#include "antenna.h"
+#include "i2c_peripherals.h"
+#include "watchdog.h"
+
+//Everything the interrupt routines touch has to outlive the task's context switches
+static I2CMessage antennaMessage;
+static char antennaCommand[2];
+static char antennaResponse[2];
+static char transferPending;
+static unsigned char pollInterval;
+static AntennaHealth health;
+
+/* Name: antennaTransfer
+   Return value:
+    char - 1 once the transaction has finished (result in antennaMessage.error), 0 while it is still going
+   Description:
+    Starts (first call) and then checks on a non-blocking transaction with the antenna controller.
+*/
+static char antennaTransfer(char command, char argument, int commandLength, int responseLength) {
+
+  if (transferPending) {
+    if (antennaMessage.error == I2CERR_IN_PROGRESS) {
+      return 0;
+    }
+    transferPending = 0;
+    return 1;
+  }
+
+  antennaCommand[0] = command;
+  antennaCommand[1] = argument;
+  i2cInitializeMessage(&antennaMessage, antennaCommand, commandLength, ANTENNA_I2C_ADDR, \
+                       (responseLength > 0) ? RX_MODE : TX_MODE, responseLength, antennaResponse, PRIMARY);
+  i2cSetMessageRate(&antennaMessage, ANTENNA_I2C_MAX_HZ);
+  i2cStartMessage(&antennaMessage);
+
+  if (antennaMessage.error == I2CERR_BUS_BUSY) { //Try again next time around
+    return 0;
+  }
+  if (antennaMessage.error != I2CERR_IN_PROGRESS) { //Failed before it started
+    return 1;
+  }
+  transferPending = 1;
+  return 0;
+}
+
+/* Name: antennaWait
+   Description:
+    Counts ticks spent waiting in the current attempt, so the timeout does not depend on the system clock.
+*/
+static unsigned char antennaWait(unsigned char ticks) {
+  health.elapsedTicks += ticks;
+  return ticks;
+}
+
+/* Name: antennaFault
+   Description:
+    Handles a failed transaction: retries the current state a little later, or gives up.
+*/
+static unsigned char antennaFault(void) {
+  health.lastError = antennaMessage.error;
+  health.faults++;
+  if (health.faults >= ANTENNA_MAX_FAULTS) {
+    health.state = ANT_FAILED;
+    return ANTENNA_IDLE_TICKS;
+  }
+  return antennaWait(ANTENNA_FAULT_RETRY_TICKS);
+}
+
+void antennaInit(void) {
+  const WatchdogKept* kept = watchdogGetKept();
+  I2CConfig cfg;
+
+  SET_ISOL_PIN_OUT;
+  ENABLE_ISOL_I2C;
+  i2cInitializeConfigRate(&cfg, PRIMARY, I2C_STANDARD_HZ);
+  i2cInit(&cfg);
+
+  transferPending = 0;
+  health.state = ANT_ARMING;
+  health.status = ANTENNA_STATUS_NOT_DEPLOYED_MASK; //Nothing known to be out yet
+  health.elapsedTicks = 0;
+  health.attempts = 0;
+  health.faults = 0;
+  health.lastError = cfg.error;
+
+  if (kept) { //Warm restart: never burn more than ANTENNA_MAX_ATTEMPTS times, nor again once done
+    health.attempts = kept -> antennaAttempts;
+    health.status = kept -> antennaStatus;
+    if (kept -> antennaState == ANT_DEPLOYED || kept -> antennaState == ANT_FAILED) {
+      health.state = kept -> antennaState;
+    } else if (health.attempts >= ANTENNA_MAX_ATTEMPTS) {
+      health.state = ANT_DISARMING;
+    }
+  }
+}
+
+unsigned char antennaStep(void) {
+
+  switch (health.state) {
+    case ANT_ARMING:
+      if (!antennaTransfer(ANTENNA_CMD_ARM, 0, 1, 0)) {
+        return 0;
+      }
+      if (antennaMessage.error != I2CERR_NO_ERROR) {
+        return antennaFault();
+      }
+      health.faults = 0;
+      health.state = ANT_DEPLOYING;
+      return 0;
+
+    case ANT_DEPLOYING:
+      if (!antennaTransfer(ANTENNA_CMD_DEPLOY_AUTO, ANTENNA_BURN_SECONDS, 2, 0)) {
+        return 0;
+      }
+      if (antennaMessage.error != I2CERR_NO_ERROR) {
+        return antennaFault();
+      }
+      health.faults = 0;
+      health.attempts++;
+      health.elapsedTicks = 0;
+      health.state = ANT_POLLING;
+      pollInterval = ANTENNA_POLL_MIN_TICKS;
+      return antennaWait(pollInterval);
+
+    case ANT_POLLING:
+      if (!antennaTransfer(ANTENNA_CMD_GET_STATUS, 0, 1, 2)) {
+        return 0;
+      }
+      if (antennaMessage.error != I2CERR_NO_ERROR) {
+        return antennaFault();
+      }
+      health.faults = 0;
+      health.status = (unsigned char)antennaResponse[0] | ((unsigned int)(unsigned char)antennaResponse[1] << 8);
+
+      if (!(health.status & ANTENNA_STATUS_NOT_DEPLOYED_MASK)) { //All four out
+        health.state = ANT_DISARMING;
+        return 0;
+      }
+      if (health.elapsedTicks >= ANTENNA_DEPLOY_TIMEOUT) {
+        //Start over, controller skips antennas that are already out
+        health.state = (health.attempts >= ANTENNA_MAX_ATTEMPTS) ? ANT_DISARMING : ANT_ARMING;
+        return 0;
+      }
+
+      //Burn takes seconds, so back off instead of hammering the bus
+      if (pollInterval < ANTENNA_POLL_MAX_TICKS / 2) {
+        pollInterval <<= 1;
+      } else {
+        pollInterval = ANTENNA_POLL_MAX_TICKS;
+      }
+      return antennaWait(pollInterval);
+
+    case ANT_DISARMING:
+      if (!antennaTransfer(ANTENNA_CMD_DISARM, 0, 1, 0)) {
+        return 0;
+      }
+      if (antennaMessage.error != I2CERR_NO_ERROR) {
+        return antennaFault();
+      }
+      health.faults = 0;
+      health.state = (health.status & ANTENNA_STATUS_NOT_DEPLOYED_MASK) ? ANT_FAILED : ANT_DEPLOYED;
+      return ANTENNA_IDLE_TICKS;
+
+    default: //ANT_DEPLOYED, ANT_FAILED
+      return ANTENNA_IDLE_TICKS;
+  }
+}
+
+const AntennaHealth* antennaGetHealth(void) {
+  return &health;
+}
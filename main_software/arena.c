@@ -0,0 +1,87 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in arena.h
+*/
+
+#include <__cross_studio_io.h>
+#include "arena.h"
+
+//Fails to compile (negative array size) when the budgets no longer fit in RAM.  Only with the MSP430's sizes: host
+//builds have wider types, and ground_software/ramcheck.c checks the budgets and the statics from them instead
+typedef char arenaBudgetCheck[(sizeof(int) != 2 || ARENA_BYTES + RAM_STACK_BUDGET + RAM_STATIC_RESERVE <= RAM_BYTES) ?
+                              1 : -1];
+
+static unsigned int pool[(ARENA_BYTES - ARENA_KEPT_BYTES + 1) / 2];
+#pragma dataseg("NO_INIT") //See watchdog.c
+static unsigned int keptPool[(ARENA_KEPT_BYTES + 1) / 2];
+#pragma dataseg(default)
+static unsigned int used[ARENA_OWNERS];
+static unsigned char failures;
+static unsigned char* stackLimit; //Lowest painted byte
+static unsigned char* stackTop; //Caller's frame when painted
+
+static const unsigned int budget[ARENA_OWNERS] = {ARENA_SAMPLES_BYTES, ARENA_RECORDER_BYTES, ARENA_I2C_BYTES, \
+                                                  ARENA_TELEMETRY_BYTES, ARENA_SNAPSHOT_BYTES};
+static const char* const ownerName[ARENA_OWNERS] = {"samples", "recorder", "i2c", "telemetry", "snapshots"};
+
+void* arenaAlloc(ArenaOwner owner, unsigned int size) {
+  unsigned int base = 0;
+  int n;
+
+  size = ARENA_ROUND(size);
+  if (owner >= ARENA_OWNERS || used[owner] + size > budget[owner]) {
+    failures++;
+    return 0;
+  }
+
+  for (n = (owner < ARENA_KEPT_OWNERS) ? 0 : ARENA_KEPT_OWNERS; n < owner; n++) { //Owners are laid out in order
+    base += budget[n];
+  }
+  base += used[owner];
+  used[owner] += size;
+  return (unsigned char*)((owner < ARENA_KEPT_OWNERS) ? keptPool : pool) + base;
+}
+
+unsigned int arenaGetUsed(ArenaOwner owner) {
+  return (owner < ARENA_OWNERS) ? used[owner] : 0;
+}
+
+void arenaPaintStack(void) {
+  unsigned char here;
+  unsigned char* p;
+
+  stackTop = &here;
+  stackLimit = &here - RAM_STACK_BUDGET;
+  for (p = stackLimit; p < &here - ARENA_STACK_GUARD; p++) {
+    *p = ARENA_STACK_PATTERN;
+  }
+}
+
+unsigned int arenaGetStackHighWater(void) {
+  unsigned char* p = stackLimit;
+
+  if (!p) { //Never painted
+    return 0;
+  }
+  while (p < stackTop && *p == ARENA_STACK_PATTERN) {
+    p++;
+  }
+  return stackTop - p;
+}
+
+void arenaReport(void) {
+  unsigned int total = 0;
+  int n;
+
+  debug_printf("%-10s %6s %6s\n", "ram", "budget", "used");
+  for (n = 0; n < ARENA_OWNERS; n++) {
+    debug_printf("%-10s %6u %6u\n", ownerName[n], budget[n], used[n]);
+    total += used[n];
+  }
+  debug_printf("%-10s %6u %6u\n", "arena", (unsigned int)ARENA_BYTES, total);
+  debug_printf("%-10s %6u %6u\n", "stack", RAM_STACK_BUDGET, arenaGetStackHighWater());
+  debug_printf("%-10s %6u\n", "other", RAM_STATIC_RESERVE);
+  debug_printf("%-10s %6u %6u\n", "total", RAM_BYTES, (unsigned int)(ARENA_BYTES + RAM_STACK_BUDGET + RAM_STATIC_RESERVE));
+  if (failures) {
+    debug_printf("%u allocation(s) over budget\n", failures);
+  }
+}
@@ -0,0 +1,601 @@
+/* Author: John Walnut
+   Purpose: Cycle-count benchmarks, see benchmark.h.  Only built into BENCHMARK builds.
+*/
+
+#ifdef BENCHMARK
+
+#include <__cross_studio_io.h>
+#include "os.h"
+#include "benchmark.h"
+#include "cycles.h"
+#include "clock.h"
+#include "data.h"
+#include "i2c_driver.h"
+#include "i2c_peripherals.h"
+#include "log_format.h"
+#include "recorder.h"
+#include "arena.h"
+#include "periodic.h"
+#include "sampler.h"
+#include "drdy.h"
+#include "calib.h"
+#include "decim.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "command.h"
+#include "radio.h"
+#include "fec.h"
+#include "tasks.h"
+#ifdef I2C_REPLAY
+#include "replay.h"
+#endif
+
+static unsigned char crcBlock[LOG_BLOCK_SIZE];
+static unsigned long benchFecCycles; //Average of benchFec(), for benchFecRate()
+static Periodic benchPeriodic;
+static unsigned int benchLoadSeed;
+
+unsigned int benchI2CBusCycles(int txBytes, int rxBytes, int baudDivider) {
+  unsigned int periods = 2; //Start and stop
+
+  if (txBytes > 0) {
+    periods += 9 * (txBytes + 1); //8 bits and ACK, address byte included
+  }
+  if (rxBytes > 0) {
+    periods += 1 + 9 * (rxBytes + 1); //Repeated start
+  }
+  return periods * baudDivider;
+}
+
+/* Name: benchBegin
+   Description:
+    Clears a result before its first call.
+*/
+static void benchBegin(BenchResult* result, const char* name, unsigned int modelCycles, unsigned int baseline) {
+  result -> name = name;
+  result -> minCycles = 0xFFFF;
+  result -> maxCycles = 0;
+  result -> totalCycles = 0;
+  result -> count = 0;
+  result -> modelCycles = modelCycles;
+  result -> baseline = baseline;
+}
+
+static void benchRecord(BenchResult* result, unsigned int cycles) {
+  if (cycles < result->minCycles) {
+    result -> minCycles = cycles;
+  }
+  if (cycles > result->maxCycles) {
+    result -> maxCycles = cycles;
+  }
+  result -> totalCycles += cycles;
+  result -> count++;
+}
+
+/* Name: benchReport
+   Return value:
+    char - 1 if the result is a regression against its baseline, or has no baseline
+*/
+static char benchReport(const BenchResult* result) {
+  unsigned long average = result->totalCycles / result->count + result->modelCycles;
+  char regressed = !result->baseline ||
+                   average * 100 > (unsigned long)result->baseline * (100 + BENCH_TOLERANCE_PERCENT);
+
+  debug_printf("%-18s %6u %6u %6lu %6u %7lu %8u  %s\n", result->name, result->minCycles, result->maxCycles,
+               result->totalCycles / result->count, result->modelCycles, average, result->baseline,
+               result->baseline ? (regressed ? "REGRESSED" : "ok") : "NO BASELINE");
+  return regressed;
+}
+
+static char benchI2CInit(void) {
+  BenchResult result;
+  I2CConfig cfg;
+  unsigned int start;
+  int n;
+
+  benchBegin(&result, "i2cInit", 0, BENCH_BASELINE_I2C_INIT);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    i2cInitializeConfigRate(&cfg, SECONDARY, I2C_FAST_HZ);
+    i2cInit(&cfg);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+static char benchI2CSend(void) {
+  BenchResult result;
+  I2CMessage msg;
+  char message_str[IMU_DATA_MSG_LEN];
+  char response_str[IMU_DATA_RESP_LEN];
+  unsigned int model = 0;
+  unsigned int start;
+  int n;
+
+#ifdef I2C_REPLAY
+  model = benchI2CBusCycles(IMU_DATA_MSG_LEN, IMU_DATA_RESP_LEN, i2cBaudDivider(IMU_I2C_MAX_HZ)); //CPU busy-waits for the whole bus time
+#endif
+
+  benchBegin(&result, "i2cSendMessage", model, BENCH_BASELINE_I2C_SEND);
+  message_str[0] = GYROSCOPE_START;
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    i2cInitializeMessage(&msg, message_str, IMU_DATA_MSG_LEN, IMU_I2C_ADDR, RX_MODE, IMU_DATA_RESP_LEN, response_str, SECONDARY);
+    i2cSetMessageRate(&msg, IMU_I2C_MAX_HZ);
+    i2cSendMessage(&msg);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+static char benchStoreSample(void) {
+  BenchResult result;
+  int gyro[DATA_AXES] = {1, 2, 3};
+  int accel[DATA_AXES] = {4, 5, 6};
+  int magnet[DATA_AXES] = {7, 8, 9};
+  unsigned int start;
+  int n;
+
+  benchBegin(&result, "dataStoreSample", 0, BENCH_BASELINE_STORE_SAMPLE);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    dataStoreSample(gyro, accel, magnet);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchCalib
+   Description:
+    Cycles per corrected sample of each sensor, with a table that has a bias and a full matrix for every sensor, so
+    nothing is skipped.
+*/
+static char benchCalib(CalibSensor sensor, const char* name, unsigned int baseline) {
+  static const int matrix[9] = {16800, -210, 95, -180, 15900, 330, 60, 270, 16420}; //About the identity at shift 1
+  unsigned char image[CALIB_IMAGE_BYTES];
+  char raw[IMU_DATA_RESP_LEN] = {0x12, 0x34, 0xF0, 0x0D, 0x05, 0x5A};
+  int out[DATA_AXES];
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  logPut16(image + CALIB_IMG_MAGIC, CALIB_MAGIC);
+  for (n = 0; n < 3; n++) {
+    logPut16(image + CALIB_IMG_GYRO_BIAS + 2 * n, 17 * n - 20);
+    logPut16(image + CALIB_IMG_ACCEL_BIAS + 2 * n, 120 - 50 * n);
+    logPut16(image + CALIB_IMG_MAGNET_BIAS + 2 * n, 35 * n + 8);
+  }
+  for (n = 0; n < 9; n++) {
+    logPut16(image + CALIB_IMG_ACCEL_MATRIX + 2 * n, matrix[n]);
+    logPut16(image + CALIB_IMG_MAGNET_MATRIX + 2 * n, matrix[8 - n]);
+  }
+  image[CALIB_IMG_ACCEL_SHIFT] = 1;
+  image[CALIB_IMG_MAGNET_SHIFT] = 1;
+  logPut16(image + CALIB_IMG_CRC, logCrc16(image, CALIB_IMG_CRC));
+  calibLoad(image);
+
+  benchBegin(&result, name, 0, baseline);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    calibApply(sensor, raw, out);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchDecim
+   Description:
+    Cycles per input sample of one three axis decimator, averaged over whole outputs (DECIM_RATIO - 1 inputs that only
+    accumulate, one that also completes an output).
+*/
+static char benchDecim(void) {
+  static Decimator decimator;
+  int in[DECIM_AXES] = {1200, -3400, 560};
+  int out[DECIM_AXES];
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  decimInit(&decimator);
+  benchBegin(&result, "decimPush", 0, BENCH_BASELINE_DECIM);
+  for (n = 0; n < BENCH_ITERATIONS * DECIM_RATIO; n++) {
+    in[n % DECIM_AXES] += 97;
+    start = CYCLES_NOW;
+    decimPush(&decimator, in, out);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchSnapshot
+   Description:
+    Cycles per sample through the trigger rules and into the armed snapshot.  Every eighth sample is a shock, so the
+    average covers quiet samples, triggers and freezes; frozen snapshots are released at once.
+*/
+static char benchSnapshot(void) {
+  int gyro[SNAPSHOT_AXES] = {150, -80, 30};
+  int accel[SNAPSHOT_AXES] = {200, -120, 16384};
+  BenchResult result;
+  Snapshot* snapshot;
+  unsigned int start;
+  int n;
+
+  benchBegin(&result, "snapshotSample", 0, BENCH_BASELINE_SNAPSHOT);
+  for (n = 0; n < BENCH_ITERATIONS * 8; n++) {
+    accel[1] = (n & 7) ? -120 : SNAPSHOT_SHOCK_LEVEL;
+    start = CYCLES_NOW;
+    snapshotSample(gyro, accel, n);
+    benchRecord(&result, cyclesSince(start));
+    while ((snapshot = snapshotNext())) {
+      snapshotRelease(snapshot);
+    }
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchTelemetry
+   Description:
+    Cycles to queue one full packet and take one back out as a frame (CRC included).  Every class has a packet waiting
+    beforehand, so each dequeue goes through the strict check and the round robin.
+*/
+static char benchTelemetry(void) {
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+  unsigned char frame[TELEMETRY_FRAME_MAX];
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  for (n = 0; n < TELEMETRY_PAYLOAD_MAX; n++) {
+    payload[n] = n;
+  }
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    telemetryPut(n, payload, TELEMETRY_PAYLOAD_MAX, 0);
+  }
+  benchBegin(&result, "telemetry put+get", 0, BENCH_BASELINE_TELEMETRY);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    telemetryPut(n % TELEMETRY_CLASSES, payload, TELEMETRY_PAYLOAD_MAX, n);
+    telemetryBeginPass();
+    telemetryDequeue(frame, TELEMETRY_FRAME_MAX, n);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchCommand
+   Description:
+    Cycles for commandParse() to check, dispatch and answer a SET_MODE frame that wraps round the end of the receive
+    ring, so the CRC is taken in two pieces.  The reply queue is emptied between calls, outside the measurement.
+*/
+static char benchCommand(void) {
+  unsigned char ring[RADIO_RX_LEN];
+  unsigned char frame[COMMAND_OVERHEAD + 3];
+  unsigned char reply[TELEMETRY_FRAME_MAX];
+  unsigned char head = RADIO_RX_LEN - 4;
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  frame[0] = COMMAND_SYNC_0;
+  frame[1] = COMMAND_SYNC_1;
+  frame[2] = 3;
+  frame[3] = COMMAND_SET_MODE;
+  frame[4] = 0;
+  frame[5] = COMMAND_MODE_DOWNLINK;
+  logPut16(frame + 6, 1);
+  logPut16(frame + 8, logCrc16(frame, 8));
+  for (n = 0; n < sizeof(frame); n++) {
+    ring[(head + n) & (RADIO_RX_LEN - 1)] = frame[n];
+  }
+  commandReset();
+  benchBegin(&result, "command parse", 0, BENCH_BASELINE_COMMAND);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    commandParse(ring, RADIO_RX_LEN - 1, head, sizeof(frame), n);
+    benchRecord(&result, cyclesSince(start));
+    telemetryBeginPass();
+    while (telemetryDequeue(reply, TELEMETRY_FRAME_MAX, n)) {
+    }
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchFec
+   Description:
+    Cycles for fecEncode() to code a full telemetry frame: moving it up for the coded length, then the parity over
+    TELEMETRY_FRAME_MAX - 2 bytes.  The frame is rebuilt between calls, outside the measurement.
+*/
+static char benchFec(void) {
+  unsigned char frame[FEC_FRAME_MAX];
+  BenchResult result;
+  unsigned int start;
+  int n;
+  int i;
+
+  benchBegin(&result, "fecEncode (frame)", 0, BENCH_BASELINE_FEC);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    frame[0] = TELEMETRY_SYNC_0;
+    frame[1] = TELEMETRY_SYNC_1;
+    frame[2] = TELEMETRY_PAYLOAD_MAX;
+    for (i = 3; i < TELEMETRY_FRAME_MAX; i++) {
+      frame[i] = i * 29 + n;
+    }
+    start = CYCLES_NOW;
+    fecEncode(frame, TELEMETRY_FRAME_MAX);
+    benchRecord(&result, cyclesSince(start));
+  }
+  benchFecCycles = result.totalCycles / result.count;
+  return benchReport(&result);
+}
+
+static char benchTimerIsr(void) {
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  benchBegin(&result, "Timer A ISR", BENCH_ISR_ENTRY_CYCLES + BENCH_ISR_EXIT_CYCLES, BENCH_BASELINE_TIMER_ISR);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    clockTimerService();
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+static char benchRecorderSample(void) {
+  BenchResult result;
+  char gyro[LOG_AXIS_BYTES] = {1, 2, 3, 4, 5, 6};
+  char magnet[LOG_AXIS_BYTES] = {7, 8, 9, 10, 11, 12};
+  unsigned int start;
+  int n;
+
+  recorderInit();
+  benchBegin(&result, "recorderAddSample", 0, BENCH_BASELINE_RECORDER_SAMPLE);
+  for (n = 0; n < BENCH_ITERATIONS; n++) { //Fewer than LOG_SAMPLES_PER_BLOCK * RECORDER_BLOCK_BUFFERS, nothing is dropped
+    start = CYCLES_NOW;
+    recorderAddSample(n, gyro, magnet);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+static char benchLogCrc(void) {
+  BenchResult result;
+  unsigned int start;
+  int n;
+
+  for (n = 0; n < LOG_BLOCK_SIZE; n++) {
+    crcBlock[n] = n;
+  }
+  benchBegin(&result, "logCrc16 (block)", 0, BENCH_BASELINE_LOG_CRC);
+  for (n = 0; n < BENCH_ITERATIONS; n++) {
+    start = CYCLES_NOW;
+    logCrc16(crcBlock, LOG_CRC_OFFSET);
+    benchRecord(&result, cyclesSince(start));
+  }
+  return benchReport(&result);
+}
+
+/* Name: benchI2CThroughput
+   Description:
+    Prints the payload rate (bytes/s) the bus model gives for one device's usual transaction, at standard mode and at the
+    device's own limit.  ground_software/i2ccheck.c measures the same transactions through the driver on the host's USCI
+    model.
+*/
+static void benchI2CThroughput(const char* name, int txBytes, int rxBytes, unsigned long deviceHz) {
+  unsigned long standard = benchI2CBusCycles(txBytes, rxBytes, i2cBaudDivider(I2C_STANDARD_HZ));
+  unsigned long limit = benchI2CBusCycles(txBytes, rxBytes, i2cBaudDivider(deviceHz));
+
+  debug_printf("%-18s %7lu %7lu\n", name, clockGetSmclkHz() / standard * rxBytes, clockGetSmclkHz() / limit * rxBytes);
+}
+
+/* Name: benchFecRate
+   Description:
+    Prints what coding costs per byte of telemetry frame, and the share of the CPU at 1 MHz it takes to code frames as
+    fast as the radio sends them.
+*/
+static void benchFecRate(void) {
+  unsigned long perByte = benchFecCycles / (TELEMETRY_FRAME_MAX - 2);
+  unsigned long frames = RADIO_BYTES_PER_SECOND / FEC_FRAME_MAX; //Full frames per second, coded
+
+  debug_printf("\n%-18s %6s %6s\n", "fecEncode (frame)", "cyc/B", "cpu %");
+  debug_printf("%-18s %6lu %6lu\n", "1 MHz, link full", perByte, frames * benchFecCycles / 10000UL);
+}
+
+/* Name: benchProfiles
+   Description:
+    Runs the block CRC on every clock profile.  The cycle count should not move (the F2xx flash has no wait states), so
+    the time per block is what a faster profile buys.
+*/
+static void benchProfiles(void) {
+  ClockProfile p;
+  unsigned int start;
+  unsigned int cycles;
+
+  debug_printf("\n%-18s %6s %6s\n", "logCrc16 profile", "cycles", "us");
+  for (p = CLOCK_1MHZ; p <= CLOCK_16MHZ; p++) {
+    clockSetProfile(p); //Timer B counts SMCLK, so it keeps counting CPU cycles
+    start = CYCLES_NOW;
+    logCrc16(crcBlock, LOG_CRC_OFFSET);
+    cycles = cyclesSince(start);
+    debug_printf("%5lu MHz %16u %6lu\n", clockGetMclkHz() / 1000000UL, cycles, cycles / (clockGetMclkHz() / 1000000UL));
+  }
+  clockSetProfile(CLOCK_1MHZ);
+}
+
+#ifdef I2C_REPLAY
+/* Name: benchSampler
+   Description:
+    Runs the sampler for BENCH_SAMPLER_RELEASES releases against the simulated devices, stepping the OS tick by hand, and
+    prints each sensor's transfers and the share of bus time they take.  The last line is what reading every sensor on
+    every release (no data-ready check, no per-sensor rate) would cost.
+*/
+static void benchSampler(void) {
+  static const char* const names[SENSOR_COUNT] = {"gyro", "accel", "magnet"};
+  static const unsigned long limits[SENSOR_COUNT] = {IMU_I2C_MAX_HZ, IMU_I2C_MAX_HZ, MAGNET_I2C_MAX_HZ};
+  unsigned long elapsed = (unsigned long)BENCH_SAMPLER_RELEASES * TASK_IMU_PERIOD_TICKS * (clockGetSmclkHz() / OS_TICK_HZ);
+  unsigned long total = 0;
+  unsigned long lockstep = 0;
+  unsigned int n;
+  char t;
+  SamplerSensor sensor;
+
+  samplerInit();
+  for (n = 0; n < BENCH_SAMPLER_RELEASES; n++) {
+    for (t = 0; t < TASK_IMU_PERIOD_TICKS; t++) {
+      clockTimerService(); //Interrupts are off, time only moves here
+    }
+    samplerStep();
+  }
+
+  debug_printf("\n%-18s %6s %6s %6s %6s %6s\n", "sampler (model)", "polls", "status", "data", "stale", "bus %");
+  for (sensor = SENSOR_GYRO; sensor < SENSOR_COUNT; sensor++) {
+    const SamplerStats* stat = samplerGetStats(sensor);
+    unsigned int divider = i2cBaudDivider(limits[sensor]);
+    unsigned long cycles = stat->statusReads * benchI2CBusCycles(1, 1, divider);
+
+    if (stat->dataReads) {
+      cycles += stat->dataReads * benchI2CBusCycles(1, stat->dataBytes / stat->dataReads, divider);
+    }
+    lockstep += (unsigned long)BENCH_SAMPLER_RELEASES * benchI2CBusCycles(1, SAMPLER_DATA_BYTES, divider);
+    total += cycles;
+    debug_printf("%-18s %6lu %6lu %6lu %6u %6lu\n", names[sensor], stat->polls, stat->statusReads, stat->dataReads,
+                 stat->stale, cycles * 100 / elapsed);
+  }
+  debug_printf("%-18s %34lu\n%-18s %34lu\n", "total", total * 100 / elapsed, "every release", lockstep * 100 / elapsed);
+}
+
+/* Name: benchDrdy
+   Description:
+    Lets the simulated INT line drive the data-ready reads (needs benchSampler() first, which sets the IMU rate and
+    starts drdy.h) for BENCH_DRDY_SAMPLES samples and prints the edge to ring latency histogram.
+*/
+static void benchDrdy(void) {
+  unsigned long timeout = clockGetTicks() + BENCH_DRDY_SAMPLES * 2UL; //At SAMPLER_IMU_HZ >= OS_TICK_HZ / 2
+
+  __enable_interrupt(); //Timer A ticks and CCR1 edges
+  while (drdyGetStats()->samples < BENCH_DRDY_SAMPLES && clockGetTicks() < timeout) {
+    while (drdyNext()) {
+      drdyRelease();
+    }
+  }
+  __disable_interrupt();
+
+  debug_printf("\n");
+  drdyReport();
+}
+#endif
+
+/* Name: benchPeriodicTask, benchLoadTask
+   Description:
+    Tasks for benchPeriodicLoad(): a periodic job of BENCH_PERIODIC_JOB_LOOPS at the higher priority, and a load that
+    holds the CPU for a pseudo-random stretch (up to BENCH_LOAD_MAX_LOOPS) before every yield.
+*/
+static void benchPeriodicTask(void) {
+  static unsigned char delay;
+  volatile unsigned int n;
+
+  OS_TASK_BEGIN();
+  periodicInit(&benchPeriodic, BENCH_PERIODIC_TICKS, BENCH_PERIODIC_TICKS, 0);
+  while (1) {
+    delay = periodicDelay(&benchPeriodic);
+    if (delay) {
+      OS_Delay(delay);
+    } else {
+      OS_Yield();
+    }
+    periodicStart(&benchPeriodic);
+    for (n = 0; n < BENCH_PERIODIC_JOB_LOOPS; n++);
+    periodicDone(&benchPeriodic);
+  }
+  OS_TASK_END();
+}
+
+static void benchLoadTask(void) {
+  volatile unsigned int n;
+  unsigned int loops;
+
+  OS_TASK_BEGIN();
+  while (1) {
+    benchLoadSeed = benchLoadSeed * 25173U + 13849U; //Same sequence every run
+    loops = benchLoadSeed % BENCH_LOAD_MAX_LOOPS;
+    for (n = 0; n < loops; n++);
+    OS_Yield();
+  }
+  OS_TASK_END();
+}
+
+/* Name: benchPeriodicLoad
+   Description:
+    Runs a periodic task against a lower priority load for BENCH_PERIODIC_JOBS jobs and prints its release jitter,
+    sample period and overruns.  Cooperative scheduling cannot preempt the load, so the jitter is bounded by the longest
+    stretch the load holds the CPU.
+*/
+static void benchPeriodicLoad(void) {
+  OSInit();
+  OSCreateTask(benchPeriodicTask, OSTCBP(1), 1);
+  OSCreateTask(benchLoadTask, OSTCBP(2), 2);
+  benchLoadSeed = 1;
+
+  __enable_interrupt(); //OS ticks from Timer A
+  while (benchPeriodic.jobs < BENCH_PERIODIC_JOBS) {
+    OSSched();
+  }
+  __disable_interrupt();
+
+  debug_printf("\nPeriodic task under load (1 job / %d ticks, load up to %u loops)\n", BENCH_PERIODIC_TICKS,
+               BENCH_LOAD_MAX_LOOPS);
+  periodicReport("periodic", &benchPeriodic);
+}
+
+int main(void) {
+  int regressions = 0;
+
+  WDTCTL = WDTPW + WDTHOLD;
+  arenaPaintStack();
+  InitializeClock(1); //1 MHz, SMCLK = MCLK, starts the OS tick
+  OSInit(); //Timer ISR calls OSTimer()
+  dataInit();
+
+#ifdef I2C_REPLAY
+  replayInit(replayTrace, replayTraceBlocks);
+#endif
+  cyclesInit(); //Interrupts stay off, nothing gets in the way of a measurement
+
+  debug_printf("%-18s %6s %6s %6s %6s %7s %8s\n", "benchmark", "min", "max", "avg", "model", "total", "baseline");
+  regressions += benchI2CInit();
+  regressions += benchI2CSend();
+  regressions += benchStoreSample();
+  regressions += benchCalib(CALIB_GYRO, "calib gyro", BENCH_BASELINE_CALIB_GYRO);
+  regressions += benchCalib(CALIB_ACCEL, "calib accel", BENCH_BASELINE_CALIB_ACCEL);
+  regressions += benchCalib(CALIB_MAGNET, "calib magnet", BENCH_BASELINE_CALIB_MAGNET);
+  regressions += benchDecim();
+  regressions += benchSnapshot();
+  regressions += benchTelemetry();
+  regressions += benchCommand();
+  regressions += benchFec();
+  regressions += benchTimerIsr();
+  regressions += benchRecorderSample();
+  regressions += benchLogCrc();
+
+  debug_printf("\n%-18s %7s %7s\n", "bytes/s (model)", "100kHz", "device");
+  benchI2CThroughput("gyro read", IMU_DATA_MSG_LEN, IMU_DATA_RESP_LEN, IMU_I2C_MAX_HZ);
+  benchI2CThroughput("magnet read", IMU_DATA_MSG_LEN, IMU_DATA_RESP_LEN, MAGNET_I2C_MAX_HZ);
+  benchI2CThroughput("antenna status", 1, 2, ANTENNA_I2C_MAX_HZ);
+  benchFecRate();
+  benchProfiles();
+#ifdef I2C_REPLAY
+  benchSampler();
+  benchDrdy();
+#endif
+  benchPeriodicLoad();
+  debug_printf("\n");
+  arenaReport();
+
+  debug_printf("%d regression(s)\n", regressions);
+
+  debug_exit(regressions);
+  return regressions;
+}
+
+#endif
@@ -0,0 +1,70 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in boot.h
+*/
+
+#include <__cross_studio_io.h>
+#include "boot.h"
+
+#define BOOT_TICKS(ms) (((unsigned long)(ms) * OS_TICK_HZ + 999) / 1000) //Rounded up
+
+static char powered; //Devices powered up with this boot
+static unsigned long startTicks;
+static unsigned long startMicroseconds;
+static unsigned long timeline[BOOT_EVENTS];
+
+static const unsigned char settleTicks[BOOT_DEVICES] = {BOOT_TICKS(BOOT_IMU_SETTLE_MS), BOOT_TICKS(BOOT_SD_SETTLE_MS),
+                                                        BOOT_TICKS(BOOT_ANTENNA_SETTLE_MS),
+                                                        BOOT_TICKS(BOOT_RADIO_SETTLE_MS)};
+static const char deferred[BOOT_DEVICES] = {0, 1, 1, 1};
+static const char* const eventName[BOOT_EVENTS] = {"scheduler", "imu configured", "first sample", "card ready",
+                                                   "log running", "antenna", "radio"};
+
+void bootStart(char powerOn) {
+  unsigned char n;
+
+  powered = powerOn;
+  startTicks = clockGetTicks();
+  startMicroseconds = clockGetMicroseconds();
+  for (n = 0; n < BOOT_EVENTS; n++) {
+    timeline[n] = BOOT_NOT_YET;
+  }
+  timeline[BOOT_SCHEDULER] = 0;
+}
+
+unsigned char bootWait(BootDevice device) {
+  unsigned long elapsed = clockGetTicks() - startTicks;
+
+  if (device >= BOOT_DEVICES) {
+    return 0;
+  }
+  if (powered && elapsed < settleTicks[device]) {
+    return settleTicks[device] - elapsed;
+  }
+  if (deferred[device] && timeline[BOOT_FIRST_SAMPLE] == BOOT_NOT_YET && elapsed < BOOT_DEFER_MAX_TICKS) {
+    return 1; //Look again next tick
+  }
+  return 0;
+}
+
+void bootMark(BootEvent event) {
+  if (event < BOOT_EVENTS && timeline[event] == BOOT_NOT_YET) {
+    timeline[event] = clockGetMicroseconds() - startMicroseconds;
+  }
+}
+
+unsigned long bootGetTime(BootEvent event) {
+  return (event < BOOT_EVENTS) ? timeline[event] : BOOT_NOT_YET;
+}
+
+void bootReport(void) {
+  unsigned char n;
+
+  debug_printf("boot (%s)\n", powered ? "power on" : "reset");
+  for (n = 0; n < BOOT_EVENTS; n++) {
+    if (timeline[n] == BOOT_NOT_YET) {
+      debug_printf("%-15s %8s\n", eventName[n], "-");
+    } else {
+      debug_printf("%-15s %8lu us\n", eventName[n], timeline[n]);
+    }
+  }
+}
@@ -0,0 +1,191 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in bulk.h
+*/
+
+#include "bulk.h"
+#include "log_format.h"
+
+static BulkStats stats;
+static BulkReader currentReader;
+static unsigned char currentSource;
+static unsigned long currentStart;
+static unsigned long currentLength;
+static unsigned char currentWindow;
+//Bit n of each is chunk stats.base + n
+static unsigned long acked; //The ground has it
+static unsigned long sent; //Queued and not known to be lost
+static unsigned long tried; //Queued at least once
+static unsigned char order[BULK_WINDOW]; //By chunk number modulo BULK_WINDOW, when it was last queued
+static unsigned char nextOrder;
+static unsigned long lastProgress; //Tick of the last chunk queued or newly acknowledged
+static unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+
+/* Name: bulkSlide
+   Description:
+    Moves the window on by count chunks.
+*/
+static void bulkSlide(unsigned int count) {
+  if (count >= BULK_WINDOW) {
+    acked = sent = tried = 0;
+  } else {
+    acked >>= count;
+    sent >>= count;
+    tried >>= count;
+  }
+  stats.base += count;
+}
+
+void bulkInit(void) {
+  stats.state = BULK_IDLE;
+  stats.transfer = 0;
+  stats.chunks = stats.base = 0;
+  stats.sent = stats.resent = stats.acks = stats.timeouts = 0;
+  acked = sent = tried = 0;
+  nextOrder = 0;
+}
+
+char bulkStart(unsigned char transfer, unsigned char source, BulkReader reader, unsigned long start,
+               unsigned long length, unsigned char window, unsigned long tick) {
+  unsigned long chunks = (length + BULK_CHUNK_BYTES - 1) / BULK_CHUNK_BYTES;
+
+  if (!length || chunks > BULK_CHUNKS_MAX || !window || window > BULK_WINDOW) {
+    return 0;
+  }
+  currentReader = reader;
+  currentWindow = window;
+  lastProgress = tick;
+  if (stats.state != BULK_IDLE && transfer == stats.transfer && source == currentSource && start == currentStart &&
+      length == currentLength) { //The ground lost track, most likely at the end of a pass: send again whatever is out
+    sent &= acked;
+    if (stats.state == BULK_FAILED) {
+      stats.state = BULK_SENDING;
+    }
+    return 2;
+  }
+
+  bulkInit();
+  stats.state = BULK_SENDING;
+  stats.transfer = transfer;
+  stats.chunks = (unsigned int)chunks;
+  currentSource = source;
+  currentStart = start;
+  currentLength = length;
+  return 1;
+}
+
+char bulkAck(unsigned char transfer, unsigned int base, unsigned long bitmap, unsigned long tick) {
+  unsigned long now; //Acknowledged by this one, bit n is chunk stats.base + n
+  unsigned long lost;
+  unsigned char newest = 0;
+  char seen = 0;
+  unsigned char n;
+
+  if (stats.state == BULK_IDLE || transfer != stats.transfer) {
+    return 0;
+  }
+  stats.acks++;
+
+  if (base > stats.chunks) {
+    base = stats.chunks;
+  }
+  if (base >= stats.base) { //Everything before base, then the bitmap
+    n = base - stats.base < BULK_WINDOW ? base - stats.base : BULK_WINDOW;
+    now = n < BULK_WINDOW ? ((1UL << n) - 1) | (bitmap << n) : 0xFFFFFFFFUL;
+  } else { //Older than what is known, only the bitmap can add anything
+    now = stats.base - base < BULK_WINDOW ? bitmap >> (stats.base - base) : 0;
+  }
+
+  for (n = 0; n < BULK_WINDOW; n++) { //The one queued last of those just acknowledged
+    if ((now & tried & ~acked) & (1UL << n)) {
+      unsigned char queued = order[(stats.base + n) & (BULK_WINDOW - 1)];
+
+      if (!seen || (signed char)(queued - newest) > 0) {
+        newest = queued;
+        seen = 1;
+      }
+    }
+  }
+  if (now & ~acked) { //Only news holds off the timeout, the ground repeats itself while it waits
+    lastProgress = tick;
+  }
+  acked |= now;
+  if (seen) { //Anything still out that was queued before it never made it
+    lost = 0;
+    for (n = 0; n < BULK_WINDOW; n++) {
+      if (((sent & ~acked) & (1UL << n)) && (signed char)(order[(stats.base + n) & (BULK_WINDOW - 1)] - newest) < 0) {
+        lost |= 1UL << n;
+      }
+    }
+    sent &= ~lost;
+  }
+
+  n = 0;
+  while (n < BULK_WINDOW && (acked >> n) & 1) {
+    n++;
+  }
+  bulkSlide(n);
+  if (stats.base >= stats.chunks) {
+    stats.base = stats.chunks;
+    stats.state = BULK_DONE;
+  }
+  return 1;
+}
+
+void bulkStep(unsigned long tick) {
+  unsigned long offset;
+  unsigned long bit;
+  unsigned int chunk;
+  unsigned char bytes;
+  unsigned char n;
+  char read;
+
+  if (stats.state != BULK_SENDING) {
+    return;
+  }
+  if ((sent & ~acked) && tick - lastProgress >= BULK_ACK_TICKS) {
+    sent &= acked;
+    stats.timeouts++;
+    lastProgress = tick;
+  }
+
+  for (n = 0; n < currentWindow; n++) {
+    chunk = stats.base + n;
+    bit = 1UL << n;
+    if (chunk >= stats.chunks) {
+      break;
+    }
+    if ((acked | sent) & bit) {
+      continue;
+    }
+    if (!telemetryGetFree(TELEMETRY_BULK)) {
+      break;
+    }
+    offset = (unsigned long)chunk * BULK_CHUNK_BYTES;
+    bytes = currentLength - offset < BULK_CHUNK_BYTES ? (unsigned char)(currentLength - offset) : BULK_CHUNK_BYTES;
+    read = currentReader(currentStart + offset, payload + BULK_HEADER, bytes);
+    if (read == 0) { //Busy, next step
+      break;
+    }
+    if (read < 0) {
+      stats.state = BULK_FAILED;
+      break;
+    }
+    payload[0] = stats.transfer;
+    logPut16(payload + 1, chunk);
+    telemetryPut(TELEMETRY_BULK, payload, BULK_HEADER + bytes, tick); //There is room, always queued
+
+    sent |= bit;
+    order[chunk & (BULK_WINDOW - 1)] = nextOrder++;
+    if (tried & bit) {
+      stats.resent++;
+    } else {
+      tried |= bit;
+      stats.sent++;
+    }
+    lastProgress = tick;
+  }
+}
+
+const BulkStats* bulkGetStats(void) {
+  return &stats;
+}
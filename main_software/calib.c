@@ -0,0 +1,140 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in calib.h
+*/
+
+#include "calib.h"
+#include "flash.h"
+#include "log_format.h"
+
+static CalibParams calibParams[CALIB_SENSORS];
+
+/* Name: calibIdentity
+   Description:
+    No bias, identity matrix (skipped in calibApply()).
+*/
+static void calibIdentity(CalibParams* params) {
+  unsigned char r;
+  unsigned char c;
+
+  for (r = 0; r < 3; r++) {
+    params -> bias[r] = 0;
+    for (c = 0; c < 3; c++) {
+      params -> matrix[r][c] = (r == c) ? (int)(CALIB_Q15_ONE >> 1) : 0;
+    }
+  }
+  params -> shift = 1;
+  params -> useMatrix = 0;
+}
+
+static void calibDecode(CalibParams* params, const unsigned char* image, int biasOffset, int matrixOffset, int shiftOffset) {
+  unsigned char r;
+  unsigned char c;
+
+  calibIdentity(params);
+  for (r = 0; r < 3; r++) {
+    params -> bias[r] = (short)logGet16(image + biasOffset + 2 * r);
+  }
+  if (matrixOffset < 0) {
+    return;
+  }
+  for (r = 0; r < 3; r++) {
+    for (c = 0; c < 3; c++) {
+      params -> matrix[r][c] = (short)logGet16(image + matrixOffset + 2 * (3 * r + c));
+    }
+  }
+  params -> shift = image[shiftOffset];
+  params -> useMatrix = 1;
+}
+
+/* Name: calibIsValid
+   Description:
+    Magic, CRC and shifts in range.
+*/
+static char calibIsValid(const unsigned char* image) {
+  return logGet16(image + CALIB_IMG_MAGIC) == CALIB_MAGIC &&
+         logGet16(image + CALIB_IMG_CRC) == logCrc16(image, CALIB_IMG_CRC) &&
+         image[CALIB_IMG_ACCEL_SHIFT] <= CALIB_MAX_SHIFT && image[CALIB_IMG_MAGNET_SHIFT] <= CALIB_MAX_SHIFT;
+}
+
+char calibLoad(const unsigned char* image) {
+  if (!calibIsValid(image)) {
+    return 0;
+  }
+  calibDecode(&calibParams[CALIB_GYRO], image, CALIB_IMG_GYRO_BIAS, -1, 0);
+  calibDecode(&calibParams[CALIB_ACCEL], image, CALIB_IMG_ACCEL_BIAS, CALIB_IMG_ACCEL_MATRIX, CALIB_IMG_ACCEL_SHIFT);
+  calibDecode(&calibParams[CALIB_MAGNET], image, CALIB_IMG_MAGNET_BIAS, CALIB_IMG_MAGNET_MATRIX, CALIB_IMG_MAGNET_SHIFT);
+  return 1;
+}
+
+char calibInit(void) {
+  unsigned char image[CALIB_IMAGE_BYTES];
+  unsigned char s;
+
+  for (s = 0; s < CALIB_SENSORS; s++) {
+    calibIdentity(&calibParams[s]);
+  }
+  flashRead(CALIB_ADDR, image, CALIB_IMAGE_BYTES);
+  return calibLoad(image);
+}
+
+char calibStore(const unsigned char* image) {
+  unsigned char stored[CALIB_IMAGE_BYTES];
+
+  if (!calibIsValid(image)) {
+    return 0;
+  }
+  if (!flashEraseSegment(CALIB_ADDR) || !flashWrite(CALIB_ADDR, image, CALIB_IMAGE_BYTES)) {
+    return 0;
+  }
+  flashRead(CALIB_ADDR, stored, CALIB_IMAGE_BYTES); //As the next boot will see it
+  return calibLoad(stored);
+}
+
+/* Name: calibSaturate
+   Description:
+    Clamps to the int range.
+*/
+static int calibSaturate(long value) {
+  if (value > 32767L) {
+    return 32767;
+  }
+  if (value < -32768L) {
+    return -32768;
+  }
+  return (int)value;
+}
+
+void calibApply(CalibSensor sensor, const char* raw, int* out) {
+  const CalibParams* params = &calibParams[sensor];
+  int v[3];
+  long sum;
+  long round;
+  char down;
+  unsigned char r;
+
+  for (r = 0; r < 3; r++) {
+    const unsigned char* axis = (const unsigned char*)raw + 2 * r;
+    int value = (sensor == CALIB_MAGNET) ? (short)((axis[1] << 8) | axis[0]) : (short)((axis[0] << 8) | axis[1]);
+
+    v[r] = calibSaturate((long)value - params->bias[r]);
+  }
+
+  if (!params->useMatrix) {
+    out[0] = v[0];
+    out[1] = v[1];
+    out[2] = v[2];
+    return;
+  }
+
+  down = 14 - params->shift; //Q15 products halved, then back to counts
+  round = down ? 1L << (down - 1) : 0;
+  for (r = 0; r < 3; r++) { //Each product halved first, so three of them cannot overflow a long
+    sum = ((long)params->matrix[r][0] * v[0] >> 1) + ((long)params->matrix[r][1] * v[1] >> 1) +
+          ((long)params->matrix[r][2] * v[2] >> 1);
+    out[r] = calibSaturate((sum + round) >> down);
+  }
+}
+
+const CalibParams* calibGetParams(CalibSensor sensor) {
+  return &calibParams[sensor];
+}
@@ -1,4 +1,139 @@
-#import clock.h
+#include "clock.h"
+#include "i2c_driver.h"
+#include "radio.h"
+#ifdef I2C_REPLAY
+#include "replay.h"
+#endif
+
+static volatile unsigned long ticks;
+static ClockProfile profile;
+static char smclkShift; //SMCLK = MCLK >> smclkShift
+
+static const unsigned long profileHz[] = {1000000UL, 8000000UL, 16000000UL};
+
+/* Name: clockSetDco
+   Description:
+    Loads the factory calibration for profile p into the DCO.
+*/
+static void clockSetDco(ClockProfile p) {
+  DCOCTL = 0; //Lowest setting first, so no intermediate step overshoots (from the family guide)
+  switch (p) {
+    case CLOCK_16MHZ:
+      BCSCTL1 = CALBC1_16MHZ;
+      DCOCTL = CALDCO_16MHZ;
+      break;
+    case CLOCK_8MHZ:
+      BCSCTL1 = CALBC1_8MHZ;
+      DCOCTL = CALDCO_8MHZ;
+      break;
+    default:
+      BCSCTL1 = CALBC1_1MHZ;
+      DCOCTL = CALDCO_1MHZ;
+      break;
+  }
+}
+
+void InitializeClock(char divider) {
+  smclkShift = 0;
+  while (smclkShift < 3 && (1 << smclkShift) < divider) {
+    smclkShift++;
+  }
+  BCSCTL2 = smclkShift << 1; //DIVSx, MCLK and SMCLK from the DCO, MCLK undivided
+
+  profile = CLOCK_1MHZ;
+  clockSetDco(profile);
+  i2cSetSourceClock(clockGetSmclkHz());
+  radioSetSourceClock(clockGetSmclkHz());
+  ConfigureTimerA();
+}
+
+char clockSetProfile(ClockProfile p) {
+  unsigned int state;
+  unsigned long period;
+  unsigned long count;
+  unsigned int pending;
+
+  if (p > CLOCK_16MHZ) {
+    p = CLOCK_16MHZ;
+  }
+  if (p == profile) {
+    return 1;
+  }
+
+  //No transfer may start (from the drdy routine or an idle hook) between the test and the new dividers, and no tick
+  //comes between reading the count and loading it again
+  state = __get_interrupt_state();
+  __disable_interrupt();
+  if (i2cIsBusy(PRIMARY) || i2cIsBusy(SECONDARY)) { //Divider cannot change under a transfer or its stop
+    __set_interrupt_state(state);
+    return 0;
+  }
+  period = TA0CCR0 + 1UL;
+  count = TA0R;
+  pending = TA0CCTL0 & CCIFG;
+
+  profile = p;
+  clockSetDco(profile);
+  i2cSetSourceClock(clockGetSmclkHz());
+  radioSetSourceClock(clockGetSmclkHz());
+  ConfigureTimerA();
+
+  TA0CTL &= ~MC_1; //Stopped to write the count (the family guide says so)
+  TA0R = (unsigned int)(count * (TA0CCR0 + 1UL) / period); //Same part of the tick gone, at the new rate
+  TA0CCTL0 |= pending; //ConfigureTimerA() cleared a tick that came in with interrupts off
+  TA0CTL |= MC_1;
+  __set_interrupt_state(state);
+  return 1;
+}
+
+ClockProfile clockGetProfile(void) {
+  return profile;
+}
+
+unsigned long clockGetMclkHz(void) {
+  return profileHz[profile];
+}
+
+unsigned long clockGetSmclkHz(void) {
+  return profileHz[profile] >> smclkShift;
+}
+
+unsigned long clockGetAclkHz(void) {
+  return CLOCK_ACLK_HZ;
+}
+
+void clockTick() {
+  ticks++;
+}
+
+unsigned long clockGetTicks(void) {
+  unsigned long now;
+
+  do { //Not atomic on a 16-bit CPU, read until the timer interrupt stays out of the way
+    now = ticks;
+  } while (now != ticks);
+  return now;
+}
+
+void clockSetTicks(unsigned long now) {
+  ticks = now;
+}
+
+unsigned long clockGetMicroseconds(void) {
+  unsigned long now;
+  unsigned int count;
+  unsigned int pending;
+
+  do { //A tick between the two reads would pair the old tick with a count from the new one
+    now = ticks;
+    count = TA0R;
+    pending = TA0CCTL0 & CCIFG; //After the count, so a set flag means the count may be from after the wrap
+  } while (now != ticks);
+  if (pending && count < TA0CCR0 / 2) { //Wrapped with interrupts off, the routine has not counted the tick yet
+    now++;
+  }
+  return now * (1000000UL / OS_TICK_HZ) + (unsigned long)count * (1000000UL / OS_TICK_HZ) / (TA0CCR0 + 1);
+}
 
 void ConfigureTimerA(void)
 {
@@ -6,21 +141,24 @@ void ConfigureTimerA(void)
 	TA0CTL = (MC_0 | TACLR); //Stop timer, Clear timer
 
 	/* Configure Timer A */
-	//Below code taken from Project 3
-	TA0CTL = (ID_3 | TASSEL_2 | TAIE); //Set to divide counter by 8, Set source to SMCLK, Enable Interrupts
-	TA0CTL &= ~TAIFG; //Reset Timer A flag
+	TA0CTL = (ID_3 | TASSEL_2); //Set to divide counter by 8, Set source to SMCLK
+	TA0CCR0 = (unsigned int)(clockGetSmclkHz() / CLOCK_TIMER_DIVIDER / OS_TICK_HZ) - 1; //One OS tick per period
+	TA0CCTL0 = CCIE; //Interrupt on CCR0
 
 	/* Start Timer */
 	TA0CTL |= MC_1; //Set to count UP (i.e., start timer a)
 }
 
+void clockTimerService(void) {
+  OSTimer();
+  clockTick();
+#ifdef I2C_REPLAY
+  replayTick(); //Simulated IMU INT line
+#endif
+}
+
 #pragma vector = TIMER0_A0_VECTOR
 // Interrupt service routine for CCIFG0
 __interrupt void Timer0_A0_routine(void) {
-  if (counter >= 50000) {
-    OSTimer();
-    counter = 0;
-  } else {
-    counter++;
-  }
+  clockTimerService();
 }
@@ -0,0 +1,146 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in command.h
+*/
+
+#include "command.h"
+#include "telemetry.h"
+#include "log_format.h"
+
+/* Name: CommandEntry_s
+   Type: struct
+   Purpose:
+    One row of the dispatch table.
+*/
+struct CommandEntry_s {
+  CommandHandler handler;
+  unsigned char minArgs;
+  unsigned char maxArgs;
+};
+typedef struct CommandEntry_s CommandEntry;
+
+#define COMMAND_ENTRY(name, handler, minArgs, maxArgs) {handler, minArgs, maxArgs},
+static const CommandEntry commandTable[COMMAND_OPCODES] = {COMMAND_LIST(COMMAND_ENTRY)};
+
+static unsigned long waitingSince; //Tick a partial frame was first seen at head
+static char waiting;
+static CommandStats stats;
+
+/* Name: commandCrc16
+   Description:
+    logCrc16() of length bytes of the ring from start, in at most two pieces.
+*/
+static unsigned int commandCrc16(const unsigned char* ring, unsigned char mask, unsigned char start,
+                                 unsigned char length) {
+  unsigned int first = mask + 1 - start; //Bytes before the end of the ring
+
+  if (length <= first) {
+    return logCrc16(ring + start, length);
+  }
+  return logCrc16Update(logCrc16(ring + start, first), ring, length - first);
+}
+
+/* Name: commandReply
+   Description:
+    Queues the reply to a frame that passed its CRC and counts it.
+*/
+static void commandReply(unsigned char opcode, unsigned char sequence, unsigned char status, unsigned long tick) {
+  unsigned char reply[COMMAND_REPLY_BYTES];
+
+  if (status == COMMAND_NO_REPLY) {
+    stats.executed++;
+    return;
+  }
+  reply[0] = opcode;
+  reply[1] = sequence;
+  reply[2] = status;
+  telemetryPut(TELEMETRY_REPLY, reply, COMMAND_REPLY_BYTES, tick);
+  if (status == COMMAND_OK) {
+    stats.executed++;
+  } else {
+    stats.rejected++;
+  }
+}
+
+void commandReset(void) {
+  waiting = 0;
+  stats.frames = stats.executed = stats.rejected = stats.crcErrors = stats.stalls = 0;
+  stats.skipped = 0;
+}
+
+unsigned char commandArg8(const CommandArgs* args, unsigned char offset) {
+  return args->ring[(args->start + offset) & args->mask];
+}
+
+unsigned int commandArg16(const CommandArgs* args, unsigned char offset) {
+  return commandArg8(args, offset) | ((unsigned int)commandArg8(args, offset + 1) << 8);
+}
+
+unsigned long commandArg32(const CommandArgs* args, unsigned char offset) {
+  return commandArg16(args, offset) | ((unsigned long)commandArg16(args, offset + 2) << 16);
+}
+
+unsigned char commandParse(const unsigned char* ring, unsigned char mask, unsigned char head, unsigned char available,
+                           unsigned long tick) {
+  const CommandEntry* entry;
+  CommandArgs args;
+  unsigned char total;
+  unsigned int crc;
+
+  if (!available) {
+    waiting = 0;
+    return 0;
+  }
+  if (ring[head] != COMMAND_SYNC_0 ||
+      (available > 1 && ring[(head + 1) & mask] != COMMAND_SYNC_1) ||
+      (available > 2 && ring[(head + 2) & mask] > COMMAND_ARGS_MAX)) {
+    waiting = 0;
+    stats.skipped++;
+    return 1;
+  }
+
+  total = available > 2 ? ring[(head + 2) & mask] + COMMAND_OVERHEAD : COMMAND_FRAME_MAX;
+  if (available < total) { //Give it time to arrive, but not forever
+    if (!waiting) {
+      waiting = 1;
+      waitingSince = tick;
+    } else if (tick - waitingSince > COMMAND_STALL_TICKS) {
+      waiting = 0;
+      stats.stalls++;
+      stats.skipped++;
+      return 1;
+    }
+    return 0;
+  }
+  waiting = 0;
+
+  crc = ring[(head + total - 2) & mask] | ((unsigned int)ring[(head + total - 1) & mask] << 8);
+  if (commandCrc16(ring, mask, head, total - 2) != crc) {
+    stats.crcErrors++;
+    stats.skipped++;
+    return 1; //Maybe a frame starts inside it
+  }
+  stats.frames++;
+
+  args.ring = ring;
+  args.mask = mask;
+  args.start = (head + COMMAND_HEADER) & mask;
+  args.length = total - COMMAND_OVERHEAD;
+  args.opcode = ring[(head + 3) & mask];
+  args.sequence = ring[(head + 4) & mask];
+  args.tick = tick;
+  if (args.opcode >= COMMAND_OPCODES) {
+    commandReply(args.opcode, args.sequence, COMMAND_BAD_OPCODE, tick);
+    return total;
+  }
+  entry = &commandTable[args.opcode];
+  if (args.length < entry->minArgs || args.length > entry->maxArgs) {
+    commandReply(args.opcode, args.sequence, COMMAND_BAD_LENGTH, tick);
+    return total;
+  }
+  commandReply(args.opcode, args.sequence, entry->handler(&args), tick);
+  return total;
+}
+
+const CommandStats* commandGetStats(void) {
+  return &stats;
+}
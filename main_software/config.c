@@ -0,0 +1,178 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in config.h
+*/
+
+#include "config.h"
+#include "flash.h"
+#include "log_format.h"
+
+#define CONFIG_BIT(key) (1 << (key))
+
+static unsigned int values[CONFIG_KEYS]; //Newest stored value of each key
+static unsigned int present; //CONFIG_BIT() of the keys stored
+static unsigned int active; //Address of the active segment, 0 for no store
+static ConfigStats stats;
+
+/* Name: configCheck
+   Description:
+    Check byte of a record or header, never CONFIG_ERASED.
+*/
+static unsigned char configCheck(const unsigned char* record) {
+  unsigned char check = (unsigned char)logCrc16(record, CONFIG_RECORD_BYTES - 1);
+
+  return check == CONFIG_ERASED ? 0 : check;
+}
+
+static void configRecord(unsigned char* record, unsigned char key, unsigned int value) {
+  record[0] = key;
+  logPut16(record + 1, value);
+  record[3] = configCheck(record);
+}
+
+static char configErased(const unsigned char* record) {
+  return record[0] == CONFIG_ERASED && record[1] == CONFIG_ERASED && record[2] == CONFIG_ERASED &&
+         record[3] == CONFIG_ERASED;
+}
+
+/* Name: configHeader
+   Return value:
+    char - 1 if the segment has a good header, with its generation in *generation
+*/
+static char configHeader(unsigned int segment, unsigned int* generation) {
+  unsigned char header[CONFIG_RECORD_BYTES];
+
+  flashRead(segment, header, CONFIG_RECORD_BYTES);
+  if (header[0] != CONFIG_HEADER_KEY || header[3] != configCheck(header)) {
+    return 0;
+  }
+  *generation = logGet16(header + 1);
+  return 1;
+}
+
+/* Name: configMove
+   Description:
+    Copies the stored keys, with key at its new value, to the spare segment, erasing it first unless it is blank, then
+    programs its header.  The active segment stays the active one until the header is in.
+*/
+static char configMove(ConfigKey key, unsigned int value) {
+  unsigned int spare = (active == CONFIG_SEGMENT_0) ? CONFIG_SEGMENT_1 : CONFIG_SEGMENT_0;
+  unsigned char record[CONFIG_RECORD_BYTES];
+  unsigned char count = 0;
+  unsigned char n;
+
+  for (n = 0; n <= CONFIG_RECORDS; n++) {
+    flashRead(spare + n * CONFIG_RECORD_BYTES, record, CONFIG_RECORD_BYTES);
+    if (!configErased(record)) {
+      break;
+    }
+  }
+  if (n <= CONFIG_RECORDS) { //Not blank: the old store, or a move cut short
+    stats.erases++;
+    if (!flashEraseSegment(spare)) {
+      stats.failures++;
+      return 0;
+    }
+  }
+
+  for (n = 0; n < CONFIG_KEYS; n++) {
+    if (n == key) {
+      configRecord(record, n, value);
+    } else if (present & CONFIG_BIT(n)) {
+      configRecord(record, n, values[n]);
+    } else {
+      continue;
+    }
+    count++;
+    stats.writes++;
+    if (!flashWrite(spare + count * CONFIG_RECORD_BYTES, record, CONFIG_RECORD_BYTES)) {
+      stats.failures++;
+      return 0;
+    }
+  }
+  configRecord(record, CONFIG_HEADER_KEY, stats.generation + 1);
+  if (!flashWrite(spare, record, CONFIG_RECORD_BYTES)) {
+    stats.failures++;
+    return 0;
+  }
+
+  active = spare;
+  stats.generation = logGet16(record + 1);
+  stats.records = count;
+  return 1;
+}
+
+char configInit(void) {
+  unsigned char record[CONFIG_RECORD_BYTES];
+  unsigned int generation0;
+  unsigned int generation1;
+  char valid0 = configHeader(CONFIG_SEGMENT_0, &generation0);
+  char valid1 = configHeader(CONFIG_SEGMENT_1, &generation1);
+  unsigned char n;
+
+  present = 0;
+  stats.generation = 0;
+  stats.records = 0;
+  stats.skipped = 0;
+  stats.writes = stats.erases = stats.failures = 0;
+  if (valid0 && (!valid1 || !((generation0 - generation1) & 0x8000))) { //Newest, through wrapping
+    active = CONFIG_SEGMENT_0;
+    stats.generation = generation0;
+  } else if (valid1) {
+    active = CONFIG_SEGMENT_1;
+    stats.generation = generation1;
+  } else {
+    active = 0;
+    return 0;
+  }
+
+  for (n = 1; n <= CONFIG_RECORDS; n++) {
+    flashRead(active + n * CONFIG_RECORD_BYTES, record, CONFIG_RECORD_BYTES);
+    if (configErased(record)) { //Records are appended in order, so the rest are free
+      break;
+    }
+    stats.records = n;
+    if (record[0] >= CONFIG_KEYS || record[3] != configCheck(record)) {
+      stats.skipped++;
+      continue;
+    }
+    values[record[0]] = logGet16(record + 1);
+    present |= CONFIG_BIT(record[0]);
+  }
+  return 1;
+}
+
+unsigned int configGet(ConfigKey key, unsigned int fallback) {
+  return (key < CONFIG_KEYS && (present & CONFIG_BIT(key))) ? values[key] : fallback;
+}
+
+char configSet(ConfigKey key, unsigned int value) {
+  unsigned char record[CONFIG_RECORD_BYTES];
+
+  if (key >= CONFIG_KEYS) {
+    return 0;
+  }
+  if ((present & CONFIG_BIT(key)) && values[key] == value) {
+    return 1;
+  }
+
+  if (!active || stats.records == CONFIG_RECORDS) {
+    if (!configMove(key, value)) {
+      return 0;
+    }
+  } else {
+    configRecord(record, key, value);
+    stats.records++; //Used even if the write fails, it is skipped from now on
+    stats.writes++;
+    if (!flashWrite(active + stats.records * CONFIG_RECORD_BYTES, record, CONFIG_RECORD_BYTES)) {
+      stats.failures++;
+      return 0;
+    }
+  }
+  values[key] = value;
+  present |= CONFIG_BIT(key);
+  return 1;
+}
+
+const ConfigStats* configGetStats(void) {
+  return &stats;
+}
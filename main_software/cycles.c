@@ -0,0 +1,22 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in cycles.h
+*/
+
+#include "cycles.h"
+
+static unsigned int overhead;
+
+void cyclesInit(void) {
+  unsigned int start;
+
+  TBCTL = TBSSEL_2 + MC_2 + TBCLR; //SMCLK, continuous mode
+  overhead = 0;
+  start = CYCLES_NOW;
+  overhead = cyclesSince(start);
+}
+
+unsigned int cyclesSince(unsigned int start) {
+  unsigned int elapsed = CYCLES_NOW - start; //Unsigned subtraction handles the wrap
+
+  return (elapsed > overhead) ? elapsed - overhead : 0;
+}
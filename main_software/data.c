@@ -3,5 +3,58 @@
 */
 
 #include "data.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "watchdog.h"
+#include "boot.h"
 
+int (*gyroscopeBuffer)[DATA_BUFFER_LEN];
+int (*accelerometerBuffer)[DATA_BUFFER_LEN];
+int (*magnetometerBuffer)[DATA_BUFFER_LEN];
+int bufferIndex;
 
+void dataInit(void) {
+  const WatchdogKept* kept = watchdogGetKept();
+  unsigned char j;
+  int i;
+
+  gyroscopeBuffer = arenaAlloc(ARENA_SAMPLES, DATA_SAMPLE_BUFFER_BYTES);
+  accelerometerBuffer = arenaAlloc(ARENA_SAMPLES, DATA_SAMPLE_BUFFER_BYTES);
+  magnetometerBuffer = arenaAlloc(ARENA_SAMPLES, DATA_SAMPLE_BUFFER_BYTES);
+  if (kept && kept -> bufferIndex >= 0 && kept -> bufferIndex < DATA_BUFFER_LEN) { //Warm restart, history kept
+    bufferIndex = kept -> bufferIndex;
+  } else if (gyroscopeBuffer && accelerometerBuffer && magnetometerBuffer) { //Kept RAM, the startup code leaves it
+    for (j = 0; j < DATA_AXES; j++) {
+      for (i = 0; i < DATA_BUFFER_LEN; i++) {
+        gyroscopeBuffer[j][i] = 0;
+        accelerometerBuffer[j][i] = 0;
+        magnetometerBuffer[j][i] = 0;
+      }
+    }
+    bufferIndex = 0;
+  }
+  snapshotInit(arenaAlloc(ARENA_SNAPSHOTS, SNAPSHOT_BYTES));
+  telemetryInit(arenaAlloc(ARENA_TELEMETRY, TELEMETRY_BYTES), telemetryPolicies);
+}
+
+void dataStoreSample(const int* gyro, const int* accel, const int* magnet) {
+  unsigned char j;
+
+  if (!gyroscopeBuffer || !accelerometerBuffer || !magnetometerBuffer) { //dataInit() not called, or over budget
+    return;
+  }
+
+  if (bufferIndex == DATA_BUFFER_LEN - 1) {
+    bufferIndex = 0;
+  } else {
+    bufferIndex++;
+  }
+
+  for (j = 0; j < DATA_AXES; j++) {
+    gyroscopeBuffer[j][bufferIndex] = gyro[j];
+    accelerometerBuffer[j][bufferIndex] = accel[j];
+    magnetometerBuffer[j][bufferIndex] = magnet[j];
+  }
+  bootMark(BOOT_FIRST_SAMPLE);
+}
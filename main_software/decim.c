@@ -0,0 +1,88 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in decim.h
+*/
+
+#include "decim.h"
+
+//Taps from "decimcheck design <ratio>" (ground_software/decimcheck.c)
+#if DECIM_RATIO == 1
+const int decimCoefficients[DECIM_TAPS] = {0, 0, 0, 0}; //Not used, samples pass straight through
+#elif DECIM_RATIO == 2
+const int decimCoefficients[DECIM_TAPS] = {-236, -411, 3875, 13156, 13156, 3875, -411, -236};
+#elif DECIM_RATIO == 5
+const int decimCoefficients[DECIM_TAPS] = {-70, -129, -220, -236, 26, 756, 1989, 3521, 4944, 5803,
+                                            5803, 4944, 3521, 1989, 756, 26, -236, -220, -129, -70};
+#elif DECIM_RATIO == 10
+const int decimCoefficients[DECIM_TAPS] = {-30, -42, -60, -84, -110, -130, -135, -110, -41, 83,
+                                            270, 522, 834, 1192, 1576, 1960, 2315, 2611, 2825, 2938,
+                                            2938, 2825, 2611, 2315, 1960, 1576, 1192, 834, 522, 270,
+                                            83, -41, -110, -135, -130, -110, -84, -60, -42, -30};
+#else
+#error "No taps for this DECIM_RATIO, generate them with decimcheck design"
+#endif
+
+void decimInit(Decimator* decimator) {
+  unsigned char i;
+  unsigned char axis;
+
+  for (i = 0; i < DECIM_PHASE_TAPS; i++) {
+    for (axis = 0; axis < DECIM_AXES; axis++) {
+      decimator -> sum[i][axis] = 0;
+    }
+  }
+  decimator -> phase = 0;
+  decimator -> head = 0;
+}
+
+/* Name: decimSaturate
+   Description:
+    Q15 sum back to counts, rounded and clamped to the int range.
+*/
+static int decimSaturate(long sum) {
+  sum = (sum + 16384) >> 15;
+  if (sum > 32767L) {
+    return 32767;
+  }
+  if (sum < -32768L) {
+    return -32768;
+  }
+  return (int)sum;
+}
+
+char decimPush(Decimator* decimator, const int* in, int* out) {
+  const int* tap;
+  long* sum;
+  unsigned char i;
+
+  if (DECIM_RATIO == 1) {
+    out[0] = in[0];
+    out[1] = in[1];
+    out[2] = in[2];
+    return 1;
+  }
+
+  //Output m is the sum over k of tap[k] x[m R + R - 1 - k], so input m R + phase meets taps R - 1 - phase, 2 R - 1 -
+  //phase, ... of outputs m, m + 1, ...
+  tap = &decimCoefficients[DECIM_RATIO - 1 - decimator->phase];
+  for (i = 0; i < DECIM_PHASE_TAPS; i++) {
+    sum = decimator->sum[(decimator->head + i) & (DECIM_PHASE_TAPS - 1)];
+    sum[0] += (long)*tap * in[0];
+    sum[1] += (long)*tap * in[1];
+    sum[2] += (long)*tap * in[2];
+    tap += DECIM_RATIO;
+  }
+
+  if (++decimator->phase < DECIM_RATIO) {
+    return 0;
+  }
+  decimator -> phase = 0;
+  sum = decimator->sum[decimator->head];
+  out[0] = decimSaturate(sum[0]);
+  out[1] = decimSaturate(sum[1]);
+  out[2] = decimSaturate(sum[2]);
+  sum[0] = 0;
+  sum[1] = 0;
+  sum[2] = 0;
+  decimator -> head = (decimator->head + 1) & (DECIM_PHASE_TAPS - 1);
+  return 1;
+}
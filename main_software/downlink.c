@@ -0,0 +1,401 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in downlink.h
+*/
+
+#include "downlink.h"
+#include "radio.h"
+#include "data.h"
+#include "snapshot.h"
+#include "antenna.h"
+#include "tasks.h"
+#include "log_format.h"
+#include "command.h"
+#include "sampler.h"
+#include "bulk.h"
+#include "recorder.h"
+#include "fec.h"
+#include "watchdog.h"
+#include "config.h"
+#include "i2c_driver.h"
+#ifdef PROFILE
+#include "profile.h"
+#endif
+
+static unsigned long nextHealth;
+static unsigned long nextImu;
+static unsigned long lastHeard; //Tick the ground was last heard
+static unsigned int heardFrames; //commandGetStats()->frames at lastHeard
+static char contact;
+static char transmit; //COMMAND_MODE_DOWNLINK
+static char coded; //COMMAND_MODE_FEC
+static Snapshot* sending; //Snapshot being queued, 0 if none
+static unsigned char sendingSample; //Next sample of it to queue
+#ifdef PROFILE
+static char profileNext; //Task whose profile goes with the next health packet
+#endif
+static unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+static unsigned char frame[FEC_FRAME_MAX];
+
+static unsigned char* downlinkPut16(unsigned char* p, unsigned int value) {
+  logPut16(p, value);
+  return p + 2;
+}
+
+static unsigned char* downlinkPut32(unsigned char* p, unsigned long value) {
+  logPut32(p, value);
+  return p + 4;
+}
+
+void downlinkInit(void) {
+  unsigned long now = clockGetTicks();
+
+  radioInit();
+  nextHealth = now;
+  nextImu = now;
+  lastHeard = now;
+  heardFrames = 0;
+  contact = 0;
+  transmit = configGet(CONFIG_DOWNLINK, 1) != 0;
+  coded = configGet(CONFIG_FEC, 0) != 0;
+  commandReset();
+  bulkInit();
+  sending = 0;
+}
+
+char downlinkInContact(void) {
+  return contact;
+}
+
+/* Name: downlinkQueueHealth
+   Description:
+    Queues a health packet, layout in downlink.h.
+*/
+static void downlinkQueueHealth(unsigned long now) {
+  const AntennaHealth* antenna = antennaGetHealth();
+  const SnapshotStats* snapshot = snapshotGetStats();
+  const RadioHealth* radio = radioGetHealth();
+  unsigned char* p = payload;
+  unsigned char n;
+
+  p = downlinkPut32(p, now);
+  *p++ = antenna -> state;
+  *p++ = antenna -> attempts;
+  *p++ = antenna -> faults;
+  p = downlinkPut16(p, imuPeriodic.overruns);
+  p = downlinkPut16(p, imuPeriodic.skipped);
+  p = downlinkPut16(p, snapshot -> triggers);
+  p = downlinkPut16(p, snapshot -> dropped);
+  p = downlinkPut16(p, radio -> rxOverruns);
+  p = downlinkPut16(p, radio -> txRefused);
+  p = downlinkPut16(p, commandGetStats() -> executed);
+  p = downlinkPut16(p, commandGetStats() -> rejected);
+  p = downlinkPut16(p, commandGetStats() -> crcErrors);
+  *p++ = bulkGetStats() -> transfer;
+  *p++ = bulkGetStats() -> state;
+  p = downlinkPut16(p, bulkGetStats() -> base);
+  p = downlinkPut16(p, watchdogGetStats() -> restarts);
+  p = downlinkPut16(p, watchdogGetStats() -> watchdogResets);
+  *p++ = watchdogGetStats() -> lastLate;
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    p = downlinkPut16(p, telemetryGetStats(n) -> dropped + telemetryGetStats(n) -> aged);
+  }
+  telemetryPut(TELEMETRY_HEALTH, payload, DOWNLINK_HEALTH_BYTES, now);
+}
+
+#ifdef PROFILE
+/* Name: downlinkQueueProfile
+   Description:
+    Queues the profile of the next task in turn as a health packet (profile.h).
+*/
+static void downlinkQueueProfile(unsigned long now) {
+  if (profilePack(profileNext, now, payload)) {
+    telemetryPut(TELEMETRY_HEALTH, payload, PROFILE_PACKED_BYTES, now);
+  }
+  profileNext = (profileNext + 1) % PROFILE_TASKS;
+}
+#endif
+
+/* Name: downlinkQueueImu
+   Description:
+    Queues the latest sample in the history.
+*/
+static void downlinkQueueImu(unsigned long now) {
+  unsigned char* p = payload;
+  int index = bufferIndex;
+  unsigned char axis;
+
+  if (!gyroscopeBuffer || !accelerometerBuffer || !magnetometerBuffer) {
+    return;
+  }
+  p = downlinkPut32(p, now);
+  for (axis = 0; axis < DATA_AXES; axis++) {
+    p = downlinkPut16(p, gyroscopeBuffer[axis][index]);
+  }
+  for (axis = 0; axis < DATA_AXES; axis++) {
+    p = downlinkPut16(p, accelerometerBuffer[axis][index]);
+  }
+  for (axis = 0; axis < DATA_AXES; axis++) {
+    p = downlinkPut16(p, magnetometerBuffer[axis][index]);
+  }
+  telemetryPut(TELEMETRY_IMU, payload, DOWNLINK_IMU_BYTES, now);
+}
+
+/* Name: downlinkQueueSnapshots
+   Description:
+    Queues snapshot packets while their queue has room, oldest snapshot first.
+*/
+static void downlinkQueueSnapshots(unsigned long now) {
+  const SnapshotSample* sample;
+  unsigned char* p;
+  unsigned char samples;
+  unsigned char axis;
+
+  while (telemetryGetFree(TELEMETRY_SNAPSHOT)) {
+    if (!sending) {
+      sending = snapshotNext();
+      sendingSample = 0;
+      if (!sending) {
+        return;
+      }
+    }
+
+    p = payload + DOWNLINK_SNAPSHOT_HEADER;
+    for (samples = 0; samples < DOWNLINK_SNAPSHOT_SAMPLES; samples++) {
+      sample = snapshotGetSample(sending, sendingSample + samples);
+      if (!sample) {
+        break;
+      }
+      for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+        p = downlinkPut16(p, sample -> gyro[axis]);
+      }
+      for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+        p = downlinkPut16(p, sample -> accel[axis]);
+      }
+    }
+    downlinkPut16(payload, sending -> sequence);
+    downlinkPut32(payload + 2, sending -> triggerTick);
+    payload[6] = sending -> cause;
+    payload[7] = sending -> pre;
+    payload[8] = sendingSample;
+    payload[9] = samples;
+    telemetryPut(TELEMETRY_SNAPSHOT, payload, (unsigned char)(p - payload), now); //There is room, always queued
+
+    sendingSample += samples;
+    if (!snapshotGetSample(sending, sendingSample)) { //All of it queued
+      snapshotRelease(sending);
+      sending = 0;
+    }
+  }
+}
+
+/* Name: downlinkReadSamples
+   Description:
+    BulkReader for COMMAND_DOWNLOAD_SAMPLES: the three sample buffers as one DOWNLINK_SAMPLE_SOURCE_BYTES range.
+*/
+static char downlinkReadSamples(unsigned long address, unsigned char* buffer, unsigned char length) {
+  const unsigned char* from;
+  unsigned char n;
+
+  if (!gyroscopeBuffer || !accelerometerBuffer || !magnetometerBuffer ||
+      address + length > DOWNLINK_SAMPLE_SOURCE_BYTES) {
+    return -1;
+  }
+  for (n = 0; n < length; n++, address++) {
+    if (address < DATA_SAMPLE_BUFFER_BYTES) {
+      from = (const unsigned char*)gyroscopeBuffer;
+    } else if (address < 2 * DATA_SAMPLE_BUFFER_BYTES) {
+      from = (const unsigned char*)accelerometerBuffer;
+    } else {
+      from = (const unsigned char*)magnetometerBuffer;
+    }
+    buffer[n] = from[address % DATA_SAMPLE_BUFFER_BYTES];
+  }
+  return 1;
+}
+
+/* Name: downlinkReadLog
+   Description:
+    BulkReader for COMMAND_DOWNLOAD_LOG, a chunk may straddle two blocks.
+*/
+static char downlinkReadLog(unsigned long address, unsigned char* buffer, unsigned char length) {
+  unsigned int start = address % LOG_BLOCK_SIZE;
+  unsigned char first = LOG_BLOCK_SIZE - start < length ? LOG_BLOCK_SIZE - start : length;
+  char read = recorderReadLog(address / LOG_BLOCK_SIZE, start, buffer, first);
+
+  if (read == 1 && first < length) {
+    read = recorderReadLog(address / LOG_BLOCK_SIZE + 1, 0, buffer + first, length - first);
+  }
+  return read;
+}
+
+unsigned char commandSetRate(const CommandArgs* args) {
+  return samplerSetReleases(commandArg8(args, 0), commandArg8(args, 1)) ? COMMAND_OK : COMMAND_BAD_ARGUMENT;
+}
+
+/* Name: downlinkApply
+   Return value:
+    unsigned char - COMMAND_* status of putting the setting in use, for SET_MODE and SET_CONFIG
+*/
+static unsigned char downlinkApply(ConfigKey key, unsigned int value) {
+  switch (key) {
+    case CONFIG_GYRO_RELEASES:
+    case CONFIG_ACCEL_RELEASES:
+    case CONFIG_MAGNET_RELEASES:
+      if (value > 0xFF || !samplerSetReleases(key - CONFIG_GYRO_RELEASES, value)) {
+        return COMMAND_BAD_ARGUMENT;
+      }
+      return COMMAND_OK;
+    case CONFIG_IMU_BUS_KHZ: //In use from the next boot
+      if (value < I2C_STANDARD_HZ / 1000 || value > I2C_FAST_HZ / 1000) {
+        return COMMAND_BAD_ARGUMENT;
+      }
+      return COMMAND_OK;
+    case CONFIG_CLOCK:
+      if (value > CLOCK_16MHZ) {
+        return COMMAND_BAD_ARGUMENT;
+      }
+      return clockSetProfile(value) ? COMMAND_OK : COMMAND_FAILED; //I2C busy, the ground tries again
+    case CONFIG_DOWNLINK:
+      if (value > 1) {
+        return COMMAND_BAD_ARGUMENT;
+      }
+      transmit = value;
+      return COMMAND_OK;
+    case CONFIG_FEC:
+      if (value > 1) {
+        return COMMAND_BAD_ARGUMENT;
+      }
+      coded = value;
+      return COMMAND_OK;
+    default:
+      return COMMAND_BAD_ARGUMENT;
+  }
+}
+
+unsigned char commandSetMode(const CommandArgs* args) {
+  unsigned char mode = commandArg8(args, 0);
+
+  if (mode > COMMAND_MODE_FEC) {
+    return COMMAND_BAD_ARGUMENT;
+  }
+  return downlinkApply(CONFIG_CLOCK + mode, commandArg16(args, 1)); //ConfigKey in COMMAND_MODE_* order
+}
+
+unsigned char commandSetConfig(const CommandArgs* args) {
+  unsigned char key = commandArg8(args, 0);
+  unsigned int value = commandArg16(args, 1);
+  unsigned char status;
+
+  if (key >= CONFIG_KEYS) {
+    return COMMAND_BAD_ARGUMENT;
+  }
+  status = downlinkApply(key, value);
+  if (status == COMMAND_OK && !configSet(key, value)) { //In use, but not kept
+    status = COMMAND_FAILED;
+  }
+  return status;
+}
+
+unsigned char commandDumpHealth(const CommandArgs* args) {
+  downlinkQueueHealth(args->tick);
+  return COMMAND_OK;
+}
+
+unsigned char commandDownload(const CommandArgs* args) {
+  unsigned char source = commandArg8(args, 0);
+  unsigned long start;
+  unsigned long length;
+
+  if (source == COMMAND_DOWNLOAD_SNAPSHOT) {
+    if (args->length != 1) {
+      return COMMAND_BAD_LENGTH;
+    }
+    snapshotTrigger(SNAPSHOT_CAUSE_COMMAND);
+    return COMMAND_OK;
+  }
+  if (source != COMMAND_DOWNLOAD_SAMPLES && source != COMMAND_DOWNLOAD_LOG) {
+    return COMMAND_BAD_ARGUMENT;
+  }
+  if (args->length != COMMAND_DOWNLOAD_BULK_ARGS) {
+    return COMMAND_BAD_LENGTH;
+  }
+  start = commandArg32(args, 3);
+  length = commandArg32(args, 7);
+  if (source == COMMAND_DOWNLOAD_SAMPLES &&
+      (start > DOWNLINK_SAMPLE_SOURCE_BYTES || length > DOWNLINK_SAMPLE_SOURCE_BYTES - start)) {
+    return COMMAND_BAD_ARGUMENT;
+  }
+  if (!bulkStart(commandArg8(args, 1), source, source == COMMAND_DOWNLOAD_LOG ? downlinkReadLog : downlinkReadSamples,
+                 start, length, commandArg8(args, 2), args->tick)) {
+    return COMMAND_BAD_ARGUMENT;
+  }
+  return COMMAND_OK;
+}
+
+unsigned char commandBulkAck(const CommandArgs* args) {
+  if (!bulkAck(commandArg8(args, 0), commandArg16(args, 1), commandArg32(args, 3), args->tick)) {
+    return COMMAND_BAD_ARGUMENT; //Not the transfer in hand, tell the ground
+  }
+  return COMMAND_NO_REPLY;
+}
+
+/* Name: downlinkGetRoom
+   Return value:
+    unsigned int - most bytes of telemetry frame the radio can take now, less what coding adds
+*/
+static unsigned int downlinkGetRoom(void) {
+  unsigned int room = radioGetTxFree();
+
+  if (coded) {
+    return room > FEC_OVERHEAD ? room - FEC_OVERHEAD : 0;
+  }
+  return room;
+}
+
+unsigned char downlinkStep(void) {
+  unsigned long now = clockGetTicks();
+  const unsigned char* ring;
+  unsigned char head;
+  unsigned char used;
+  unsigned char length;
+
+  do { //Commands are run where they lie in the receive ring, while there is room to answer them
+    length = radioRxPeek(&ring, &head);
+    used = transmit && !telemetryGetFree(TELEMETRY_REPLY) ? 0 : commandParse(ring, RADIO_RX_LEN - 1, head, length, now);
+    radioRxDrop(used);
+  } while (used);
+  if (commandGetStats() -> frames != heardFrames) {
+    heardFrames = commandGetStats() -> frames;
+    lastHeard = now;
+    contact = 1;
+  } else if (now - lastHeard >= DOWNLINK_CONTACT_TICKS) {
+    contact = 0;
+  }
+
+  if ((long)(now - nextHealth) >= 0) {
+    downlinkQueueHealth(now);
+#ifdef PROFILE
+    downlinkQueueProfile(now);
+#endif
+    nextHealth += DOWNLINK_HEALTH_TICKS;
+  }
+  if ((long)(now - nextImu) >= 0 ||
+      (contact && bulkGetStats()->state != BULK_SENDING &&
+       telemetryGetFree(TELEMETRY_IMU) == telemetryPolicies[TELEMETRY_IMU].slots)) { //Link has room
+    downlinkQueueImu(now);
+    nextImu = now + DOWNLINK_IMU_TICKS;
+  }
+  downlinkQueueSnapshots(now);
+
+  if (contact && transmit) {
+    bulkStep(now);
+    telemetryBeginPass();
+    while ((length = telemetryDequeue(frame, downlinkGetRoom(), now))) {
+      if (coded) {
+        length = fecEncode(frame, length);
+      }
+      radioSend(frame, length); //Fits, it was dequeued for the room there is
+    }
+  }
+  return DOWNLINK_PASS_TICKS;
+}
@@ -0,0 +1,167 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in drdy.h
+*/
+
+#include <__cross_studio_io.h>
+#include "drdy.h"
+#include "i2c_driver.h"
+#include "i2c_peripherals.h"
+#include "clock.h"
+#include "arena.h"
+
+static I2CMessage* msg; //From the arena
+static char reg = ACCEL_START;
+static DrdySample ring[DRDY_RING_LEN];
+static volatile unsigned char head; //Next slot the interrupt routines fill
+static volatile unsigned char tail; //Next slot the task reads
+static volatile char pending; //Edge seen, read not started yet
+static volatile char inFlight; //Read started, result not in yet
+static unsigned long pendingUs;
+static DrdyStats stats;
+
+/* Name: drdyStart
+   Description:
+    Starts the read for the pending edge into the head slot.  Interrupts are off.
+*/
+static void drdyStart(void) {
+  DrdySample* sample = &ring[head & (DRDY_RING_LEN - 1)];
+
+  if ((unsigned char)(head - tail) >= DRDY_RING_LEN) { //Task has fallen behind
+    stats.overruns++;
+    pending = 0;
+    return;
+  }
+
+  sample -> edgeUs = pendingUs;
+  i2cInitializeMessage(msg, &reg, 1, IMU_I2C_ADDR, RX_MODE, DRDY_READ_LEN, sample->raw, SECONDARY);
+  i2cSetMessageRate(msg, IMU_I2C_MAX_HZ);
+  pending = 0;
+  inFlight = 1; //Before starting, replay builds finish inside i2cStartMessage()
+  i2cStartMessage(msg);
+
+  if (msg->error == I2CERR_BUS_BUSY) { //Transfer, or its stop, on the bus: the idle hook or drdyNext() tries again
+    inFlight = 0;
+    pending = 1;
+    stats.deferred++;
+  } else if (msg->error != I2CERR_IN_PROGRESS && inFlight) { //Refused outright
+    inFlight = 0;
+    stats.errors++;
+  }
+}
+
+/* Name: drdyIdle
+   Description:
+    I2C idle hook of the SECONDARY interface: files a finished read and starts a deferred one.
+*/
+static void drdyIdle(char i2cInterface) {
+  if (inFlight && msg->error != I2CERR_IN_PROGRESS) {
+    inFlight = 0;
+    if (msg->error == I2CERR_NO_ERROR) {
+      unsigned long latency = clockGetMicroseconds() - ring[head & (DRDY_RING_LEN - 1)].edgeUs;
+      unsigned int bucket = latency / DRDY_LATENCY_BUCKET_US;
+
+      if (latency > 0xFFFF) {
+        latency = 0xFFFF;
+      }
+      if (latency > stats.latencyMax) {
+        stats.latencyMax = latency;
+      }
+      stats.latency[bucket < DRDY_LATENCY_BUCKETS ? bucket : DRDY_LATENCY_BUCKETS - 1]++;
+      stats.samples++;
+      head++;
+    } else {
+      stats.errors++;
+    }
+  }
+  if (pending) {
+    drdyStart();
+  }
+}
+
+char drdyInit(void) {
+  char* p = (char*)&stats;
+
+  if (!msg) {
+    msg = arenaAlloc(ARENA_I2C, sizeof(I2CMessage));
+  }
+  if (!msg) { //Over budget, arenaReport() says so
+    return 0;
+  }
+  while (p < (char*)(&stats + 1)) {
+    *p++ = 0;
+  }
+  head = 0;
+  tail = 0;
+  pending = 0;
+  inFlight = 0;
+  i2cSetIdleHook(SECONDARY, drdyIdle);
+
+  P2SEL &= ~DRDY_PIN;
+  P2DIR &= ~DRDY_PIN;
+  P2IES &= ~DRDY_PIN; //Rising edge
+  P2IFG &= ~DRDY_PIN;
+  P2IE |= DRDY_PIN;
+  return 1;
+}
+
+void drdyEdge(unsigned long edgeUs) {
+  if (!msg) { //drdyInit() not called
+    return;
+  }
+  stats.edges++;
+  if (inFlight) { //Newer sample overwrites the one being read
+    stats.missed++;
+    return;
+  }
+  if (pending) { //Read still refused, the newer sample takes its place
+    stats.missed++;
+  }
+  pendingUs = edgeUs;
+  pending = 1;
+  drdyStart();
+}
+
+const DrdySample* drdyNext(void) {
+  if (pending) { //Refused from the idle hook while the last stop went out, nothing else will start it
+    unsigned int state = __get_interrupt_state();
+
+    __disable_interrupt();
+    if (pending && !inFlight) {
+      drdyStart();
+    }
+    __set_interrupt_state(state);
+  }
+  return head != tail ? &ring[tail & (DRDY_RING_LEN - 1)] : 0;
+}
+
+void drdyRelease(void) {
+  if (head != tail) {
+    tail++;
+  }
+}
+
+const DrdyStats* drdyGetStats(void) {
+  return &stats;
+}
+
+void drdyReport(void) {
+  unsigned char n;
+
+  debug_printf("drdy: %lu edges %lu samples %u missed %u overrun %u deferred %u errors, latency max %u us\n",
+               stats.edges, stats.samples, stats.missed, stats.overruns, stats.deferred, stats.errors, stats.latencyMax);
+  for (n = 0; n < DRDY_LATENCY_BUCKETS; n++) {
+    debug_printf("  %s%4u us %6u\n", n == DRDY_LATENCY_BUCKETS - 1 ? ">=" : "< ", (n + (n < DRDY_LATENCY_BUCKETS - 1)) *
+                 DRDY_LATENCY_BUCKET_US, stats.latency[n]);
+  }
+}
+
+#ifndef I2C_REPLAY
+#pragma vector = PORT2_VECTOR
+// Interrupt service routine for the MPU-9250 INT line
+__interrupt void Port2_routine(void) {
+  if (P2IFG & DRDY_PIN) {
+    P2IFG &= ~DRDY_PIN;
+    drdyEdge(clockGetMicroseconds());
+  }
+}
+#endif
@@ -0,0 +1,97 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in flash.h
+*/
+
+#include "msp430.h"
+#include "flash.h"
+#include "clock.h"
+
+/* Name: flashIsInfo
+   Description:
+    True for addresses in segments B to D.
+*/
+static char flashIsInfo(unsigned int address, unsigned int length) {
+  return address >= FLASH_INFO_D && length <= FLASH_INFO_A - FLASH_INFO_D && address + length <= FLASH_INFO_A;
+}
+
+/* Name: flashUnlock
+   Description:
+    Sets the timing generator from MCLK, whichever clock profile is active, and clears LOCK.
+*/
+static void flashUnlock(void) {
+  unsigned long divider = (clockGetMclkHz() + FLASH_TIMING_HZ - 1) / FLASH_TIMING_HZ;
+
+  if (divider > 64) {
+    divider = 64;
+  }
+  while (FCTL3 & BUSY);
+  FCTL2 = FWKEY + FSSEL_1 + (unsigned int)(divider - 1); //MCLK / (FN + 1)
+  FCTL3 = FWKEY; //LOCKA stays set
+}
+
+static void flashLock(void) {
+  FCTL1 = FWKEY;
+  FCTL3 = FWKEY + LOCK;
+}
+
+char flashEraseSegment(unsigned int address) {
+  volatile unsigned char* segment;
+  unsigned int state;
+  unsigned int n;
+
+  if (!flashIsInfo(address, 1)) {
+    return 0;
+  }
+  segment = (volatile unsigned char*)(address & ~(FLASH_INFO_SEGMENT_BYTES - 1));
+
+  state = __get_interrupt_state();
+  __disable_interrupt();
+  flashUnlock();
+  FCTL1 = FWKEY + ERASE;
+  *segment = 0; //Dummy write starts the erase, the CPU is held until it is done
+  flashLock();
+  __set_interrupt_state(state);
+
+  for (n = 0; n < FLASH_INFO_SEGMENT_BYTES; n++) {
+    if (segment[n] != 0xFF) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void flashRead(unsigned int address, unsigned char* data, unsigned int length) {
+  const unsigned char* source = (const unsigned char*)address;
+  unsigned int n;
+
+  for (n = 0; n < length; n++) {
+    data[n] = source[n];
+  }
+}
+
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length) {
+  volatile unsigned char* target = (volatile unsigned char*)address;
+  unsigned int state;
+  unsigned int n;
+
+  if (!flashIsInfo(address, length)) {
+    return 0;
+  }
+
+  state = __get_interrupt_state();
+  __disable_interrupt();
+  flashUnlock();
+  FCTL1 = FWKEY + WRT;
+  for (n = 0; n < length; n++) {
+    target[n] = data[n];
+  }
+  flashLock();
+  __set_interrupt_state(state);
+
+  for (n = 0; n < length; n++) {
+    if (target[n] != data[n]) {
+      return 0;
+    }
+  }
+  return 1;
+}
@@ -5,13 +5,61 @@
 
 #include "msp430.h"
 #include "i2c_driver.h"
-#include "salvo.h"
+#include "os.h"
+#include "radio.h"
+#ifdef I2C_REPLAY
+#include "replay.h"
+#endif
+
+//State of the message being moved by the interrupt routines, one per interface
+static I2CMessage* volatile i2cActiveMessage[I2C_INTERFACE_COUNT];
+static volatile int i2cTxIndex[I2C_INTERFACE_COUNT];
+static volatile int i2cRxIndex[I2C_INTERFACE_COUNT];
+static volatile char i2cNackCount[I2C_INTERFACE_COUNT];
+static volatile char i2cOwned[I2C_INTERFACE_COUNT]; //Set while a blocking or interrupt-driven message has the interface
+static I2CIdleHook i2cIdleHooks[I2C_INTERFACE_COUNT];
+
+#define I2C_RATE_UNKNOWN      0xFFFFFFFFUL //Never a real rate, forces the divider to be recomputed
+#define I2C_MAX_DIVIDER       0x7FFF
+
+//Bus rate bookkeeping, one per interface
+static unsigned long i2cSourceHz = I2C_DEFAULT_SOURCE_HZ;
+static unsigned long i2cConfigHz[I2C_INTERFACE_COUNT]; //Rate given to i2cInit(), 0 if configured by divider
+static int i2cConfigDivider[I2C_INTERFACE_COUNT]; //Divider given to i2cInit()
+static unsigned long i2cRateHz[I2C_INTERFACE_COUNT]; //Rate the programmed divider was picked for
+static int i2cDivider[I2C_INTERFACE_COUNT]; //Divider in UCBxBR0/1 right now
+
+static char i2cClaim(unsigned char i2cInterface);
+static void i2cRelease(unsigned char i2cInterface);
+
+//The register code, compiled once per interface (see i2c_interface.h): i2cSendBlocking0(), i2cSendBlocking1(), ...
+#define I2C_CAT_(a, b)        a##b
+#define I2C_CAT(a, b)         I2C_CAT_(a, b)
+#define I2C_FN(name)          I2C_CAT(name, I2C_N)
+#define I2C_REG(name)         I2C_CAT(I2C_CAT(I2C, I2C_N), _##name)
+
+#define I2C_N 0
+#include "i2c_interface.h"
+#undef I2C_N
+#if I2C_INTERFACE_COUNT > 1
+#define I2C_N 1
+#include "i2c_interface.h"
+#undef I2C_N
+#endif
+
+//Copy of function for the interface, picked once per call of the public functions
+#if I2C_INTERFACE_COUNT > 1
+#define I2C_SELECT(i2cInterface, function) ((i2cInterface) ? function##1 : function##0)
+#else
+#define I2C_SELECT(i2cInterface, function) (function##0)
+#endif
 
 /* Name: i2cInit
    Description:
     Initializes I2C interface according to settings in parameter configStruct.
 */
 void i2cInit(I2CConfig* configStruct) {
+  unsigned char interface;
 
   //Error checking
   if (!configStruct) { //Null pointer
@@ -22,39 +70,24 @@ void i2cInit(I2CConfig* configStruct) {
     return;
   }
 
-  if (configStruct -> i2cInterface == PRIMARY) {
-
-    DISABLE_PRIMARY_I2C; //Disable I2C while we're configuring
-    RESET_PRIMARY_CONFIG_0; //Clear config register so we're starting from a clean slate (all zeros)
-    UCB0CTL1 = BIT0; //Clear out config register except for reset enable
-
-    UCB0CTL0 |= (UCMST + UCMODE_3 + UCSYNC); //UCMST - master mode, UCMODE_3 - I2C mode, UCSYNC - synchronous mode
-    UCB0CTL1 |= (configStruct->clockSource) << CLOCK_SRC_SHIFT; //Double check this...
-    PRIMARY_I2C_SEL |= (SCL_PIN + SDA_PIN); //Set pin mode
-    UCB0BR0 = ((configStruct->baudDivider) & BAUD_LOW_MASK); //Low 8 bits register
-    UCB0BR1 = (configStruct->baudDivider) >> BAUD_SHIFT; //High 8 bits register
-
-    ENABLE_PRIMARY_I2C;
-
-  } else if (configStruct -> i2cInterface == SECONDARY) {
-
-    DISABLE_SECONDARY_I2C;
-    RESET_SECONDARY_CONFIG_0;
-    UCB1CTL1 = BIT0;
-
-    UCB1CTL0 |= (UCMST + UCMODE_3 + UCSYNC);
-    UCB1CTL1 |= (configStruct->clockSource) << CLOCK_SRC_SHIFT;
-    SECONDARY_I2C_SEL |= (SCL_PIN + SDA_PIN);
-    UCB1BR0 = ((configStruct->baudDivider) & BAUD_LOW_MASK); //Low 8 bits register
-    UCB1BR1 = (configStruct->baudDivider) >> BAUD_SHIFT; //High 8 bits register
-
-    ENABLE_SECONDARY_I2C;
+#ifdef I2C_REPLAY
+  configStruct -> error = I2CERR_NO_ERROR; //No hardware to set up
+  return;
+#endif
 
-  } else { //Invalid input
+  if (configStruct -> i2cInterface < 0 || configStruct -> i2cInterface >= I2C_INTERFACE_COUNT) { //Not on this target
     configStruct -> error = I2CERR_UNSPECIFIED_ERR;
     return;
   }
 
+  interface = configStruct->i2cInterface;
+  i2cConfigHz[interface] = configStruct->busHz;
+  i2cConfigDivider[interface] = configStruct->busHz ? i2cBaudDivider(configStruct->busHz) : configStruct->baudDivider;
+  i2cRateHz[interface] = configStruct->busHz;
+  i2cDivider[interface] = i2cConfigDivider[interface];
+
+  I2C_SELECT(interface, i2cInitPort)(configStruct->clockSource);
+
   configStruct -> error = I2CERR_NO_ERROR; //All is well
   return;
 }
@@ -66,7 +99,7 @@ void i2cInitializeConfig(I2CConfig* configStruct, char interface, char clockSour
     //Don't set error, because will generate segfault
     return;
   }
-  if (interface < 0 || interface > 1) { //Range checks
+  if (interface < 0 || interface >= I2C_INTERFACE_COUNT) { //Range checks
     configStruct -> error = I2CERR_BAD_PARAMETERS;
     return;
   }
@@ -78,6 +111,7 @@ void i2cInitializeConfig(I2CConfig* configStruct, char interface, char clockSour
   configStruct -> i2cInterface = interface;
   configStruct -> clockSource = clockSource;
   configStruct -> baudDivider = baudDivider;
+  configStruct -> busHz = 0;
 
   configStruct -> isInitialized = IS_INITIALIZED;
 
@@ -85,6 +119,44 @@ void i2cInitializeConfig(I2CConfig* configStruct, char interface, char clockSour
   return;
 }
 
+void i2cInitializeConfigRate(I2CConfig* configStruct, char interface, unsigned long busHz) {
+
+  //Error checks
+  if (!configStruct) { //Null pointer check
+    return;
+  }
+  if (busHz == 0 || busHz > i2cSourceHz) {
+    configStruct -> error = I2CERR_BAD_PARAMETERS;
+    return;
+  }
+
+  i2cInitializeConfig(configStruct, interface, SMCLK, i2cBaudDivider(busHz));
+  if (configStruct->error == I2CERR_NO_ERROR) {
+    configStruct -> busHz = busHz;
+  }
+}
+
+int i2cBaudDivider(unsigned long busHz) {
+  unsigned long divider = (i2cSourceHz + busHz - 1) / busHz; //Round up, never faster than asked
+
+  if (divider > I2C_MAX_DIVIDER) {
+    divider = I2C_MAX_DIVIDER;
+  }
+  return (int)divider;
+}
+
+void i2cSetSourceClock(unsigned long sourceHz) {
+  int n;
+
+  i2cSourceHz = sourceHz;
+  for (n = 0; n < I2C_INTERFACE_COUNT; n++) {
+    i2cRateHz[n] = I2C_RATE_UNKNOWN;
+    if (i2cConfigHz[n]) {
+      i2cConfigDivider[n] = i2cBaudDivider(i2cConfigHz[n]);
+    }
+  }
+}
+
 void i2cInitializeMessage(I2CMessage* messageStruct, char* the_message, int messageLength, char address, char txrxMode, \
                           int respLen, char* response, char i2cInterface) {
 
@@ -92,7 +164,7 @@ void i2cInitializeMessage(I2CMessage* messageStruct, char* the_message, int mess
   if (!messageStruct) {//Null pointer check
     return;
   }
-  if (!the_message || !response) { //Null pointer checks
+  if (!the_message) { //Null pointer check, response may be NO_RESPONSE in TX_MODE (checked below)
     messageStruct -> error = I2CERR_BAD_PARAMETERS;
     return;
   }
@@ -104,7 +176,7 @@ void i2cInitializeMessage(I2CMessage* messageStruct, char* the_message, int mess
     messageStruct -> error = I2CERR_BAD_PARAMETERS;
     return;
   }
-  if (i2cInterface < 0 || i2cInterface > 1) {
+  if (i2cInterface < 0 || i2cInterface >= I2C_INTERFACE_COUNT) {
     messageStruct -> error = I2CERR_BAD_PARAMETERS;
     return;
   }
@@ -120,6 +192,7 @@ void i2cInitializeMessage(I2CMessage* messageStruct, char* the_message, int mess
   messageStruct -> respLen = respLen;
   messageStruct -> response = response;
   messageStruct -> i2cInterface = i2cInterface;
+  messageStruct -> busHz = I2C_ANY_RATE;
 
   messageStruct -> isInitialized = IS_INITIALIZED;
 
@@ -127,191 +200,165 @@ void i2cInitializeMessage(I2CMessage* messageStruct, char* the_message, int mess
   return;
 }
 
+void i2cSetMessageRate(I2CMessage* messageStruct, unsigned long busHz) {
+  if (!messageStruct) { //Null pointer check
+    return;
+  }
+  messageStruct -> busHz = busHz;
+}
+
 void i2cConfigure(I2CConfig* configStruct) {
   i2cInit(configStruct); //This kosher under MISRA?
 }
 
-void i2cSendMessage(I2CMessage* messageStruct) { //errors need to be handled
+/* Name: i2cClaim
+   Return value:
+    char - 1 if the interface was free and now belongs to the caller, 0 if a message is in progress on it
+   Description:
+    Test and set with interrupts off, so a message started from an interrupt routine cannot slip in between.
+*/
+static char i2cClaim(unsigned char i2cInterface) {
+  unsigned int state = __get_interrupt_state();
+  char claimed = 0;
+
+  __disable_interrupt();
+  if (!i2cOwned[i2cInterface]) {
+    i2cOwned[i2cInterface] = 1;
+    claimed = 1;
+  }
+  __set_interrupt_state(state);
+  return claimed;
+}
+
+/* Name: i2cRelease
+   Description:
+    Frees the interface and runs its idle hook, if any, with interrupts off.
+*/
+static void i2cRelease(unsigned char i2cInterface) {
+  unsigned int state = __get_interrupt_state();
+
+  __disable_interrupt();
+  i2cOwned[i2cInterface] = 0;
+  if (i2cIdleHooks[i2cInterface]) {
+    i2cIdleHooks[i2cInterface](i2cInterface);
+  }
+  __set_interrupt_state(state);
+}
+
+char i2cAcquireInterface(char i2cInterface) {
+  unsigned int state;
+  char acquired = 0;
+
+  if (i2cInterface < 0 || i2cInterface >= I2C_INTERFACE_COUNT) {
+    return 0;
+  }
+  state = __get_interrupt_state();
+  __disable_interrupt(); //No message can start between the stop test and the claim
+  if (!I2C_SELECT(i2cInterface, i2cStopPending)()) {
+    acquired = i2cClaim(i2cInterface);
+  }
+  __set_interrupt_state(state);
+  return acquired;
+}
 
- //Local variables
-  char nackCount = 0;
-  int i = 0;
-  char stoppedFlag = 0;
+void i2cReleaseInterface(char i2cInterface) {
+  if (i2cInterface >= 0 && i2cInterface < I2C_INTERFACE_COUNT) {
+    i2cRelease(i2cInterface);
+  }
+}
 
-  //OSProtect(); //Will this interfere with normal TX/RX interrupt functioning?
+void i2cSetIdleHook(char i2cInterface, I2CIdleHook hook) {
+  if (i2cInterface >= 0 && i2cInterface < I2C_INTERFACE_COUNT) {
+    i2cIdleHooks[(unsigned char)i2cInterface] = hook;
+  }
+}
+
+void i2cSendMessage(I2CMessage* messageStruct) { //errors need to be handled
 
   //Error czechs
   if (!messageStruct) { //Null pointer
-    ////OSUnprotect();
     return;
   }
   if (messageStruct->isInitialized != IS_INITIALIZED) { //message has not been initialized'
     messageStruct -> error = I2CERR_STRUCT_NOT_INITIALIZED;
-    //OSUnprotect();
+    return;
+  }
+  if (messageStruct->i2cInterface < 0 || messageStruct->i2cInterface >= I2C_INTERFACE_COUNT) {
+    messageStruct -> error = I2CERR_UNSPECIFIED_ERR;
+    return;
+  }
+  if (!i2cClaim(messageStruct->i2cInterface)) { //Someone else's message is in progress
+    messageStruct -> error = I2CERR_BUS_BUSY;
     return;
   }
 
-  //Lessgo
-  if (messageStruct->i2cInterface == PRIMARY) {
-    if (!GET_PRIMARY_IS_ACTIVE) { //Interface is not active
-      messageStruct -> error = I2CERR_INTERFACE_NOT_ACTIVE;
-      //OSUnprotect();
-      return; //Must be activated manually
-    }
-    
-    //Initialize
-    UCB0I2CSA = messageStruct->address; //Set address
-
-    if (messageStruct->messageLength > 0) { //if no TX, then we want to go straight to RX section
-      UCB0CTL1 |= UCTR; //Always start in TX mode
-      START_PRIMARY_I2C; //Set start condition
-    }
-
-    i = 0;
-    while (i < messageStruct->messageLength) {//takes care of RX only case: if message is empty, while loop never run
-      if (!GET_PRIMARY_TX_READY) {
-        if (PRIMARY_GET_NACK) { //Send same byte again if slave transmitted a NACK
-          nackCount++;
-          if (nackCount >= MAX_NACK) { //Slave unreachable, abort to prevent stalling OS
-            STOP_PRIMARY_I2C;
-            DISABLE_PRIMARY_I2C; //Problem with the slave, so shut down interface to prevent undefined behavior (not sure what behavior, though)
-            messageStruct -> error = I2CERR_NACK_LIMIT_REACHED;
-            //OSUnprotect();
-            return;
-          }
-          START_PRIMARY_I2C; //Repeated start
-        }
-        continue;
-      } else {
-        UCB0TXBUF = messageStruct->message[i];
-        nackCount = 0; //byte got through, slave is reachable.
-        i++;
-      }
-    }
+  I2C_SELECT(messageStruct->i2cInterface, i2cSendBlocking)(messageStruct);
+  i2cRelease(messageStruct->i2cInterface);
+}
 
-    while(!GET_PRIMARY_TX_READY); //wait for last byte to finish sending
-
-    //Receive
-    if (messageStruct->txrxMode == RX_MODE) {
-      int j = 0;
-      UCB0CTL1 &= ~UCTR; //Set to receive mode
-      START_PRIMARY_I2C; //(repeated) start condition
-      IFG2 &= ~UCB0TXIFG; //clear TX flag (the datasheet told me so)
-
-      //special case for single byte receive
-      if ((messageStruct->respLen == 1) && PRIMARY_GET_STT_CLR) { //Send stop cond. as soon as STT is cleared if only receiving one byte (from datasheet)
-        while(UCB0CTL1 & UCTXSTT);
-        STOP_PRIMARY_I2C; //Automatically sends final NACK as required by I2C spec.
-        stoppedFlag = 1;
-      }
-
-      while (j < messageStruct->respLen) {
-        if (!GET_PRIMARY_RX_READY) {
-          if (PRIMARY_GET_NACK) { //Didn't acknowledge address (only has possibility of happening when while loop is entered
-            START_PRIMARY_I2C; //Repeated start
-            continue;
-          }
-        } else {
-          messageStruct->response[j] = UCB0RXBUF;
-          j++;
-        }
-      }
-      //All done (pretty sure...)
-    }
+void i2cStartMessage(I2CMessage* messageStruct) {
 
-    //Stop communication
-    if (!stoppedFlag) { //prevents repeated stop (don't know if that would be a problem)
-      STOP_PRIMARY_I2C;
-    }
+  //Error checks
+  if (!messageStruct) { //Null pointer
+    return;
+  }
+  if (messageStruct->isInitialized != IS_INITIALIZED) {
+    messageStruct -> error = I2CERR_STRUCT_NOT_INITIALIZED;
+    return;
+  }
+  if (messageStruct->i2cInterface < 0 || messageStruct->i2cInterface >= I2C_INTERFACE_COUNT) {
+    messageStruct -> error = I2CERR_UNSPECIFIED_ERR;
+    return;
+  }
 
-    messageStruct -> error = I2CERR_NO_ERROR;
-    //OSUnprotect();
+#ifdef I2C_REPLAY
+  if (!i2cClaim(messageStruct->i2cInterface)) {
+    messageStruct -> error = I2CERR_BUS_BUSY;
     return;
+  }
+  replayTransfer(messageStruct); //Done before the caller checks on it
+  i2cRelease(messageStruct->i2cInterface);
+  return;
+#endif
 
-  } else if (messageStruct->i2cInterface == SECONDARY) {
-    if (!GET_SECONDARY_IS_ACTIVE) { //Interface is not active
-      messageStruct -> error = I2CERR_INTERFACE_NOT_ACTIVE;
-      //OSUnprotect();
-      return; //Must be activated manually
-    }
-    
-    //Initialize
-    UCB1I2CSA = messageStruct->address; //Set address
+  I2C_SELECT(messageStruct->i2cInterface, i2cAsyncStart)(messageStruct);
+}
 
-    if (messageStruct->messageLength > 0) {
-      UCB1CTL1 |= UCTR;
-      START_SECONDARY_I2C; //Set start condition
-    }
+char i2cIsBusy(char i2cInterface) {
+  if (i2cInterface < 0 || i2cInterface >= I2C_INTERFACE_COUNT) {
+    return 0;
+  }
+  return i2cOwned[(unsigned char)i2cInterface] || I2C_SELECT(i2cInterface, i2cStopPending)();
+}
 
-    //Transmit data
-    i = 0;
-    while (i < messageStruct->messageLength) {//takes care of RX only case: if message is empty, while loop never run
-      if (!GET_SECONDARY_TX_READY) {
-        if (SECONDARY_GET_NACK) { //Send same byte again if slave transmitted a NACK
-          nackCount++;
-          if (nackCount >= MAX_NACK) { //Slave unreachable, abort to prevent stalling OS
-            STOP_SECONDARY_I2C;
-            DISABLE_SECONDARY_I2C; //Problem with the slave, so shut down interface to prevent undefined behavior (not sure what behavior, though)
-            messageStruct -> error = I2CERR_NACK_LIMIT_REACHED;
-            //OSUnprotect();
-            return;
-          }
-          START_SECONDARY_I2C; //Repeated start
-        }
-        continue;
-      } else {
-        UCB1TXBUF = messageStruct->message[i];
-        nackCount = 0; //byte got through, slave is reachable.
-        i++;
-      }
-    }
+#ifndef I2C_REPLAY //Nothing below runs without the hardware
 
-    while(!GET_SECONDARY_TX_READY); //wait for final byte to finish transmission
-
-    //Receive
-    if (messageStruct->txrxMode == RX_MODE) {
-      int j = 0;
-      UCB1CTL1 &= ~UCTR; //Set to receive mode
-      START_SECONDARY_I2C; //(repeated) start condition
-      UC1IFG &= ~UCB1TXIFG; //clear TX flag (the datasheet told me so)
-
-      //special case for single byte transmission
-      if ((messageStruct->respLen == 1) && SECONDARY_GET_STT_CLR) { //Send stop cond. as soon as STT is cleared if only receiving one byte (from datasheet)
-        while(!SECONDARY_GET_STT_CLR);
-        STOP_SECONDARY_I2C; //Automatically sends final NACK as required by I2C spec.
-        stoppedFlag = 1;
-      }
-
-      while (j < messageStruct->respLen) {
-        if (!GET_SECONDARY_RX_READY) {
-          if (SECONDARY_GET_NACK) { //Didn't acknowledge address (only has possibility of happening when while loop is entered            debug_printf("NACKED ADDRESS ON REC\n");
-            START_SECONDARY_I2C; //Repeated start
-            continue;
-          }
-        } else {
-          j++;
-          if (j >= messageStruct->respLen) {
-            STOP_SECONDARY_I2C;
-            stoppedFlag = 1;
-          }
-          messageStruct->response[j] = UCB1RXBUF;
-        }
-      }
-      //All done (pretty sure...)
-    }
+#pragma vector = USCIAB0TX_VECTOR
+__interrupt void USCIAB0TX_routine(void) {
+  i2cAsyncServiceData0();
+}
 
-    //Stop communication
-    if (!stoppedFlag) {
-      STOP_SECONDARY_I2C;
-    }
+#pragma vector = USCIAB0RX_VECTOR
+__interrupt void USCIAB0RX_routine(void) {
+  i2cAsyncServiceState0();
+}
 
-    messageStruct -> error = I2CERR_NO_ERROR;
-    //OSUnprotect();
-    return;
+#endif
 
-  } else {
-    messageStruct -> error = I2CERR_UNSPECIFIED_ERR;
-    //OSUnprotect();
-    return;
-  }  
-}
\ No newline at end of file
+#if I2C_INTERFACE_COUNT > 1 //UCA1 carries the radio link (radio.h); each service routine only takes its own flags
+#pragma vector = USCIAB1TX_VECTOR
+__interrupt void USCIAB1TX_routine(void) {
+#ifndef I2C_REPLAY
+  i2cAsyncServiceData1();
+#endif
+  radioServiceTx();
+}
+
+#pragma vector = USCIAB1RX_VECTOR
+__interrupt void USCIAB1RX_routine(void) {
+#ifndef I2C_REPLAY
+  i2cAsyncServiceState1();
+#endif
+  radioServiceRx();
+}
+#endif
@@ -0,0 +1,98 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Primary I2C (UCB0 on Port 3) - ISIS deployable antenna system at ANTENNA_I2C_ADDR
+    P3.0 - -CS_SD/I2C_ON (isolator must be switched to I2C)
+   Modifications:
+    None beyond those made by the I2C driver
+   Purpose:
+    Deploys the antennas.  The deployment sequence is a state machine (arm, deploy, poll status, disarm) that is advanced
+    one step at a time by antennaStep(), so a Salvo task can delay between steps instead of holding the CPU while the burn
+    wires heat up.  All I2C traffic goes through the non-blocking i2cStartMessage().
+*/
+
+#ifndef ANTENNA_H
+#define ANTENNA_H
+
+#include "i2c_driver.h"
+#include "clock.h"
+
+/* CONSTANTS */
+#define ANTENNA_BURN_SECONDS        10 //Burn time per antenna, sent with ANTENNA_CMD_DEPLOY_AUTO
+#define ANTENNA_COUNT               4
+#define ANTENNA_DEPLOY_TIMEOUT      ((unsigned int)(ANTENNA_COUNT * ANTENNA_BURN_SECONDS + 10) * OS_TICK_HZ) //Ticks to wait for all four
+#define ANTENNA_MAX_ATTEMPTS        3 //Full deployment sequences before giving up
+#define ANTENNA_MAX_FAULTS          10 //Consecutive I2C errors before giving up
+#define ANTENNA_POLL_MIN_TICKS      (OS_TICK_HZ / 4) //First status poll after deploy command
+#define ANTENNA_POLL_MAX_TICKS      (2 * OS_TICK_HZ) //Backoff limit, must fit in an 8-bit Salvo delay
+#define ANTENNA_FAULT_RETRY_TICKS   (OS_TICK_HZ / 2)
+#define ANTENNA_IDLE_TICKS          255 //Nothing left to do
+
+/* DATATYPES */
+
+/* Name: AntennaState_e
+   Type: enum
+   Values:
+    ANT_ARMING - Sending the arm command
+    ANT_DEPLOYING - Sending the automatic deployment command
+    ANT_POLLING - Waiting for the burn wires, polling status with increasing intervals
+    ANT_DISARMING - All antennas out (or out of attempts), sending the disarm command
+    ANT_DEPLOYED - Done, all antennas reported deployed
+    ANT_FAILED - Done, antennas could not be deployed or the controller stopped answering
+   Purpose:
+    States of the deployment sequence.
+*/
+enum AntennaState_e {ANT_ARMING = 0,
+                     ANT_DEPLOYING = 1,
+                     ANT_POLLING = 2,
+                     ANT_DISARMING = 3,
+                     ANT_DEPLOYED = 4,
+                     ANT_FAILED = 5};
+typedef enum AntennaState_e AntennaState;
+
+/* Name: AntennaHealth_s
+   Type: struct
+   Parameters:
+    AntennaState state - current state of the deployment sequence
+    unsigned int status - last status word read from the controller (see ANTENNA_STATUS_* in i2c_peripherals.h)
+    unsigned int elapsedTicks - ticks spent polling in the current attempt
+    char attempts - deployment sequences started so far
+    char faults - consecutive I2C errors
+    I2CError lastError - last error returned by the I2C driver
+   Purpose:
+    Keeps track of the antenna deployment, for the health task.
+*/
+struct AntennaHealth_s {
+  AntennaState state;
+  unsigned int status;
+  unsigned int elapsedTicks;
+  char attempts;
+  char faults;
+  I2CError lastError;
+};
+typedef struct AntennaHealth_s AntennaHealth;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: antennaInit
+   Description:
+    Brings up the primary I2C interface, switches the SD card isolator to I2C, and resets the deployment sequence to ANT_ARMING.
+    After a warm restart (watchdog.h) a finished sequence stays finished, and the attempts already made count.
+*/
+void antennaInit(void);
+
+/* Name: antennaStep
+   Return value:
+    unsigned char - number of Salvo ticks to wait before calling again, 0 if the caller should only yield (an I2C
+                    transfer is in progress)
+   Description:
+    Advances the deployment sequence by at most one I2C transaction.  Never busy-waits.
+*/
+unsigned char antennaStep(void);
+
+/* Name: antennaGetHealth
+   Return value:
+    const AntennaHealth* - current deployment state, read only
+*/
+const AntennaHealth* antennaGetHealth(void);
+
+#endif
@@ -0,0 +1,109 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Owns the large RAM buffers (IMU samples, flight log blocks, I2C descriptors, telemetry, snapshots) in one pool whose size is
+    fixed at compile time.  Each subsystem has its own budget below, derived from the buffer depths in its header, and
+    the build fails if the budgets plus the stack and the reserve for everything else no longer fit in the F2618's
+    8 KB.  ground_software/ramcheck.c sums the statics the modules really declare against that reserve.  Buffers are
+    handed out once, at init, and never freed.  arenaReport() prints budgets, use and the stack high water mark.
+
+    The first ARENA_KEPT_OWNERS owners are in a pool of their own in the NO_INIT section, which the startup code leaves
+    alone, so their buffers survive a warm restart (watchdog.h).  Their owners clear them on a cold boot.
+*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "data.h"
+#include "recorder.h"
+#include "i2c_driver.h"
+#include "snapshot.h"
+#include "telemetry.h"
+
+/* CONSTANTS */
+#define RAM_BYTES                 8192 //MSP430F2618
+#define RAM_STACK_BUDGET          1024 //Salvo tasks share one stack: deepest task call chain plus nested interrupts
+#define RAM_STATIC_RESERVE        1792 //Statics outside the arena (driver state, health structs, Salvo control blocks),
+                                       //about 1560 bytes by ground_software/ramcheck.c
+#define ARENA_STACK_PATTERN       0xA5 //Painted over the stack at boot to find the high water mark
+#define ARENA_STACK_GUARD         32 //Bytes left unpainted under the caller of arenaPaintStack()
+
+#define ARENA_ROUND(n)            (((n) + 1) & ~1) //Every buffer starts word aligned
+
+#define ARENA_I2C_DESCRIPTORS     2 //sampler.c, drdy.c
+#define ARENA_I2C_BUFFER_BYTES    16 //Message and response bytes per descriptor (drdy.c reads into its own ring)
+
+//Budget of each owner (bytes)
+#define ARENA_SAMPLES_BYTES       (3 * ARENA_ROUND(DATA_SAMPLE_BUFFER_BYTES)) //Gyroscope, accelerometer, magnetometer
+#define ARENA_RECORDER_BYTES      ARENA_ROUND(RECORDER_BLOCK_BUFFERS * LOG_BLOCK_SIZE)
+#define ARENA_I2C_BYTES           (ARENA_I2C_DESCRIPTORS * (ARENA_ROUND(sizeof(I2CMessage)) + ARENA_ROUND(ARENA_I2C_BUFFER_BYTES)))
+#define ARENA_TELEMETRY_BYTES     ARENA_ROUND(TELEMETRY_BYTES)
+#define ARENA_SNAPSHOT_BYTES      ARENA_ROUND(SNAPSHOT_BYTES)
+#define ARENA_KEPT_OWNERS         1 //ARENA_SAMPLES, kept through a warm restart
+#define ARENA_KEPT_BYTES          ARENA_SAMPLES_BYTES
+#define ARENA_BYTES               (ARENA_SAMPLES_BYTES + ARENA_RECORDER_BYTES + ARENA_I2C_BYTES + ARENA_TELEMETRY_BYTES + \
+                                   ARENA_SNAPSHOT_BYTES)
+
+/* DATATYPES */
+
+/* Name: ArenaOwner_e
+   Type: enum
+   Values:
+    ARENA_SAMPLES (0) - IMU sample history (data.h)
+    ARENA_RECORDER (1) - flight log blocks waiting for the SD card (recorder.h)
+    ARENA_I2C (2) - I2C messages and their buffers owned by tasks
+    ARENA_TELEMETRY (3) - packets waiting for the downlink (telemetry.h)
+    ARENA_SNAPSHOTS (4) - event snapshots waiting for the downlink (snapshot.h)
+    ARENA_OWNERS (5) - number of owners, not an owner
+   Purpose:
+    Subsystems with a budget in the arena.
+*/
+enum ArenaOwner_e {ARENA_SAMPLES = 0,
+                   ARENA_RECORDER = 1,
+                   ARENA_I2C = 2,
+                   ARENA_TELEMETRY = 3,
+                   ARENA_SNAPSHOTS = 4,
+                   ARENA_OWNERS = 5};
+typedef enum ArenaOwner_e ArenaOwner;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: arenaAlloc
+   Parameters:
+    ArenaOwner owner - subsystem the buffer is charged to
+    unsigned int size - bytes needed
+   Return value:
+    void* - word aligned buffer, or 0 if it does not fit in the owner's budget (the failure is counted and reported)
+   Description:
+    Hands out the next size bytes of the owner's budget.  Only call from init code; nothing is ever freed.
+*/
+void* arenaAlloc(ArenaOwner owner, unsigned int size);
+
+/* Name: arenaGetUsed
+   Return value:
+    unsigned int - bytes of the owner's budget handed out so far
+*/
+unsigned int arenaGetUsed(ArenaOwner owner);
+
+/* Name: arenaPaintStack
+   Description:
+    Fills the RAM_STACK_BUDGET bytes below the caller's stack frame with ARENA_STACK_PATTERN.  Call first thing in main().
+*/
+void arenaPaintStack(void);
+
+/* Name: arenaGetStackHighWater
+   Return value:
+    unsigned int - deepest stack use below main() since arenaPaintStack() (bytes)
+*/
+unsigned int arenaGetStackHighWater(void);
+
+/* Name: arenaReport
+   Description:
+    Prints each owner's budget and use, the static totals, and the stack high water mark through the debug I/O.
+*/
+void arenaReport(void);
+
+#endif
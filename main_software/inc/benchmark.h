@@ -0,0 +1,100 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Timer B (see cycles.h)
+   Modifications:
+    None
+   Purpose:
+    Cycle-count benchmarks of the firmware's hot paths.  Build with BENCHMARK defined (and I2C_REPLAY, unless the sensors
+    are really connected): benchmark.c then provides main() instead of main.c, runs every benchmark, prints a table
+    through the debug I/O, and exits with the number of regressions, so a run in the CrossWorks simulator or on the board
+    fails when a path gets slower than its baseline.
+
+    Measured cycles cover the CPU only.  Whatever the CPU cannot see is added from a small cost model:
+     - interrupt acceptance and RETI (BENCH_ISR_ENTRY_CYCLES + BENCH_ISR_EXIT_CYCLES) for interrupt routines
+     - bus time for I2C messages in replay builds, 9 SCL periods per byte plus start/stop, see benchI2CBusCycles()
+
+    Replay builds also run the sampler against the simulated sensors and print the bus time each sensor takes at its
+    configured rate, and the latency from the simulated IMU INT edge to the sample being in the ring.  Last, a periodic
+    task runs against a synthetic load under the scheduler and its release jitter and overruns are printed.  None of
+    these are compared against a baseline.
+
+    To update the baselines, run the benchmark and copy the "total" column into the BENCH_BASELINE_* values below.  A
+    baseline of 0 means none has been recorded, and counts as a regression: the run fails until every path has one, so
+    a path cannot go unchecked.  None are recorded yet, as that takes the CrossWorks simulator or a board.  Until then
+    ground_software/benchhost.c times the same paths in wall time on the host, against the baselines committed in
+    ground_software/benchhost.baseline.
+*/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/* CONSTANTS */
+#define BENCH_ITERATIONS          32
+#define BENCH_TOLERANCE_PERCENT   10 //Allowed slowdown before a result counts as a regression
+#define BENCH_ISR_ENTRY_CYCLES    6 //MSP430x2xx family guide, interrupt acceptance
+#define BENCH_ISR_EXIT_CYCLES     5 //RETI
+
+#define BENCH_SAMPLER_RELEASES    200 //Sampler releases against the simulated devices, replay builds
+#define BENCH_DRDY_SAMPLES        200 //Data-ready reads on the simulated INT line, replay builds
+
+//Periodic task under synthetic load, see benchPeriodicLoad()
+#define BENCH_PERIODIC_TICKS      2
+#define BENCH_PERIODIC_JOBS       200
+#define BENCH_PERIODIC_JOB_LOOPS  500
+#define BENCH_LOAD_MAX_LOOPS      2000 //About one OS tick at 1 MHz at most
+
+//Baselines, average cycles per call including modelled cycles, 0 until measured (fails the run, see above)
+#define BENCH_BASELINE_I2C_INIT           0
+#define BENCH_BASELINE_I2C_SEND           0
+#define BENCH_BASELINE_STORE_SAMPLE       0
+#define BENCH_BASELINE_CALIB_GYRO         0
+#define BENCH_BASELINE_CALIB_ACCEL        0
+#define BENCH_BASELINE_CALIB_MAGNET       0
+#define BENCH_BASELINE_DECIM              0
+#define BENCH_BASELINE_SNAPSHOT           0
+#define BENCH_BASELINE_TELEMETRY          0
+#define BENCH_BASELINE_COMMAND            0
+#define BENCH_BASELINE_FEC                0
+#define BENCH_BASELINE_TIMER_ISR          0
+#define BENCH_BASELINE_RECORDER_SAMPLE    0
+#define BENCH_BASELINE_LOG_CRC            0
+
+/* DATATYPES */
+
+/* Name: BenchResult_s
+   Type: struct
+   Parameters:
+    const char* name - what was measured
+    unsigned int minCycles - fastest call (measured)
+    unsigned int maxCycles - slowest call (measured)
+    unsigned long totalCycles - sum of all calls (measured)
+    unsigned int count - number of calls
+    unsigned int modelCycles - cycles added per call by the cost model
+    unsigned int baseline - expected average, 0 if none (a regression)
+   Purpose:
+    Result of one benchmark.
+*/
+struct BenchResult_s {
+  const char* name;
+  unsigned int minCycles;
+  unsigned int maxCycles;
+  unsigned long totalCycles;
+  unsigned int count;
+  unsigned int modelCycles;
+  unsigned int baseline;
+};
+typedef struct BenchResult_s BenchResult;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: benchI2CBusCycles
+   Parameters:
+    int txBytes - bytes written (not counting the address byte)
+    int rxBytes - bytes read (not counting the address byte)
+    int baudDivider - SMCLK cycles per SCL period
+   Return value:
+    unsigned int - MCLK cycles the bus needs for the message, with MCLK = SMCLK
+*/
+unsigned int benchI2CBusCycles(int txBytes, int rxBytes, int baudDivider);
+
+#endif
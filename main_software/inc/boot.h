@@ -0,0 +1,118 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None, times come from clock.h
+   Modifications:
+    None
+   Purpose:
+    Boot sequencer.  Brings the peripherals up in the order that gets the first IMU sample into the history soonest,
+    and keeps a timeline of the boot.  Each device is started by its own task, which asks bootWait() how long to wait
+    first:
+
+      - settle: after a power on reset the devices all power up with the MCU, so their start-up times run at once,
+        counted from bootStart(), instead of one after the other.  After any other reset they kept their power, and
+        there is nothing to wait for.
+      - deferral: devices the first sample does not need (the SD card, the antenna controller, the radio) are not
+        started until it is in, or BOOT_DEFER_MAX_TICKS have gone by without one.  The IMU is the only critical device.
+
+    Meanwhile the tasks do what needs no device (calibInit() runs while the IMU starts up), and the slow device inits
+    are split into steps that give up the CPU between them (sdInitStart() and sdInitPoll(), one log read per step in
+    recorder.c), so none holds up the IMU task once it is running.
+
+    The timeline holds the time of each BootEvent, in microseconds from bootStart() (before it, the startup code and
+    main() take a few milliseconds Timer A cannot see).  bootReport() prints it; PROFILE builds do so with the rest.
+*/
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include "clock.h"
+
+/* CONSTANTS */
+#define BOOT_IMU_SETTLE_MS        35 //MPU-9250 gyroscope start-up from power on, its registers answer from 11 ms
+#define BOOT_SD_SETTLE_MS         1 //Supply ramp before the 74 clocks of sdInitStart()
+#define BOOT_ANTENNA_SETTLE_MS    100 //Allowance for the deployment controller's own boot
+#define BOOT_RADIO_SETTLE_MS      100 //Allowance for the modem's boot
+#define BOOT_DEFER_MAX_TICKS      OS_TICK_HZ //Deferred devices start after this, first sample or not
+#define BOOT_NOT_YET              0xFFFFFFFFUL //Timeline entry of an event that has not happened
+
+/* DATATYPES */
+
+/* Name: BootDevice_e
+   Type: enum
+   Values:
+    BOOT_IMU (0) - MPU-9250 and its magnetometer, critical
+    BOOT_SD (1) - SD card, deferred
+    BOOT_ANTENNA (2) - antenna deployment controller, deferred
+    BOOT_RADIO (3) - radio modem, deferred
+    BOOT_DEVICES (4) - number of devices, not a device
+*/
+enum BootDevice_e {BOOT_IMU = 0,
+                   BOOT_SD = 1,
+                   BOOT_ANTENNA = 2,
+                   BOOT_RADIO = 3,
+                   BOOT_DEVICES = 4};
+typedef enum BootDevice_e BootDevice;
+
+/* Name: BootEvent_e
+   Type: enum
+   Values:
+    BOOT_SCHEDULER (0) - bootStart(), the scheduler about to run
+    BOOT_IMU_CONFIGURED (1) - samplerInit() done
+    BOOT_FIRST_SAMPLE (2) - first sample in the history (dataStoreSample())
+    BOOT_CARD_READY (3) - SD card initialized
+    BOOT_LOG_RUNNING (4) - recorder appending to the log
+    BOOT_ANTENNA_STARTED (5) - antennaInit() done
+    BOOT_RADIO_STARTED (6) - downlinkInit() done
+    BOOT_EVENTS (7) - number of events, not an event
+*/
+enum BootEvent_e {BOOT_SCHEDULER = 0,
+                  BOOT_IMU_CONFIGURED = 1,
+                  BOOT_FIRST_SAMPLE = 2,
+                  BOOT_CARD_READY = 3,
+                  BOOT_LOG_RUNNING = 4,
+                  BOOT_ANTENNA_STARTED = 5,
+                  BOOT_RADIO_STARTED = 6,
+                  BOOT_EVENTS = 7};
+typedef enum BootEvent_e BootEvent;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: bootStart
+   Parameters:
+    char powerOn - 1 if the devices powered up with this boot (PORIFG, see watchdogGetStats())
+   Description:
+    Starts the settle times and the timeline.  Call from main() after the clock is running, just before the scheduler.
+*/
+void bootStart(char powerOn);
+
+/* Name: bootWait
+   Parameters:
+    BootDevice device - device about to be started
+   Return value:
+    unsigned char - Salvo ticks to wait before starting it, 0 to start it now
+*/
+unsigned char bootWait(BootDevice device);
+
+/* Name: bootMark
+   Parameters:
+    BootEvent event - what just happened
+   Description:
+    Records the time of the event, the first time only.  Cheap enough to call on every sample.
+*/
+void bootMark(BootEvent event);
+
+/* Name: bootGetTime
+   Parameters:
+    BootEvent event - event wanted
+   Return value:
+    unsigned long - microseconds from bootStart() to the event, BOOT_NOT_YET if it has not happened
+*/
+unsigned long bootGetTime(BootEvent event);
+
+/* Name: bootReport
+   Description:
+    Prints the timeline through the debug I/O.
+*/
+void bootReport(void);
+
+#endif
@@ -0,0 +1,139 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Bulk download: streams a byte range of a source (the sample history, the SD log) to the ground as TELEMETRY_BULK
+    packets, with selective repeat.  The range is cut into BULK_CHUNK_BYTES chunks, numbered from 0.  Up to a window of
+    chunks (chosen by the ground, BULK_WINDOW at most) may be out at once; the ground acknowledges them with BULK_ACK
+    commands (command.h) carrying the first chunk it is missing and a bitmap of the BULK_WINDOW chunks from there, so
+    one acknowledgement covers everything it has.  A chunk is sent again when:
+
+      - a chunk sent after it has been acknowledged and it has not (the link keeps frames in order, so it was lost)
+      - nothing new has been acknowledged for BULK_ACK_TICKS while chunks are out
+
+    Chunks are read from the source again when they are resent, so nothing is held in RAM but the bitmaps.  The transfer
+    survives the end of a pass: the sender just stops while out of contact, and the ground picks up where it left off by
+    acknowledging again, or by repeating the DOWNLOAD command (same transfer, source and range), which keeps what has
+    been acknowledged.  It does not survive a reset.
+
+    Packet payload: transfer (1), chunk (2, little endian), data (BULK_CHUNK_BYTES, less for the last chunk).
+
+    Kept free of MSP430 headers so ground_software/bulksim.c can run it over a lossy link model; the sources are
+    readers supplied by the caller (downlink.c).
+*/
+
+#ifndef BULK_H
+#define BULK_H
+
+#include "telemetry.h"
+
+/* CONSTANTS */
+#define BULK_WINDOW           32 //Chunks, one bit each in the bitmaps
+#define BULK_HEADER           3
+#define BULK_CHUNK_BYTES      (TELEMETRY_PAYLOAD_MAX - BULK_HEADER)
+#define BULK_CHUNKS_MAX       65535UL //Chunk numbers are 16 bits
+#define BULK_ACK_TICKS        300 //No news from the ground for this long, and every chunk out is sent again
+#define BULK_ACK_BYTES        7 //BULK_ACK arguments: transfer (1), first missing chunk (2), bitmap (4)
+
+/* DATATYPES */
+
+/* Name: BulkReader
+   Parameters:
+    unsigned long address - of the first byte, in the source
+    unsigned char* buffer - length bytes
+    unsigned char length - BULK_CHUNK_BYTES at most
+   Return value:
+    char - 1 if read, 0 if the source is busy (try again on a later step), -1 if it cannot be read (the transfer stops)
+*/
+typedef char (*BulkReader)(unsigned long address, unsigned char* buffer, unsigned char length);
+
+/* Name: BulkState_e
+   Type: enum
+   Values:
+    BULK_IDLE (0) - no transfer since bulkInit()
+    BULK_SENDING (1) - chunks still to be acknowledged
+    BULK_DONE (2) - every chunk acknowledged
+    BULK_FAILED (3) - the source could not be read; repeating the DOWNLOAD carries on from the same place
+*/
+enum BulkState_e {BULK_IDLE = 0,
+                  BULK_SENDING = 1,
+                  BULK_DONE = 2,
+                  BULK_FAILED = 3};
+typedef enum BulkState_e BulkState;
+
+/* Name: BulkStats_s
+   Type: struct
+   Parameters:
+    BulkState state - of the current transfer
+    unsigned char transfer - its number, from the ground
+    unsigned int chunks - chunks in it
+    unsigned int base - first chunk not yet acknowledged
+    unsigned int sent - chunks queued, first time
+    unsigned int resent - chunks queued again
+    unsigned int acks - acknowledgements for it
+    unsigned int timeouts - times everything out was sent again for want of an acknowledgement
+*/
+struct BulkStats_s {
+  BulkState state;
+  unsigned char transfer;
+  unsigned int chunks;
+  unsigned int base;
+  unsigned int sent;
+  unsigned int resent;
+  unsigned int acks;
+  unsigned int timeouts;
+};
+typedef struct BulkStats_s BulkStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: bulkInit
+   Description:
+    Forgets any transfer.
+*/
+void bulkInit(void);
+
+/* Name: bulkStart
+   Parameters:
+    unsigned char transfer - number the ground gave it, echoed in every packet
+    unsigned char source - the ground's number for the source; with the range, tells a repeat from a new transfer
+    BulkReader reader - reads the source
+    unsigned long start - address of the first byte
+    unsigned long length - bytes, at most BULK_CHUNKS_MAX chunks
+    unsigned char window - chunks out at once, 1 (stop and wait) to BULK_WINDOW
+    unsigned long tick - now
+   Return value:
+    char - 1 if started, 2 if it is the transfer already in hand (carried on from where it was), 0 if the length or
+           window is out of range
+*/
+char bulkStart(unsigned char transfer, unsigned char source, BulkReader reader, unsigned long start,
+               unsigned long length, unsigned char window, unsigned long tick);
+
+/* Name: bulkAck
+   Parameters:
+    unsigned char transfer - as in bulkStart(); acknowledgements for any other transfer are ignored
+    unsigned int base - first chunk the ground is missing, it has every one before
+    unsigned long bitmap - bit n set if the ground has chunk base + n
+    unsigned long tick - now
+   Return value:
+    char - 1 if it was for the current transfer
+*/
+char bulkAck(unsigned char transfer, unsigned int base, unsigned long bitmap, unsigned long tick);
+
+/* Name: bulkStep
+   Parameters:
+    unsigned long tick - now
+   Description:
+    Queues the chunks in the window that are due, while TELEMETRY_BULK has room.  Call on every step the link is up.
+*/
+void bulkStep(unsigned long tick);
+
+/* Name: bulkGetStats
+   Return value:
+    const BulkStats* - the current transfer, read only
+*/
+const BulkStats* bulkGetStats(void);
+
+#endif
@@ -0,0 +1,131 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None (the table lives in information memory segment B, see flash.h)
+   Modifications:
+    None
+   Purpose:
+    Calibration of the raw sensor readings, applied once per sample by task_getIMUData before anything else uses them:
+
+      gyroscope       out = raw - bias
+      accelerometer   out = M (raw - bias)
+      magnetometer    out = M (raw - bias)    bias is the hard iron offset, M the soft iron correction
+
+    M is a 3x3 matrix of Q15 values with a left shift per sensor, so entries up to 2^shift can be held: an entry m stands
+    for m * 2^shift / 32768, and the identity is 16384 with a shift of 1.  Outputs keep the units of the raw readings
+    (counts) and saturate at the int range.
+
+    The parameters are fitted on the ground from recorded data (ground_software/calfit.c) and programmed into segment B
+    as the CALIB_IMAGE_BYTES image below, little endian, kept free of MSP430 headers so the ground tool can include it:
+
+      offset  size  field
+      0       2     magic, CALIB_MAGIC
+      2       6     gyroscope bias x, y, z
+      8       6     accelerometer bias
+      14      18    accelerometer matrix, row by row
+      32      6     magnetometer bias
+      38      18    magnetometer matrix
+      56      1     accelerometer shift
+      57      1     magnetometer shift
+      58      2     CRC-16/CCITT of bytes 0 to 57, see logCrc16()
+
+    Without a valid image every sensor gets the identity and calibInit() says so.
+*/
+
+#ifndef CALIB_H
+#define CALIB_H
+
+/* CONSTANTS */
+#define CALIB_MAGIC               0xCA1B
+#define CALIB_ADDR                0x1080 //FLASH_INFO_B
+#define CALIB_IMAGE_BYTES         60
+#define CALIB_Q15_ONE             32768L
+#define CALIB_MAX_SHIFT           14
+
+#define CALIB_IMG_MAGIC           0
+#define CALIB_IMG_GYRO_BIAS       2
+#define CALIB_IMG_ACCEL_BIAS      8
+#define CALIB_IMG_ACCEL_MATRIX    14
+#define CALIB_IMG_MAGNET_BIAS     32
+#define CALIB_IMG_MAGNET_MATRIX   38
+#define CALIB_IMG_ACCEL_SHIFT     56
+#define CALIB_IMG_MAGNET_SHIFT    57
+#define CALIB_IMG_CRC             58
+
+/* DATATYPES */
+
+/* Name: CalibSensor_e
+   Type: enum
+   Values:
+    CALIB_GYRO (0) - gyroscope, 6 bytes big endian (GYRO_XOUT_H first)
+    CALIB_ACCEL (1) - accelerometer, 6 bytes big endian (ACCEL_XOUT_H first)
+    CALIB_MAGNET (2) - magnetometer, 6 bytes little endian (HXL first)
+    CALIB_SENSORS (3) - number of sensors, not a sensor
+*/
+enum CalibSensor_e {CALIB_GYRO = 0,
+                    CALIB_ACCEL = 1,
+                    CALIB_MAGNET = 2,
+                    CALIB_SENSORS = 3};
+typedef enum CalibSensor_e CalibSensor;
+
+/* Name: CalibParams_s
+   Type: struct
+   Parameters:
+    int bias[3] - subtracted from the raw reading, counts
+    int matrix[3][3] - Q15 correction, row by row (the identity for the gyroscope)
+    unsigned char shift - left shift applied after the Q15 product, 0 to CALIB_MAX_SHIFT
+    char useMatrix - 0 skips the matrix
+   Purpose:
+    Correction of one sensor, decoded from the image.
+*/
+struct CalibParams_s {
+  int bias[3];
+  int matrix[3][3];
+  unsigned char shift;
+  char useMatrix;
+};
+typedef struct CalibParams_s CalibParams;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: calibInit
+   Return value:
+    char - 1 if the image in segment B is valid and in use, 0 if every sensor fell back to the identity
+*/
+char calibInit(void);
+
+/* Name: calibLoad
+   Parameters:
+    const unsigned char* image - CALIB_IMAGE_BYTES image
+   Return value:
+    char - 1 if the image is valid and now in use, 0 if it was rejected (the parameters in use do not change)
+*/
+char calibLoad(const unsigned char* image);
+
+/* Name: calibStore
+   Parameters:
+    const unsigned char* image - CALIB_IMAGE_BYTES image, from the ground
+   Return value:
+    char - 1 if the image was valid, is programmed into segment B and in use, 0 otherwise
+   Description:
+    Erases and programs segment B, so interrupts are off for about 15 ms.  A failed write leaves the old parameters in
+    use until the next reset, which then falls back to the identity.
+*/
+char calibStore(const unsigned char* image);
+
+/* Name: calibApply
+   Parameters:
+    CalibSensor sensor - which correction
+    const char* raw - 6 bytes as read from the sensor, byte order as in CalibSensor
+    int* out - x, y, z corrected
+   Description:
+    The per-sample correction, see the top of this file.  Call once per sample, at acquisition.
+*/
+void calibApply(CalibSensor sensor, const char* raw, int* out);
+
+/* Name: calibGetParams
+   Return value:
+    const CalibParams* - the parameters in use for sensor
+*/
+const CalibParams* calibGetParams(CalibSensor sensor);
+
+#endif
@@ -2,28 +2,113 @@
    Purpose: To define everything needed for clocking - both hardware and software
 */
 
-#include "salvo.h"
+#include "os.h"
 #include "msp430.h"
 
 #ifndef CLOCK_H
 #define CLOCK_H
 
+/* CONSTANTS */
+#define OS_TICK_HZ            100 //Rate at which the Timer A routine calls OSTimer(), all Salvo delays are in these ticks
+#define CLOCK_ACLK_HZ         32768UL //LFXT1 watch crystal
+#define CLOCK_TIMER_DIVIDER   8 //Timer A input divider (ID_3), keeps the tick period within 16 bits at 16 MHz
+
+/* DATATYPES */
+
+/* Name: ClockProfile_e
+   Type: enum
+   Values:
+    CLOCK_1MHZ (0) - DCO on its 1 MHz calibration, the reset default
+    CLOCK_8MHZ (1) - DCO on its 8 MHz calibration
+    CLOCK_16MHZ (2) - DCO on its 16 MHz calibration, needs the supply at 3.3 V
+   Purpose:
+    MCLK frequencies the clock manager can switch between.  SMCLK follows MCLK through the divider given to InitializeClock().
+*/
+enum ClockProfile_e {CLOCK_1MHZ = 0,
+                     CLOCK_8MHZ = 1,
+                     CLOCK_16MHZ = 2};
+typedef enum ClockProfile_e ClockProfile;
+
 /* FUNCTION PROTOTYPES */
 
 /* Name: InitializeClock
    Parameters:
-     char divider - value by which to divide the master clock into SMCLK
+     char divider - value by which to divide the master clock into SMCLK (1, 2, 4 or 8)
    Purpose: 
-     To initialize the master hardware clock.
+     To initialize the master hardware clock.  Starts on CLOCK_1MHZ and starts the Timer A tick, so OSTimer() runs from
+     here on (once interrupts are enabled).
 */
 void InitializeClock(char divider);
 
+/* Name: clockSetProfile
+   Parameters:
+     ClockProfile profile - new MCLK frequency
+   Return value:
+     char - 1 if the profile is in use, 0 if an I2C transfer or its stop was in progress and nothing was changed
+   Purpose:
+     Switches the DCO and rescales everything derived from SMCLK: the Timer A tick period, the I2C dividers and the radio's baud rate.  The part of
+     the tick in progress already gone is carried over to the new rate, so ticks and clockGetMicroseconds() run on
+     without a jump.  Call from a task, never with the SD card bus held.
+*/
+char clockSetProfile(ClockProfile profile);
+
+/* Name: clockGetProfile
+   Return value:
+     ClockProfile - profile in use
+*/
+ClockProfile clockGetProfile(void);
+
+/* Name: clockGetMclkHz, clockGetSmclkHz, clockGetAclkHz
+   Return value:
+     unsigned long - current frequency of the clock (Hz)
+*/
+unsigned long clockGetMclkHz(void);
+unsigned long clockGetSmclkHz(void);
+unsigned long clockGetAclkHz(void);
+
+/* Name: ConfigureTimerA
+   Purpose:
+     (Re)starts Timer A in up mode from SMCLK so its CCR0 interrupt fires OS_TICK_HZ times per second.
+*/
+void ConfigureTimerA(void);
+
 /* Name: clockTick
    Purpose:
      Ticks the software clock once - to occur on interrupt
 */
 void clockTick();
 
+/* Name: clockTimerService
+   Purpose:
+     Body of the Timer A interrupt: ticks Salvo and the software clock.
+*/
+void clockTimerService(void);
+
+/* Name: clockGetTicks
+   Return value:
+     unsigned long - OS_TICK_HZ ticks since boot
+   Purpose:
+     Timestamps for logged data.  Salvo's own tick count is not built into the library we link.
+*/
+unsigned long clockGetTicks(void);
+
+/* Name: clockSetTicks
+   Parameters:
+     unsigned long now - new tick count
+   Purpose:
+     Carries the tick count on through a warm restart (watchdog.h).  Call with interrupts off, before anything has
+     taken a timestamp.
+*/
+void clockSetTicks(unsigned long now);
+
+/* Name: clockGetMicroseconds
+   Return value:
+     unsigned long - microseconds since boot, wraps after about 71 minutes
+   Purpose:
+     Finer timestamps than clockGetTicks(), from the Timer A count within the current tick (8 us steps at 1 MHz).  For
+     measuring intervals, take differences.  Also right with interrupts off, as long as they have not been off for
+     half a tick or more.
+*/
+unsigned long clockGetMicroseconds(void);
 
-int counter;
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,180 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Commands from the ground.  Frames are parsed where they lie in the radio's receive ring (radio.h): nothing is copied
+    out, the handler reads its arguments from the ring through commandArg8() and commandArg16().  The opcode indexes the
+    dispatch table directly, so finding the handler and checking the argument length take the same time for every
+    command.  The table and the opcodes are both generated from COMMAND_LIST below, so they cannot get out of step.
+
+    Frame: sync (2), argument length (1), opcode (1), sequence (1), arguments, CRC-16 over all before it (2, little
+    endian, logCrc16()).  Every frame that passes its CRC is answered with a TELEMETRY_REPLY packet (telemetry.h):
+    opcode, sequence, COMMAND_* status (BULK_ACK excepted, the chunks that follow it are its answer).  Bytes that are
+    not the start of a frame, and frames that fail their CRC, are skipped one byte at a time, so the parser finds the
+    next frame however the ring was corrupted.  A frame that stops arriving part way is given up after
+    COMMAND_STALL_TICKS.  downlinkStep() only parses while the reply queue has room, so the ground station should wait
+    for a reply (or give up on it) before sending much more.
+
+    Kept free of MSP430 headers so ground_software/cmdcheck.c can fuzz it; the handlers are in downlink.c (cmdcheck.c
+    has its own).
+*/
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+/* CONSTANTS */
+#define COMMAND_SYNC_0            0x47 //"GS"
+#define COMMAND_SYNC_1            0x53
+#define COMMAND_HEADER            5
+#define COMMAND_OVERHEAD          (COMMAND_HEADER + 2)
+#define COMMAND_ARGS_MAX          16
+#define COMMAND_FRAME_MAX         (COMMAND_ARGS_MAX + COMMAND_OVERHEAD) //Less than the receive ring
+#define COMMAND_STALL_TICKS       50 //A whole frame takes 25 ms at 9600 baud
+#define COMMAND_REPLY_BYTES       3
+
+//Statuses, in the reply
+#define COMMAND_OK                0
+#define COMMAND_BAD_OPCODE        1
+#define COMMAND_BAD_LENGTH        2
+#define COMMAND_BAD_ARGUMENT      3
+#define COMMAND_FAILED            4 //Arguments fine, but it could not be done now
+#define COMMAND_NO_REPLY          0xFF //From a handler: done, and not worth a reply (never sent)
+
+/* Name: COMMAND_LIST
+   Parameters (of each entry):
+    name - opcode is COMMAND_<name>, numbered from 0 in list order
+    handler - function that carries it out, see CommandHandler
+    minArgs, maxArgs - argument bytes it takes
+   Purpose:
+    The commands.  Arguments are little endian:
+     SET_RATE: sensor (SamplerSensor), releases between polls (1 each), see samplerSetReleases()
+     SET_MODE: mode (COMMAND_MODE_*), value (2)
+     DUMP_HEALTH: none, queues a health packet now
+     DOWNLOAD: source (COMMAND_DOWNLOAD_*), then whatever that source takes
+     BULK_ACK: transfer, first chunk missing (2), bitmap (4), see bulkAck() in bulk.h
+     SET_CONFIG: key (ConfigKey, config.h), value (2); applied as SET_RATE or SET_MODE would, and kept through resets
+    SET_RATE and SET_MODE last until the next reset.
+*/
+#define COMMAND_LIST(X) \
+  X(SET_RATE, commandSetRate, 2, 2) \
+  X(SET_MODE, commandSetMode, 3, 3) \
+  X(DUMP_HEALTH, commandDumpHealth, 0, 0) \
+  X(DOWNLOAD, commandDownload, 1, COMMAND_ARGS_MAX) \
+  X(BULK_ACK, commandBulkAck, 7, 7) \
+  X(SET_CONFIG, commandSetConfig, 3, 3)
+
+#define COMMAND_MODE_CLOCK        0 //value: ClockProfile (clock.h)
+#define COMMAND_MODE_DOWNLINK     1 //value: 0 to keep the transmitter off, 1 to send while in contact
+#define COMMAND_MODE_FEC          2 //value: 0 to send telemetry frames as they are, 1 to code them (fec.h)
+
+#define COMMAND_DOWNLOAD_SNAPSHOT 0 //Freeze a snapshot now (SNAPSHOT_CAUSE_COMMAND), it follows the others down
+//Bulk downloads (bulk.h) take transfer, window (1 each), start address, length (4 each) after the source
+#define COMMAND_DOWNLOAD_SAMPLES  1 //Sample history: gyroscope, accelerometer, magnetometer buffers (data.h) end to end
+#define COMMAND_DOWNLOAD_LOG      2 //Flight log: address is LOG_BLOCK_SIZE * block offset + byte (recorderReadLog())
+#define COMMAND_DOWNLOAD_BULK_ARGS 11
+
+/* DATATYPES */
+
+#define COMMAND_OPCODE(name, handler, minArgs, maxArgs) COMMAND_##name,
+enum CommandOpcode_e {COMMAND_LIST(COMMAND_OPCODE)
+                      COMMAND_OPCODES};
+typedef enum CommandOpcode_e CommandOpcode;
+
+/* Name: CommandArgs_s
+   Type: struct
+   Parameters:
+    const unsigned char* ring - receive ring holding the frame
+    unsigned char mask - ring length less one (a power of two)
+    unsigned char start - ring index of the first argument byte
+    unsigned char length - argument bytes
+    unsigned char opcode, sequence - from the frame header
+    unsigned long tick - now
+   Purpose:
+    A handler's view of its frame, in place.
+*/
+struct CommandArgs_s {
+  const unsigned char* ring;
+  unsigned char mask;
+  unsigned char start;
+  unsigned char length;
+  unsigned char opcode;
+  unsigned char sequence;
+  unsigned long tick;
+};
+typedef struct CommandArgs_s CommandArgs;
+
+/* Name: CommandHandler
+   Parameters:
+    const CommandArgs* args - the frame, with a length the table allows
+   Return value:
+    unsigned char - COMMAND_* status for the reply, or COMMAND_NO_REPLY
+*/
+typedef unsigned char (*CommandHandler)(const CommandArgs* args);
+
+/* Name: CommandStats_s
+   Type: struct
+   Parameters:
+    unsigned int frames - frames that passed their CRC
+    unsigned int executed - of those, handled with COMMAND_OK or COMMAND_NO_REPLY
+    unsigned int rejected - of those, answered with any other status
+    unsigned int crcErrors - frames that failed their CRC
+    unsigned int stalls - frames given up part way
+    unsigned long skipped - bytes skipped looking for a frame
+*/
+struct CommandStats_s {
+  unsigned int frames;
+  unsigned int executed;
+  unsigned int rejected;
+  unsigned int crcErrors;
+  unsigned int stalls;
+  unsigned long skipped;
+};
+typedef struct CommandStats_s CommandStats;
+
+/* FUNCTION PROTOTYPES */
+
+#define COMMAND_HANDLER(name, handler, minArgs, maxArgs) unsigned char handler(const CommandArgs* args);
+COMMAND_LIST(COMMAND_HANDLER)
+
+/* Name: commandParse
+   Parameters:
+    const unsigned char* ring - receive ring
+    unsigned char mask - ring length less one (a power of two)
+    unsigned char head - ring index of the oldest byte
+    unsigned char available - bytes from head on
+    unsigned long tick - now
+   Return value:
+    unsigned char - bytes the caller may drop from the ring, 0 to wait for more
+   Description:
+    Looks at the bytes from head.  Skips a byte that cannot start a frame; runs a complete frame that passes its CRC
+    and queues the reply.  Call again, after dropping the bytes, until it returns 0.
+*/
+unsigned char commandParse(const unsigned char* ring, unsigned char mask, unsigned char head, unsigned char available,
+                           unsigned long tick);
+
+/* Name: commandArg8, commandArg16, commandArg32
+   Parameters:
+    const CommandArgs* args - handler's view
+    unsigned char offset - of the argument, from the first argument byte
+   Return value:
+    the argument (little endian)
+*/
+unsigned char commandArg8(const CommandArgs* args, unsigned char offset);
+unsigned int commandArg16(const CommandArgs* args, unsigned char offset);
+unsigned long commandArg32(const CommandArgs* args, unsigned char offset);
+
+/* Name: commandReset
+   Description:
+    Clears the statistics and any frame in progress.
+*/
+void commandReset(void);
+
+/* Name: commandGetStats
+   Return value:
+    const CommandStats* - counters since commandReset(), read only
+*/
+const CommandStats* commandGetStats(void);
+
+#endif
@@ -0,0 +1,127 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None (the store lives in information memory segments D and C, see flash.h)
+   Modifications:
+    None
+   Purpose:
+    Settings changed from the ground that are kept through a reset: sample rates, the sensor bus rate, the clock
+    profile and the downlink modes.  Each module reads its own at init with configGet(), giving its compile time
+    constant as the value to use when none is stored; SET_CONFIG (command.h) applies a setting and stores it.
+
+    The store is a log in one of segments D and C (the active one), the other kept spare:
+
+      offset  size  field
+      0       4     header: CONFIG_HEADER_KEY, generation (2), check
+      4       4     record: key (ConfigKey), value (2, little endian), check
+      ...           CONFIG_RECORDS records, erased (0xFF) from the first free one on
+
+    check is the low byte of logCrc16() of the three bytes before it, never 0xFF, and is programmed after them, so a
+    write cut short by a reset leaves a record that fails its check and is skipped.  configSet() appends a record; the
+    newest record of a key is its value.  When the active segment is full, the spare is erased, the value of every key
+    stored is copied to it, and its header is programmed last with the next generation: until then the old segment
+    stays the active one, so an update is in either the old log or the new one, never lost part way.  The two segments
+    take turns, so they wear alike, and a segment is erased once every CONFIG_RECORDS - CONFIG_KEYS updates at most
+    (CONFIG_RECORDS every one for a store that rewrote a segment per update): at the flash's 10000 cycles that is over
+    100000 updates.
+
+    configInit() reads the active segment once at boot into a RAM index of the newest value of each key, so
+    configGet() is an array lookup.
+
+    Kept free of MSP430 headers so ground_software/configsim.c can run it against a model of the flash; flash access is
+    through flash.h only (flashRead() included).  An erase holds the CPU with interrupts off for about 15 ms.
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/* CONSTANTS */
+#define CONFIG_SEGMENT_0          0x1000 //FLASH_INFO_D
+#define CONFIG_SEGMENT_1          0x1040 //FLASH_INFO_C
+#define CONFIG_SEGMENT_BYTES      64 //FLASH_INFO_SEGMENT_BYTES
+#define CONFIG_RECORD_BYTES       4
+#define CONFIG_RECORDS            (CONFIG_SEGMENT_BYTES / CONFIG_RECORD_BYTES - 1) //Less the header
+#define CONFIG_HEADER_KEY         0xC5 //Key byte of a header, no key is this large
+#define CONFIG_ERASED             0xFF
+
+/* DATATYPES */
+
+/* Name: ConfigKey_e
+   Type: enum
+   Values:
+    CONFIG_GYRO_RELEASES (0) - releases between gyroscope polls (samplerSetReleases()), in SamplerSensor order
+    CONFIG_ACCEL_RELEASES (1) - releases between accelerometer polls
+    CONFIG_MAGNET_RELEASES (2) - releases between magnetometer polls
+    CONFIG_IMU_BUS_KHZ (3) - SECONDARY I2C rate in kHz, from the next samplerInit()
+    CONFIG_CLOCK (4) - ClockProfile, in COMMAND_MODE_* order from here on
+    CONFIG_DOWNLINK (5) - as COMMAND_MODE_DOWNLINK
+    CONFIG_FEC (6) - as COMMAND_MODE_FEC
+    CONFIG_KEYS (7) - number of keys, not a key
+*/
+enum ConfigKey_e {CONFIG_GYRO_RELEASES = 0,
+                  CONFIG_ACCEL_RELEASES = 1,
+                  CONFIG_MAGNET_RELEASES = 2,
+                  CONFIG_IMU_BUS_KHZ = 3,
+                  CONFIG_CLOCK = 4,
+                  CONFIG_DOWNLINK = 5,
+                  CONFIG_FEC = 6,
+                  CONFIG_KEYS = 7};
+typedef enum ConfigKey_e ConfigKey;
+
+/* Name: ConfigStats_s
+   Type: struct
+   Parameters:
+    unsigned int generation - of the active segment, one more each time the store moves (0: no store yet)
+    unsigned char records - records used in the active segment
+    unsigned char skipped - records found at boot that failed their check (writes cut short by a reset)
+    unsigned int writes - records appended since boot
+    unsigned int erases - segments erased since boot
+    unsigned int failures - writes and erases that did not read back, since boot
+*/
+struct ConfigStats_s {
+  unsigned int generation;
+  unsigned char records;
+  unsigned char skipped;
+  unsigned int writes;
+  unsigned int erases;
+  unsigned int failures;
+};
+typedef struct ConfigStats_s ConfigStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: configInit
+   Return value:
+    char - 1 if a store was found, 0 if there is none yet (every key reads its default)
+   Description:
+    Finds the active segment and builds the index from it.  Call from main() before anything reads a setting.
+*/
+char configInit(void);
+
+/* Name: configGet
+   Parameters:
+    ConfigKey key - setting wanted
+    unsigned int fallback - value to use if none is stored
+   Return value:
+    unsigned int - stored value of the key, or fallback
+*/
+unsigned int configGet(ConfigKey key, unsigned int fallback);
+
+/* Name: configSet
+   Parameters:
+    ConfigKey key - setting to keep
+    unsigned int value - its new value, checked by the caller
+   Return value:
+    char - 1 if the value is stored (or was already), 0 if the flash failed and the stored value did not change
+   Description:
+    Appends a record, or moves the store to the spare segment first if the active one is full.  Interrupts are off for
+    the write (about 0.5 ms), and for about 15 ms more when it erases.
+*/
+char configSet(ConfigKey key, unsigned int value);
+
+/* Name: configGetStats
+   Return value:
+    const ConfigStats* - state of the store, read only
+*/
+const ConfigStats* configGetStats(void);
+
+#endif
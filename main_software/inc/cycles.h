@@ -0,0 +1,35 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Timer B, counting SMCLK.  Counts are CPU cycles as long as SMCLK is MCLK undivided (true after reset).
+   Modifications:
+    TBCTL
+   Purpose:
+    Cycle counter for timing short code paths (up to 65535 cycles per measurement).  Used by the benchmark build.
+*/
+
+#ifndef CYCLES_H
+#define CYCLES_H
+
+#include "msp430.h"
+
+/* MACROS */
+#define CYCLES_NOW            TBR //Free running, wraps at 65536
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: cyclesInit
+   Description:
+    Starts Timer B in continuous mode from SMCLK and measures the cost of an empty measurement, which cyclesSince()
+    subtracts.
+*/
+void cyclesInit(void);
+
+/* Name: cyclesSince
+   Parameters:
+    unsigned int start - CYCLES_NOW taken at the start of the measurement
+   Return value:
+    unsigned int - cycles spent since start, not counting the measurement itself
+*/
+unsigned int cyclesSince(unsigned int start);
+
+#endif
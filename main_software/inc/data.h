@@ -6,34 +6,43 @@
 #define DATA_H
 
 /* CONSTANTS */
-#define X_AXIS_H 0
-#define X_AXIS_L 1
-#define Y_AXIS_H 2
-#define Y_AXIS_L 3
-#define Z_AXIS_H 4
-#define Z_AXIS_L 5
+#define X_AXIS 0
+#define Y_AXIS 1
+#define Z_AXIS 2
+#define DATA_AXES 3
 
 #define IMU_DATA_RESP_LEN 6
 #define IMU_DATA_MSG_LEN 1
+#define DATA_BUFFER_LEN 100
+#define DATA_SAMPLE_BUFFER_BYTES (DATA_AXES * DATA_BUFFER_LEN * sizeof(int)) //One sensor, see arena.h
 
 /* VARIABLES */
-int gyroscopeBuffer[6][100]; //First dimension for three axes, use predefined "X_AXIS", etc.
-int magnetometerBuffer[6][100];
-int bufferIndex;
+extern int (*gyroscopeBuffer)[DATA_BUFFER_LEN]; //First index for three axes, use predefined "X_AXIS", etc.  Set up by dataInit()
+extern int (*accelerometerBuffer)[DATA_BUFFER_LEN];
+extern int (*magnetometerBuffer)[DATA_BUFFER_LEN]; //Calibrated, see calib.h
+extern int bufferIndex;
 
 /* DATATYPES */
 
 /* Name: RadioHealth
    Type: struct
    Parameters:
-     TBD
+     unsigned long txBytes - bytes handed to the UART
+     unsigned long rxBytes - bytes received
+     unsigned int txFrames - frames queued by radioSend()
+     unsigned int txRefused - frames radioSend() had no room for
+     unsigned int rxOverruns - bytes lost because the receive ring was full
    Purpose:
-     To keep track of the current health of RFM radio.
+     To keep track of the current health of the radio link (radio.h).
 */
 struct RadioHealth_s {
-  //things
+  unsigned long txBytes;
+  unsigned long rxBytes;
+  unsigned int txFrames;
+  unsigned int txRefused;
+  unsigned int rxOverruns;
 };
-typedef RadioHealth struct RadioHealth_s;
+typedef struct RadioHealth_s RadioHealth;
 
 /* Name: IMUHealth
    Type: struct
@@ -45,4 +54,25 @@ typedef RadioHealth struct RadioHealth_s;
 struct IMUHealth_s {
   //things
 };
-typedef IMUHealth struct IMUHealth_s;
\ No newline at end of file
+typedef struct IMUHealth_s IMUHealth;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: dataInit
+   Purpose:
+     Takes the sample buffers, the event snapshots (snapshot.h) and the telemetry queue (telemetry.h) from the arena.  Call from main() before the scheduler
+     starts, after watchdogInit(): the sample history is kept through a warm restart (watchdog.h), and cleared otherwise.
+*/
+void dataInit(void);
+
+/* Name: dataStoreSample
+   Parameters:
+     const int* gyro - calibrated gyroscope x, y, z
+     const int* accel - calibrated accelerometer x, y, z
+     const int* magnet - calibrated magnetometer x, y, z
+   Purpose:
+     Advances bufferIndex (wrapping at DATA_BUFFER_LEN) and stores one sample of all three sensors there.
+*/
+void dataStoreSample(const int* gyro, const int* accel, const int* magnet);
+
+#endif
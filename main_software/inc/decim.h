@@ -0,0 +1,72 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Hardware multiplier (through the compiler's long multiplies)
+   Modifications:
+    None
+   Purpose:
+    Anti-alias filtering and decimation of the gyroscope and accelerometer, between calibration and the sample history.
+    The IMU converts at SAMPLER_IMU_HZ, DECIM_RATIO times the rate the history, the log and the radio get, so the extra
+    samples lower the noise instead of costing buffer space or bandwidth.
+
+    The filter is a Q15 low-pass FIR of DECIM_TAPS = DECIM_RATIO * DECIM_PHASE_TAPS taps, cut off just under half the
+    output rate, computed in polyphase form: no history of inputs is kept, instead each input is multiplied into the partial
+    sums of the DECIM_PHASE_TAPS outputs it belongs to, and an output is complete after every DECIM_RATIO inputs.  That is
+    DECIM_PHASE_TAPS multiply-adds per axis and input, and DECIM_PHASE_TAPS longs per axis of RAM.  The taps sum to
+    exactly 32768, so a constant input comes through unchanged.
+
+    The taps for each ratio come from ground_software/decimcheck.c ("decimcheck design <ratio>"), which also checks the
+    frequency response and runs this file on test signals ("decimcheck check").  A ratio of 1 passes samples straight
+    through.
+*/
+
+#ifndef DECIM_H
+#define DECIM_H
+
+/* CONSTANTS */
+#ifndef DECIM_RATIO
+#define DECIM_RATIO               2 //Inputs per output: 1, 2, 5 or 10, see decimCoefficients in decim.c
+#endif
+#define DECIM_PHASE_TAPS          4 //Taps per polyphase branch, a power of two
+#define DECIM_TAPS                (DECIM_RATIO * DECIM_PHASE_TAPS)
+#define DECIM_AXES                3
+
+/* DATATYPES */
+
+/* Name: Decimator_s
+   Type: struct
+   Parameters:
+    long sum[DECIM_PHASE_TAPS][DECIM_AXES] - partial sums of the next DECIM_PHASE_TAPS outputs (Q15)
+    unsigned char phase - inputs taken towards the current output, 0 to DECIM_RATIO - 1
+    unsigned char head - sum holding the current output
+   Purpose:
+    Filter state of one three axis sensor.
+*/
+struct Decimator_s {
+  long sum[DECIM_PHASE_TAPS][DECIM_AXES];
+  unsigned char phase;
+  unsigned char head;
+};
+typedef struct Decimator_s Decimator;
+
+/* VARIABLES */
+extern const int decimCoefficients[DECIM_TAPS]; //Q15, for the ground check
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: decimInit
+   Parameters:
+    Decimator* decimator - state to clear
+*/
+void decimInit(Decimator* decimator);
+
+/* Name: decimPush
+   Parameters:
+    Decimator* decimator - filter of the sensor
+    const int* in - x, y, z at the input rate
+    int* out - x, y, z at the output rate, written only when an output is complete
+   Return value:
+    char - 1 if out holds a new output, 0 if more inputs are needed
+*/
+char decimPush(Decimator* decimator, const int* in, int* out);
+
+#endif
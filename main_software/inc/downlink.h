@@ -0,0 +1,79 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Radio link (see radio.h)
+   Modifications:
+    None beyond those made by the radio driver
+   Purpose:
+    Everything task_sendData does, split into short steps like antenna.h and recorder.h.  Each step runs the commands
+    that have come in from the ground (command.h, the handlers are here), fills the telemetry queue (telemetry.h) and,
+    while the ground is in contact, hands the radio as many frames as it can take:
+
+      - a health packet every DOWNLINK_HEALTH_TICKS (antenna, IMU task, snapshots, radio, queue losses); in PROFILE
+        builds the profile of one task (profile.h) goes with each, the tasks in turn
+      - an IMU frame every DOWNLINK_IMU_TICKS, the latest sample in the history; in contact also on every step the
+        last one has gone out, so whatever the link has left after the other classes is filled with fresh samples
+      - the frozen snapshots, DOWNLINK_SNAPSHOT_SAMPLES samples per packet, as fast as their queue has room; a snapshot
+        is released as soon as its last packet is queued
+      - while in contact, the chunks of a bulk download (bulk.h) of the sample history or the flight log; the spare
+        IMU frames above stop until it is done
+
+    Frames are only pulled from the queue when the radio's transmit ring has room for them, so the choice of what goes
+    next is made as late as possible and the ring never holds more than a pass's worth.  With SET_MODE COMMAND_MODE_FEC
+    on, each frame is coded on its way to the radio (fec.h), and pulled for the room less what the coding adds.  The
+    ground is taken to be in contact while it has sent a command that passed its CRC in the last DOWNLINK_CONTACT_TICKS
+    (DUMP_HEALTH will do); out of contact, or with the transmitter turned off by SET_MODE, the queue keeps filling under
+    its drop and age policies.
+
+    Payloads, little endian:
+     health: tick (4), antenna state, attempts, faults (1 each), IMU overruns, skipped (2 each), snapshot triggers,
+             dropped (2 each), radio rxOverruns, txRefused (2 each), commands executed, rejected, crcErrors (2 each),
+             bulk transfer, state (1 each), first chunk not acknowledged (2), warm restarts, watchdog resets (2
+             each), task late before the last reset (1, see watchdog.h), then for each class dropped + aged (2 each)
+     profile: PROFILE_PACKED_BYTES in the health class, see profilePack()
+     IMU: tick (4), gyroscope, accelerometer, magnetometer x, y, z (2 each), calibrated
+     snapshot: sequence (2), triggerTick (4), cause, pre, first sample, samples (1 each), then the samples, gyroscope
+               x, y, z and accelerometer x, y, z (2 each)
+*/
+
+#ifndef DOWNLINK_H
+#define DOWNLINK_H
+
+#include "telemetry.h"
+#include "clock.h"
+
+/* CONSTANTS */
+#define DOWNLINK_PASS_TICKS         (OS_TICK_HZ / 10) //Between steps; the transmit ring holds about this much link time
+#define DOWNLINK_HEALTH_TICKS       (5 * OS_TICK_HZ)
+#define DOWNLINK_IMU_TICKS          OS_TICK_HZ
+#define DOWNLINK_CONTACT_TICKS      (30 * OS_TICK_HZ) //Silence from the ground that ends a contact
+#define DOWNLINK_SNAPSHOT_SAMPLES   3 //Per packet
+
+#define DOWNLINK_HEALTH_BYTES       (34 + 2 * TELEMETRY_CLASSES)
+#define DOWNLINK_IMU_BYTES          22
+#define DOWNLINK_SNAPSHOT_HEADER    10
+#define DOWNLINK_SNAPSHOT_BYTES     (DOWNLINK_SNAPSHOT_HEADER + 12 * DOWNLINK_SNAPSHOT_SAMPLES)
+#define DOWNLINK_SAMPLE_SOURCE_BYTES (3UL * DATA_SAMPLE_BUFFER_BYTES) //COMMAND_DOWNLOAD_SAMPLES
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: downlinkInit
+   Description:
+    Starts the radio and the producers.  The queue itself is set up by dataInit().
+*/
+void downlinkInit(void);
+
+/* Name: downlinkStep
+   Return value:
+    unsigned char - number of Salvo ticks to wait before calling again
+   Description:
+    Runs the producers that are due and sends what the radio has room for.  Never waits.
+*/
+unsigned char downlinkStep(void);
+
+/* Name: downlinkInContact
+   Return value:
+    char - 1 while the ground is in contact
+*/
+char downlinkInContact(void);
+
+#endif
@@ -0,0 +1,117 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    MPU-9250 INT pin on DRDY_PIN of Port 2, SECONDARY I2C interface
+   Modifications:
+    P2DIR, P2SEL, P2IES, P2IE (DRDY_PIN only)
+   Purpose:
+    Interrupt driven acquisition of the gyroscope and accelerometer.  The MPU-9250 pulses INT (active high, 50 us, its
+    reset default) when a new sample is ready; the Port 2 interrupt starts the burst read of ACCEL_XOUT_H to GYRO_ZOUT_L
+    on the spot with i2cStartMessage(), and the I2C interrupt routines put the sample into a small ring for
+    task_getIMUData.  If the bus is in use at the edge (a magnetometer poll), the read is started from the I2C idle hook
+    the moment that transfer ends, so the time from sample ready to sample in the ring is one transfer at most plus one
+    burst read.
+
+    Each sample carries the time of its edge, and the latency from edge to ring is kept as a histogram.  In I2C_REPLAY
+    builds the INT line is simulated (see replay.h) and the edge time is the simulated conversion time.
+    ground_software/drdysim.c runs this module on the host's model of the MCU, with the INT line and the bus modelled,
+    and prints drdyReport().
+*/
+
+#ifndef DRDY_H
+#define DRDY_H
+
+#include "msp430.h"
+
+/* CONSTANTS */
+#define DRDY_PIN                BIT0 //P2.0, MPU-9250 INT
+#define DRDY_RING_LEN           8 //Samples waiting for task_getIMUData, a power of two; four releases at 200 Hz
+#define DRDY_READ_LEN           14 //ACCEL_XOUT_H to GYRO_ZOUT_L: accel, temperature, gyro
+#define DRDY_ACCEL              0 //Offsets into DrdySample.raw
+#define DRDY_GYRO               8
+#define DRDY_LATENCY_BUCKETS    8
+#define DRDY_LATENCY_BUCKET_US  100 //Histogram step, the last bucket holds everything above
+
+/* DATATYPES */
+
+/* Name: DrdySample_s
+   Type: struct
+   Parameters:
+    char raw[DRDY_READ_LEN] - registers as read, big endian, see DRDY_ACCEL and DRDY_GYRO
+    unsigned long edgeUs - clockGetMicroseconds() at the INT edge
+   Purpose:
+    One sample of the gyroscope and accelerometer.
+*/
+struct DrdySample_s {
+  char raw[DRDY_READ_LEN];
+  unsigned long edgeUs;
+};
+typedef struct DrdySample_s DrdySample;
+
+/* Name: DrdyStats_s
+   Type: struct
+   Parameters:
+    unsigned long edges - INT edges seen
+    unsigned long samples - samples put in the ring
+    unsigned int missed - samples overwritten: edges that came while the previous read was still waiting or in progress
+    unsigned int overruns - edges dropped because the ring was full
+    unsigned int deferred - read starts refused because the bus was in use, each retried
+    unsigned int errors - reads that failed on the bus
+    unsigned int latencyMax - longest edge to ring time (us)
+    unsigned int latency[DRDY_LATENCY_BUCKETS] - edge to ring times, DRDY_LATENCY_BUCKET_US per bucket
+   Purpose:
+    Acquisition statistics since drdyInit().
+*/
+struct DrdyStats_s {
+  unsigned long edges;
+  unsigned long samples;
+  unsigned int missed;
+  unsigned int overruns;
+  unsigned int deferred;
+  unsigned int errors;
+  unsigned int latencyMax;
+  unsigned int latency[DRDY_LATENCY_BUCKETS];
+};
+typedef struct DrdyStats_s DrdyStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: drdyInit
+   Return value:
+    char - 1 on success, 0 if the message did not fit in the arena
+   Description:
+    Takes an I2C message from the arena, hooks the SECONDARY interface and enables the INT pin interrupt.  Call after
+    samplerInit(), which sets the IMU's sample rate and enables its data-ready interrupt.
+*/
+char drdyInit(void);
+
+/* Name: drdyEdge
+   Parameters:
+    unsigned long edgeUs - time of the edge
+   Description:
+    Called with interrupts off on every INT edge, by the Port 2 interrupt or by the simulated INT line.
+*/
+void drdyEdge(unsigned long edgeUs);
+
+/* Name: drdyNext, drdyRelease
+   Return value:
+    const DrdySample* - oldest sample in the ring, 0 if it is empty
+   Description:
+    The task reads samples with drdyNext() and hands each back with drdyRelease() when done with it.  drdyNext() also
+    starts a read the idle hook was refused, which happens while the stop of the message before it is still going out.
+*/
+const DrdySample* drdyNext(void);
+void drdyRelease(void);
+
+/* Name: drdyGetStats
+   Return value:
+    const DrdyStats* - statistics, read only
+*/
+const DrdyStats* drdyGetStats(void);
+
+/* Name: drdyReport
+   Description:
+    Prints the statistics and latency histogram through the debug I/O.
+*/
+void drdyReport(void);
+
+#endif
@@ -0,0 +1,54 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Forward error correction for downlink frames, so a few bit errors cost a few bytes of parity instead of a whole
+    frame sent again.  When it is turned on (SET_MODE, COMMAND_MODE_FEC) downlink.c passes every telemetry frame through
+    fecEncode() on its way to the radio.
+
+    Coded frame: sync (2, FEC_SYNC_*), payload length (2, one extended Hamming (8,4) codeword per nibble), the telemetry
+    frame from its length byte on (length, class, sequence, payload, CRC, see telemetry.h), then FEC_PARITY bytes of
+    Reed-Solomon parity over that.  The code is RS(255, 247) over GF(256) (polynomial 0x11D, generator roots alpha^0 to
+    alpha^7), shortened to the frame: any FEC_PARITY / 2 bytes in error are corrected, however many bits in each.  The
+    coded length tells the ground where the parity is before it has corrected anything; each nibble survives one bit
+    error.  The sync is not protected, the ground looks for it allowing for a few bit errors and lets the parity and
+    the frame's own CRC decide.
+
+    Encoding is table driven: one log lookup per byte, then FEC_PARITY antilog lookups and exclusive ors.  Decoding is
+    only done on the ground (ground_software/fecsim.c, which also measures goodput at simulated bit error rates), which
+    shares the tables below.  Kept free of MSP430 headers for that.
+*/
+
+#ifndef FEC_H
+#define FEC_H
+
+#include "telemetry.h"
+
+/* CONSTANTS */
+#define FEC_SYNC_0            0x50 //"PF"
+#define FEC_SYNC_1            0x46
+#define FEC_PARITY            8 //Reed-Solomon parity bytes, corrects half as many
+#define FEC_LENGTH_BYTES      2
+#define FEC_OVERHEAD          (FEC_LENGTH_BYTES + FEC_PARITY) //Over the telemetry frame
+#define FEC_FRAME_MAX         (TELEMETRY_FRAME_MAX + FEC_OVERHEAD)
+
+/* GLOBALS */
+extern const unsigned char fecExp[510]; //alpha^n for n up to 509, so exponents can be added without a modulo
+extern const unsigned char fecLog[256]; //n for alpha^n, entry 0 unused
+extern const unsigned char fecGenerator[FEC_PARITY]; //Logs of the generator's coefficients, x^7 first
+extern const unsigned char fecHamming[16]; //Codeword of each nibble
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: fecEncode
+   Parameters:
+    unsigned char* frame - a telemetry frame, in a buffer of FEC_FRAME_MAX bytes; rewritten as a coded frame in place
+    unsigned char length - bytes of the telemetry frame
+   Return value:
+    unsigned char - bytes of the coded frame, length + FEC_OVERHEAD
+*/
+unsigned char fecEncode(unsigned char* frame, unsigned char length);
+
+#endif
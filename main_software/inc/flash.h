@@ -0,0 +1,57 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Flash controller
+   Modifications:
+    FCTL1, FCTL2, FCTL3
+   Purpose:
+    Erases and programs the information memory (segments B to D, FLASH_INFO_* below): segment B holds the sensor
+    calibration (calib.h), D and C the configuration store (config.h).  Segment A holds the DCO calibration and is
+    never touched.  Code runs from flash, so the CPU is held while the controller is busy; interrupts
+    are off for the duration of each call (an erase takes about 15 ms).
+*/
+
+#ifndef FLASH_H
+#define FLASH_H
+
+/* CONSTANTS */
+#define FLASH_INFO_SEGMENT_BYTES  64
+#define FLASH_INFO_D              0x1000
+#define FLASH_INFO_C              0x1040
+#define FLASH_INFO_B              0x1080
+#define FLASH_INFO_A              0x10C0 //DCO calibration, locked
+#define FLASH_TIMING_HZ           350000UL //Flash timing generator, 257 to 476 kHz allowed
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: flashEraseSegment
+   Parameters:
+    unsigned int address - any address in segment B, C or D
+   Return value:
+    char - 1 if the segment now reads as all 0xFF, 0 if the address is outside B to D or the erase failed
+*/
+char flashEraseSegment(unsigned int address);
+
+/* Name: flashRead
+   Parameters:
+    unsigned int address - first byte to read, in segment B, C or D
+    unsigned char* data - where to put them
+    unsigned int length - number of bytes
+   Description:
+    Copies bytes out of the information memory.  The flash is mapped, so code may read it directly; modules that are
+    also built on the host (config.c, calib.c) read through here instead, so a model of the flash can stand in.
+*/
+void flashRead(unsigned int address, unsigned char* data, unsigned int length);
+
+/* Name: flashWrite
+   Parameters:
+    unsigned int address - first byte to program, in segment B, C or D
+    const unsigned char* data - bytes to program
+    unsigned int length - number of bytes, must not run past the end of segment B
+   Return value:
+    char - 1 if the bytes read back as written, 0 otherwise
+   Description:
+    Programs bytes into an erased segment.  Bits only go from 1 to 0, so erase first unless the bytes are still 0xFF.
+*/
+char flashWrite(unsigned int address, const unsigned char* data, unsigned int length);
+
+#endif
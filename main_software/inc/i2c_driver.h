@@ -1,41 +1,32 @@
 /*
   Author: John Walnut
   Hardware Dependencies:
-    P5.2 - UCB1-SCL
-    P5.1 - UCB1-SDA
-    P3.2 - UCB0-SCL (also used for SD card SPI, goes through isolator on MB)
-    P3.1 - UCB0-SDA (also used for SD card SPI, goes through isolator on MB)
-    P3.0 - -CS_SD/I2C_ON (controls SD card isolator on MB)
+    USCI_B0 (primary) and, on the MSP430F2618, USCI_B1 (secondary).  Pins are listed in i2c_target.h.
   Modifications:
-    P5SEL
-    P3SEL
-    UCB0CTL0
-    UCB0CTL1
-    UCB1CTL0
-    UCB1CTL1
-    IE2
-    UC1IE
-    IFG2
-    UC1IFG
-    P3DIR
-    P3OUT
+    PxSEL (I2C pins)
+    UCBxCTL0
+    UCBxCTL1
+    UCBxBR0
+    UCBxBR1
+    UCBxI2CIE
+    IE2/UC1IE
+    IFG2/UC1IFG
   Purpose:
     This module is intended to be an API for I2C communication on the MSP430.  It includes function definitions for
     initialization and communication.  It does not contain Salvo-specific functions (semaphores, messages, scheduler commands,
-    etc.), but it does assume the CubeSat PPM architecture for the MSP430F2618, including specific GPIO pins, onboard external
-h    oscillators, and other necessary settings.
+    etc.).  The same code runs on the CubeSat PPM (MSP430F2618) and the LaunchPad (MSP430G2553); what differs between the
+    two is selected at compile time in i2c_target.h.
 */
 
 #ifndef I2C_DRIVER_H
 #define I2C_DRIVER_H
 
 #include "msp430.h"
+#include "i2c_target.h"
 
 
 /* DEFINITIONS */
 
-#define SCL_PIN               BIT2 //Same pins for both ports
-#define SDA_PIN               BIT1
 #define PRIMARY               0 
 #define SECONDARY             1
 #define TX_MODE               1
@@ -52,58 +43,10 @@ h    oscillators, and other necessary settings.
 #define NO_RESPONSE           0 //pass to "response" parameter of i2cInitializeMessage when no response is expected (null pointer)
 #define NO_MESSAGE            0 //pass to "message" parameter of i2cInitializeMessage when no message is sent (null pointer)
 #define BAUD_DIVIDE_10        10
-
-//Primary I2C (on Port 3)
-#define PRIMARY_I2C_SEL       P3SEL //This port shares lines with SD card SPI interface and runs through isolator on MB
-#define PRIMARY_I2C_DIR       P3DIR //Included for completeness
-#define PRIMARY_I2C_OUT       P3OUT //Included to use the isolator pin
-#define SD_I2C_ISOL           BIT0 //Activate/deactivate SD card isolator on MB
-
-//Secondary I2C (on Port 5)
-#define SECONDARY_I2C_SEL     P5SEL
-#define SECONDARY_I2C_DIR     P5DIR
-
-
-/* MACROS */
-
-//Primary I2C (on Port 3)
-#define DISABLE_PRIMARY_I2C       (UCB0CTL1 |= UCSWRST)
-#define ENABLE_PRIMARY_I2C        (UCB0CTL1 &= ~UCSWRST)
-#define SET_I2C_MODE_PRIMARY      (UCB0CTL0 |= UCMODE_3)
-#define SET_SYNC_PRIMARY          (UCB0CTL0 |= USYNC)
-#define RESET_PRIMARY_CONFIG_0    (UCB0CTL0 ^= UCB0CTL0)
-#define RESET_PRIMARY_CONFIG_1    (UCB0CTL1 ^= UCB0CTL1)
-#define GET_PRIMARY_IS_ACTIVE     ~(UCB0CTL1 & UCSWRST) //Returns inverted value of reset pin to indicate active (1) or inactive (0)
-#define START_PRIMARY_I2C         (UCB0CTL1 |= UCTXSTT) //generate start condition by setting start bit in config reg
-#define PRIMARY_TXRX_INT_EN       (IE2 |= UCB0TXIE + UCB0RXIE)
-#define PRIMARY_TXRX_INT_DIS      (IE2 &= ~(UCB0TXIE + UCB0RXIE))
-#define GET_PRIMARY_TX_READY      (IFG2 & UCB0TXIFG) //Check flags
-#define GET_PRIMARY_RX_READY      (IFG2 & UCB0RXIFG)
-#define STOP_PRIMARY_I2C          (UCB0CTL1 |= UCTXSTP) //generate stop condition
-#define SET_ISOL_PIN_OUT          (PRIMARY_I2C_DIR |= SD_I2C_ISOL) //Set pin to indicate output
-#define ENABLE_ISOL_I2C           (PRIMARY_I2C_OUT |= SD_I2C_ISOL) //Double check to make sure this activates I2C
-#define ENABLE_ISOL_SD            (PRIMARY_I2C_OUT &= ~SD_I2C_ISOL) //Do we want these macros in I2C, since it also applies to SPI?
-#define PRIMARY_GET_NACK          (UCB0STAT & UCNACKIFG)
-#define PRIMARY_GET_STT_CLR       ~(UCB0CTL1 & UCTXSTT) //gets whether start bit has cleared
-
-//Secondary I2C (on Port 5)
-#define DISABLE_SECONDARY_I2C     (UCB1CTL1 |= UCSWRST)
-#define ENABLE_SECONDARY_I2C      (UCB1CTL1 &= ~UCSWRST)
-#define SET_I2C_MODE_SECONDARY    (UCB1CTL0 |= UCMODE_3)
-#define SET_SYNC_SECONDARY        (UCB1CTL0 |= USYNC)
-#define RESET_SECONDARY_CONFIG_0  (UCB1CTL0 ^= UCB1CTL0)
-#define RESET_SECONDARY_CONFIG_1  (UCB1CTL1 ^= UCB1CTL1)
-#define GET_SECONDARY_IS_ACTIVE   ~(UCB1CTL1 & UCSWRST)
-#define START_SECONDARY_I2C       (UCB1CTL1 |= UCTXSTT)
-#define SECONDARY_TXRX_INT_EN     (UC1IE |= (UCB1TXIE + UCB1RXIE))
-#define SECONDARY_TXRX_INT_DIS    (UC1IE &= ~(UCB1TXIE + UCB1RXIE))
-#define GET_SECONDARY_TX_READY    (UC1IFG & UCB1TXIFG)
-#define GET_SECONDARY_RX_READY    (UC1IFG & UCB1RXIFG)
-#define STOP_SECONDARY_I2C        (UCB1CTL1 |= UCTXSTP)
-#define SECONDARY_GET_NACK        (UCB1STAT & UCNACKIFG)
-#define SECONDARY_GET_STT_CLR     ~(UCB1CTL1 & UCTXSTT)
-
-
+#define I2C_STANDARD_HZ       100000UL //Standard mode
+#define I2C_FAST_HZ           400000UL //Fast mode
+#define I2C_DEFAULT_SOURCE_HZ 1000000UL //SMCLK with the DCO on its 1 MHz calibration, until i2cSetSourceClock() says otherwise
+#define I2C_ANY_RATE          0 //Message has no speed limit of its own, interface rate is used
 
 /* DATATYPES */
 
@@ -122,6 +65,10 @@ h    oscillators, and other necessary settings.
     I2CERR_BAD_PARAMETERS (5) - Indicates that an initialization parameter for the struct was out of bounds, or in some other way illegal.
                                 If this error is set, the initialization method returns, and the struct is unchanged (except, of course,
                                 for its "error" parameter).
+    I2CERR_IN_PROGRESS (6) - Indicates that a message started with i2cStartMessage() is still being transferred by the interrupt
+                             routines.  The message, its buffers, and the interface must not be touched until this changes.
+    I2CERR_BUS_BUSY (7) - Indicates that another message is already being transferred on the interface, or the previous stop
+                          condition has not yet been sent.  Nothing was started; try again later.
    Purpose: 
     Provides information about the errors thrown by the I2C methods
 */
@@ -130,18 +77,21 @@ enum I2CError_e {I2CERR_NO_ERROR = 0,
                  I2CERR_NACK_LIMIT_REACHED = 2,
                  I2CERR_INTERFACE_NOT_ACTIVE = 3,
                  I2CERR_UNSPECIFIED_ERR = 4,
-                 I2CERR_BAD_PARAMETERS = 5};
+                 I2CERR_BAD_PARAMETERS = 5,
+                 I2CERR_IN_PROGRESS = 6,
+                 I2CERR_BUS_BUSY = 7};
 typedef enum I2CError_e I2CError;
 
 /* Name: I2CConfig_s
    Type: struct
    Parameters:
-    char i2cInterface - Indicates which of the MSP430F2618's two I2C interfaces should be configured, either primary or secondary.
+    char i2cInterface - Indicates which of the target's I2C interfaces (I2C_INTERFACE_COUNT) should be configured, either primary or secondary.
                         It is recommended to use the predefined PRIMARY and SECONDARY macros
     char clockSource - Selects the MSP430 clock source to the I2C interface, may be fazed out in later versions of the driver.  Values
                        must fall between 0 and 3 inclusive.  For now, always use the predefined SMCLK.
-    int baudDivider - Value by which to divide the clock source frequency for I2C.  This may be fazed out in later versions of the driver.
-                      For now, always use the predefined BAUD_DIVIDE_10.
+    int baudDivider - Value by which to divide the clock source frequency for I2C.  Only used when busHz is 0.
+    unsigned long busHz - Bus rate of the interface (Hz), the highest rate any device on it may be run at.  The divider is
+                          computed from the SMCLK rate and recomputed whenever that changes.  0 if baudDivider is used instead.
     I2CError error - Error message.  Contains information about any errors that occur when this struct is used/initialized.
     char isInitialized - If not set to 0x42, then the struct has not been initialized and anything using it should abort.  Never set
                          directly, but always within driver methods.
@@ -153,6 +103,7 @@ struct I2CConfig_s {
   char i2cInterface;
   char clockSource;
   int baudDivider;
+  unsigned long busHz;
   I2CError error;
   char isInitialized;
 };
@@ -161,7 +112,7 @@ typedef struct I2CConfig_s I2CConfig;
 /* Name: I2CMessage_s
    Type: struct
    Parameters:
-    char i2cInterface - Indicates on which of the MSP430F2618's two I2C interfaces the message should be sent, either primary or secondary.
+    char i2cInterface - Indicates on which of the target's I2C interfaces (I2C_INTERFACE_COUNT) the message should be sent, either primary or secondary.
                         It is recommended to use the predefined PRIMARY and SECONDARY macros
     int messageLength - Indicates the length (in bytes) of the message to prevent buffer overflows
     char* message - Pointer to the char array that holds the message to be transmitted
@@ -172,6 +123,8 @@ typedef struct I2CConfig_s I2CConfig;
     int respLen - Indicates the length (in bytes) of the response array (that is, the length of the expected response).  This should be exactly
                   the length of the expected response.
     char* response - Pointer to the char array that will hold the response upon its reception from the peripheral
+    unsigned long busHz - Highest bus rate the addressed device supports (see i2c_peripherals.h), or I2C_ANY_RATE.  The message is
+                          sent at the lower of this and the interface rate.  Set with i2cSetMessageRate().
     I2CError error - Error message.  Contains information about any errors that occur when this struct is used/initialized.
     char isInitialized - If not set to 0x42, then the struct has not been initialized and anything using it should abort.  Never set
                          directly, but always within driver methods.
@@ -187,11 +140,14 @@ struct I2CMessage_s {
   char txrxMode;
   int respLen;
   char* response;
+  unsigned long busHz;
   I2CError error;
   char isInitialized;
 };
 typedef struct I2CMessage_s I2CMessage;
 
+typedef void (*I2CIdleHook)(char i2cInterface); //See i2cSetIdleHook()
+
 
 
 /* FUNCTION PROTOTYPES */
@@ -215,7 +171,7 @@ void i2cInit(I2CConfig* configStruct);
 /* Name i2cInitializeConfig
    Parameters:
     I2CConfig* configStruct - pointer to the config struct to initialize
-    char interface - 0 = primary, 1 = secondary, use defined macros PRIMARY and SECONDARY
+    char interface - 0 = primary, 1 = secondary (F2618 only), use defined macros PRIMARY and SECONDARY
     char clockSource - 0 = UCLKI, 1 = ACLK, 2 = SMCLK, use defined macros
     int baudDivider - 16 bit value for clock prescaling
    Return value:
@@ -231,6 +187,22 @@ void i2cInit(I2CConfig* configStruct);
 */
 void i2cInitializeConfig(I2CConfig* configStruct, char interface, char clockSource, int baudDivider);
 
+/* Name: i2cInitializeConfigRate
+   Parameters:
+    I2CConfig* configStruct - pointer to the config struct to initialize
+    char interface - PRIMARY or SECONDARY
+    unsigned long busHz - bus rate of the interface, usually I2C_STANDARD_HZ or I2C_FAST_HZ
+   Return value:
+    void - error messages are stored in the "error" parameter of configStruct
+   Errors:
+    I2CERR_BAD_PARAMETERS - Interface out of range, or busHz is 0 or faster than SMCLK.  No initialization occurs.
+    I2CERR_NO_ERROR - Initialization successful.
+   Description:
+    Like i2cInitializeConfig(), but clocks the interface from SMCLK and picks the divider from the requested rate (never faster).
+    Use this one: the divider follows SMCLK if the clock is changed later.
+*/
+void i2cInitializeConfigRate(I2CConfig* configStruct, char interface, unsigned long busHz);
+
 /* Name: i2cInitializeMessage
    Parameters:
     I2CMessage* messageStruct - pointer to structure to initialize
@@ -254,6 +226,33 @@ void i2cInitializeConfig(I2CConfig* configStruct, char interface, char clockSour
 void i2cInitializeMessage(I2CMessage* messageStruct, char* message, int length, char address, char txrxMode, \
                           int respLen, char* response, char i2cInterface);
 
+/* Name: i2cSetMessageRate
+   Parameters:
+    I2CMessage* messageStruct - initialized message
+    unsigned long busHz - highest rate the addressed device supports, or I2C_ANY_RATE
+   Description:
+    Sets the speed limit of the message.  Messages to different devices on the same interface may have different limits;
+    the driver only reprograms the interface when the resulting divider actually changes.
+*/
+void i2cSetMessageRate(I2CMessage* messageStruct, unsigned long busHz);
+
+/* Name: i2cSetSourceClock
+   Parameters:
+    unsigned long sourceHz - new SMCLK frequency (Hz)
+   Description:
+    Tells the driver that SMCLK has changed.  Dividers of interfaces configured by rate are recomputed before their next
+    message.  Must not be called while a message is in progress.
+*/
+void i2cSetSourceClock(unsigned long sourceHz);
+
+/* Name: i2cBaudDivider
+   Parameters:
+    unsigned long busHz - requested bus rate (Hz), not 0
+   Return value:
+    int - SMCLK divider giving the fastest bus rate not above busHz
+*/
+int i2cBaudDivider(unsigned long busHz);
+
 /* Name: i2cConfigure
    Parameters:
     I2CConfig* configStruct - pointer to the configuration structure from which to configure the I2C channel
@@ -277,16 +276,88 @@ void i2cConfigure(I2CConfig* configStruct);
     I2CERR_STRUCT_NOT_INITIALIZED - Indicates that messageStruct was not properly initialized.
     I2CERR_INTERFACE_NOT_ACTIVE - Indicates that the specified interface is not active.  Interface must be activated manually by using
                                   i2cInit().
-    I2CERR_NACK_LIMIT_REACHED - Number of NACKs specified in MAX_NACK was exceeded during transmission.
-    I2CERR_UNSPECIFIED_ERROR - Unknown error occurred.
+    I2CERR_BUS_BUSY - Another message is in progress on the interface (started with i2cStartMessage(), or sent from an
+                      interrupt routine).  Nothing was sent.
+    I2CERR_NACK_LIMIT_REACHED - Number of NACKs specified in MAX_NACK was exceeded during the message.  A stop condition is sent;
+                                the interface stays active.
+    I2CERR_UNSPECIFIED_ERROR - Interface does not exist on this target.
     I2CERR_NO_ERROR - Message successfully sent.
    Description:
-    Sends a message over the I2C interface specified in messageStruct and saves response to response.  Any response data
-    over length respLen will be ignored.  THIS METHOD IS CRITICAL AND SHOULD BE MARKED AS SUCH (this isdone in the method body).  
-    TX and RX interrupts for UCB0 or UCB1 (whichever is specified) are enabled at the beginning of this method, and explicitly disabled at the end.
+    Sends a message over the I2C interface specified in messageStruct and saves response to response, polling the USCI
+    flags (no interrupts).  On a NACK the message is restarted from its first byte with a repeated start; every NACK of
+    the message counts towards MAX_NACK.  Returns after the stop condition has gone out.
 */
 void i2cSendMessage(I2CMessage* messageStruct);
 
+/* Name: i2cStartMessage
+   Parameters:
+    I2CMessage* messageStruct - pointer to a structure containing the message to send
+   Return value:
+    void - error messages are stored in the "error" parameter of messageStruct
+   Error:
+    I2CERR_STRUCT_NOT_INITIALIZED - Indicates that messageStruct was not properly initialized.
+    I2CERR_INTERFACE_NOT_ACTIVE - Indicates that the specified interface is not active.  Interface must be activated manually by using
+                                  i2cInit().
+    I2CERR_BUS_BUSY - Another message is in progress on the interface.  Nothing was started.
+    I2CERR_IN_PROGRESS - Message was started.  Set to one of the errors below by the interrupt routines once the transfer is over.
+    I2CERR_NACK_LIMIT_REACHED - (after completion) Number of NACKs specified in MAX_NACK was exceeded during transmission.
+    I2CERR_NO_ERROR - (after completion) Message successfully sent, and response (if any) received.
+   Description:
+    Non-blocking version of i2cSendMessage().  Issues the start condition and returns immediately; the USCI_B interrupt
+    routines move the bytes and write the final result into the "error" parameter of messageStruct.  The caller owns the
+    message and its buffers (so they must not live on a task's stack across a context switch) and should poll the error
+    parameter, yielding in between, until it is no longer I2CERR_IN_PROGRESS.  Requires global interrupts to be enabled.
+    The interrupt routines never wait on the bus, so a single byte read cannot have its stop requested while the address
+    goes out: the slave sends one byte more, which is NACKed and dropped.  Use i2cSendMessage() for single byte reads
+    of devices where reading the next register has an effect.
+*/
+void i2cStartMessage(I2CMessage* messageStruct);
+
+/* Name: i2cIsBusy
+   Parameters:
+    char i2cInterface - interface to check, PRIMARY or SECONDARY
+   Return value:
+    char - 1 if a message (blocking or started with i2cStartMessage()) is in progress on the interface, or the stop of
+           the last one is still going out, 0 otherwise
+   Description:
+    Only a snapshot: an interrupt routine or idle hook may start a message right after.  Test with interrupts off to
+    rely on it, or take the interface with i2cAcquireInterface().
+*/
+char i2cIsBusy(char i2cInterface);
+
+/* Name: i2cAcquireInterface
+   Parameters:
+    char i2cInterface - interface to take, PRIMARY or SECONDARY
+   Return value:
+    char - 1 if the interface was idle, with no stop going out, and now belongs to the caller, 0 otherwise
+   Description:
+    For other users of the USCI_B module (the SD card shares UCB0 in SPI mode).  Messages started while the caller holds
+    the interface are refused with I2CERR_BUS_BUSY.  Give it back with i2cReleaseInterface(), after i2cInit() has put
+    the module back into I2C mode.
+*/
+char i2cAcquireInterface(char i2cInterface);
+
+/* Name: i2cReleaseInterface
+   Parameters:
+    char i2cInterface - interface taken with i2cAcquireInterface()
+   Description:
+    Frees the interface and runs its idle hook, as the end of a message does.
+*/
+void i2cReleaseInterface(char i2cInterface);
+
+/* Name: i2cSetIdleHook
+   Parameters:
+    char i2cInterface - PRIMARY or SECONDARY
+    I2CIdleHook hook - function to call, 0 for none
+   Description:
+    hook runs, with interrupts off, every time a message on the interface ends: when i2cSendMessage() is about to return,
+    and from the interrupt routine once a message started with i2cStartMessage() has its result.  It may start the next
+    message with i2cStartMessage(), so work that was refused with I2CERR_BUS_BUSY goes out as soon as the bus is free.
+    After an interrupt-driven message the stop may still be going out, and the start is refused again: retry it from
+    somewhere else too.
+*/
+void i2cSetIdleHook(char i2cInterface, I2CIdleHook hook);
+
 //currently not needed and not implemented
 I2CConfig* i2cGetConfigStruct(char i2cInterface); //do we need this?
 int i2cCalculateChecksum(I2CMessage* message); //do we need this?
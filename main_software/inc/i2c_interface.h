@@ -0,0 +1,311 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    USCI_B module of interface I2C_N, registers named in i2c_target.h
+   Modifications:
+    None
+   Purpose:
+    The part of i2c_driver.c that touches the registers.  Not a header: i2c_driver.c includes it once per interface,
+    with I2C_N defined as the interface number (0 or 1), so every function below is compiled once for each interface
+    with its register names filled in by the preprocessor (I2C_REG(CTL1) is I2C0_CTL1, that is UCB0CTL1, for interface
+    0) and its name suffixed with the number (I2C_FN(i2cSendBlocking) is i2cSendBlocking0).  No register is reached
+    through a pointer and nothing branches on the interface: the public functions pick the copy once, the interrupt
+    routines call theirs directly.
+*/
+
+/* Name: i2cInitPort
+   Description:
+    Register part of i2cInit(), with the rate bookkeeping already done.
+*/
+static void I2C_FN(i2cInitPort)(char clockSource) {
+  I2C_REG(CTL1) |= UCSWRST; //Disable I2C while we're configuring
+  I2C_REG(CTL0) = UCMST + UCMODE_3 + UCSYNC; //UCMST - master mode, UCMODE_3 - I2C mode, UCSYNC - synchronous mode
+  I2C_REG(CTL1) = UCSWRST + (clockSource << CLOCK_SRC_SHIFT); //Clears everything else
+  I2C_REG(SELECT_PINS); //Set pin mode
+  I2C_REG(BR0) = i2cDivider[I2C_N] & BAUD_LOW_MASK; //Low 8 bits register
+  I2C_REG(BR1) = i2cDivider[I2C_N] >> BAUD_SHIFT; //High 8 bits register
+  I2C_REG(CTL1) &= ~UCSWRST;
+}
+
+/* Name: i2cStopPending
+   Return value:
+    char - 1 while the stop of the last message is still going out
+*/
+static char I2C_FN(i2cStopPending)(void) {
+  return (I2C_REG(CTL1) & UCTXSTP) ? 1 : 0;
+}
+
+/* Name: i2cApplyRate
+   Description:
+    Programs the divider for a message with speed limit messageHz, if it differs from the one in use.  The interface must
+    be active and idle.
+*/
+static void I2C_FN(i2cApplyRate)(unsigned long messageHz) {
+  unsigned long busHz = i2cConfigHz[I2C_N];
+  int divider;
+
+  if (messageHz != I2C_ANY_RATE && (busHz == 0 || messageHz < busHz)) { //Slowest of interface and device
+    busHz = messageHz;
+  }
+  if (busHz == i2cRateHz[I2C_N]) { //Same as last message, nothing to do
+    return;
+  }
+
+  divider = busHz ? i2cBaudDivider(busHz) : i2cConfigDivider[I2C_N];
+  if (divider != i2cDivider[I2C_N]) {
+    I2C_REG(CTL1) |= UCSWRST; //Divider may only be changed in reset
+    I2C_REG(BR0) = divider & BAUD_LOW_MASK;
+    I2C_REG(BR1) = divider >> BAUD_SHIFT;
+    I2C_REG(CTL1) &= ~UCSWRST;
+    i2cDivider[I2C_N] = divider;
+  }
+  i2cRateHz[I2C_N] = busHz;
+}
+
+/* Name: i2cRetry
+   Return value:
+    char - 1 if the NACK limit has been reached (stop condition already requested), 0 if a repeated start was issued
+   Description:
+    Handles a NACK seen by i2cSendMessage().
+*/
+static char I2C_FN(i2cRetry)(char* nackCount) {
+  I2C_REG(STAT) &= ~UCNACKIFG;
+  (*nackCount)++;
+  if (*nackCount >= MAX_NACK) { //Slave unreachable, abort to prevent stalling OS
+    I2C_REG(CTL1) |= UCTXSTP;
+    return 1;
+  }
+  I2C_REG(CTL1) |= UCTXSTT; //Repeated start, same direction
+  return 0;
+}
+
+/* Name: i2cStopAfterAddress
+   Description:
+    For single byte receives the stop has to be requested while the address is still going out, so the byte is NACKed.
+    Blocking messages only; the interrupt routines never wait on the bus (see i2cAsyncServiceData()).
+*/
+static void I2C_FN(i2cStopAfterAddress)(void) {
+  while (I2C_REG(CTL1) & UCTXSTT); //Address byte only, a few bit times
+  I2C_REG(CTL1) |= UCTXSTP; //Automatically sends final NACK as required by I2C spec.
+}
+
+/* Name: i2cSendBlocking
+   Description:
+    Body of i2cSendMessage(), called with the interface claimed.
+*/
+static void I2C_FN(i2cSendBlocking)(I2CMessage* messageStruct) {
+
+ //Local variables
+  char nackCount = 0;
+  int i = 0;
+  int j = 0;
+
+#ifdef I2C_REPLAY
+  replayTransfer(messageStruct);
+  return;
+#endif
+
+  if (I2C_REG(CTL1) & UCSWRST) { //Interface is not active
+    messageStruct -> error = I2CERR_INTERFACE_NOT_ACTIVE;
+    return; //Must be activated manually
+  }
+  while (I2C_REG(CTL1) & UCTXSTP); //Stop of an interrupt-driven message before this one, a byte time at most
+
+  //Lessgo
+  I2C_FN(i2cApplyRate)(messageStruct->busHz);
+  I2C_REG(I2CSA) = messageStruct->address; //Set address
+  I2C_REG(STAT) &= ~UCNACKIFG;
+
+  //Transmit
+  if (messageStruct->messageLength > 0) { //if no TX, then we want to go straight to RX section
+    I2C_REG(CTL1) |= UCTR + UCTXSTT; //Always start in TX mode
+    while (1) {
+      if (I2C_REG(STAT) & UCNACKIFG) { //Start over from the first byte
+        if (I2C_FN(i2cRetry)(&nackCount)) {
+          messageStruct -> error = I2CERR_NACK_LIMIT_REACHED;
+          return;
+        }
+        i = 0;
+      } else if (I2C_REG(IFG) & I2C_REG(TXIFG)) {
+        if (i >= messageStruct->messageLength) { //Last byte has moved into the shift register
+          break;
+        }
+        I2C_REG(TXBUF) = messageStruct->message[i];
+        i++;
+      }
+    }
+  }
+
+  //Receive
+  if (messageStruct->txrxMode == RX_MODE) {
+    I2C_REG(CTL1) &= ~UCTR; //Set to receive mode
+    I2C_REG(IFG) &= ~(I2C_REG(TXIFG) + I2C_REG(RXIFG)); //clear TX flag (the datasheet told me so), and any byte dropped
+    I2C_REG(CTL1) |= UCTXSTT; //(repeated) start condition
+    if (messageStruct->respLen == 1) {
+      I2C_FN(i2cStopAfterAddress)();
+    }
+
+    while (j < messageStruct->respLen) {
+      if (I2C_REG(STAT) & UCNACKIFG) { //Address was not acknowledged
+        if (I2C_FN(i2cRetry)(&nackCount)) {
+          messageStruct -> error = I2CERR_NACK_LIMIT_REACHED;
+          return;
+        }
+        if (messageStruct->respLen == 1) {
+          I2C_FN(i2cStopAfterAddress)();
+        }
+        j = 0;
+      } else if (I2C_REG(IFG) & I2C_REG(RXIFG)) {
+        messageStruct->response[j] = I2C_REG(RXBUF);
+        j++;
+        if (j == messageStruct->respLen - 1) { //Next byte is the last one, NACK it and stop
+          I2C_REG(CTL1) |= UCTXSTP;
+        }
+      }
+    }
+  } else {
+    I2C_REG(CTL1) |= UCTXSTP;
+    I2C_REG(IFG) &= ~I2C_REG(TXIFG);
+  }
+
+  while (I2C_REG(CTL1) & UCTXSTP); //wait for stop condition to be sent
+  messageStruct -> error = I2CERR_NO_ERROR;
+  return;
+}
+
+/* Name: i2cAsyncReceive
+   Description:
+    Switches the interface to receive mode with a (repeated) start condition.  Does not wait for the address to go out,
+    so a single byte read gets its stop from the RX interrupt instead (see i2cAsyncServiceData()).
+*/
+static void I2C_FN(i2cAsyncReceive)(void) {
+  I2C_REG(IE) &= ~I2C_REG(TXIFG);
+  I2C_REG(IFG) &= ~(I2C_REG(TXIFG) + I2C_REG(RXIFG)); //clear TX flag (the datasheet told me so), and any byte dropped
+  I2C_REG(CTL1) &= ~UCTR;
+  I2C_REG(IE) |= I2C_REG(RXIFG);
+  I2C_REG(CTL1) |= UCTXSTT;
+}
+
+/* Name: i2cAsyncBegin
+   Description:
+    (Re)starts the active message on the interface from its first byte.
+*/
+static void I2C_FN(i2cAsyncBegin)(void) {
+  i2cTxIndex[I2C_N] = 0;
+  i2cRxIndex[I2C_N] = 0;
+
+  if (i2cActiveMessage[I2C_N]->messageLength > 0) {
+    I2C_REG(CTL1) |= UCTR; //Always start in TX mode
+    I2C_REG(IE) |= I2C_REG(TXIFG);
+    I2C_REG(CTL1) |= UCTXSTT;
+  } else { //RX only
+    I2C_FN(i2cAsyncReceive)();
+  }
+}
+
+/* Name: i2cAsyncStart
+   Description:
+    Register part of i2cStartMessage(), after the parameter checks.
+*/
+static void I2C_FN(i2cAsyncStart)(I2CMessage* messageStruct) {
+  if (I2C_REG(CTL1) & UCSWRST) { //Interface is not active
+    messageStruct -> error = I2CERR_INTERFACE_NOT_ACTIVE;
+    return;
+  }
+  if ((I2C_REG(CTL1) & UCTXSTP) || !i2cClaim(I2C_N)) { //Someone else's transfer, or its stop, is still going
+    messageStruct -> error = I2CERR_BUS_BUSY;
+    return;
+  }
+
+  I2C_FN(i2cApplyRate)(messageStruct->busHz); //Before any interrupt is enabled, reset clears them
+  messageStruct -> error = I2CERR_IN_PROGRESS;
+  i2cActiveMessage[I2C_N] = messageStruct;
+  i2cNackCount[I2C_N] = 0;
+
+  I2C_REG(I2CSA) = messageStruct->address;
+  I2C_REG(STAT) &= ~UCNACKIFG;
+  I2C_REG(I2CIE) |= UCNACKIE;
+  I2C_FN(i2cAsyncBegin)();
+}
+
+#ifndef I2C_REPLAY //Nothing below runs without the hardware
+
+/* Name: i2cAsyncFinish
+   Description:
+    Ends the interrupt-driven transfer on the interface and reports result to the message owner.
+*/
+static void I2C_FN(i2cAsyncFinish)(I2CError result) {
+  I2CMessage* messageStruct = i2cActiveMessage[I2C_N];
+
+  I2C_REG(IE) &= ~(I2C_REG(TXIFG) + I2C_REG(RXIFG)); //IE bits sit in the same positions as the IFG bits
+  I2C_REG(I2CIE) &= ~UCNACKIE;
+  i2cActiveMessage[I2C_N] = 0;
+  messageStruct -> error = result; //Owner may reuse the message as soon as it sees this
+  i2cRelease(I2C_N);
+}
+
+/* Name: i2cAsyncServiceData
+   Description:
+    Called from the USCI TX vector (which carries both TX and RX data flags in I2C mode).  Moves one byte.
+*/
+static void I2C_FN(i2cAsyncServiceData)(void) {
+  I2CMessage* messageStruct = i2cActiveMessage[I2C_N];
+
+  if (!messageStruct) { //Not ours (blocking driver, or UCAx sharing the vector)
+    return;
+  }
+
+  if ((I2C_REG(IE) & I2C_REG(RXIFG)) && (I2C_REG(IFG) & I2C_REG(RXIFG))) {
+    int j = i2cRxIndex[I2C_N];
+
+    if (messageStruct->respLen == 1) { //Too late to NACK this byte: the one after it is NACKed and dropped
+      I2C_REG(CTL1) |= UCTXSTP; //Before the read, so a bus held for it stops at once
+    }
+    messageStruct->response[j] = I2C_REG(RXBUF); //Reading clears the flag
+    j++;
+    i2cRxIndex[I2C_N] = j;
+
+    if (j >= messageStruct->respLen) {
+      I2C_FN(i2cAsyncFinish)(I2CERR_NO_ERROR);
+    } else if (j == messageStruct->respLen - 1) { //Next byte is the last one, NACK it and stop
+      I2C_REG(CTL1) |= UCTXSTP;
+    }
+  } else if ((I2C_REG(IE) & I2C_REG(TXIFG)) && (I2C_REG(IFG) & I2C_REG(TXIFG))) {
+    int i = i2cTxIndex[I2C_N];
+
+    if (i < messageStruct->messageLength) {
+      I2C_REG(TXBUF) = messageStruct->message[i]; //Writing clears the flag
+      i2cTxIndex[I2C_N] = i + 1;
+    } else if (messageStruct->txrxMode == RX_MODE) {
+      I2C_FN(i2cAsyncReceive)();
+    } else {
+      I2C_REG(CTL1) |= UCTXSTP;
+      I2C_REG(IFG) &= ~I2C_REG(TXIFG);
+      I2C_FN(i2cAsyncFinish)(I2CERR_NO_ERROR);
+    }
+  }
+}
+
+/* Name: i2cAsyncServiceState
+   Description:
+    Called from the USCI RX vector (state changes in I2C mode).  Retries the message on NACK, up to MAX_NACK times.
+*/
+static void I2C_FN(i2cAsyncServiceState)(void) {
+  if (!(I2C_REG(STAT) & UCNACKIFG)) {
+    return;
+  }
+  I2C_REG(STAT) &= ~UCNACKIFG;
+
+  if (!i2cActiveMessage[I2C_N]) {
+    return;
+  }
+
+  i2cNackCount[I2C_N]++;
+  if (i2cNackCount[I2C_N] >= MAX_NACK) { //Slave unreachable, give up
+    I2C_REG(CTL1) |= UCTXSTP;
+    I2C_FN(i2cAsyncFinish)(I2CERR_NACK_LIMIT_REACHED);
+  } else {
+    I2C_FN(i2cAsyncBegin)(); //Repeated start, from the first byte
+  }
+}
+
+#endif
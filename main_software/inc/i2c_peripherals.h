@@ -18,10 +18,43 @@
 #define EPS_I2C_ADDR          0x2B
 #define MAGNET_I2C_ADDR       0x0C
 
+//Fastest bus rate each peripheral supports (Hz), pass to i2cSetMessageRate()
+#define ANTENNA_I2C_MAX_HZ    100000UL
+#define IMU_I2C_MAX_HZ        400000UL //MPU-9250 fast mode
+#define MAGNET_I2C_MAX_HZ     400000UL //AK8963 fast mode
+
 /* Peripheral-specific commands */
 
 //IMU (MPU-9250)
 #define WHOAMI_REG            117 //should return 0x71
 #define MAGNET_ID_REG         0x00 //should return 0x48
+#define GYROSCOPE_START       0x43 //GYRO_XOUT_H, first of six data registers (big endian)
+#define MAGNET_START          0x03 //AK8963 HXL, first of six data registers (little endian)
+#define ACCEL_START           0x3B //ACCEL_XOUT_H, first of six data registers (big endian)
+#define IMU_SMPLRT_DIV_REG    0x19 //Sample rate = 1 kHz / (1 + SMPLRT_DIV) with the DLPF on
+#define IMU_CONFIG_REG        0x1A
+#define IMU_CONFIG_DLPF_184HZ 0x01 //Gyro DLPF on, 1 kHz internal rate
+#define IMU_INT_PIN_CFG_REG   0x37
+#define IMU_BYPASS_EN         0x02 //INT_PIN_CFG: AK8963 on the host's bus; the rest left at reset (INT active high, 50 us)
+#define IMU_INT_ENABLE_REG    0x38
+#define IMU_INT_STATUS_REG    0x3A //Cleared by reading it
+#define IMU_RAW_DATA_RDY      0x01 //INT_STATUS and INT_ENABLE, new gyro and accel sample
+#define IMU_INTERNAL_HZ       1000UL
+
+#define MAGNET_ST1_REG        0x02
+#define MAGNET_ST1_DRDY       0x01 //New measurement, cleared by reading through ST2
+#define MAGNET_DATA_LEN       7 //HXL to HZH and ST2, ST2 must be read to release the next measurement
+#define MAGNET_CNTL1_REG      0x0A
+#define MAGNET_MODE_CONT_8HZ  0x12 //Continuous measurement 1, 16 bit
+#define MAGNET_MODE_CONT_100HZ 0x16 //Continuous measurement 2, 16 bit
+
+//Antenna (ISIS deployable antenna system)
+#define ANTENNA_CMD_RESET         0xAA
+#define ANTENNA_CMD_ARM           0xAD
+#define ANTENNA_CMD_DISARM        0xAC
+#define ANTENNA_CMD_DEPLOY_AUTO   0xA5 //Followed by one byte: burn time per antenna in seconds, antennas are burned in sequence
+#define ANTENNA_CMD_GET_STATUS    0xC3 //Returns two bytes, LSB first
+#define ANTENNA_STATUS_ARMED      0x0001
+#define ANTENNA_STATUS_NOT_DEPLOYED_MASK  0x8888 //Bits 15, 11, 7, 3 are set while antennas 1-4 are still stowed
 
 #endif
@@ -0,0 +1,108 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    MSP430F2618 (CubeSat PPM):
+     P3.2 - UCB0-SCL, P3.1 - UCB0-SDA (primary, shared with SD card SPI, goes through isolator on MB)
+     P3.0 - -CS_SD/I2C_ON (controls SD card isolator on MB)
+     P5.2 - UCB1-SCL, P5.1 - UCB1-SDA (secondary)
+    MSP430G2553 (LaunchPad test board):
+     P1.6 - UCB0-SCL, P1.7 - UCB0-SDA (primary only)
+   Modifications:
+    None (definitions only)
+   Purpose:
+    Everything about the I2C driver that differs between the two MCUs it runs on: how many USCI_B modules are used for
+    I2C, which pins they are on, and which IE/IFG registers hold their flags.  The target is picked from the processor
+    define the compiler sets for the project (__MSP430G2553__, otherwise the F2618 is assumed).  i2c_driver.c only uses
+    I2C_INTERFACE_COUNT and the I2Cn_* names of interface n, so both targets run the same driver code, compiled once per
+    interface with the register names filled in by the preprocessor (see i2c_interface.h).
+*/
+
+#ifndef I2C_TARGET_H
+#define I2C_TARGET_H
+
+#include "msp430.h"
+
+#if defined(__MSP430G2553__)
+
+#define I2C_INTERFACE_COUNT   1
+
+#define SCL_PIN               BIT6
+#define SDA_PIN               BIT7
+
+//Primary I2C (on Port 1)
+#define PRIMARY_I2C_SEL       P1SEL
+#define PRIMARY_I2C_SEL_2     P1SEL2 //Both select registers must be set for the USCI function
+#define PRIMARY_I2C_DIR       P1DIR //Included for completeness
+#define PRIMARY_I2C_OUT       P1OUT
+
+//Interface 0 (PRIMARY) on UCB0
+#define I2C0_CTL0             UCB0CTL0
+#define I2C0_CTL1             UCB0CTL1
+#define I2C0_BR0              UCB0BR0
+#define I2C0_BR1              UCB0BR1
+#define I2C0_STAT             UCB0STAT
+#define I2C0_I2CIE            UCB0I2CIE
+#define I2C0_TXBUF            UCB0TXBUF
+#define I2C0_RXBUF            UCB0RXBUF
+#define I2C0_I2CSA            UCB0I2CSA
+#define I2C0_IE               IE2 //Shared with UCA0
+#define I2C0_IFG              IFG2
+#define I2C0_TXIFG            UCB0TXIFG //Same bit positions in IE2
+#define I2C0_RXIFG            UCB0RXIFG
+#define I2C0_SELECT_PINS      (PRIMARY_I2C_SEL |= SCL_PIN + SDA_PIN, PRIMARY_I2C_SEL_2 |= SCL_PIN + SDA_PIN)
+
+#else //MSP430F2618
+
+#define I2C_INTERFACE_COUNT   2
+
+#define SCL_PIN               BIT2 //Same pins for both ports
+#define SDA_PIN               BIT1
+
+//Primary I2C (on Port 3)
+#define PRIMARY_I2C_SEL       P3SEL //This port shares lines with SD card SPI interface and runs through isolator on MB
+#define PRIMARY_I2C_DIR       P3DIR //Included for completeness
+#define PRIMARY_I2C_OUT       P3OUT //Included to use the isolator pin
+#define SD_I2C_ISOL           BIT0 //Activate/deactivate SD card isolator on MB
+
+//Secondary I2C (on Port 5)
+#define SECONDARY_I2C_SEL     P5SEL
+#define SECONDARY_I2C_DIR     P5DIR
+
+#define SET_ISOL_PIN_OUT      (PRIMARY_I2C_DIR |= SD_I2C_ISOL) //Set pin to indicate output
+#define ENABLE_ISOL_I2C       (PRIMARY_I2C_OUT |= SD_I2C_ISOL) //Double check to make sure this activates I2C
+#define ENABLE_ISOL_SD        (PRIMARY_I2C_OUT &= ~SD_I2C_ISOL) //Do we want these macros in I2C, since it also applies to SPI?
+
+//Interface 0 (PRIMARY) on UCB0
+#define I2C0_CTL0             UCB0CTL0
+#define I2C0_CTL1             UCB0CTL1
+#define I2C0_BR0              UCB0BR0
+#define I2C0_BR1              UCB0BR1
+#define I2C0_STAT             UCB0STAT
+#define I2C0_I2CIE            UCB0I2CIE
+#define I2C0_TXBUF            UCB0TXBUF
+#define I2C0_RXBUF            UCB0RXBUF
+#define I2C0_I2CSA            UCB0I2CSA
+#define I2C0_IE               IE2 //Shared with UCA0
+#define I2C0_IFG              IFG2
+#define I2C0_TXIFG            UCB0TXIFG //Same bit positions in IE2
+#define I2C0_RXIFG            UCB0RXIFG
+#define I2C0_SELECT_PINS      (PRIMARY_I2C_SEL |= SCL_PIN + SDA_PIN)
+
+//Interface 1 (SECONDARY) on UCB1
+#define I2C1_CTL0             UCB1CTL0
+#define I2C1_CTL1             UCB1CTL1
+#define I2C1_BR0              UCB1BR0
+#define I2C1_BR1              UCB1BR1
+#define I2C1_STAT             UCB1STAT
+#define I2C1_I2CIE            UCB1I2CIE
+#define I2C1_TXBUF            UCB1TXBUF
+#define I2C1_RXBUF            UCB1RXBUF
+#define I2C1_I2CSA            UCB1I2CSA
+#define I2C1_IE               UC1IE //Shared with UCA1 (radio.h)
+#define I2C1_IFG              UC1IFG
+#define I2C1_TXIFG            UCB1TXIFG
+#define I2C1_RXIFG            UCB1RXIFG
+#define I2C1_SELECT_PINS      (SECONDARY_I2C_SEL |= SCL_PIN + SDA_PIN)
+
+#endif
+
+#endif
@@ -0,0 +1,92 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Defines the on-card format of the flight log written by the recorder (recorder.h).  Kept free of MSP430 headers so
+    ground tools can include it as is.
+
+    The log is a run of 512-byte blocks starting at LOG_FIRST_BLOCK.  Every block is written whole and looks like:
+
+      offset  size  field
+      0       2     magic, LOG_MAGIC
+      2       1     format version, LOG_VERSION
+      3       1     number of samples in the block (1 to LOG_SAMPLES_PER_BLOCK)
+      4       4     sequence number, counts up by one per block and never wraps back
+      8       4     Salvo tick of the first sample
+      12      490   samples, LOG_SAMPLE_SIZE bytes each, unused space is zero
+      510     2     CRC-16/CCITT (poly 0x1021, init 0xFFFF) of bytes 0 to 509
+
+    A sample is the tick offset from the block's first tick (2 bytes), then the six raw gyroscope bytes and the six raw
+    magnetometer bytes exactly as read from the sensors.  Multi-byte header fields are little endian.
+
+    Block LOG_FIRST_BLOCK + n (modulo LOG_BLOCK_COUNT) always holds a sequence number congruent to n, so the newest block
+    can be found by binary search (see recorderRecover()).
+*/
+
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+/* CONSTANTS */
+#define LOG_BLOCK_SIZE            512
+#define LOG_MAGIC                 0x5053 //"PS"
+#define LOG_VERSION               1
+#define LOG_FIRST_BLOCK           2048UL //Leaves the start of the card for a partition table, should one ever be needed
+#define LOG_BLOCK_COUNT           1048576UL //512 MB of log, wraps after this
+
+#define LOG_HDR_MAGIC             0
+#define LOG_HDR_VERSION           2
+#define LOG_HDR_COUNT             3
+#define LOG_HDR_SEQUENCE          4
+#define LOG_HDR_FIRST_TICK        8
+#define LOG_HDR_SIZE              12
+
+#define LOG_SAMPLE_TICK           0
+#define LOG_SAMPLE_GYRO           2
+#define LOG_SAMPLE_MAGNET         8
+#define LOG_SAMPLE_SIZE           14
+#define LOG_AXIS_BYTES            6
+
+#define LOG_CRC_OFFSET            (LOG_BLOCK_SIZE - 2)
+#define LOG_CRC_SEED              0xFFFF
+#define LOG_SAMPLES_PER_BLOCK     ((LOG_CRC_OFFSET - LOG_HDR_SIZE) / LOG_SAMPLE_SIZE)
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: logCrc16
+   Parameters:
+    const unsigned char* data - bytes to check
+    unsigned int length - number of bytes
+   Return value:
+    unsigned int - CRC-16/CCITT of data
+*/
+unsigned int logCrc16(const unsigned char* data, unsigned int length);
+
+/* Name: logCrc16Update
+   Parameters:
+    unsigned int crc - LOG_CRC_SEED for the first piece, then the result of the previous call
+    const unsigned char* data, unsigned int length - next piece
+   Return value:
+    unsigned int - CRC-16/CCITT of everything so far, for data that is not all in one place
+*/
+unsigned int logCrc16Update(unsigned int crc, const unsigned char* data, unsigned int length);
+
+/* Name: logGet16, logGet32, logPut16, logPut32
+   Description:
+    Little endian field access, independent of the host's byte order and alignment rules.
+*/
+unsigned int logGet16(const unsigned char* field);
+unsigned long logGet32(const unsigned char* field);
+void logPut16(unsigned char* field, unsigned int value);
+void logPut32(unsigned char* field, unsigned long value);
+
+/* Name: logBlockIsValid
+   Parameters:
+    const unsigned char* block - LOG_BLOCK_SIZE bytes read from the card
+   Return value:
+    char - 1 if the block has the right magic, version, sample count and CRC, 0 otherwise
+*/
+char logBlockIsValid(const unsigned char* block);
+
+#endif
@@ -0,0 +1,27 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Selects the scheduler.  Normal builds use Salvo.  Builds with OS_SHIM use os_shim.h instead, a cooperative
+    scheduler in plain C with the part of the Salvo API this project uses, so the task set builds and runs without the
+    Salvo library.  Include this instead of salvo.h.
+
+    Every task wraps its body in OS_TASK_BEGIN() and OS_TASK_END(), which the shim needs to resume a task where it left
+    off and which are empty under Salvo.
+*/
+
+#ifndef OS_H
+#define OS_H
+
+#ifdef OS_SHIM
+#include "os_shim.h"
+#else
+#include "salvo.h"
+
+#define OS_TASK_BEGIN()
+#define OS_TASK_END()
+#endif
+
+#endif
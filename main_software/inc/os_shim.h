@@ -0,0 +1,191 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Cooperative scheduler with the part of the Salvo API this project uses: tasks with priorities, OS_Yield(),
+    OS_Delay() on OSTimer() ticks, and binary semaphores with timeouts.  Built with OS_SHIM (see os.h) in place of the
+    Salvo library, so the tasks run wherever the project compiles, e.g. on an MSP430 simulator from Linux.
+
+    Tasks are stackless coroutines, as under Salvo: a context switch returns from the task function and the next dispatch
+    jumps back to the line after it.  OS_TASK_BEGIN() opens a switch on that line, so, unlike Salvo:
+     - a task must not switch context from inside a switch statement of its own
+     - only one context switch per source line
+    Locals do not survive a context switch, same as under Salvo.
+
+    Scheduling follows Salvo: OSSched() runs the eligible task with the lowest priority number (0 is highest), tasks of
+    equal priority take turns, and a task that returns from its function without switching context is destroyed.
+
+    The only MSP430 code is the interrupt lock in os_shim.c.  Building with OS_SHIM_HOST as well leaves it out (and
+    msp430.h with it), for hosts where OSTimer() and OSSignalBinSem() are called between dispatches rather than from
+    interrupts; ground_software/shimcheck.c runs tasks that way.
+*/
+
+#ifndef OS_SHIM_H
+#define OS_SHIM_H
+
+#include "salvocfg.h"
+
+/* CONSTANTS */
+#ifndef TRUE
+#define TRUE  1
+#define FALSE 0
+#endif
+
+#define OSNO_ERR          0
+#define OSERR             1
+#define OSERR_BAD_P       2
+#define OSERR_EVENT_FULL  3
+#define OSERR_TIMEOUT     4
+#define OSNO_TIMEOUT      0
+
+#define OSLOWEST_PRIO     15
+
+/* DATATYPES */
+typedef unsigned char OStypeErr;
+typedef unsigned char OStypePrio;
+typedef unsigned char OStypeDelay;
+typedef unsigned char OStypeBinSem;
+typedef unsigned long OStypeTick;
+typedef void (*OStypeTFP)(void);
+
+enum OStypeState_e {
+  OSTCB_DESTROYED = 0,
+  OSTCB_ELIGIBLE,
+  OSTCB_DELAYED,
+  OSTCB_WAITING,
+  OSTCB_STOPPED
+};
+
+/* Name: OStypeTcb_s
+   Type: struct
+   Parameters:
+    OStypeTFP function - task function
+    unsigned int resume - line to resume at, 0 to start from OS_TASK_BEGIN()
+    unsigned int turn - when the task last became eligible, orders tasks of equal priority
+    OStypeDelay delay - OSTimer() ticks left while delayed or waiting
+    OStypePrio prio - priority, 0 is highest
+    char state - OStypeState_e
+    char timedOut - set when a wait ended on its timeout
+    struct OStypeEcb_s* waitingOn - semaphore the task waits for
+   Purpose:
+    Task control block.
+*/
+struct OStypeEcb_s;
+
+struct OStypeTcb_s {
+  OStypeTFP function;
+  unsigned int resume;
+  unsigned int turn;
+  OStypeDelay delay;
+  OStypePrio prio;
+  char state;
+  char timedOut;
+  struct OStypeEcb_s* waitingOn;
+};
+typedef struct OStypeTcb_s OStypeTcb;
+typedef OStypeTcb* OStypeTcbP;
+
+/* Name: OStypeEcb_s
+   Type: struct
+   Parameters:
+    OStypeBinSem value - 1 if the semaphore is available
+    char created - set by OSCreateBinSem()
+   Purpose:
+    Event control block, binary semaphores only.
+*/
+struct OStypeEcb_s {
+  OStypeBinSem value;
+  char created;
+};
+typedef struct OStypeEcb_s OStypeEcb;
+typedef OStypeEcb* OStypeEcbP;
+
+extern OStypeTcb osShimTcbs[OSTASKS];
+extern OStypeEcb osShimEcbs[OSEVENTS];
+extern OStypeTcbP osShimCurrent;
+
+/* MACROS */
+#define OSTCBP(n)   (&osShimTcbs[(n) - 1])
+#define OSECBP(n)   (&osShimEcbs[(n) - 1])
+
+#define OS_TASK_BEGIN()  switch (osShimCurrent -> resume) { case 0:
+#define OS_TASK_END()    }
+
+#define OS_Yield() \
+  do { osShimSwitch(OSTCB_ELIGIBLE, 0, __LINE__); return; case __LINE__: ; } while (0)
+#define OS_Delay(ticks) \
+  do { osShimSwitch((ticks) ? OSTCB_DELAYED : OSTCB_STOPPED, ticks, __LINE__); return; case __LINE__: ; } while (0)
+#define OS_WaitBinSem(ecbP, timeout) \
+  do { if (!osShimTryWait(ecbP, timeout, __LINE__)) { return; case __LINE__: ; } } while (0)
+#define OSTimedOut() (osShimCurrent -> timedOut)
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: OSInit
+   Description:
+    Destroys all tasks and semaphores and clears the tick count.
+*/
+void OSInit(void);
+
+/* Name: OSCreateTask
+   Parameters:
+    OStypeTFP function - task function
+    OStypeTcbP tcbP - OSTCBP(n), 1 <= n <= OSTASKS
+    OStypePrio prio - 0 (highest) to OSLOWEST_PRIO
+   Return value:
+    OStypeErr - OSNO_ERR, or OSERR_BAD_P if tcbP or prio is out of range
+   Description:
+    Creates an eligible task that starts at OS_TASK_BEGIN() on its first dispatch.
+*/
+OStypeErr OSCreateTask(OStypeTFP function, OStypeTcbP tcbP, OStypePrio prio);
+
+/* Name: OSSched
+   Description:
+    Runs the highest priority eligible task until its next context switch.  Returns at once if no task is eligible.
+*/
+void OSSched(void);
+
+/* Name: OSTimer
+   Description:
+    Advances the tick count and the delays and timeouts of all tasks by one tick.  Call at OS_TICK_HZ (see clock.h);
+    safe from an interrupt.
+*/
+void OSTimer(void);
+
+/* Name: OSGetTicks
+   Return value:
+    OStypeTick - OSTimer() calls since OSInit()
+*/
+OStypeTick OSGetTicks(void);
+
+/* Name: OSTaskRunning
+   Return value:
+    OStypeTcbP - task being dispatched, 0 outside OSSched()
+*/
+OStypeTcbP OSTaskRunning(void);
+
+/* Name: OSCreateBinSem, OSSignalBinSem, OSTryBinSem
+   Parameters:
+    OStypeEcbP ecbP - OSECBP(n), 1 <= n <= OSEVENTS
+    OStypeBinSem value - initial value, 0 or 1
+   Return value:
+    OStypeErr - OSNO_ERR, OSERR_BAD_P for a bad pointer, OSERR_EVENT_FULL when signaling a semaphore that is already 1
+    OStypeBinSem - OSTryBinSem(): 1 if the semaphore was available, and takes it
+   Description:
+    Signaling a semaphore with tasks waiting makes the highest priority of them eligible instead of setting it.
+    OSSignalBinSem() is safe from an interrupt.
+*/
+OStypeErr OSCreateBinSem(OStypeEcbP ecbP, OStypeBinSem value);
+OStypeErr OSSignalBinSem(OStypeEcbP ecbP);
+OStypeBinSem OSTryBinSem(OStypeEcbP ecbP);
+
+/* Name: osShimSwitch, osShimTryWait
+   Description:
+    Used by the context switch macros above, not called directly.
+*/
+void osShimSwitch(char state, OStypeDelay delay, unsigned int line);
+char osShimTryWait(OStypeEcbP ecbP, OStypeDelay timeout, unsigned int line);
+
+#endif
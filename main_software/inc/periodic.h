@@ -0,0 +1,114 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None, times come from clock.h
+   Modifications:
+    None
+   Purpose:
+    Periodic releases for Salvo tasks.  A periodic task is released every period OS ticks, starting phase ticks after
+    periodicInit(), and should finish each job within deadline ticks of its release.  Releases are computed from the
+    OS tick count, not from when the task last ran, so the rate does not drift with the load; a task that finishes late
+    skips the releases it missed instead of running back to back.  Usage, with delay static:
+
+      periodicInit(&period, 2, 2, 0);
+      while (1) {
+        delay = periodicDelay(&period);
+        if (delay) {
+          TASK_DELAY(id, delay);
+        } else {
+          TASK_YIELD(id); //Released already, let equal priorities have a turn
+        }
+        periodicStart(&period);
+        ...job...
+        periodicDone(&period);
+      }
+
+    Each task keeps statistics: how late its jobs started after their release (release jitter), the shortest and longest
+    time between two starts (sample period), and the overruns (jobs that finished past their deadline) and releases
+    skipped.  Give the periodic task the highest priority; the lower ones run in the slack between its jobs.
+*/
+
+#ifndef PERIODIC_H
+#define PERIODIC_H
+
+/* DATATYPES */
+
+/* Name: Periodic_s
+   Type: struct
+   Parameters:
+    unsigned long release - OS tick of the current release
+    unsigned long lastStart - clockGetMicroseconds() at the last periodicStart()
+    unsigned char period - OS ticks between releases
+    unsigned char deadline - OS ticks after a release by which the job must be finished
+    unsigned int jobs - jobs started
+    unsigned int overruns - jobs finished past their deadline
+    unsigned int skipped - releases dropped because the previous job ran into them
+    unsigned long latencyTotal - sum of release jitter (us)
+    unsigned int latencyMax - largest release jitter (us)
+    unsigned long periodMin, periodMax - shortest and longest time between two starts (us)
+   Purpose:
+    State and statistics of one periodic task.
+*/
+struct Periodic_s {
+  unsigned long release;
+  unsigned long lastStart;
+  unsigned char period;
+  unsigned char deadline;
+  unsigned int jobs;
+  unsigned int overruns;
+  unsigned int skipped;
+  unsigned long latencyTotal;
+  unsigned int latencyMax;
+  unsigned long periodMin;
+  unsigned long periodMax;
+};
+typedef struct Periodic_s Periodic;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: periodicInit
+   Parameters:
+    Periodic* periodic - periodic task state
+    unsigned char period - OS ticks between releases, 1 or more
+    unsigned char deadline - OS ticks after a release by which each job must finish, normally period
+    unsigned char phase - OS ticks to the first release
+   Description:
+    Sets up the releases and clears the statistics.
+*/
+void periodicInit(Periodic* periodic, unsigned char period, unsigned char deadline, unsigned char phase);
+
+/* Name: periodicDelay
+   Parameters:
+    Periodic* periodic - periodic task state
+   Return value:
+    unsigned char - OS ticks to delay until the next release, 0 if it is due already
+   Description:
+    Moves past releases that have gone by without a job, counting them as skipped, and gives the wait for the next.
+*/
+unsigned char periodicDelay(Periodic* periodic);
+
+/* Name: periodicStart
+   Parameters:
+    Periodic* periodic - periodic task state
+   Description:
+    Marks the start of a job, call first thing after being released.  Records the release jitter and sample period.
+*/
+void periodicStart(Periodic* periodic);
+
+/* Name: periodicDone
+   Parameters:
+    Periodic* periodic - periodic task state
+   Description:
+    Marks the end of a job: counts an overrun if it is past the deadline and moves to the next release.
+*/
+void periodicDone(Periodic* periodic);
+
+/* Name: periodicReport
+   Parameters:
+    const char* name - printed with the statistics
+    const Periodic* periodic - periodic task state
+   Description:
+    Prints the statistics through the debug I/O.
+*/
+void periodicReport(const char* name, const Periodic* periodic);
+
+#endif
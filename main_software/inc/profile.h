@@ -0,0 +1,114 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Timer B, counting ACLK (32768 Hz) in continuous mode, only in PROFILE builds
+   Modifications:
+    TBCTL
+   Purpose:
+    Task-level profiler for the Salvo tasks.  Salvo's dispatcher is in the library and cannot be hooked, so tasks switch
+    context through TASK_YIELD() and TASK_DELAY() instead of OS_Yield() and OS_Delay().  In PROFILE builds these record,
+    per task:
+     - how often it ran and for how long in total
+     - its longest run between two context switches (how long it held the CPU)
+     - how long it waited to be dispatched after a yield, and how many ticks late it woke from a delay
+    Without PROFILE they are plain OS_Yield()/OS_Delay() and this module adds nothing.  Run times use Timer B ticks
+    (PROFILE_TIMER_HZ), so a single run or yield wait over two seconds wraps.  Not for BENCHMARK builds, which use Timer B
+    to count cycles.
+*/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "os.h"
+#include "salvocfg.h"
+
+#if defined(PROFILE) && defined(BENCHMARK)
+#error "PROFILE and BENCHMARK both use Timer B"
+#endif
+
+/* CONSTANTS */
+#define PROFILE_TASKS         OSTASKS
+#define PROFILE_TIMER_HZ      32768UL //ACLK
+#define PROFILE_PACKED_BYTES  23 //Telemetry payload for one task, see profilePack()
+
+/* MACROS */
+#ifdef PROFILE
+#define TASK_START(id)        profileResume(id)
+#define TASK_YIELD(id)        do { profileSuspend(id, 0); OS_Yield(); profileResume(id); } while (0)
+#define TASK_DELAY(id, ticks) do { profileSuspend(id, ticks); OS_Delay(ticks); profileResume(id); } while (0)
+#else
+#define TASK_START(id)
+#define TASK_YIELD(id)        OS_Yield()
+#define TASK_DELAY(id, ticks) OS_Delay(ticks)
+#endif
+
+/* DATATYPES */
+
+/* Name: TaskProfile_s
+   Type: struct
+   Parameters:
+    unsigned long runs - times the task was dispatched
+    unsigned long runTime - total time running (PROFILE_TIMER_HZ ticks)
+    unsigned int longestRun - longest time between being dispatched and switching context (PROFILE_TIMER_HZ ticks)
+    unsigned int longestYieldWait - longest time from OS_Yield() to being dispatched again (PROFILE_TIMER_HZ ticks)
+    unsigned int longestDelayLate - most OS ticks a delay ran over what was asked for
+    unsigned int yields - context switches through TASK_YIELD()
+    unsigned int delays - context switches through TASK_DELAY()
+   Purpose:
+    Profile of one task.
+*/
+struct TaskProfile_s {
+  unsigned long runs;
+  unsigned long runTime;
+  unsigned int longestRun;
+  unsigned int longestYieldWait;
+  unsigned int longestDelayLate;
+  unsigned int yields;
+  unsigned int delays;
+};
+typedef struct TaskProfile_s TaskProfile;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: profileInit
+   Description:
+    Clears all profiles and starts Timer B from ACLK.  Call from main() before the scheduler starts.
+*/
+void profileInit(void);
+
+/* Name: profileResume, profileSuspend
+   Parameters:
+    char id - task (TASK_ID_* in tasks.h)
+    unsigned char delay - OS ticks the task is about to wait, 0 for a yield
+   Description:
+    Used by the TASK_ macros, not called directly.
+*/
+void profileResume(char id);
+void profileSuspend(char id, unsigned char delay);
+
+/* Name: profileGet
+   Return value:
+    const TaskProfile* - profile of task id, read only, 0 if id is out of range
+*/
+const TaskProfile* profileGet(char id);
+
+/* Name: profilePack
+   Parameters:
+    char id - task
+    unsigned long tick - now
+    unsigned char* out - PROFILE_PACKED_BYTES bytes
+   Return value:
+    char - 1 if packed, 0 if id is out of range
+   Description:
+    Writes the profile of task id as a TELEMETRY_HEALTH payload (downlink.h queues one per health packet, the tasks in
+    turn), little endian: tick (4), id (1), then the fields of TaskProfile_s (4, 4, 2, 2, 2, 2, 2 bytes).  Its length
+    tells it from the health packet; ground_software/tlmdecode.c decodes both.
+*/
+char profilePack(char id, unsigned long tick, unsigned char* out);
+
+/* Name: profileReport
+   Description:
+    Prints all profiles, in microseconds, through the debug I/O.
+*/
+void profileReport(void);
+
+#endif
@@ -0,0 +1,90 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    MSP430F2618: P3.6 - UCA1TXD, P3.7 - UCA1RXD, to the radio modem's serial port
+   Modifications:
+    P3SEL (P3.6 and P3.7), UCA1 registers, UCA1TXIE and UCA1RXIE in UC1IE
+   Purpose:
+    Serial link to the radio.  The modem is transparent: bytes written to it go out over the air as they are, and bytes
+    from the ground come back the same way, so framing is up to the caller (telemetry.h, command.h).  Frames are copied
+    into a transmit ring and sent by the USCI interrupt; received bytes go into a receive ring, where the caller parses
+    them in place.  Nothing here ever waits on the UART.
+
+    UCA1 shares its interrupt vectors with UCB1, the secondary I2C interface.  The routines in i2c_driver.c call
+    radioServiceTx() and radioServiceRx(), which only look at the UCA1 flags.
+*/
+
+#ifndef RADIO_H
+#define RADIO_H
+
+#include "data.h"
+
+/* CONSTANTS */
+#define RADIO_BAUD              9600 //Modem's serial rate, 8N1
+#define RADIO_BYTES_PER_SECOND  (RADIO_BAUD / 10) //Start and stop bit per byte
+#define RADIO_TX_LEN            128 //Transmit ring, a power of two, over two frames so the UART runs on while one waits
+#define RADIO_RX_LEN            64 //Receive ring, a power of two, holds a COMMAND_FRAME_MAX frame (command.h)
+#define RADIO_PINS              (BIT6 + BIT7) //P3
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: radioInit
+   Description:
+    Sets up UCA1 for RADIO_BAUD from the current SMCLK, empties both rings and enables the receive interrupt.
+*/
+void radioInit(void);
+
+/* Name: radioSetSourceClock
+   Parameters:
+    unsigned long smclkHz - SMCLK frequency from now on
+   Description:
+    Reprograms the baud rate divider for the new clock.  Called by the clock manager on every profile change, like
+    i2cSetSourceClock().  Does nothing before radioInit().
+*/
+void radioSetSourceClock(unsigned long smclkHz);
+
+/* Name: radioSend
+   Parameters:
+    const unsigned char* frame - bytes to send
+    unsigned char length - number of bytes
+   Return value:
+    char - 1 if the frame was queued, 0 if the transmit ring has no room for all of it (nothing is queued)
+*/
+char radioSend(const unsigned char* frame, unsigned char length);
+
+/* Name: radioGetTxFree
+   Return value:
+    unsigned int - bytes radioSend() can take right now
+*/
+unsigned int radioGetTxFree(void);
+
+/* Name: radioRxPeek
+   Parameters:
+    const unsigned char** ring - set to the receive ring, RADIO_RX_LEN bytes
+    unsigned char* head - set to the ring index of the oldest byte
+   Return value:
+    unsigned char - bytes received from head on; they stay put until radioRxDrop()
+   Description:
+    For parsing in place (command.h).
+*/
+unsigned char radioRxPeek(const unsigned char** ring, unsigned char* head);
+
+/* Name: radioRxDrop
+   Parameters:
+    unsigned char count - oldest bytes to drop, no more than radioRxPeek() returned
+*/
+void radioRxDrop(unsigned char count);
+
+/* Name: radioGetHealth
+   Return value:
+    const RadioHealth* - byte counters since radioInit(), read only
+*/
+const RadioHealth* radioGetHealth(void);
+
+/* Name: radioServiceTx, radioServiceRx
+   Description:
+    Interrupt service for UCA1, called from the shared USCIAB1 vectors.  Move one byte each.
+*/
+void radioServiceTx(void);
+void radioServiceRx(void);
+
+#endif
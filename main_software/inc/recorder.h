@@ -0,0 +1,123 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    SD card (see sd_card.h)
+   Modifications:
+    None beyond those made by the SD card driver
+   Purpose:
+    Black-box recorder.  Packs every IMU sample into 512-byte log blocks (format in log_format.h) and appends them to the
+    SD card with multiple block writes.  At boot the write pointer is found by binary search over the log instead of
+    scanning the card, one block read per step.  Like antenna.h, the work is split into short steps run by a Salvo task.
+*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "sd_card.h"
+#include "log_format.h"
+#include "clock.h"
+
+/* CONSTANTS */
+#define RECORDER_BLOCK_BUFFERS      3 //Blocks of RAM, one is filled while the others wait for the card
+#define RECORDER_BURST_BLOCKS       2 //Full blocks to collect before a multiple block write
+#define RECORDER_IDLE_TICKS         (OS_TICK_HZ / 10) //How often to check for full blocks
+#define RECORDER_RETRY_TICKS        OS_TICK_HZ //Wait before retrying a failed card operation
+#define RECORDER_MAX_FAULTS         10 //Consecutive card errors before the recorder gives up
+
+/* DATATYPES */
+
+/* Name: RecorderState_e
+   Type: enum
+   Values:
+    REC_STARTING - Initializing the card
+    REC_RECOVERING - Looking for the end of the existing log
+    REC_RUNNING - Appending blocks
+    REC_FAILED - Card unusable, samples are dropped
+   Purpose:
+    States of the recorder.
+*/
+enum RecorderState_e {REC_STARTING = 0,
+                      REC_RECOVERING = 1,
+                      REC_RUNNING = 2,
+                      REC_FAILED = 3};
+typedef enum RecorderState_e RecorderState;
+
+/* Name: RecorderHealth_s
+   Type: struct
+   Parameters:
+    RecorderState state - current state
+    unsigned long nextOffset - block (relative to LOG_FIRST_BLOCK) the next write goes to
+    unsigned long nextSequence - sequence number of the next block written
+    unsigned long blocksWritten - blocks written since boot
+    unsigned int droppedSamples - samples lost because every block buffer was full
+    char highCapacity - 1 if the card is addressed by block (SDCard.isHighCapacity)
+    char faults - consecutive card errors
+    SDError lastError - last error returned by the SD driver
+   Purpose:
+    Keeps track of the recorder, for the health task.
+*/
+struct RecorderHealth_s {
+  RecorderState state;
+  unsigned long nextOffset;
+  unsigned long nextSequence;
+  unsigned long blocksWritten;
+  unsigned int droppedSamples;
+  char highCapacity;
+  char faults;
+  SDError lastError;
+};
+typedef struct RecorderHealth_s RecorderHealth;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: recorderInit
+   Description:
+    Empties the block buffers and starts over at REC_STARTING.  The first call takes the buffers from the arena.  After
+    a warm restart (watchdog.h) that found the recorder running, it carries on at REC_RUNNING with the card and the log
+    position it had; if the card turns out to have been reset too, the first card error initializes it again and goes
+    back to running at the same position, without searching the log.
+*/
+void recorderInit(void);
+
+/* Name: recorderAddSample
+   Parameters:
+    unsigned long tick - time of the sample (clockGetTicks())
+    const char* gyro - LOG_AXIS_BYTES raw gyroscope bytes
+    const char* magnet - LOG_AXIS_BYTES raw magnetometer bytes
+   Description:
+    Copies one sample into the block being filled.  Constant time, never touches the card, so it is safe to call from the
+    acquisition task.  Samples are accepted before the card is ready and dropped (and counted) only when all buffers are full, or before
+    recorderInit() has run.
+*/
+void recorderAddSample(unsigned long tick, const char* gyro, const char* magnet);
+
+/* Name: recorderStep
+   Return value:
+    unsigned char - number of Salvo ticks to wait before calling again, 0 if the caller should only yield
+   Description:
+    Advances the recorder: a few tries at card initialization (once bootWait() lets the card start), one read of the
+    search for the end of the log, or one multiple block write.
+*/
+unsigned char recorderStep(void);
+
+/* Name: recorderReadLog
+   Parameters:
+    unsigned long offset - log block, relative to LOG_FIRST_BLOCK like RecorderHealth.nextOffset
+    unsigned int start - first byte wanted in the block
+    unsigned char* buffer - length bytes
+    unsigned char length - bytes wanted, start + length no more than LOG_BLOCK_SIZE
+   Return value:
+    char - 1 if read, 0 if the card cannot be read right now (not running yet, bus or card busy; try again later), -1
+           if it never will be (bad range, card failed or read error)
+   Description:
+    For the bulk download (bulk.h).  Reads from the card whatever is there, including blocks not yet written in this
+    pass over the card; the ground checks them with logBlockIsValid().  Holds the bus for one block read.
+*/
+char recorderReadLog(unsigned long offset, unsigned int start, unsigned char* buffer, unsigned char length);
+
+/* Name: recorderGetHealth
+   Return value:
+    const RecorderHealth* - current recorder state, read only
+*/
+const RecorderHealth* recorderGetHealth(void);
+
+#endif
@@ -0,0 +1,97 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None (replaces the I2C hardware)
+   Modifications:
+    None
+   Purpose:
+    Replay mode, built when I2C_REPLAY is defined.  The I2C driver stops touching the USCI registers and hands every
+    message to replayTransfer(), which plays the IMU and magnetometer back from a recorded trace.  The rest of the
+    software (acquisition, recorder, everything downstream) runs unchanged, so a bench or flight run can be repeated
+    exactly in the simulator, as fast as the CPU allows.
+
+    The trace is a run of log blocks (log_format.h) linked into the image as replayTrace/replayTraceBlocks.  Generate it
+    from an SD card image with:
+      flightlog trace <image> <first block> <blocks> > replay_trace.c
+    and add replay_trace.c to the project.
+
+    Reads of GYROSCOPE_START from IMU_I2C_ADDR and of MAGNET_START from MAGNET_I2C_ADDR each take the next sample of their
+    sensor from the trace (wrapping at the end).  Accelerometer reads return zeros, the log has no accelerometer.
+    IMU_INT_PIN_CFG_REG reads back what was last written to it, as samplerInit() checks.  Any other message succeeds
+    with an all-zero response.
+
+    Both devices convert at the rate last written to them (IMU_SMPLRT_DIV_REG, MAGNET_CNTL1_REG), timed by
+    clockGetMicroseconds(), and report it in their data-ready bits: IMU_INT_STATUS_REG is cleared by reading it,
+    MAGNET_ST1_REG by reading the data.  Until a rate is written a device always reports new data.  The
+    IMU's INT line is simulated with Timer A CCR1, which fires at each conversion and calls drdyEdge() with the
+    conversion time.  A burst read from ACCEL_START through the gyroscope (DRDY_READ_LEN) takes the next gyroscope
+    sample.
+*/
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "i2c_driver.h"
+
+/* DATATYPES */
+
+/* Name: ReplayStats_s
+   Type: struct
+   Parameters:
+    unsigned long gyroSamples - gyroscope reads served from the trace
+    unsigned long magnetSamples - magnetometer reads served from the trace
+    unsigned long otherMessages - messages answered with zeros
+    unsigned int gyroWraps - times the gyroscope cursor went past the end of the trace
+    unsigned int magnetWraps - times the magnetometer cursor went past the end of the trace
+    unsigned long accelSamples - accelerometer reads
+    unsigned long statusReads - data-ready reads of either device
+   Purpose:
+    Throughput of a replay run.  Divide by elapsed time for samples per second.
+*/
+struct ReplayStats_s {
+  unsigned long gyroSamples;
+  unsigned long magnetSamples;
+  unsigned long otherMessages;
+  unsigned int gyroWraps;
+  unsigned int magnetWraps;
+  unsigned long accelSamples;
+  unsigned long statusReads;
+};
+typedef struct ReplayStats_s ReplayStats;
+
+
+/* VARIABLES */
+extern const unsigned char replayTrace[]; //Generated, see above
+extern const unsigned long replayTraceBlocks;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: replayInit
+   Parameters:
+    const unsigned char* trace - log blocks to play back
+    unsigned long blocks - number of blocks in trace
+   Description:
+    Rewinds both sensors to the first sample of the trace and clears the statistics.
+*/
+void replayInit(const unsigned char* trace, unsigned long blocks);
+
+/* Name: replayTransfer
+   Parameters:
+    I2CMessage* messageStruct - initialized message, as passed to i2cSendMessage() or i2cStartMessage()
+   Description:
+    Completes the message immediately: fills the response and sets error to I2CERR_NO_ERROR.
+*/
+void replayTransfer(I2CMessage* messageStruct);
+
+/* Name: replayGetStats
+   Return value:
+    const ReplayStats* - statistics since replayInit(), read only
+*/
+const ReplayStats* replayGetStats(void);
+
+/* Name: replayTick
+   Description:
+    Arms the simulated INT line for the OS tick that just started.  Called by the Timer A interrupt in replay builds.
+*/
+void replayTick(void);
+
+#endif
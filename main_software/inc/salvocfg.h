@@ -1,6 +1,8 @@
 //Project: Clean Slate
 
+#ifndef OS_SHIM_HOST
 #include <msp430.h>
+#endif
 
 #define OSENABLE_TASKS        TRUE
 #define OSUSE_LIBRARY         TRUE
@@ -10,4 +12,4 @@
 #define OSEVENTS              1
 #define OSEVENT_FLAGS         0
 #define OSMESSAGE_QUEUES      0
-#define OSTASKS               2
+#define OSTASKS               6
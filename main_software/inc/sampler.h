@@ -0,0 +1,122 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    SECONDARY I2C interface (MPU-9250 and AK8963)
+   Modifications:
+    None
+   Purpose:
+    Multi-rate sampling of the gyroscope, accelerometer and magnetometer.  task_getIMUData calls samplerStep() on every
+    release (TASK_IMU_PERIOD_TICKS), and each sensor is polled every SAMPLER_*_RELEASES releases, fastest first (rate
+    monotonic order).  A poll reads the device's data-ready bit and only reads the data when there is a new sample, so a
+    sensor polled faster than it converts costs a two byte status read instead of a full data read.
+
+    The gyroscope and accelerometer share the MPU-9250's sample rate (SAMPLER_IMU_HZ) and its data-ready bit, which is
+    cleared by reading it: one status read per release serves both, and neither should be polled faster than
+    SAMPLER_IMU_HZ.  With SAMPLER_IMU_DRDY they are not polled at all but read on the IMU's data-ready interrupt (see
+    drdy.h), at the full SAMPLER_IMU_HZ; the task takes those samples with drdyNext().  The magnetometer converts at the
+    rate set by SAMPLER_MAGNET_MODE (8 or 100 Hz) and is always polled.
+*/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "i2c_peripherals.h"
+
+/* CONSTANTS */
+#define SAMPLER_IMU_DRDY          1 //Gyro and accel on the data-ready interrupt, 0 to poll them
+
+//Releases between polls, one release every TASK_IMU_PERIOD_TICKS (tasks.h); CONFIG_*_RELEASES (config.h) if stored
+#define SAMPLER_GYRO_RELEASES     1 //100 Hz
+#define SAMPLER_ACCEL_RELEASES    2 //50 Hz
+#define SAMPLER_MAGNET_RELEASES   4 //25 Hz polls for 8 Hz data, at most 40 ms old
+
+//Device rates
+#define SAMPLER_IMU_HZ            200 //Divides IMU_INTERNAL_HZ; DECIM_RATIO (decim.h) times the storage rate
+#define SAMPLER_MAGNET_MODE       MAGNET_MODE_CONT_8HZ
+
+#define SAMPLER_DATA_BYTES        6 //Raw bytes kept per sensor, three axes
+#define SAMPLER_NEW(sensor)       (1 << (sensor)) //Bit of samplerStep()'s result
+
+/* DATATYPES */
+
+/* Name: SamplerSensor_e
+   Type: enum
+   Values:
+    SENSOR_GYRO (0) - MPU-9250 gyroscope, big endian
+    SENSOR_ACCEL (1) - MPU-9250 accelerometer, big endian
+    SENSOR_MAGNET (2) - AK8963 magnetometer, little endian
+    SENSOR_COUNT (3) - number of sensors, not a sensor
+*/
+enum SamplerSensor_e {SENSOR_GYRO = 0,
+                      SENSOR_ACCEL = 1,
+                      SENSOR_MAGNET = 2,
+                      SENSOR_COUNT = 3};
+typedef enum SamplerSensor_e SamplerSensor;
+
+/* Name: SamplerStats_s
+   Type: struct
+   Parameters:
+    unsigned long polls - times the sensor was due
+    unsigned long statusReads - data-ready reads on the bus (fewer than polls where a status read is shared)
+    unsigned long dataReads - data reads on the bus, one per new sample
+    unsigned long dataBytes - bytes received by the data reads
+    unsigned int stale - polls that found no new sample
+    unsigned int errors - polls that failed on the bus
+   Purpose:
+    Bus use of one sensor since samplerInit().
+*/
+struct SamplerStats_s {
+  unsigned long polls;
+  unsigned long statusReads;
+  unsigned long dataReads;
+  unsigned long dataBytes;
+  unsigned int stale;
+  unsigned int errors;
+};
+typedef struct SamplerStats_s SamplerStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: samplerInit
+   Return value:
+    char - 1 on success, 0 if the message buffers did not fit in the arena or the MPU-9250 did not take the bypass
+   Description:
+    Takes its I2C message from the arena, initializes the SECONDARY interface (at CONFIG_IMU_BUS_KHZ if stored), turns
+    on the MPU-9250's I2C bypass (INT_PIN_CFG) and reads it back, since the magnetometer is unreachable without it, and
+    sets the device rates, then starts drdy.h if SAMPLER_IMU_DRDY.  Call once from task_getIMUData (blocking I2C).
+*/
+char samplerInit(void);
+
+/* Name: samplerStep
+   Return value:
+    unsigned char - SAMPLER_NEW() bits of the sensors that delivered a new sample
+   Description:
+    One release: polls the sensors that are due, in rate monotonic order, blocking on each transfer.
+*/
+unsigned char samplerStep(void);
+
+/* Name: samplerSetReleases
+   Parameters:
+    SamplerSensor sensor - sensor to change
+    unsigned char count - releases between polls from now on, 1 or more
+   Return value:
+    char - 1 if changed, 0 if the sensor is not polled (on the data-ready interrupt) or count is 0
+   Description:
+    Changes a polled sensor's rate, as the SAMPLER_*_RELEASES above do at boot.  It is polled on the next release.
+*/
+char samplerSetReleases(SamplerSensor sensor, unsigned char count);
+
+/* Name: samplerGetData
+   Parameters:
+    SamplerSensor sensor - sensor to read
+   Return value:
+    const char* - SAMPLER_DATA_BYTES raw bytes of its latest sample (zeros before the first)
+*/
+const char* samplerGetData(SamplerSensor sensor);
+
+/* Name: samplerGetStats
+   Return value:
+    const SamplerStats* - bus use of the sensor, read only
+*/
+const SamplerStats* samplerGetStats(SamplerSensor sensor);
+
+#endif
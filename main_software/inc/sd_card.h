@@ -0,0 +1,218 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    P3.1 - UCB0SIMO (shared with primary I2C SDA, goes through isolator on MB)
+    P3.2 - UCB0SOMI (shared with primary I2C SCL, goes through isolator on MB)
+    P3.3 - UCB0CLK
+    P3.0 - -CS_SD/I2C_ON (low selects the SD card and cuts the I2C bus off, high reconnects the I2C bus)
+   Modifications:
+    P3SEL
+    P3DIR
+    P3OUT
+    UCB0CTL0
+    UCB0CTL1
+    UCB0BR0
+    UCB0BR1
+    IFG2
+   Purpose:
+    Minimal SD card driver (SPI mode, 512-byte blocks) for the flight log.  UCB0 is shared with the primary I2C bus, so
+    every access is bracketed by sdAcquireBus()/sdReleaseBus(), which switch UCB0 between SPI and I2C.  Callers must not
+    context switch while they hold the bus.
+*/
+
+#ifndef SD_CARD_H
+#define SD_CARD_H
+
+#include "msp430.h"
+#include "i2c_driver.h"
+#include "clock.h"
+
+/* DEFINITIONS */
+
+#define SD_BLOCK_SIZE         512
+#define SD_INIT_HZ            400000UL //Card must be clocked at 400 kHz or less until initialized
+#define SD_RUN_DIVIDER        1 //SMCLK / 1
+#define SD_CMD_TRIES          8 //Bytes to wait for an R1 response
+#define SD_INIT_TRIES         1000 //ACMD41 attempts before giving up
+#define SD_INIT_POLL_TRIES    8 //ACMD41 attempts per sdInitPoll(), about 4 ms at 400 kHz
+#define SD_TOKEN_MS           100 //Time to wait for a read token
+#define SD_BUSY_MS            500 //Time to wait for the card to finish programming a block
+#define SD_SPI_PINS           (BIT1 + BIT2 + BIT3)
+
+//Commands
+#define SD_CMD0               0 //GO_IDLE_STATE
+#define SD_CMD8               8 //SEND_IF_COND
+#define SD_CMD16              16 //SET_BLOCKLEN
+#define SD_CMD17              17 //READ_SINGLE_BLOCK
+#define SD_CMD23              23 //SET_WR_BLK_ERASE_COUNT (after CMD55)
+#define SD_CMD25              25 //WRITE_MULTIPLE_BLOCK
+#define SD_CMD41              41 //SD_SEND_OP_COND (after CMD55)
+#define SD_CMD55              55 //APP_CMD
+#define SD_CMD58              58 //READ_OCR
+
+//Tokens and responses
+#define SD_R1_IDLE            0x01
+#define SD_R1_ILLEGAL_CMD     0x04
+#define SD_TOKEN_READ         0xFE
+#define SD_TOKEN_MULTI_WRITE  0xFC
+#define SD_TOKEN_STOP_TRAN    0xFD
+#define SD_DATA_RESP_MASK     0x1F
+#define SD_DATA_ACCEPTED      0x05
+#define SD_OCR_CCS            0x40 //In the first OCR byte
+
+/* MACROS */
+#define SD_SELECT             ENABLE_ISOL_SD //Same pin
+#define SD_DESELECT           ENABLE_ISOL_I2C
+#define SD_TX_READY           (IFG2 & UCB0TXIFG)
+#define SD_RX_READY           (IFG2 & UCB0RXIFG)
+
+/* DATATYPES */
+
+/* Name: SDError_e
+   Type: enum
+   Values:
+    SDERR_NO_ERROR (0) - Method returned successfully.
+    SDERR_NO_CARD (1) - Card did not answer the reset command.
+    SDERR_UNSUPPORTED (2) - Card answered, but is not a card this driver can handle.
+    SDERR_TIMEOUT (3) - Card stopped answering, or stayed busy too long.
+    SDERR_WRITE_REJECTED (4) - Card rejected a data block (CRC or write error).
+    SDERR_READ_FAILED (5) - Card refused the read command or sent an error token.
+    SDERR_NOT_INITIALIZED (6) - sdInit() has not succeeded on this card.
+    SDERR_BUS_BUSY (7) - UCB0 is in the middle of an I2C transfer or its stop, try again later.
+   Purpose:
+    Provides information about the errors thrown by the SD methods
+*/
+enum SDError_e {SDERR_NO_ERROR = 0,
+                SDERR_NO_CARD = 1,
+                SDERR_UNSUPPORTED = 2,
+                SDERR_TIMEOUT = 3,
+                SDERR_WRITE_REJECTED = 4,
+                SDERR_READ_FAILED = 5,
+                SDERR_NOT_INITIALIZED = 6,
+                SDERR_BUS_BUSY = 7};
+typedef enum SDError_e SDError;
+
+/* Name: SDCard_s
+   Type: struct
+   Parameters:
+    char isHighCapacity - 1 for SDHC/SDXC (block addressed), 0 for SDSC (byte addressed)
+    char hasBus - 1 between sdAcquireBus() and sdReleaseBus()
+    SDError error - Error message.  Contains information about the last operation on this card.
+    char isInitialized - Set to IS_INITIALIZED by sdInit() once the card is ready for block transfers.
+    char isVersion2 - card answered CMD8 (sdInitStart())
+    unsigned int initTries - ACMD41 attempts so far (sdInitPoll())
+   Purpose:
+    State of the SD card.
+*/
+struct SDCard_s {
+  char isHighCapacity;
+  char hasBus;
+  SDError error;
+  char isInitialized;
+  char isVersion2;
+  unsigned int initTries;
+};
+typedef struct SDCard_s SDCard;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: sdAcquireBus
+   Parameters:
+    SDCard* card - card to talk to
+   Return value:
+    char - 1 if UCB0 is now in SPI mode with the card selected, 0 if an I2C transfer or its stop is in progress (error
+           set to SDERR_BUS_BUSY)
+   Description:
+    Takes the primary I2C interface (i2cAcquireInterface()) until sdReleaseBus(), so no I2C message can start meanwhile.
+*/
+char sdAcquireBus(SDCard* card);
+
+/* Name: sdReleaseBus
+   Parameters:
+    SDCard* card - card that holds the bus
+   Description:
+    Deselects the card (reconnecting the I2C bus through the isolator) and reinitializes UCB0 as the primary I2C interface.
+    The card may still be programming the last block; check with sdIsReady() next time.
+*/
+void sdReleaseBus(SDCard* card);
+
+/* Name: sdInit
+   Parameters:
+    SDCard* card - card to initialize, bus must be held
+   Errors:
+    SDERR_NO_CARD, SDERR_UNSUPPORTED, SDERR_TIMEOUT, SDERR_NO_ERROR
+   Description:
+    Puts the card in SPI mode, negotiates SDHC support, fixes the block length at 512 bytes, and raises the SPI clock.
+    Takes up to about a second, only call at boot.  sdInitStart() then sdInitPoll() until it returns 1, all in one go.
+*/
+void sdInit(SDCard* card);
+
+/* Name: sdInitStart
+   Parameters:
+    SDCard* card - card to initialize, bus must be held
+   Errors:
+    SDERR_NO_CARD, SDERR_UNSUPPORTED, SDERR_NO_ERROR (go on with sdInitPoll())
+   Description:
+    First part of sdInit(): puts the card in SPI mode and checks its version.  Takes about a millisecond.
+*/
+void sdInitStart(SDCard* card);
+
+/* Name: sdInitPoll
+   Parameters:
+    SDCard* card - card after sdInitStart(), bus must be held
+   Return value:
+    char - 1 when done (card initialized, or error set), 0 while the card is still starting up
+   Errors:
+    SDERR_UNSUPPORTED, SDERR_TIMEOUT (after SD_INIT_TRIES attempts in all), SDERR_NO_ERROR
+   Description:
+    Rest of sdInit(), SD_INIT_POLL_TRIES attempts at a time, so the bus can be released and the CPU given up between
+    calls while the card starts up (hundreds of milliseconds after power on).
+*/
+char sdInitPoll(SDCard* card);
+
+/* Name: sdIsReady
+   Parameters:
+    SDCard* card - card to check, bus must be held
+   Return value:
+    char - 1 if the card has finished programming and will accept a command
+*/
+char sdIsReady(SDCard* card);
+
+/* Name: sdReadBlock
+   Parameters:
+    SDCard* card - card to read from, bus must be held
+    unsigned long block - block number
+    unsigned char* buffer - SD_BLOCK_SIZE bytes
+   Errors:
+    SDERR_NOT_INITIALIZED, SDERR_READ_FAILED, SDERR_TIMEOUT, SDERR_NO_ERROR
+*/
+void sdReadBlock(SDCard* card, unsigned long block, unsigned char* buffer);
+
+/* Name: sdReadRange
+   Parameters:
+    SDCard* card - card to read from, bus must be held
+    unsigned long block - block number
+    unsigned int start - first byte of the block to keep
+    unsigned char* buffer - length bytes
+    unsigned int length - bytes to keep, start + length no more than SD_BLOCK_SIZE
+   Errors:
+    As sdReadBlock()
+   Description:
+    Reads the whole block from the card but only keeps part of it, for callers without a block of RAM to spare.
+*/
+void sdReadRange(SDCard* card, unsigned long block, unsigned int start, unsigned char* buffer, unsigned int length);
+
+/* Name: sdWriteBlocks
+   Parameters:
+    SDCard* card - card to write to, bus must be held
+    unsigned long block - number of the first block
+    unsigned char* const* buffers - count pointers to SD_BLOCK_SIZE bytes each, written to consecutive blocks
+    int count - number of blocks
+   Errors:
+    SDERR_NOT_INITIALIZED, SDERR_WRITE_REJECTED, SDERR_TIMEOUT, SDERR_NO_ERROR
+   Description:
+    Writes all blocks with one multiple block write (pre-erased with ACMD23).  Returns right after the stop token, without
+    waiting for the card to finish programming.
+*/
+void sdWriteBlocks(SDCard* card, unsigned long block, unsigned char* const* buffers, int count);
+
+#endif
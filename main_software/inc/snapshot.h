@@ -0,0 +1,206 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Event-triggered capture.  The sample history (data.h) is a ring that keeps the last second, so by the time anyone
+    looks, a tumble or a deployment shock has long been overwritten.  Every sample that goes into the history also goes
+    through the trigger rules below and into the armed snapshot, a ring of SNAPSHOT_LEN samples.  When a rule fires the
+    snapshot takes SNAPSHOT_POST more samples (the trigger sample first) and is then frozen, holding the SNAPSHOT_PRE
+    samples before the trigger and the SNAPSHOT_POST from it on, until the downlink releases it.  The next free snapshot
+    is armed at once.  Nothing is copied at the trigger, so the cost per sample is the same whether a rule fires or not:
+    one sample written and SNAPSHOT_RULES rules checked.
+
+    Rules compare each axis of the calibrated gyroscope or accelerometer against a level: the value crossing it
+    (SNAPSHOT_ABOVE, a tumble starting; staying above does not fire again) or the change since the previous sample
+    reaching it (SNAPSHOT_STEP, a shock).  Rules that fire while a
+    snapshot is taking its post-trigger samples are added to its causes, they do not start another one.  When every
+    snapshot is frozen, triggers are counted as dropped until one is released.
+
+    Kept free of MSP430 headers so ground_software/snapcheck.c can run it on synthetic and recorded traces; the
+    storage comes from the caller (dataInit() takes it from the arena).
+*/
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/* CONSTANTS */
+#define SNAPSHOT_PRE              16 //Samples before the trigger, 0.16 s at 100 Hz (32 did not fit in RAM, see arena.h)
+#define SNAPSHOT_POST             16 //Samples from the trigger on
+#define SNAPSHOT_LEN              (SNAPSHOT_PRE + SNAPSHOT_POST) //A power of two
+#define SNAPSHOT_BUFFERS          2
+#define SNAPSHOT_AXES             3
+
+//Trigger levels, calibrated counts at the MPU-9250's reset default ranges (131 per deg/s, 16384 per g)
+#define SNAPSHOT_TUMBLE_LEVEL     3930 //30 deg/s on any axis
+#define SNAPSHOT_GYRO_STEP_LEVEL  1310 //10 deg/s between two samples
+#define SNAPSHOT_SHOCK_LEVEL      8192 //0.5 g between two samples
+
+//Causes, one bit per rule (in the order of snapshotRules in snapshot.c) and one for snapshotTrigger()
+#define SNAPSHOT_CAUSE_TUMBLE     0x01
+#define SNAPSHOT_CAUSE_GYRO_STEP  0x02
+#define SNAPSHOT_CAUSE_SHOCK      0x04
+#define SNAPSHOT_CAUSE_COMMAND    0x80
+
+/* DATATYPES */
+
+/* Name: SnapshotSource_e, SnapshotTest_e
+   Type: enum
+   Purpose:
+    What a rule looks at: the gyroscope or accelerometer, and the value itself or its change since the last sample.
+*/
+enum SnapshotSource_e {SNAPSHOT_GYRO = 0,
+                       SNAPSHOT_ACCEL = 1};
+typedef enum SnapshotSource_e SnapshotSource;
+
+enum SnapshotTest_e {SNAPSHOT_ABOVE = 0,
+                     SNAPSHOT_STEP = 1};
+typedef enum SnapshotTest_e SnapshotTest;
+
+/* Name: SnapshotRule_s
+   Type: struct
+   Parameters:
+    SnapshotSource source - sensor the rule watches
+    SnapshotTest test - value or change
+    int level - fires when the magnitude on any axis crosses (SNAPSHOT_ABOVE) or steps by (SNAPSHOT_STEP) this much
+*/
+struct SnapshotRule_s {
+  SnapshotSource source;
+  SnapshotTest test;
+  int level;
+};
+typedef struct SnapshotRule_s SnapshotRule;
+
+/* Name: SnapshotSample_s
+   Type: struct
+   Parameters:
+    int gyro[SNAPSHOT_AXES] - calibrated gyroscope x, y, z
+    int accel[SNAPSHOT_AXES] - calibrated accelerometer x, y, z
+*/
+struct SnapshotSample_s {
+  int gyro[SNAPSHOT_AXES];
+  int accel[SNAPSHOT_AXES];
+};
+typedef struct SnapshotSample_s SnapshotSample;
+
+/* Name: SnapshotState_e
+   Type: enum
+   Values:
+    SNAPSHOT_FREE (0) - not in use
+    SNAPSHOT_ARMED (1) - recording, waiting for a trigger
+    SNAPSHOT_TRIGGERED (2) - taking the post-trigger samples
+    SNAPSHOT_FROZEN (3) - complete, waiting for the downlink
+*/
+enum SnapshotState_e {SNAPSHOT_FREE = 0,
+                      SNAPSHOT_ARMED = 1,
+                      SNAPSHOT_TRIGGERED = 2,
+                      SNAPSHOT_FROZEN = 3};
+typedef enum SnapshotState_e SnapshotState;
+
+/* Name: Snapshot_s
+   Type: struct
+   Parameters:
+    unsigned long triggerTick - tick of the trigger sample
+    unsigned int sequence - counts up by one per frozen snapshot, the downlink takes the lowest first
+    unsigned char cause - SNAPSHOT_CAUSE_* bits of the rules that fired
+    unsigned char pre - samples before the trigger, SNAPSHOT_PRE unless the snapshot was armed just before
+    unsigned char first - slot of the oldest sample once frozen
+    unsigned char next - slot the next sample goes to
+    unsigned char count - samples written since armed, up to SNAPSHOT_LEN
+    unsigned char post - post-trigger samples still to take
+    unsigned char state - SnapshotState
+    SnapshotSample samples[SNAPSHOT_LEN] - ring, read it through snapshotGetSample()
+   Purpose:
+    One capture.
+*/
+struct Snapshot_s {
+  unsigned long triggerTick;
+  unsigned int sequence;
+  unsigned char cause;
+  unsigned char pre;
+  unsigned char first;
+  unsigned char next;
+  unsigned char count;
+  unsigned char post;
+  unsigned char state;
+  SnapshotSample samples[SNAPSHOT_LEN];
+};
+typedef struct Snapshot_s Snapshot;
+
+#define SNAPSHOT_BYTES            (SNAPSHOT_BUFFERS * sizeof(Snapshot)) //See arena.h
+
+/* Name: SnapshotStats_s
+   Type: struct
+   Parameters:
+    unsigned long samples - samples checked
+    unsigned int triggers - snapshots triggered
+    unsigned int frozen - snapshots completed
+    unsigned int dropped - samples on which a rule fired with every snapshot frozen
+*/
+struct SnapshotStats_s {
+  unsigned long samples;
+  unsigned int triggers;
+  unsigned int frozen;
+  unsigned int dropped;
+};
+typedef struct SnapshotStats_s SnapshotStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: snapshotInit
+   Parameters:
+    Snapshot* buffers - SNAPSHOT_BYTES of storage, or 0 to leave capture off
+   Description:
+    Frees every snapshot and arms the first.
+*/
+void snapshotInit(Snapshot* buffers);
+
+/* Name: snapshotSample
+   Parameters:
+    const int* gyro - calibrated gyroscope x, y, z
+    const int* accel - calibrated accelerometer x, y, z
+    unsigned long tick - tick of the sample
+   Description:
+    Checks the rules and records the sample.  Call once per sample that goes into the history.
+*/
+void snapshotSample(const int* gyro, const int* accel, unsigned long tick);
+
+/* Name: snapshotTrigger
+   Parameters:
+    unsigned char cause - SNAPSHOT_CAUSE_* bits, SNAPSHOT_CAUSE_COMMAND for a request from the ground
+   Description:
+    Triggers the armed snapshot on the next sample, as if a rule had fired.
+*/
+void snapshotTrigger(unsigned char cause);
+
+/* Name: snapshotNext
+   Return value:
+    Snapshot* - the frozen snapshot with the lowest sequence, 0 if none is waiting
+*/
+Snapshot* snapshotNext(void);
+
+/* Name: snapshotGetSample
+   Parameters:
+    const Snapshot* snapshot - a frozen snapshot
+    unsigned char n - 0 for the oldest sample; the trigger sample is snapshot->pre
+   Return value:
+    const SnapshotSample* - the sample, 0 past the last one (pre + SNAPSHOT_POST samples)
+*/
+const SnapshotSample* snapshotGetSample(const Snapshot* snapshot, unsigned char n);
+
+/* Name: snapshotRelease
+   Parameters:
+    Snapshot* snapshot - from snapshotNext(), once it has been sent
+   Description:
+    Frees the snapshot; it is armed at once if no other snapshot is recording.
+*/
+void snapshotRelease(Snapshot* snapshot);
+
+/* Name: snapshotGetStats
+   Return value:
+    const SnapshotStats* - counters since snapshotInit()
+*/
+const SnapshotStats* snapshotGetStats(void);
+
+#endif
@@ -2,16 +2,27 @@
    Purpose: Defines Salvo tasks for software
 */
 
-#include "salvo.h"
+#include "os.h"
 #include "msp430.h"
+#include "periodic.h"
 
 #ifndef TASKS_H
 #define TASKS_H
 
+/* CONSTANTS */
+#define TASK_IMU_PERIOD_TICKS   1 //Sampler base rate, OS_TICK_HZ = 100 Hz, sensor rates in sampler.h
+#define TASK_IMU_DEADLINE_TICKS TASK_IMU_PERIOD_TICKS
+
+/* GLOBALS */
+extern Periodic imuPeriodic; //Release statistics of task_getIMUData
+
 /* TASK PROTOTYPES */
 
 /* Name: task_getIMUData
-   Purpose: Gets data from IMU over I2C bus.  This includes gyroscope and magnetometer data (?).
+   Purpose: Gets data from IMU over I2C bus.  This includes gyroscope, accelerometer and magnetometer data, each at its
+            own rate (see sampler.h), calibrated (calib.h) and, for interrupt driven gyroscope and accelerometer samples,
+            decimated to the storage rate (decim.h).  Periodic (see periodic.h), released every TASK_IMU_PERIOD_TICKS at
+            the highest priority.
 */
 void task_getIMUData();
 
@@ -26,14 +37,43 @@ void task_kalmanFilter();
 void task_getHealth();
 
 /* Name: task_sendData
-   Purpose: Sends data (both Kalman filter results, and health data if available) through RFM radio to counterpart.
+   Purpose: Sends health packets, event snapshots and IMU frames through the radio to the ground (see downlink.h), most
+            valuable first (see telemetry.h).  Runs every DOWNLINK_PASS_TICKS at the lowest priority.
 */
 void task_sendData();
 
+/* Name: task_deployAntenna
+   Purpose: Runs the antenna deployment sequence (see antenna.h).  Runs at a lower priority than task_getIMUData and
+            waits with OS_Delay between steps, so burn-wire waits and status polling never hold the CPU.
+*/
+void task_deployAntenna();
+
+/* Name: task_recordData
+   Purpose: Writes the samples collected by task_getIMUData to the SD card (see recorder.h).  Holds the CPU only for the
+            duration of one multiple block write.
+*/
+void task_recordData();
+
 /* SALVO DEFINITIONS */
 #define TASK_GET_IMU_DATA OSTCBP(1)
 #define TASK_RUN_KALMAN_FILTER OSTCBP(2)
 #define TASK_GET_HEALTH_INFO OSTCBP(3)
 #define TASK_SEND_DATA OSTCBP(4)
+#define TASK_DEPLOY_ANTENNA OSTCBP(5)
+#define TASK_RECORD_DATA OSTCBP(6)
+
+/* PRIORITIES (0 is highest), acquisition first, everything else in its slack */
+#define TASK_PRIO_GET_IMU_DATA 10
+#define TASK_PRIO_RECORD_DATA 11
+#define TASK_PRIO_DEPLOY_ANTENNA 12
+#define TASK_PRIO_SEND_DATA 13
+
+/* PROFILER IDS (see profile.h), one below the Salvo task number */
+#define TASK_ID_GET_IMU_DATA 0
+#define TASK_ID_RUN_KALMAN_FILTER 1
+#define TASK_ID_GET_HEALTH_INFO 2
+#define TASK_ID_SEND_DATA 3
+#define TASK_ID_DEPLOY_ANTENNA 4
+#define TASK_ID_RECORD_DATA 5
 
 #endif
@@ -0,0 +1,179 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    None
+   Modifications:
+    None
+   Purpose:
+    Downlink packet queue.  Health packets, event snapshots, routine IMU frames, command replies and bulk download
+    chunks all wait here for the radio, one queue per class, in a fixed pool of TELEMETRY_SLOTS packets.  Each class has
+    a policy (telemetryPolicies in telemetry.c):
+
+      - how many slots it may hold, so a burst in one class never starves the others of room
+      - what happens when those are full: the oldest packet is dropped for the new one (data where only the latest
+        matters) or the new one is refused (data the producer will offer again, such as the rest of a snapshot)
+      - how old a packet may get before it is not worth sending (aged out when it reaches the head of its queue)
+      - strict priority, or a quantum for weighted fair sharing: strict classes are always served first, the others by
+        deficit round robin, so over time they get the link in proportion to their quanta whatever their packet sizes
+      - a byte budget per pass, so no class can take the whole of one pass of the sender
+
+    The sender calls telemetryBeginPass() each time it runs, then telemetryDequeue() with the bytes the link can take,
+    for as long as it returns frames.  Frames carry their own sync, length and CRC (TELEMETRY_FRAME_* below).
+
+    Kept free of MSP430 headers so ground_software/tlmsim.c can run it on simulated contact windows; the storage comes
+    from the caller (dataInit() takes it from the arena).
+*/
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* CONSTANTS */
+#define TELEMETRY_SLOTS           16 //Packets in the pool, shared out between the classes by telemetryPolicies
+#define TELEMETRY_PAYLOAD_MAX     48
+
+//Frame: sync (2), payload length (1), class (1), sequence (2, little endian), payload, CRC-16 over all before it (2)
+#define TELEMETRY_SYNC_0          0x50 //"PS"
+#define TELEMETRY_SYNC_1          0x53
+#define TELEMETRY_FRAME_HEADER    6
+#define TELEMETRY_FRAME_OVERHEAD  (TELEMETRY_FRAME_HEADER + 2)
+#define TELEMETRY_FRAME_MAX       (TELEMETRY_PAYLOAD_MAX + TELEMETRY_FRAME_OVERHEAD)
+
+/* DATATYPES */
+
+/* Name: TelemetryClass_e
+   Type: enum
+   Values:
+    TELEMETRY_HEALTH (0) - health packets (antenna, tasks, radio, queues)
+    TELEMETRY_SNAPSHOT (1) - event snapshots (snapshot.h), a few packets each
+    TELEMETRY_IMU (2) - routine IMU frames from the sample history
+    TELEMETRY_REPLY (3) - answers to commands from the ground (command.h)
+    TELEMETRY_BULK (4) - chunks of a bulk download (bulk.h)
+    TELEMETRY_CLASSES (5) - number of classes, not a class
+*/
+enum TelemetryClass_e {TELEMETRY_HEALTH = 0,
+                       TELEMETRY_SNAPSHOT = 1,
+                       TELEMETRY_IMU = 2,
+                       TELEMETRY_REPLY = 3,
+                       TELEMETRY_BULK = 4,
+                       TELEMETRY_CLASSES = 5};
+typedef enum TelemetryClass_e TelemetryClass;
+
+/* Name: TelemetryPolicy_s
+   Type: struct
+   Parameters:
+    unsigned char slots - most packets the class may have queued
+    unsigned char dropOldest - 1 to drop the oldest packet for a new one when the class is full, 0 to refuse the new one
+    unsigned char strict - 1 to serve before every class with 0 (in class order among strict classes)
+    unsigned int quantum - bytes of credit per round of the weighted classes; at least one full frame
+    unsigned int passBytes - most frame bytes sent per pass, 0 for no limit
+    unsigned int maxAgeTicks - packets older than this are dropped unsent, 0 to keep them until sent
+*/
+struct TelemetryPolicy_s {
+  unsigned char slots;
+  unsigned char dropOldest;
+  unsigned char strict;
+  unsigned int quantum;
+  unsigned int passBytes;
+  unsigned int maxAgeTicks;
+};
+typedef struct TelemetryPolicy_s TelemetryPolicy;
+
+/* Name: TelemetryPacket_s
+   Type: struct
+   Parameters:
+    unsigned long tick - when it was queued
+    unsigned char length - payload bytes
+    unsigned char next - slot of the next packet in the same queue, or of the next free slot
+    unsigned char payload[TELEMETRY_PAYLOAD_MAX]
+*/
+struct TelemetryPacket_s {
+  unsigned long tick;
+  unsigned char length;
+  unsigned char next;
+  unsigned char payload[TELEMETRY_PAYLOAD_MAX];
+};
+typedef struct TelemetryPacket_s TelemetryPacket;
+
+#define TELEMETRY_BYTES           (TELEMETRY_SLOTS * sizeof(TelemetryPacket)) //See arena.h
+
+/* Name: TelemetryStats_s
+   Type: struct
+   Parameters:
+    unsigned int queued - packets accepted
+    unsigned int sent - packets sent
+    unsigned int dropped - packets lost to a full queue (refused, or dropped for a newer one)
+    unsigned int aged - packets dropped for age
+    unsigned long bytes - frame bytes sent
+    unsigned long latencyTotal - sum over the sent packets of ticks from queued to sent
+    unsigned int latencyMax - longest of those (ticks)
+   Purpose:
+    Counters of one class since telemetryInit().
+*/
+struct TelemetryStats_s {
+  unsigned int queued;
+  unsigned int sent;
+  unsigned int dropped;
+  unsigned int aged;
+  unsigned long bytes;
+  unsigned long latencyTotal;
+  unsigned int latencyMax;
+};
+typedef struct TelemetryStats_s TelemetryStats;
+
+/* GLOBALS */
+extern const TelemetryPolicy telemetryPolicies[TELEMETRY_CLASSES]; //The flight policy
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: telemetryInit
+   Parameters:
+    TelemetryPacket* pool - TELEMETRY_BYTES of storage, or 0 to leave the queue off (every packet is refused)
+    const TelemetryPolicy* policies - one per class, normally telemetryPolicies; their slots must add up to
+                                      TELEMETRY_SLOTS at most
+   Description:
+    Empties every queue and clears the statistics.
+*/
+void telemetryInit(TelemetryPacket* pool, const TelemetryPolicy* policies);
+
+/* Name: telemetryPut
+   Parameters:
+    TelemetryClass type - class of the packet
+    const unsigned char* payload - packet contents
+    unsigned char length - bytes, TELEMETRY_PAYLOAD_MAX at most
+    unsigned long tick - now
+   Return value:
+    char - 1 if queued, 0 if refused (class full and not dropOldest, bad length, or no storage)
+*/
+char telemetryPut(TelemetryClass type, const unsigned char* payload, unsigned char length, unsigned long tick);
+
+/* Name: telemetryGetFree
+   Return value:
+    unsigned char - packets the class can take without dropping or refusing any
+*/
+unsigned char telemetryGetFree(TelemetryClass type);
+
+/* Name: telemetryBeginPass
+   Description:
+    Starts a new pass: every class gets its passBytes budget back.
+*/
+void telemetryBeginPass(void);
+
+/* Name: telemetryDequeue
+   Parameters:
+    unsigned char* frame - TELEMETRY_FRAME_MAX bytes, the frame goes here
+    unsigned int room - most bytes the frame may take (what the link can carry now)
+    unsigned long tick - now
+   Return value:
+    unsigned char - length of the frame, 0 if nothing is waiting within the pass budgets, or the frame due does not
+                    fit in room (keep room at least one TELEMETRY_FRAME_MAX when the link is idle)
+   Description:
+    Drops aged packets, picks the next packet by the policies and removes it from its queue.
+*/
+unsigned char telemetryDequeue(unsigned char* frame, unsigned int room, unsigned long tick);
+
+/* Name: telemetryGetStats
+   Return value:
+    const TelemetryStats* - counters of the class, read only
+*/
+const TelemetryStats* telemetryGetStats(TelemetryClass type);
+
+#endif
@@ -0,0 +1,165 @@
+/* Author: John Walnut
+   Hardware Dependencies:
+    Watchdog timer (WDT+), clocked from ACLK (LFXT1, see clock.h)
+   Modifications:
+    None
+   Purpose:
+    Task supervisor and warm restart.  The hardware watchdog resets the MCU unless it is cleared every
+    WATCHDOG_INTERVAL_MS, and only main() clears it (watchdogService(), between scheduler passes): each supervised task
+    checks in once per loop (watchdogCheckIn()), and the watchdog is cleared only while every one of them has done so
+    within its deadline below.  A task that stops checking in, or that holds the CPU, lets it run out.  The task that
+    was late is kept for the health packet.
+
+    A block of RAM that the startup code never clears (WatchdogKept, in the NO_INIT section) is checkpointed from the
+    kicks: the tick count, the end of the flight log, the antenna sequence and the place in the sample history.  The
+    sample history itself lives there too (ARENA_KEPT_OWNERS in arena.h).  At boot watchdogInit() checks the block
+    (magic number and CRC) and the reset cause; after anything but a power on reset, with the block intact, the boot is
+    warm and each module picks up where it was (watchdogGetKept()).  A reset in the middle of a checkpoint fails the CRC
+    and makes the boot cold.  On a warm boot:
+
+      - clock.h: the tick count carries on from the last checkpoint (watchdogStart())
+      - data.h: the sample history and its index are kept
+      - recorder.h: the card is not initialized again and the log not searched; if the card lost its state with the
+        MCU, the first card error initializes it again, and the log carries on at the same place
+      - antenna.h: a finished deployment stays finished, and the attempts made are not made again
+
+    Drivers that may wait close to WATCHDOG_INTERVAL_MS without returning to the scheduler (the SD card) call
+    watchdogKick() from their bounded waits.  BENCHMARK builds keep the watchdog held, they have no scheduler.
+*/
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include "clock.h"
+
+/* CONSTANTS */
+#define WATCHDOG_INTERVAL_MS        1000 //ACLK / 32768
+#define WATCHDOG_KICK               WDT_ARST_1000 //Clears the count, ACLK, watchdog (not interval) mode
+#define WATCHDOG_MAGIC              0x5752 //"WR"
+#define WATCHDOG_TASKS              6 //OSTASKS, indexed by TASK_ID_* (tasks.h)
+#define WATCHDOG_NONE               0xFF //No task late
+#define WATCHDOG_CHECKPOINT_TICKS   (OS_TICK_HZ / 10) //Also on every log write and antenna state change
+
+//Longest a supervised task may go without checking in (ticks); 0 for tasks that are not supervised
+#define WATCHDOG_IMU_TICKS          OS_TICK_HZ //Released every tick, but a card write may wait SD_BUSY_MS
+#define WATCHDOG_RECORD_TICKS       (3 * OS_TICK_HZ) //Waits RECORDER_RETRY_TICKS at most
+#define WATCHDOG_ANTENNA_TICKS      (4 * OS_TICK_HZ) //Waits ANTENNA_IDLE_TICKS at most
+#define WATCHDOG_SEND_TICKS         (2 * OS_TICK_HZ) //Every DOWNLINK_PASS_TICKS, lowest priority
+
+/* DATATYPES */
+
+/* Name: WatchdogKept_s
+   Type: struct
+   Parameters:
+    unsigned int magic - WATCHDOG_MAGIC
+    unsigned int restarts - warm boots since the last cold one
+    unsigned int watchdogResets - of those, by the watchdog
+    unsigned char lateTask - TASK_ID_* of the task that let the watchdog run out in this run, or WATCHDOG_NONE
+    unsigned char antennaState - AntennaState (antenna.h)
+    unsigned char antennaAttempts - deployment sequences started
+    unsigned char recorderState - RecorderState (recorder.h); the log position below is only good in REC_RUNNING
+    unsigned char cardHighCapacity - SDCard.isHighCapacity
+    unsigned char spare - keeps the words aligned
+    unsigned int antennaStatus - last status word from the antenna controller
+    unsigned long ticks - clockGetTicks()
+    unsigned long logOffset - RecorderHealth.nextOffset
+    unsigned long logSequence - RecorderHealth.nextSequence
+    int bufferIndex - newest sample in the history (data.h)
+    unsigned int crc - logCrc16() of everything above
+   Purpose:
+    State kept through a reset, as of the last checkpoint.
+*/
+struct WatchdogKept_s {
+  unsigned int magic;
+  unsigned int restarts;
+  unsigned int watchdogResets;
+  unsigned char lateTask;
+  unsigned char antennaState;
+  unsigned char antennaAttempts;
+  unsigned char recorderState;
+  unsigned char cardHighCapacity;
+  unsigned char spare;
+  unsigned int antennaStatus;
+  unsigned long ticks;
+  unsigned long logOffset;
+  unsigned long logSequence;
+  int bufferIndex;
+  unsigned int crc;
+};
+typedef struct WatchdogKept_s WatchdogKept;
+
+/* Name: WatchdogStats_s
+   Type: struct
+   Parameters:
+    char warm - 1 if this boot was warm
+    unsigned char resetCause - IFG1 reset flags at boot (WDTIFG, RSTIFG, PORIFG)
+    unsigned char lastLate - task that let the watchdog run out before this boot, or WATCHDOG_NONE
+    unsigned char lateTask - task late in this run, or WATCHDOG_NONE (the reset follows within WATCHDOG_INTERVAL_MS)
+    unsigned int restarts - warm boots since the last cold one
+    unsigned int watchdogResets - of those, by the watchdog
+*/
+struct WatchdogStats_s {
+  char warm;
+  unsigned char resetCause;
+  unsigned char lastLate;
+  unsigned char lateTask;
+  unsigned int restarts;
+  unsigned int watchdogResets;
+};
+typedef struct WatchdogStats_s WatchdogStats;
+
+/* FUNCTION PROTOTYPES */
+
+/* Name: watchdogInit
+   Return value:
+    char - 1 if the boot is warm
+   Description:
+    Holds the watchdog, reads and clears the reset cause and checks the kept block; on a cold boot the block is started
+    over.  Call first thing in main(), before anything that takes long.
+*/
+char watchdogInit(void);
+
+/* Name: watchdogGetKept
+   Return value:
+    const WatchdogKept* - state as of the last checkpoint before the reset, 0 on a cold boot
+   Description:
+    For the modules' init functions.  Only good until the tasks have all checked in, when checkpoints start again.
+*/
+const WatchdogKept* watchdogGetKept(void);
+
+/* Name: watchdogStart
+   Description:
+    Carries the tick count on (warm boot) and starts the watchdog.  Call from main() with interrupts still off, just
+    before the scheduler starts.
+*/
+void watchdogStart(void);
+
+/* Name: watchdogCheckIn
+   Parameters:
+    unsigned char task - TASK_ID_* of the caller
+   Description:
+    Tells the supervisor the task is still running.  Call once per pass of the task's loop.
+*/
+void watchdogCheckIn(unsigned char task);
+
+/* Name: watchdogService
+   Description:
+    Clears the watchdog if every supervised task is within its deadline, and checkpoints the kept block.  Does its work
+    once per tick; call from main() after every OSSched().
+*/
+void watchdogService(void);
+
+/* Name: watchdogKick
+   Description:
+    Clears the watchdog unless a task is already late.  Only for driver waits that are bounded, but may take close to
+    WATCHDOG_INTERVAL_MS.
+*/
+void watchdogKick(void);
+
+/* Name: watchdogGetStats
+   Return value:
+    const WatchdogStats* - reset cause and counts, read only
+*/
+const WatchdogStats* watchdogGetStats(void);
+
+#endif
@@ -1,29 +1,72 @@
 #include <__cross_studio_io.h>
-#include "salvo.h"
+#include "os.h"
 #include "data.h"
 #include "tasks.h"
+#include "clock.h"
+#include "arena.h"
+#include "watchdog.h"
+#include "boot.h"
+#include "config.h"
+#ifdef PROFILE
+#include "profile.h"
+#include "drdy.h"
 
+#define PROFILE_REPORT_TICKS (10 * OS_TICK_HZ) //Profile printed every 10 s
+#endif
+#ifdef I2C_REPLAY
+#include "replay.h"
+#endif
+
+#ifndef BENCHMARK //benchmark.c provides main() in benchmark builds
 int main(void) {
   OSInit();
   
-  WDTCTL = WDTPW + WDTHOLD;
-  BCSCTL1 = CALBC1_1MHZ;
-  DCOCTL = CALDCO_1MHZ;
+  watchdogInit(); //Holds the watchdog while main() sets up, and finds out whether the boot is warm
+  arenaPaintStack(); //Before anything else runs on the stack
+  InitializeClock(1); //1 MHz, SMCLK = MCLK, starts the OS tick
+  configInit(); //Settings from the ground, before the modules read them
+  clockSetProfile(configGet(CONFIG_CLOCK, CLOCK_1MHZ)); //Nothing on the I2C buses yet
+  dataInit();
+
+#ifdef I2C_REPLAY
+  replayInit(replayTrace, replayTraceBlocks); //Sensors are played back from the linked trace
+#endif
+#ifdef PROFILE
+  profileInit();
+#endif
 
+  OSCreateTask(task_getIMUData, TASK_GET_IMU_DATA, TASK_PRIO_GET_IMU_DATA);
+  OSCreateTask(task_deployAntenna, TASK_DEPLOY_ANTENNA, TASK_PRIO_DEPLOY_ANTENNA);
+  OSCreateTask(task_recordData, TASK_RECORD_DATA, TASK_PRIO_RECORD_DATA);
+  OSCreateTask(task_sendData, TASK_SEND_DATA, TASK_PRIO_SEND_DATA);
 
-  OSCreateTask(task_getIMUData(), OSTCBP(1), 10);
+  watchdogStart(); //Supervision from here on
+  bootStart((watchdogGetStats() -> resetCause & PORIFG) != 0); //Devices powered up with the MCU, or kept their power
+  __enable_interrupt(); //Timer A tick, interrupt-driven I2C and the radio
 
   while (1) {
     OSSched();
+    watchdogService();
+
+#ifdef PROFILE
+    {
+      static unsigned long lastReport;
 
-    debug_printf("Gyro (x, y, z): %d%d, %d%d, %d%d\nMagnet (x, y, z): %d%d, %d%d, %d%d\n", 
-                  gyroscopeBuffer[X_AXIS_H][bufferIndex], gyroscopeBuffer[X_AXIS_L][bufferIndex],
-                  gyroscopeBuffer[Y_AXIS_H][bufferIndex], gyroscopeBuffer[Y_AXIS_L][bufferIndex],
-                  gyroscopeBuffer[Z_AXIS_H][bufferIndex], gyroscopeBuffer[Z_AXIS_L][bufferIndex],
-                  magnetometerBuffer[X_AXIS_H][bufferIndex], gyroscopeBuffer[X_AXIS_L][bufferIndex],
-                  magnetometerBuffer[Y_AXIS_H][bufferIndex], gyroscopeBuffer[Y_AXIS_L][bufferIndex],
-                  magnetometerBuffer[Z_AXIS_H][bufferIndex], gyroscopeBuffer[Z_AXIS_L][bufferIndex]);
+      if (clockGetTicks() - lastReport >= PROFILE_REPORT_TICKS) {
+        lastReport = clockGetTicks();
+        profileReport();
+        periodicReport("IMU", &imuPeriodic);
+        drdyReport();
+        bootReport();
+      }
+    }
+#endif
+
+    debug_printf("Gyro (x, y, z): %d, %d, %d\nMagnet (x, y, z): %d, %d, %d\n", 
+                  gyroscopeBuffer[X_AXIS][bufferIndex], gyroscopeBuffer[Y_AXIS][bufferIndex],
+                  gyroscopeBuffer[Z_AXIS][bufferIndex], magnetometerBuffer[X_AXIS][bufferIndex],
+                  magnetometerBuffer[Y_AXIS][bufferIndex], magnetometerBuffer[Z_AXIS][bufferIndex]);
 
   }
 }
-
+#endif
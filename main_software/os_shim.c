@@ -0,0 +1,236 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in os_shim.h
+*/
+
+#ifdef OS_SHIM
+
+#include "os_shim.h"
+
+/* Name: OS_SHIM_LOCK, OS_SHIM_UNLOCK
+   Description:
+    The port: save the interrupt state and turn interrupts off, and put the state back.  Keep OSTimer() and
+    OSSignalBinSem() in interrupts from changing a task while the scheduler does.  No-ops in host builds (OS_SHIM_HOST),
+    which have no interrupts.
+*/
+#ifdef OS_SHIM_HOST
+#define OS_SHIM_LOCK(state)     ((state) = 0)
+#define OS_SHIM_UNLOCK(state)   ((void)(state))
+#else
+#include "msp430.h"
+#define OS_SHIM_LOCK(state)     do { (state) = __get_interrupt_state(); __disable_interrupt(); } while (0)
+#define OS_SHIM_UNLOCK(state)   __set_interrupt_state(state)
+#endif
+
+OStypeTcb osShimTcbs[OSTASKS];
+OStypeEcb osShimEcbs[OSEVENTS];
+OStypeTcbP osShimCurrent;
+
+static volatile OStypeTick ticks;
+static unsigned int turns; //Handed out in order as tasks become eligible
+static char switched; //Set when the running task switches context
+
+/* Name: osShimMakeEligible
+   Description:
+    Puts a task behind the other eligible tasks of its priority.
+*/
+static void osShimMakeEligible(OStypeTcbP tcbP) {
+  tcbP -> state = OSTCB_ELIGIBLE;
+  tcbP -> turn = turns++;
+}
+
+static char osShimValidTcb(OStypeTcbP tcbP) {
+  return tcbP >= osShimTcbs && tcbP < osShimTcbs + OSTASKS;
+}
+
+static char osShimValidEcb(OStypeEcbP ecbP) {
+  return ecbP >= osShimEcbs && ecbP < osShimEcbs + OSEVENTS && ecbP -> created;
+}
+
+void OSInit(void) {
+  unsigned char n;
+
+  for (n = 0; n < OSTASKS; n++) {
+    osShimTcbs[n].state = OSTCB_DESTROYED;
+    osShimTcbs[n].waitingOn = 0;
+  }
+  for (n = 0; n < OSEVENTS; n++) {
+    osShimEcbs[n].created = FALSE;
+  }
+  osShimCurrent = 0;
+  ticks = 0;
+  turns = 0;
+}
+
+OStypeErr OSCreateTask(OStypeTFP function, OStypeTcbP tcbP, OStypePrio prio) {
+  if (!osShimValidTcb(tcbP) || !function || prio > OSLOWEST_PRIO) {
+    return OSERR_BAD_P;
+  }
+  tcbP -> function = function;
+  tcbP -> resume = 0;
+  tcbP -> delay = 0;
+  tcbP -> prio = prio;
+  tcbP -> timedOut = FALSE;
+  tcbP -> waitingOn = 0;
+  osShimMakeEligible(tcbP);
+  return OSNO_ERR;
+}
+
+void OSSched(void) {
+  OStypeTcbP next = 0;
+  OStypeTcbP tcbP;
+  unsigned int state;
+
+  OS_SHIM_LOCK(state);
+  for (tcbP = osShimTcbs; tcbP < osShimTcbs + OSTASKS; tcbP++) {
+    if (tcbP -> state != OSTCB_ELIGIBLE) {
+      continue;
+    }
+    if (!next || tcbP -> prio < next -> prio ||
+        (tcbP -> prio == next -> prio && (int)(tcbP -> turn - next -> turn) < 0)) { //Wraps safely
+      next = tcbP;
+    }
+  }
+  OS_SHIM_UNLOCK(state);
+
+  if (!next) {
+    return;
+  }
+
+  osShimCurrent = next;
+  switched = FALSE;
+  next -> function();
+  if (!switched) { //Returned without a context switch
+    next -> state = OSTCB_DESTROYED;
+  }
+  osShimCurrent = 0;
+}
+
+void OSTimer(void) {
+  OStypeTcbP tcbP;
+
+  ticks++;
+  for (tcbP = osShimTcbs; tcbP < osShimTcbs + OSTASKS; tcbP++) {
+    if (tcbP -> state == OSTCB_DELAYED) {
+      if (--tcbP -> delay == 0) {
+        osShimMakeEligible(tcbP);
+      }
+    } else if (tcbP -> state == OSTCB_WAITING && tcbP -> delay) { //Waiting with a timeout
+      if (--tcbP -> delay == 0) {
+        tcbP -> timedOut = TRUE;
+        tcbP -> waitingOn = 0;
+        osShimMakeEligible(tcbP);
+      }
+    }
+  }
+}
+
+OStypeTick OSGetTicks(void) {
+  OStypeTick now;
+  unsigned int state;
+
+  OS_SHIM_LOCK(state); //Not atomic on a 16 bit CPU
+  now = ticks;
+  OS_SHIM_UNLOCK(state);
+  return now;
+}
+
+OStypeTcbP OSTaskRunning(void) {
+  return osShimCurrent;
+}
+
+OStypeErr OSCreateBinSem(OStypeEcbP ecbP, OStypeBinSem value) {
+  if (ecbP < osShimEcbs || ecbP >= osShimEcbs + OSEVENTS) {
+    return OSERR_BAD_P;
+  }
+  ecbP -> value = value ? 1 : 0;
+  ecbP -> created = TRUE;
+  return OSNO_ERR;
+}
+
+OStypeErr OSSignalBinSem(OStypeEcbP ecbP) {
+  OStypeTcbP waiter = 0;
+  OStypeTcbP tcbP;
+  OStypeErr error = OSNO_ERR;
+  unsigned int state;
+
+  if (!osShimValidEcb(ecbP)) {
+    return OSERR_BAD_P;
+  }
+
+  OS_SHIM_LOCK(state);
+  for (tcbP = osShimTcbs; tcbP < osShimTcbs + OSTASKS; tcbP++) {
+    if (tcbP -> state == OSTCB_WAITING && tcbP -> waitingOn == ecbP &&
+        (!waiter || tcbP -> prio < waiter -> prio ||
+         (tcbP -> prio == waiter -> prio && (int)(tcbP -> turn - waiter -> turn) < 0))) {
+      waiter = tcbP;
+    }
+  }
+
+  if (waiter) { //Handed straight to the waiter, the semaphore stays 0
+    waiter -> waitingOn = 0;
+    waiter -> timedOut = FALSE;
+    osShimMakeEligible(waiter);
+  } else if (ecbP -> value) {
+    error = OSERR_EVENT_FULL;
+  } else {
+    ecbP -> value = 1;
+  }
+  OS_SHIM_UNLOCK(state);
+  return error;
+}
+
+OStypeBinSem OSTryBinSem(OStypeEcbP ecbP) {
+  OStypeBinSem value;
+  unsigned int state;
+
+  if (!osShimValidEcb(ecbP)) {
+    return 0;
+  }
+  OS_SHIM_LOCK(state);
+  value = ecbP -> value;
+  ecbP -> value = 0;
+  OS_SHIM_UNLOCK(state);
+  return value;
+}
+
+void osShimSwitch(char state, OStypeDelay delay, unsigned int line) {
+  OStypeTcbP tcbP = osShimCurrent;
+  unsigned int interrupts;
+
+  OS_SHIM_LOCK(interrupts);
+  tcbP -> resume = line;
+  tcbP -> delay = delay;
+  if (state == OSTCB_ELIGIBLE) {
+    osShimMakeEligible(tcbP);
+  } else {
+    tcbP -> state = state;
+  }
+  switched = TRUE;
+  OS_SHIM_UNLOCK(interrupts);
+}
+
+char osShimTryWait(OStypeEcbP ecbP, OStypeDelay timeout, unsigned int line) {
+  OStypeTcbP tcbP = osShimCurrent;
+  unsigned int interrupts;
+
+  tcbP -> timedOut = FALSE;
+  if (!osShimValidEcb(ecbP)) {
+    return TRUE; //Salvo returns at once on a bad pointer too
+  }
+
+  OS_SHIM_LOCK(interrupts);
+  if (ecbP -> value) {
+    ecbP -> value = 0;
+    OS_SHIM_UNLOCK(interrupts);
+    return TRUE;
+  }
+  tcbP -> resume = line;
+  tcbP -> delay = timeout;
+  tcbP -> waitingOn = ecbP;
+  tcbP -> state = OSTCB_WAITING;
+  switched = TRUE;
+  OS_SHIM_UNLOCK(interrupts);
+  return FALSE;
+}
+
+#endif
@@ -0,0 +1,72 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in periodic.h
+*/
+
+#include <__cross_studio_io.h>
+#include "periodic.h"
+#include "clock.h"
+
+#define PERIODIC_TICK_US (1000000UL / OS_TICK_HZ)
+
+void periodicInit(Periodic* periodic, unsigned char period, unsigned char deadline, unsigned char phase) {
+  periodic -> period = period ? period : 1;
+  periodic -> deadline = deadline;
+  periodic -> release = clockGetTicks() + phase;
+  periodic -> jobs = 0;
+  periodic -> overruns = 0;
+  periodic -> skipped = 0;
+  periodic -> latencyTotal = 0;
+  periodic -> latencyMax = 0;
+  periodic -> periodMin = 0xFFFFFFFFUL;
+  periodic -> periodMax = 0;
+}
+
+unsigned char periodicDelay(Periodic* periodic) {
+  unsigned long now = clockGetTicks();
+
+  while ((long)(now - periodic->release) > 0) { //Missed, wait for the next one instead of catching up
+    periodic -> release += periodic->period;
+    periodic -> skipped++;
+  }
+  return (unsigned char)(periodic->release - now);
+}
+
+void periodicStart(Periodic* periodic) {
+  unsigned long now = clockGetMicroseconds();
+  unsigned long latency = now - periodic->release * PERIODIC_TICK_US; //Both wrap together
+
+  if (latency > 0xFFFF) { //Over 65 ms late, or started without waiting for the release
+    latency = 0xFFFF;
+  }
+  periodic -> latencyTotal += latency;
+  if (latency > periodic->latencyMax) {
+    periodic -> latencyMax = latency;
+  }
+
+  if (periodic->jobs) {
+    unsigned long between = now - periodic->lastStart;
+
+    if (between < periodic->periodMin) {
+      periodic -> periodMin = between;
+    }
+    if (between > periodic->periodMax) {
+      periodic -> periodMax = between;
+    }
+  }
+  periodic -> lastStart = now;
+  periodic -> jobs++;
+}
+
+void periodicDone(Periodic* periodic) {
+  if ((long)(clockGetTicks() - periodic->release) >= periodic->deadline) {
+    periodic -> overruns++;
+  }
+  periodic -> release += periodic->period;
+}
+
+void periodicReport(const char* name, const Periodic* periodic) {
+  debug_printf("%-10s %6u jobs %5u overrun %5u skipped, jitter avg %5lu max %5u us, period %lu-%lu us\n", name,
+               periodic->jobs, periodic->overruns, periodic->skipped,
+               periodic->jobs ? periodic->latencyTotal / periodic->jobs : 0UL, periodic->latencyMax,
+               periodic->jobs > 1 ? periodic->periodMin : 0UL, periodic->periodMax);
+}
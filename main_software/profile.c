@@ -0,0 +1,131 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in profile.h
+*/
+
+#ifdef PROFILE
+
+#include <__cross_studio_io.h>
+#include "msp430.h"
+#include "profile.h"
+#include "clock.h"
+#include "log_format.h"
+
+static TaskProfile profiles[PROFILE_TASKS];
+static unsigned int resumedAt[PROFILE_TASKS]; //Timer B at dispatch
+static unsigned int suspendedAt[PROFILE_TASKS]; //Timer B at the last yield
+static unsigned long wakeTick[PROFILE_TASKS]; //OS tick a delayed task is due, 0 after a yield
+
+void profileInit(void) {
+  unsigned char n;
+  char* p = (char*)profiles;
+
+  for (n = 0; n < PROFILE_TASKS; n++) {
+    wakeTick[n] = 0;
+  }
+  while (p < (char*)(profiles + PROFILE_TASKS)) {
+    *p++ = 0;
+  }
+  TBCTL = TBSSEL_1 + MC_2 + TBCLR; //ACLK, continuous mode
+}
+
+void profileResume(char id) {
+  unsigned int now = TBR;
+  unsigned int waited;
+  unsigned char task = id; //Indexes the arrays once id is known to be in range
+  TaskProfile* profile;
+
+  if (id < 0 || id >= PROFILE_TASKS) {
+    return;
+  }
+  profile = &profiles[task];
+  resumedAt[task] = now;
+  profile->runs++;
+
+  if (wakeTick[task]) { //Back from a delay
+    unsigned long late = clockGetTicks() - wakeTick[task];
+
+    if (late < 0x8000 && late > profile->longestDelayLate) {
+      profile->longestDelayLate = late;
+    }
+    wakeTick[task] = 0;
+  } else if (profile->runs > 1) { //Back from a yield
+    waited = now - suspendedAt[task];
+    if (waited > profile->longestYieldWait) {
+      profile->longestYieldWait = waited;
+    }
+  }
+}
+
+void profileSuspend(char id, unsigned char delay) {
+  unsigned int now = TBR;
+  unsigned int ran;
+  unsigned char task = id;
+  TaskProfile* profile;
+
+  if (id < 0 || id >= PROFILE_TASKS) {
+    return;
+  }
+  profile = &profiles[task];
+  ran = now - resumedAt[task];
+  profile->runTime += ran;
+  if (ran > profile->longestRun) {
+    profile->longestRun = ran;
+  }
+
+  suspendedAt[task] = now;
+  if (delay) {
+    profile->delays++;
+    wakeTick[task] = clockGetTicks() + delay;
+  } else {
+    profile->yields++;
+  }
+}
+
+const TaskProfile* profileGet(char id) {
+  return (id >= 0 && id < PROFILE_TASKS) ? &profiles[(unsigned char)id] : 0;
+}
+
+char profilePack(char id, unsigned long tick, unsigned char* out) {
+  const TaskProfile* profile = profileGet(id);
+
+  if (!profile) {
+    return 0;
+  }
+  logPut32(out, tick);
+  out[4] = id;
+  logPut32(out + 5, profile->runs);
+  logPut32(out + 9, profile->runTime);
+  logPut16(out + 13, profile->longestRun);
+  logPut16(out + 15, profile->longestYieldWait);
+  logPut16(out + 17, profile->longestDelayLate);
+  logPut16(out + 19, profile->yields);
+  logPut16(out + 21, profile->delays);
+  return 1;
+}
+
+/* Name: profileMicroseconds
+   Description:
+    Converts Timer B ticks to microseconds.
+*/
+static unsigned long profileMicroseconds(unsigned long ticks) {
+  return ticks * 1000UL / (PROFILE_TIMER_HZ / 1000UL); //32 ticks per ms, close enough for a report
+}
+
+void profileReport(void) {
+  unsigned char n;
+
+  debug_printf("%4s %8s %10s %8s %8s %6s %6s %6s\n", "task", "runs", "run us", "max us", "wait us", "late", "yields",
+               "delays");
+  for (n = 0; n < PROFILE_TASKS; n++) {
+    const TaskProfile* profile = &profiles[n];
+
+    if (!profile->runs) {
+      continue;
+    }
+    debug_printf("%4d %8lu %10lu %8lu %8lu %6u %6u %6u\n", n, profile->runs, profileMicroseconds(profile->runTime),
+                 profileMicroseconds(profile->longestRun), profileMicroseconds(profile->longestYieldWait),
+                 profile->longestDelayLate, profile->yields, profile->delays);
+  }
+}
+
+#endif
@@ -0,0 +1,123 @@
+/* Author: John Walnut
+   Purpose: Implements the radio serial link defined in radio.h
+*/
+
+#include "msp430.h"
+#include "radio.h"
+#include "clock.h"
+
+static unsigned char radioTx[RADIO_TX_LEN];
+static unsigned char radioRx[RADIO_RX_LEN];
+static volatile unsigned char radioTxHead; //Next byte the interrupt sends
+static volatile unsigned char radioTxTail; //Next free byte
+static volatile unsigned char radioRxHead;
+static volatile unsigned char radioRxTail;
+static RadioHealth radioHealth;
+static char radioStarted;
+
+/* Name: radioSetDivider
+   Description:
+    Oversampling baud rate generator (UCOS16): UCBRx is the divider over 16, UCBRFx the sixteenths left over.
+*/
+static void radioSetDivider(unsigned long smclkHz) {
+  unsigned int divider = (unsigned int)((smclkHz + RADIO_BAUD / 2) / RADIO_BAUD);
+
+  UCA1CTL1 |= UCSWRST;
+  UCA1BR0 = (divider >> 4) & 0xFF;
+  UCA1BR1 = divider >> 12;
+  UCA1MCTL = ((divider & 0x0F) << 4) + UCOS16;
+  UCA1CTL1 &= ~UCSWRST;
+}
+
+void radioInit(void) {
+  UCA1CTL1 = UCSWRST; //Hold the USCI while it is set up
+  UCA1CTL0 = 0; //UART, 8N1, LSB first
+  UCA1CTL1 |= UCSSEL_2; //SMCLK
+  P3SEL |= RADIO_PINS;
+
+  radioTxHead = radioTxTail = 0;
+  radioRxHead = radioRxTail = 0;
+  radioHealth.txBytes = radioHealth.rxBytes = 0;
+  radioHealth.txFrames = radioHealth.txRefused = radioHealth.rxOverruns = 0;
+
+  radioSetDivider(clockGetSmclkHz()); //Releases the reset
+  radioStarted = 1;
+  UC1IE |= UCA1RXIE; //Enabled after the reset is released, which clears it
+}
+
+void radioSetSourceClock(unsigned long smclkHz) {
+  if (radioStarted) {
+    radioSetDivider(smclkHz);
+    UC1IE |= UCA1RXIE;
+    if (radioTxHead != radioTxTail) {
+      UC1IE |= UCA1TXIE; //Carry on with the frame that was going out
+    }
+  }
+}
+
+unsigned int radioGetTxFree(void) {
+  return (RADIO_TX_LEN - 1) - ((radioTxTail - radioTxHead) & (RADIO_TX_LEN - 1)); //One byte kept free to tell full from empty
+}
+
+char radioSend(const unsigned char* frame, unsigned char length) {
+  unsigned char tail = radioTxTail;
+  unsigned char n;
+
+  if (length > radioGetTxFree()) {
+    radioHealth.txRefused++;
+    return 0;
+  }
+  for (n = 0; n < length; n++) {
+    radioTx[tail] = frame[n];
+    tail = (tail + 1) & (RADIO_TX_LEN - 1);
+  }
+  radioTxTail = tail; //Only now can the interrupt see the frame
+  radioHealth.txFrames++;
+  UC1IE |= UCA1TXIE; //UCA1TXIFG is set while the buffer is empty, so this starts the frame if the UART is idle
+  return 1;
+}
+
+unsigned char radioRxPeek(const unsigned char** ring, unsigned char* head) {
+  *ring = radioRx;
+  *head = radioRxHead;
+  return (radioRxTail - radioRxHead) & (RADIO_RX_LEN - 1);
+}
+
+void radioRxDrop(unsigned char count) {
+  radioRxHead = (radioRxHead + count) & (RADIO_RX_LEN - 1); //Frees the bytes for the interrupt
+}
+
+const RadioHealth* radioGetHealth(void) {
+  return &radioHealth;
+}
+
+void radioServiceTx(void) {
+  if (!(UC1IE & UCA1TXIE) || !(UC1IFG & UCA1TXIFG)) { //Not ours (UCB1 shares the vector)
+    return;
+  }
+  if (radioTxHead == radioTxTail) {
+    UC1IE &= ~UCA1TXIE; //Ring empty, the last byte is on its way
+    return;
+  }
+  UCA1TXBUF = radioTx[radioTxHead]; //Writing clears the flag
+  radioTxHead = (radioTxHead + 1) & (RADIO_TX_LEN - 1);
+  radioHealth.txBytes++;
+}
+
+void radioServiceRx(void) {
+  unsigned char tail;
+  unsigned char byte;
+
+  if (!(UC1IFG & UCA1RXIFG)) {
+    return;
+  }
+  byte = UCA1RXBUF; //Reading clears the flag
+  radioHealth.rxBytes++;
+  tail = (radioRxTail + 1) & (RADIO_RX_LEN - 1);
+  if (tail == radioRxHead) {
+    radioHealth.rxOverruns++;
+    return;
+  }
+  radioRx[radioRxTail] = byte;
+  radioRxTail = tail;
+}
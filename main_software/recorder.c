@@ -0,0 +1,388 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in recorder.h
+*/
+
+#include "recorder.h"
+#include "arena.h"
+#include "watchdog.h"
+#include "boot.h"
+
+static SDCard card;
+static unsigned char (*blocks)[LOG_BLOCK_SIZE]; //RECORDER_BLOCK_BUFFERS of them, from the arena
+static unsigned char blockCount[RECORDER_BLOCK_BUFFERS]; //Samples in each block
+static unsigned long blockTick[RECORDER_BLOCK_BUFFERS]; //Tick of the first sample of each block
+static unsigned char fullHead; //Oldest full block
+static unsigned char fullCount; //Full blocks waiting for the card, the one after them is being filled
+static RecorderHealth health;
+static char resumed; //Running on the card and position kept through a warm restart, nothing written since
+static char cardStarting; //sdInitStart() done, polling
+static char searching; //Log search under way: searchFirst read, newest block between searchGood and searchBad
+static unsigned long searchFirst;
+static unsigned long searchGood;
+static unsigned long searchBad;
+
+/* Name: recorderSeal
+   Description:
+    Marks the block being filled as full, zeroing the space its samples do not use.
+*/
+static void recorderSeal(void) {
+  unsigned char index = (fullHead + fullCount) % RECORDER_BLOCK_BUFFERS;
+  unsigned char* unused = blocks[index] + LOG_HDR_SIZE + blockCount[index] * LOG_SAMPLE_SIZE;
+
+  while (unused < blocks[index] + LOG_CRC_OFFSET) {
+    *unused++ = 0;
+  }
+  fullCount++;
+}
+
+/* Name: recorderFault
+   Description:
+    Handles a failed card operation: retries later, or gives up.
+*/
+static unsigned char recorderFault(void) {
+  health.lastError = card.error;
+  health.faults++;
+  if (health.faults >= RECORDER_MAX_FAULTS) {
+    health.state = REC_FAILED;
+  }
+  return RECORDER_RETRY_TICKS;
+}
+
+/* Name: recorderScratch
+   Return value:
+    unsigned char* - an empty block buffer to read the card into
+   Description:
+    The buffer after the block being filled, if it is free.  If not, the block being filled is closed, and the oldest
+    full block dropped if that leaves none empty, so the block being filled is.  recorderAddSample() writes over it
+    later, so it only holds what is read into it until the task next gives up the CPU.
+*/
+static unsigned char* recorderScratch(void) {
+  if (fullCount + 2 <= RECORDER_BLOCK_BUFFERS) {
+    return blocks[(fullHead + fullCount + 1) % RECORDER_BLOCK_BUFFERS];
+  }
+  if (fullCount < RECORDER_BLOCK_BUFFERS && blockCount[(fullHead + fullCount) % RECORDER_BLOCK_BUFFERS] > 0) {
+    recorderSeal();
+  }
+  if (fullCount >= RECORDER_BLOCK_BUFFERS) {
+    health.droppedSamples += blockCount[fullHead];
+    blockCount[fullHead] = 0;
+    fullHead = (fullHead + 1) % RECORDER_BLOCK_BUFFERS;
+    fullCount--;
+  }
+  return blocks[(fullHead + fullCount) % RECORDER_BLOCK_BUFFERS];
+}
+
+/* Name: recorderReadSequence
+   Return value:
+    char - 1 if the block at offset holds a valid log block (sequence number in *sequence), 0 if it does not, -1 on a
+           card error
+*/
+static char recorderReadSequence(unsigned long offset, unsigned long* sequence) {
+  unsigned char* buffer = recorderScratch();
+
+  sdReadBlock(&card, LOG_FIRST_BLOCK + offset, buffer);
+  if (card.error != SDERR_NO_ERROR) {
+    return -1;
+  }
+  if (!logBlockIsValid(buffer)) {
+    return 0;
+  }
+  *sequence = logGet32(buffer + LOG_HDR_SEQUENCE);
+  return 1;
+}
+
+/* Name: recorderRecover
+   Return value:
+    char - 1 if the end of the log was found, 0 if there is more to read, -1 on a card error (the search starts over)
+   Description:
+    One read of the search for the end of the log.  The block at offset n holds sequence number first + n for every
+    block written in the current pass over the card, and something else (an older pass, or garbage) after it.  That
+    makes "holds first + n" true up to the newest block and false after it, so the newest block is found with about
+    log2(LOG_BLOCK_COUNT) reads.
+*/
+static char recorderRecover(void) {
+  unsigned long sequence;
+  unsigned long mid;
+  char result;
+
+  if (!searching) {
+    result = recorderReadSequence(0, &searchFirst);
+    if (result < 0) {
+      return -1;
+    }
+    if (result == 0) { //Empty log
+      health.nextOffset = 0;
+      health.nextSequence = 0;
+      return 1;
+    }
+    searchGood = 0;
+    searchBad = LOG_BLOCK_COUNT;
+    searching = 1;
+  } else {
+    mid = searchGood + (searchBad - searchGood) / 2;
+    result = recorderReadSequence(mid, &sequence);
+    if (result < 0) {
+      searching = 0;
+      return -1;
+    }
+    if (result && sequence == searchFirst + mid) {
+      searchGood = mid;
+    } else {
+      searchBad = mid;
+    }
+  }
+  if (searchBad - searchGood > 1) {
+    return 0;
+  }
+
+  searching = 0;
+  health.nextOffset = (searchGood + 1) % LOG_BLOCK_COUNT;
+  health.nextSequence = searchFirst + searchGood + 1;
+  return 1;
+}
+
+/* Name: recorderWriteBurst
+   Return value:
+    char - 1 if all full blocks went to the card, 0 on a card error
+   Description:
+    Stamps sequence numbers and CRCs on the full blocks and writes them, split in two if the log wraps.
+*/
+static char recorderWriteBurst(void) {
+  unsigned char* burst[RECORDER_BLOCK_BUFFERS];
+  int count = fullCount;
+  int written = 0;
+  int n;
+
+  for (n = 0; n < count; n++) {
+    unsigned char index = (fullHead + n) % RECORDER_BLOCK_BUFFERS;
+    unsigned char* block = blocks[index];
+
+    logPut16(block + LOG_HDR_MAGIC, LOG_MAGIC);
+    block[LOG_HDR_VERSION] = LOG_VERSION;
+    block[LOG_HDR_COUNT] = blockCount[index];
+    logPut32(block + LOG_HDR_SEQUENCE, health.nextSequence + n);
+    logPut32(block + LOG_HDR_FIRST_TICK, blockTick[index]);
+    logPut16(block + LOG_CRC_OFFSET, logCrc16(block, LOG_CRC_OFFSET));
+    burst[n] = block;
+  }
+
+  while (written < count) {
+    int chunk = count - written;
+
+    if (health.nextOffset + chunk > LOG_BLOCK_COUNT) { //Do not run off the end of the log
+      chunk = LOG_BLOCK_COUNT - health.nextOffset;
+    }
+    sdWriteBlocks(&card, LOG_FIRST_BLOCK + health.nextOffset, burst + written, chunk);
+    if (card.error != SDERR_NO_ERROR) {
+      return 0; //Blocks stay queued, the whole burst is rewritten next time
+    }
+
+    written += chunk;
+    health.nextOffset = (health.nextOffset + chunk) % LOG_BLOCK_COUNT;
+    health.nextSequence += chunk;
+    health.blocksWritten += chunk;
+    for (n = 0; n < chunk; n++) {
+      blockCount[fullHead] = 0;
+      fullHead = (fullHead + 1) % RECORDER_BLOCK_BUFFERS;
+    }
+    fullCount -= chunk;
+  }
+  return 1;
+}
+
+void recorderInit(void) {
+  const WatchdogKept* kept = watchdogGetKept();
+  unsigned char i;
+
+  if (!blocks) { //First call
+    blocks = arenaAlloc(ARENA_RECORDER, RECORDER_BLOCK_BUFFERS * LOG_BLOCK_SIZE);
+  }
+  for (i = 0; i < RECORDER_BLOCK_BUFFERS; i++) {
+    blockCount[i] = 0;
+  }
+  fullHead = 0;
+  fullCount = 0;
+
+  card.isInitialized = 0;
+  card.hasBus = 0;
+  health.state = blocks ? REC_STARTING : REC_FAILED;
+  health.nextOffset = 0;
+  health.nextSequence = 0;
+  health.blocksWritten = 0;
+  health.droppedSamples = 0;
+  health.highCapacity = 0;
+  health.faults = 0;
+  health.lastError = SDERR_NO_ERROR;
+  resumed = 0;
+  cardStarting = 0;
+  searching = 0;
+
+  if (blocks && kept && kept -> recorderState == REC_RUNNING) { //Warm restart, the card kept its power
+    card.isInitialized = IS_INITIALIZED;
+    card.isHighCapacity = kept -> cardHighCapacity;
+    health.state = REC_RUNNING;
+    health.nextOffset = kept -> logOffset;
+    health.nextSequence = kept -> logSequence;
+    health.highCapacity = kept -> cardHighCapacity;
+    resumed = 1;
+    bootMark(BOOT_LOG_RUNNING);
+  }
+}
+
+void recorderAddSample(unsigned long tick, const char* gyro, const char* magnet) {
+  unsigned char index;
+  unsigned char* sample;
+  unsigned char i;
+
+  if (!blocks || fullCount >= RECORDER_BLOCK_BUFFERS) { //Not initialized yet, or card is not keeping up
+    health.droppedSamples++;
+    return;
+  }
+
+  index = (fullHead + fullCount) % RECORDER_BLOCK_BUFFERS;
+  if (blockCount[index] > 0 && tick - blockTick[index] > 0xFFFF) { //Offset would not fit, start a new block
+    recorderSeal();
+    if (fullCount >= RECORDER_BLOCK_BUFFERS) {
+      health.droppedSamples++;
+      return;
+    }
+    index = (fullHead + fullCount) % RECORDER_BLOCK_BUFFERS;
+  }
+
+  if (blockCount[index] == 0) {
+    for (i = 0; i < LOG_HDR_SIZE; i++) {
+      blocks[index][i] = 0;
+    }
+    blockTick[index] = tick;
+  }
+
+  sample = blocks[index] + LOG_HDR_SIZE + blockCount[index] * LOG_SAMPLE_SIZE;
+  logPut16(sample + LOG_SAMPLE_TICK, tick - blockTick[index]);
+  for (i = 0; i < LOG_AXIS_BYTES; i++) {
+    sample[LOG_SAMPLE_GYRO + i] = gyro[i];
+    sample[LOG_SAMPLE_MAGNET + i] = magnet[i];
+  }
+  blockCount[index]++;
+
+  if (blockCount[index] >= LOG_SAMPLES_PER_BLOCK) {
+    recorderSeal();
+  }
+}
+
+unsigned char recorderStep(void) {
+  unsigned char delay;
+  char recovered;
+  char done;
+  char written;
+  int n;
+
+  switch (health.state) {
+    case REC_STARTING:
+      delay = bootWait(BOOT_SD); //Not before the first sample
+      if (delay) {
+        return delay;
+      }
+      if (!sdAcquireBus(&card)) {
+        return 0; //Antenna is using the primary I2C bus
+      }
+      if (cardStarting) {
+        done = sdInitPoll(&card);
+      } else {
+        sdInitStart(&card);
+        done = card.error != SDERR_NO_ERROR;
+      }
+      sdReleaseBus(&card);
+      if (!done) {
+        cardStarting = 1;
+        return 1; //Card starting up, the others have the CPU and the bus meanwhile
+      }
+      cardStarting = 0;
+      if (card.error != SDERR_NO_ERROR) {
+        return recorderFault();
+      }
+      health.faults = 0;
+      health.highCapacity = card.isHighCapacity;
+      bootMark(BOOT_CARD_READY);
+      if (resumed) { //The position is still good after a warm restart
+        health.state = REC_RUNNING;
+        bootMark(BOOT_LOG_RUNNING);
+      } else {
+        health.state = REC_RECOVERING;
+      }
+      return 0;
+
+    case REC_RECOVERING:
+      if (!sdAcquireBus(&card)) {
+        return 0;
+      }
+      recovered = recorderRecover();
+      sdReleaseBus(&card);
+      if (recovered < 0) {
+        return recorderFault();
+      }
+      if (!recovered) {
+        return 0; //One read per step, the IMU task is never held up for the whole search
+      }
+      health.faults = 0;
+      health.state = REC_RUNNING;
+      bootMark(BOOT_LOG_RUNNING);
+      return 0;
+
+    case REC_RUNNING:
+      if (fullCount < RECORDER_BURST_BLOCKS) {
+        return RECORDER_IDLE_TICKS;
+      }
+      if (!sdAcquireBus(&card)) {
+        return 0;
+      }
+      if (!sdIsReady(&card)) { //Still programming the last burst, let it finish with the I2C bus reconnected
+        sdReleaseBus(&card);
+        return 1;
+      }
+      written = recorderWriteBurst();
+      sdReleaseBus(&card);
+      if (!written) {
+        if (resumed) { //The card may have been reset with the MCU, initialize it again
+          card.isInitialized = 0;
+          health.state = REC_STARTING;
+        }
+        return recorderFault();
+      }
+      health.faults = 0;
+      resumed = 0;
+      return 0;
+
+    default: //REC_FAILED, stop holding samples
+      for (n = 0; n < fullCount; n++) {
+        unsigned char index = (fullHead + n) % RECORDER_BLOCK_BUFFERS;
+
+        health.droppedSamples += blockCount[index];
+        blockCount[index] = 0;
+      }
+      fullCount = 0;
+      return RECORDER_IDLE_TICKS;
+  }
+}
+
+char recorderReadLog(unsigned long offset, unsigned int start, unsigned char* buffer, unsigned char length) {
+  if (health.state != REC_RUNNING) {
+    return health.state == REC_FAILED ? -1 : 0;
+  }
+  if (offset >= LOG_BLOCK_COUNT || start + length > LOG_BLOCK_SIZE) {
+    return -1;
+  }
+  if (!sdAcquireBus(&card)) {
+    return 0;
+  }
+  if (!sdIsReady(&card)) { //Programming a burst
+    sdReleaseBus(&card);
+    return 0;
+  }
+  sdReadRange(&card, LOG_FIRST_BLOCK + offset, start, buffer, length);
+  sdReleaseBus(&card);
+  return card.error == SDERR_NO_ERROR ? 1 : -1;
+}
+
+const RecorderHealth* recorderGetHealth(void) {
+  return &health;
+}
@@ -0,0 +1,248 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in replay.h
+*/
+
+#include "replay.h"
+#include "i2c_peripherals.h"
+#include "log_format.h"
+#include "clock.h"
+#include "drdy.h"
+
+/* Name: ReplayCursor_s
+   Type: struct
+   Purpose:
+    Position of one sensor in the trace.
+*/
+struct ReplayCursor_s {
+  unsigned long block;
+  unsigned char sample;
+};
+typedef struct ReplayCursor_s ReplayCursor;
+
+/* Name: ReplayDevice_s
+   Type: struct
+   Purpose:
+    Data-ready state of one simulated device.
+*/
+struct ReplayDevice_s {
+  unsigned long periodUs; //Conversion period, 0 if no rate was set
+  unsigned long seen; //Conversion the data-ready bit was last cleared at
+};
+typedef struct ReplayDevice_s ReplayDevice;
+
+static const unsigned char* traceBlocks;
+static unsigned long traceLength;
+static ReplayCursor gyroCursor;
+static ReplayCursor magnetCursor;
+static ReplayStats stats;
+static ReplayDevice imu;
+static ReplayDevice magnet;
+static unsigned long intUs; //Conversion the armed INT edge belongs to
+static unsigned char pinCfg; //INT_PIN_CFG as last written, read back by samplerInit()
+
+#define REPLAY_TICK_US (1000000UL / OS_TICK_HZ)
+
+/* Name: replayReady
+   Parameters:
+    ReplayDevice* device - simulated device
+    char clear - 1 to clear the data-ready bit
+   Return value:
+    char - 1 if the device has converted a sample since the bit was last cleared, always 1 with no rate set
+*/
+static char replayReady(ReplayDevice* device, char clear) {
+  unsigned long sample;
+  char ready;
+
+  if (!device->periodUs) {
+    return 1;
+  }
+  sample = clockGetMicroseconds() / device->periodUs;
+  ready = sample != device->seen;
+  if (clear) {
+    device -> seen = sample;
+  }
+  return ready;
+}
+
+/* Name: replayConfigure
+   Description:
+    Picks up the rate registers written to the simulated devices.
+*/
+static void replayConfigure(I2CMessage* messageStruct) {
+  char reg = messageStruct->message[0];
+  unsigned char value = messageStruct->message[1];
+
+  if (messageStruct->messageLength < 2) {
+    return;
+  }
+  if (messageStruct->address == IMU_I2C_ADDR && reg == IMU_INT_PIN_CFG_REG) {
+    pinCfg = value;
+  } else if (messageStruct->address == IMU_I2C_ADDR && reg == IMU_SMPLRT_DIV_REG) {
+    imu.periodUs = (1 + value) * (1000000UL / IMU_INTERNAL_HZ);
+  } else if (messageStruct->address == MAGNET_I2C_ADDR && reg == MAGNET_CNTL1_REG) {
+    if (value == MAGNET_MODE_CONT_8HZ) {
+      magnet.periodUs = 125000UL;
+    } else if (value == MAGNET_MODE_CONT_100HZ) {
+      magnet.periodUs = 10000UL;
+    } else {
+      magnet.periodUs = 0;
+    }
+  }
+}
+
+/* Name: replayArmInt
+   Parameters:
+    unsigned long afterUs - time after which to look for the next IMU conversion
+   Description:
+    Sets Timer A CCR1 to the next conversion if it falls within the current OS tick, and disarms it otherwise.  A
+    conversion the count has already passed (at the start of the tick, TA0R moves on while the tick routine is taken)
+    sets CCIFG at once, as the compare would never come.
+*/
+static void replayArmInt(unsigned long afterUs) {
+  unsigned long tickStart = clockGetTicks() * REPLAY_TICK_US;
+  unsigned long next;
+
+  TA0CCTL1 = 0;
+  if (!imu.periodUs) {
+    return;
+  }
+  next = (afterUs / imu.periodUs + 1) * imu.periodUs;
+  if (next - tickStart < REPLAY_TICK_US) {
+    intUs = next;
+    TA0CCR1 = (unsigned int)((next - tickStart) * (TA0CCR0 + 1) / REPLAY_TICK_US);
+    TA0CCTL1 = (TA0CCR1 <= TA0R) ? CCIE | CCIFG : CCIE;
+  }
+}
+
+/* Name: replayNext
+   Return value:
+    const unsigned char* - next sample for the cursor (see log_format.h), 0 if the trace holds no valid block
+   Description:
+    Returns the sample under the cursor and moves it on, skipping invalid blocks and wrapping at the end of the trace.
+*/
+static const unsigned char* replayNext(ReplayCursor* cursor, unsigned int* wraps) {
+  unsigned long checked;
+
+  for (checked = 0; checked <= traceLength; checked++) {
+    const unsigned char* block = traceBlocks + cursor->block * LOG_BLOCK_SIZE;
+
+    if (logBlockIsValid(block) && cursor->sample < block[LOG_HDR_COUNT]) {
+      const unsigned char* sample = block + LOG_HDR_SIZE + cursor->sample * LOG_SAMPLE_SIZE;
+
+      cursor->sample++;
+      return sample;
+    }
+
+    cursor->sample = 0;
+    cursor->block++;
+    if (cursor->block >= traceLength) {
+      cursor->block = 0;
+      (*wraps)++;
+    }
+  }
+  return 0;
+}
+
+void replayInit(const unsigned char* trace, unsigned long blocks) {
+  traceBlocks = trace;
+  traceLength = blocks;
+  gyroCursor.block = 0;
+  gyroCursor.sample = 0;
+  magnetCursor.block = 0;
+  magnetCursor.sample = 0;
+  stats.gyroSamples = 0;
+  stats.magnetSamples = 0;
+  stats.otherMessages = 0;
+  stats.gyroWraps = 0;
+  stats.magnetWraps = 0;
+  stats.accelSamples = 0;
+  stats.statusReads = 0;
+  imu.periodUs = 0;
+  imu.seen = 0;
+  magnet.periodUs = 0;
+  magnet.seen = 0;
+  pinCfg = 0;
+}
+
+void replayTransfer(I2CMessage* messageStruct) {
+  const unsigned char* source = 0;
+  char status = 0;
+  char answered = 0;
+  int offset = 0; //Where source starts in the response
+  int j;
+
+  if (messageStruct->txrxMode == TX_MODE) {
+    replayConfigure(messageStruct);
+  } else if (messageStruct->messageLength > 0) {
+    char reg = messageStruct->message[0];
+
+    if (messageStruct->address == IMU_I2C_ADDR && reg == IMU_INT_PIN_CFG_REG) {
+      status = pinCfg;
+      answered = 1;
+    } else if (messageStruct->address == IMU_I2C_ADDR && reg == IMU_INT_STATUS_REG) {
+      status = replayReady(&imu, 1) ? IMU_RAW_DATA_RDY : 0;
+      answered = 1;
+      stats.statusReads++;
+    } else if (messageStruct->address == MAGNET_I2C_ADDR && reg == MAGNET_ST1_REG) {
+      status = replayReady(&magnet, 0) ? MAGNET_ST1_DRDY : 0;
+      answered = 1;
+      stats.statusReads++;
+    } else if (messageStruct->address == IMU_I2C_ADDR && reg == ACCEL_START) {
+      stats.accelSamples++; //Not in the flight log, reads as zeros
+      if (traceLength > 0 && messageStruct->respLen >= DRDY_READ_LEN) { //Burst through the gyroscope registers
+        source = replayNext(&gyroCursor, &stats.gyroWraps);
+        if (source) {
+          source += LOG_SAMPLE_GYRO;
+          offset = GYROSCOPE_START - ACCEL_START;
+          stats.gyroSamples++;
+        }
+      }
+      answered = !source;
+    } else if (traceLength > 0 && messageStruct->address == IMU_I2C_ADDR && reg == GYROSCOPE_START) {
+      source = replayNext(&gyroCursor, &stats.gyroWraps);
+      if (source) {
+        source += LOG_SAMPLE_GYRO;
+        stats.gyroSamples++;
+      }
+    } else if (messageStruct->address == MAGNET_I2C_ADDR && reg == MAGNET_START) {
+      replayReady(&magnet, 1); //Reading through ST2 releases the next measurement
+      source = traceLength > 0 ? replayNext(&magnetCursor, &stats.magnetWraps) : 0;
+      if (source) {
+        source += LOG_SAMPLE_MAGNET;
+        stats.magnetSamples++;
+      }
+    }
+  }
+  if (!source && !answered) {
+    stats.otherMessages++;
+  }
+
+  if (messageStruct->txrxMode == RX_MODE) {
+    for (j = 0; j < messageStruct->respLen; j++) {
+      messageStruct->response[j] = (source && j >= offset && j < offset + LOG_AXIS_BYTES) ? source[j - offset] : 0;
+    }
+    if (answered && messageStruct->respLen > 0) {
+      messageStruct->response[0] = status;
+    }
+  }
+  messageStruct -> error = I2CERR_NO_ERROR;
+}
+
+const ReplayStats* replayGetStats(void) {
+  return &stats;
+}
+
+void replayTick(void) {
+  replayArmInt(clockGetTicks() * REPLAY_TICK_US - 1);
+}
+
+#ifdef I2C_REPLAY
+#pragma vector = TIMER0_A1_VECTOR
+// Interrupt service routine for CCIFG1, the simulated MPU-9250 INT line
+__interrupt void Timer0_A1_routine(void) {
+  if (TA0IV == TA0IV_TACCR1) {
+    drdyEdge(intUs);
+    replayArmInt(intUs); //Next conversion, if it is still in this tick
+  }
+}
+#endif
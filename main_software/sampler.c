@@ -0,0 +1,207 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in sampler.h
+*/
+
+#include "sampler.h"
+#include "i2c_driver.h"
+#include "arena.h"
+#include "drdy.h"
+#include "config.h"
+
+#if SAMPLER_IMU_DRDY
+#define SAMPLER_IMU_RELEASES(releases) 0 //Not polled
+#else
+#define SAMPLER_IMU_RELEASES(releases) (releases)
+#endif
+
+#define SAMPLER_BUFFER_BYTES (1 + MAGNET_DATA_LEN) //Register address, then the longest response
+
+/* Name: SamplerSource_s
+   Type: struct
+   Purpose:
+    Where and how often a sensor is read.
+*/
+struct SamplerSource_s {
+  char address;
+  char statusReg; //Register holding the data-ready bit
+  char readyMask;
+  char dataReg;
+  char dataLen; //Bytes read from dataReg, at least SAMPLER_DATA_BYTES
+  unsigned char releases; //Releases between polls at boot, 0 for never
+  unsigned long maxHz;
+};
+typedef struct SamplerSource_s SamplerSource;
+
+static const SamplerSource sources[SENSOR_COUNT] = {
+  {IMU_I2C_ADDR, IMU_INT_STATUS_REG, IMU_RAW_DATA_RDY, GYROSCOPE_START, SAMPLER_DATA_BYTES, SAMPLER_IMU_RELEASES(SAMPLER_GYRO_RELEASES),
+   IMU_I2C_MAX_HZ},
+  {IMU_I2C_ADDR, IMU_INT_STATUS_REG, IMU_RAW_DATA_RDY, ACCEL_START, SAMPLER_DATA_BYTES, SAMPLER_IMU_RELEASES(SAMPLER_ACCEL_RELEASES),
+   IMU_I2C_MAX_HZ},
+  {MAGNET_I2C_ADDR, MAGNET_ST1_REG, MAGNET_ST1_DRDY, MAGNET_START, MAGNET_DATA_LEN, SAMPLER_MAGNET_RELEASES,
+   MAGNET_I2C_MAX_HZ}
+};
+
+static I2CMessage* msg; //From the arena
+static char* buffer;
+static unsigned char releases[SENSOR_COUNT]; //Releases between polls now, 0 for never
+static unsigned char order[SENSOR_COUNT]; //Sensors by poll period, shortest first
+static unsigned char countdown[SENSOR_COUNT]; //Releases until the next poll
+static char latest[SENSOR_COUNT][SAMPLER_DATA_BYTES];
+static SamplerStats stats[SENSOR_COUNT];
+
+/* Name: samplerTransfer
+   Parameters:
+    char address, char reg - device and first register
+    char txrxMode - TX_MODE writes value to reg, RX_MODE reads respLen bytes into buffer + 1
+    unsigned long maxHz - device's bus rate limit
+   Return value:
+    char - 1 if the transfer succeeded
+*/
+static char samplerTransfer(char address, char reg, char txrxMode, char value, int respLen, unsigned long maxHz) {
+  buffer[0] = reg;
+  buffer[1] = value;
+  if (txrxMode == TX_MODE) {
+    i2cInitializeMessage(msg, buffer, 2, address, TX_MODE, 0, NO_RESPONSE, SECONDARY);
+  } else {
+    i2cInitializeMessage(msg, buffer, 1, address, RX_MODE, respLen, buffer + 1, SECONDARY);
+  }
+  i2cSetMessageRate(msg, maxHz);
+  do {
+    i2cSendMessage(msg);
+  } while (msg->error == I2CERR_BUS_BUSY); //Data-ready read in progress, a few hundred us
+  return msg->error == I2CERR_NO_ERROR;
+}
+
+/* Name: samplerSortOrder
+   Description:
+    Puts the sensors in order of their poll period, shortest first (rate monotonic).  Insertion sort.
+*/
+static void samplerSortOrder(void) {
+  unsigned char n;
+  unsigned char m;
+
+  for (n = 0; n < SENSOR_COUNT; n++) {
+    for (m = n; m > 0 && releases[order[m - 1]] > releases[n]; m--) {
+      order[m] = order[m - 1];
+    }
+    order[m] = n;
+  }
+}
+
+char samplerInit(void) {
+  I2CConfig cfg;
+  unsigned int stored;
+  unsigned int busKhz = configGet(CONFIG_IMU_BUS_KHZ, I2C_FAST_HZ / 1000);
+  unsigned char n;
+
+  if (!msg) {
+    msg = arenaAlloc(ARENA_I2C, sizeof(I2CMessage));
+    buffer = arenaAlloc(ARENA_I2C, SAMPLER_BUFFER_BYTES);
+  }
+  if (!msg || !buffer) { //Over budget, arenaReport() says so
+    return 0;
+  }
+
+  for (n = 0; n < SENSOR_COUNT; n++) {
+    releases[n] = sources[n].releases;
+    stored = configGet(CONFIG_GYRO_RELEASES + n, releases[n]); //From the ground, see samplerSetReleases()
+    if (releases[n] && stored && stored <= 0xFF) {
+      releases[n] = stored;
+    }
+    countdown[n] = 0;
+    stats[n].polls = 0;
+    stats[n].statusReads = 0;
+    stats[n].dataReads = 0;
+    stats[n].dataBytes = 0;
+    stats[n].stale = 0;
+    stats[n].errors = 0;
+  }
+  samplerSortOrder();
+
+  if (busKhz < I2C_STANDARD_HZ / 1000 || busKhz > I2C_FAST_HZ / 1000) {
+    busKhz = I2C_FAST_HZ / 1000;
+  }
+  i2cInitializeConfigRate(&cfg, SECONDARY, busKhz * 1000UL); //Both devices do fast mode, the ground may slow it
+  i2cInit(&cfg);
+
+  //The AK8963 sits behind the MPU-9250, and only answers at MAGNET_I2C_ADDR once the bypass is on
+  if (!samplerTransfer(IMU_I2C_ADDR, IMU_INT_PIN_CFG_REG, TX_MODE, IMU_BYPASS_EN, 0, IMU_I2C_MAX_HZ) ||
+      !samplerTransfer(IMU_I2C_ADDR, IMU_INT_PIN_CFG_REG, RX_MODE, 0, 1, IMU_I2C_MAX_HZ) ||
+      buffer[1] != IMU_BYPASS_EN) {
+    return 0;
+  }
+  samplerTransfer(IMU_I2C_ADDR, IMU_CONFIG_REG, TX_MODE, IMU_CONFIG_DLPF_184HZ, 0, IMU_I2C_MAX_HZ);
+  samplerTransfer(IMU_I2C_ADDR, IMU_SMPLRT_DIV_REG, TX_MODE, IMU_INTERNAL_HZ / SAMPLER_IMU_HZ - 1, 0, IMU_I2C_MAX_HZ);
+  samplerTransfer(IMU_I2C_ADDR, IMU_INT_ENABLE_REG, TX_MODE, IMU_RAW_DATA_RDY, 0, IMU_I2C_MAX_HZ);
+  samplerTransfer(MAGNET_I2C_ADDR, MAGNET_CNTL1_REG, TX_MODE, SAMPLER_MAGNET_MODE, 0, MAGNET_I2C_MAX_HZ);
+  return SAMPLER_IMU_DRDY ? drdyInit() : 1;
+}
+
+unsigned char samplerStep(void) {
+  unsigned char fresh = 0;
+  char statusAddress = 0; //Device whose status was read this release, 0 for none
+  char status = 0;
+  unsigned char n;
+  unsigned char j;
+
+  for (n = 0; n < SENSOR_COUNT; n++) {
+    unsigned char sensor = order[n];
+    const SamplerSource* source = &sources[sensor];
+    SamplerStats* stat = &stats[sensor];
+
+    if (!releases[sensor]) {
+      continue;
+    }
+    if (countdown[sensor]) {
+      countdown[sensor]--;
+      continue;
+    }
+    countdown[sensor] = releases[sensor] - 1;
+    stat -> polls++;
+
+    if (statusAddress != source->address) { //Reading the status clears it, so one read per device and release
+      stat -> statusReads++;
+      if (!samplerTransfer(source->address, source->statusReg, RX_MODE, 0, 1, source->maxHz)) {
+        stat -> errors++;
+        continue;
+      }
+      statusAddress = source->address;
+      status = buffer[1];
+    }
+    if (!(status & source->readyMask)) {
+      stat -> stale++;
+      continue;
+    }
+
+    stat -> dataReads++;
+    stat -> dataBytes += source->dataLen;
+    if (!samplerTransfer(source->address, source->dataReg, RX_MODE, 0, source->dataLen, source->maxHz)) {
+      stat -> errors++;
+      continue;
+    }
+    for (j = 0; j < SAMPLER_DATA_BYTES; j++) {
+      latest[sensor][j] = buffer[1 + j];
+    }
+    fresh |= SAMPLER_NEW(sensor);
+  }
+
+  return fresh;
+}
+
+char samplerSetReleases(SamplerSensor sensor, unsigned char count) {
+  if (sensor >= SENSOR_COUNT || !count || !sources[sensor].releases) { //Sensors on the interrupt are never polled
+    return 0;
+  }
+  releases[sensor] = count;
+  countdown[sensor] = 0;
+  samplerSortOrder();
+  return 1;
+}
+
+const char* samplerGetData(SamplerSensor sensor) {
+  return latest[sensor];
+}
+
+const SamplerStats* samplerGetStats(SamplerSensor sensor) {
+  return &stats[sensor];
+}
@@ -0,0 +1,334 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in sd_card.h
+*/
+
+#include "sd_card.h"
+#include "watchdog.h"
+
+/* Name: sdExchange
+   Description:
+    Clocks one byte out and returns the byte clocked in.
+*/
+static unsigned char sdExchange(unsigned char out) {
+  while (!SD_TX_READY);
+  UCB0TXBUF = out;
+  while (!SD_RX_READY);
+  return UCB0RXBUF;
+}
+
+/* Name: sdSetDivider
+   Description:
+    Sets the SPI clock divider (from SMCLK).
+*/
+static void sdSetDivider(int divider) {
+  UCB0CTL1 |= UCSWRST;
+  UCB0BR0 = divider & BAUD_LOW_MASK;
+  UCB0BR1 = divider >> BAUD_SHIFT;
+  UCB0CTL1 &= ~UCSWRST;
+}
+
+/* Name: sdInitDivider
+   Description:
+    SPI clock divider that keeps the card at or below SD_INIT_HZ at the current SMCLK.
+*/
+static int sdInitDivider(void) {
+  return (int)((clockGetSmclkHz() + SD_INIT_HZ - 1) / SD_INIT_HZ);
+}
+
+/* Name: sdBytesIn
+   Description:
+    Number of bytes that take ms milliseconds to clock at the run speed, for timeouts that follow the clock profile.
+*/
+static unsigned long sdBytesIn(unsigned int ms) {
+  return clockGetSmclkHz() / SD_RUN_DIVIDER / 8000 * ms;
+}
+
+/* Name: sdWaitReady
+   Description:
+    Waits until the card stops holding its output low (busy).  Returns 1 if it did within SD_BUSY_MS.
+*/
+static char sdWaitReady(void) {
+  unsigned long tries;
+  unsigned long limit = sdBytesIn(SD_BUSY_MS);
+
+  watchdogKick(); //SD_BUSY_MS, twice in a burst, would be most of WATCHDOG_INTERVAL_MS
+  for (tries = 0; tries < limit; tries++) {
+    if (sdExchange(0xFF) == 0xFF) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Name: sdCommand
+   Description:
+    Sends a command frame and returns its R1 response (0xFF if the card never answered).
+*/
+static unsigned char sdCommand(unsigned char command, unsigned long argument) {
+  unsigned char crc = 0x01; //CRC is ignored in SPI mode, except for CMD0 and CMD8
+  unsigned char response = 0xFF;
+  char tries;
+
+  if (command == SD_CMD0) {
+    crc = 0x95;
+  } else if (command == SD_CMD8) {
+    crc = 0x87;
+  }
+
+  sdExchange(0x40 | command);
+  sdExchange((argument >> 24) & 0xFF);
+  sdExchange((argument >> 16) & 0xFF);
+  sdExchange((argument >> 8) & 0xFF);
+  sdExchange(argument & 0xFF);
+  sdExchange(crc);
+
+  for (tries = 0; tries < SD_CMD_TRIES; tries++) {
+    response = sdExchange(0xFF);
+    if (!(response & 0x80)) {
+      break;
+    }
+  }
+  return response;
+}
+
+/* Name: sdAppCommand
+   Description:
+    Sends CMD55 followed by the application specific command.
+*/
+static unsigned char sdAppCommand(unsigned char command, unsigned long argument) {
+  sdCommand(SD_CMD55, 0);
+  return sdCommand(command, argument);
+}
+
+/* Name: sdAddress
+   Description:
+    Converts a block number to the command argument the card expects.
+*/
+static unsigned long sdAddress(SDCard* card, unsigned long block) {
+  return card->isHighCapacity ? block : block * SD_BLOCK_SIZE;
+}
+
+char sdAcquireBus(SDCard* card) {
+  int divider = (card->isInitialized == IS_INITIALIZED) ? SD_RUN_DIVIDER : sdInitDivider();
+
+  if (!i2cAcquireInterface(PRIMARY)) { //A message, or the stop of the last one, is still on the bus
+    card -> error = SDERR_BUS_BUSY;
+    return 0;
+  }
+
+  UCB0CTL1 |= UCSWRST;
+  UCB0CTL0 = UCCKPH + UCMSB + UCMST + UCSYNC; //SPI mode 0, 3-pin, master
+  UCB0CTL1 = UCSSEL_2 + UCSWRST; //SMCLK
+  UCB0BR0 = divider & BAUD_LOW_MASK;
+  UCB0BR1 = divider >> BAUD_SHIFT;
+  PRIMARY_I2C_SEL |= SD_SPI_PINS;
+  UCB0CTL1 &= ~UCSWRST;
+
+  SET_ISOL_PIN_OUT;
+  SD_SELECT;
+  card -> hasBus = 1;
+  card -> error = SDERR_NO_ERROR;
+  return 1;
+}
+
+void sdReleaseBus(SDCard* card) {
+  I2CConfig cfg;
+
+  SD_DESELECT;
+  sdExchange(0xFF); //Card releases its output one clock after deselect
+  PRIMARY_I2C_SEL &= ~BIT3; //UCB0CLK is not part of the I2C bus
+
+  i2cInitializeConfigRate(&cfg, PRIMARY, I2C_STANDARD_HZ);
+  i2cInit(&cfg);
+  card -> hasBus = 0;
+  i2cReleaseInterface(PRIMARY); //Back in I2C mode first: the idle hook may start a message
+}
+
+void sdInit(SDCard* card) {
+  sdInitStart(card);
+  while (card->error == SDERR_NO_ERROR && !sdInitPoll(card)) {
+    watchdogKick(); //SD_INIT_TRIES take over half a second
+  }
+}
+
+void sdInitStart(SDCard* card) {
+  unsigned char response;
+  unsigned char ocr[4];
+  unsigned char i;
+
+  card -> isInitialized = 0;
+  card -> isHighCapacity = 0;
+  card -> isVersion2 = 0;
+  card -> initTries = 0;
+  sdSetDivider(sdInitDivider());
+
+  //At least 74 clocks with the card deselected.  SIMO (SDA) stays high and SOMI (SCL) is an input, so the I2C bus sees
+  //nothing on the way past the isolator.
+  SD_DESELECT;
+  for (i = 0; i < 10; i++) {
+    sdExchange(0xFF);
+  }
+  SD_SELECT;
+
+  if (sdCommand(SD_CMD0, 0) != SD_R1_IDLE) {
+    card -> error = SDERR_NO_CARD;
+    return;
+  }
+
+  response = sdCommand(SD_CMD8, 0x1AA); //2.7-3.6 V, check pattern 0xAA
+  card -> isVersion2 = !(response & SD_R1_ILLEGAL_CMD);
+  if (card->isVersion2) {
+    for (i = 0; i < 4; i++) {
+      ocr[i] = sdExchange(0xFF);
+    }
+    if (ocr[3] != 0xAA) {
+      card -> error = SDERR_UNSUPPORTED;
+      return;
+    }
+  }
+  card -> error = SDERR_NO_ERROR;
+}
+
+char sdInitPoll(SDCard* card) {
+  unsigned char response = 0xFF;
+  unsigned char ocr[4];
+  unsigned char i;
+
+  for (i = 0; i < SD_INIT_POLL_TRIES && card->initTries < SD_INIT_TRIES; i++) {
+    card -> initTries++;
+    response = sdAppCommand(SD_CMD41, card->isVersion2 ? 0x40000000UL : 0); //Announce SDHC support to version 2 cards
+    if (response == 0) {
+      break;
+    }
+  }
+  if (response != 0) {
+    if (card->initTries < SD_INIT_TRIES) {
+      return 0; //Still starting up
+    }
+    card -> error = SDERR_TIMEOUT;
+    return 1;
+  }
+
+  if (card->isVersion2) {
+    if (sdCommand(SD_CMD58, 0) != 0) {
+      card -> error = SDERR_UNSUPPORTED;
+      return 1;
+    }
+    for (i = 0; i < 4; i++) {
+      ocr[i] = sdExchange(0xFF);
+    }
+    card -> isHighCapacity = (ocr[0] & SD_OCR_CCS) ? 1 : 0;
+  }
+
+  if (!card->isHighCapacity && sdCommand(SD_CMD16, SD_BLOCK_SIZE) != 0) {
+    card -> error = SDERR_UNSUPPORTED;
+    return 1;
+  }
+
+  sdSetDivider(SD_RUN_DIVIDER);
+  card -> isInitialized = IS_INITIALIZED;
+  card -> error = SDERR_NO_ERROR;
+  return 1;
+}
+
+char sdIsReady(SDCard* card) {
+  return sdExchange(0xFF) == 0xFF;
+}
+
+void sdReadBlock(SDCard* card, unsigned long block, unsigned char* buffer) {
+  sdReadRange(card, block, 0, buffer, SD_BLOCK_SIZE);
+}
+
+void sdReadRange(SDCard* card, unsigned long block, unsigned int start, unsigned char* buffer, unsigned int length) {
+  unsigned long tries;
+  unsigned long limit = sdBytesIn(SD_TOKEN_MS);
+  unsigned int i;
+  unsigned char token = 0xFF;
+  unsigned char byte;
+
+  if (card->isInitialized != IS_INITIALIZED) {
+    card -> error = SDERR_NOT_INITIALIZED;
+    return;
+  }
+  if (!sdWaitReady()) {
+    card -> error = SDERR_TIMEOUT;
+    return;
+  }
+  if (sdCommand(SD_CMD17, sdAddress(card, block)) != 0) {
+    card -> error = SDERR_READ_FAILED;
+    return;
+  }
+
+  for (tries = 0; tries < limit; tries++) {
+    token = sdExchange(0xFF);
+    if (token != 0xFF) {
+      break;
+    }
+  }
+  if (token != SD_TOKEN_READ) { //Timed out, or error token
+    card -> error = (token == 0xFF) ? SDERR_TIMEOUT : SDERR_READ_FAILED;
+    return;
+  }
+
+  for (i = 0; i < SD_BLOCK_SIZE; i++) { //The whole block has to be clocked out, only the range is kept
+    byte = sdExchange(0xFF);
+    if (i - start < length) {
+      buffer[i - start] = byte;
+    }
+  }
+  sdExchange(0xFF); //CRC, unused
+  sdExchange(0xFF);
+
+  card -> error = SDERR_NO_ERROR;
+}
+
+void sdWriteBlocks(SDCard* card, unsigned long block, unsigned char* const* buffers, int count) {
+  int n;
+  unsigned int i;
+
+  if (card->isInitialized != IS_INITIALIZED) {
+    card -> error = SDERR_NOT_INITIALIZED;
+    return;
+  }
+  if (count <= 0) {
+    card -> error = SDERR_NO_ERROR;
+    return;
+  }
+  if (!sdWaitReady()) {
+    card -> error = SDERR_TIMEOUT;
+    return;
+  }
+
+  sdAppCommand(SD_CMD23, count); //Pre-erase hint, speeds up the multiple block write.  Failure is harmless.
+  if (sdCommand(SD_CMD25, sdAddress(card, block)) != 0) {
+    card -> error = SDERR_WRITE_REJECTED;
+    return;
+  }
+
+  for (n = 0; n < count; n++) {
+    const unsigned char* data = buffers[n];
+
+    sdExchange(0xFF); //One byte gap before each data token
+    sdExchange(SD_TOKEN_MULTI_WRITE);
+    for (i = 0; i < SD_BLOCK_SIZE; i++) {
+      sdExchange(data[i]);
+    }
+    sdExchange(0xFF); //CRC, unused
+    sdExchange(0xFF);
+
+    if ((sdExchange(0xFF) & SD_DATA_RESP_MASK) != SD_DATA_ACCEPTED) {
+      sdExchange(SD_TOKEN_STOP_TRAN);
+      card -> error = SDERR_WRITE_REJECTED;
+      return;
+    }
+    if (!sdWaitReady()) {
+      sdExchange(SD_TOKEN_STOP_TRAN); //Out of the write state, or the next command would be taken as data
+      card -> error = SDERR_TIMEOUT;
+      return;
+    }
+  }
+
+  sdExchange(SD_TOKEN_STOP_TRAN);
+  sdExchange(0xFF); //Card starts signalling busy one byte after the stop token
+  card -> error = SDERR_NO_ERROR;
+}
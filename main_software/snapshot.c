@@ -0,0 +1,187 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in snapshot.h
+*/
+
+#include "snapshot.h"
+
+#define SNAPSHOT_RULES (sizeof(snapshotRules) / sizeof(snapshotRules[0]))
+
+static const SnapshotRule snapshotRules[] = {{SNAPSHOT_GYRO, SNAPSHOT_ABOVE, SNAPSHOT_TUMBLE_LEVEL},
+                                             {SNAPSHOT_GYRO, SNAPSHOT_STEP, SNAPSHOT_GYRO_STEP_LEVEL},
+                                             {SNAPSHOT_ACCEL, SNAPSHOT_STEP, SNAPSHOT_SHOCK_LEVEL}};
+
+static Snapshot* snapshots;
+static Snapshot* armed; //Recording (armed or taking post-trigger samples), 0 when every snapshot is frozen
+static SnapshotSample previous; //For SNAPSHOT_STEP
+static char havePrevious;
+static unsigned char pendingCause; //From snapshotTrigger()
+static unsigned int sequence;
+static SnapshotStats stats;
+
+/* Name: snapshotArm
+   Description:
+    Arms a free snapshot, if there is one and none is recording.
+*/
+static void snapshotArm(void) {
+  unsigned char n;
+
+  if (armed || !snapshots) {
+    return;
+  }
+  for (n = 0; n < SNAPSHOT_BUFFERS; n++) {
+    if (snapshots[n].state == SNAPSHOT_FREE) {
+      armed = &snapshots[n];
+      armed -> state = SNAPSHOT_ARMED;
+      armed -> next = 0;
+      armed -> count = 0;
+      armed -> cause = 0;
+      return;
+    }
+  }
+}
+
+void snapshotInit(Snapshot* buffers) {
+  unsigned char n;
+
+  snapshots = buffers;
+  armed = 0;
+  havePrevious = 0;
+  pendingCause = 0;
+  if (buffers) {
+    for (n = 0; n < SNAPSHOT_BUFFERS; n++) {
+      buffers[n].state = SNAPSHOT_FREE;
+    }
+  }
+  snapshotArm();
+}
+
+/* Name: snapshotCheck
+   Return value:
+    unsigned char - SNAPSHOT_CAUSE_* bits of the rules that fire on this sample
+*/
+static unsigned char snapshotCheck(const SnapshotSample* sample) {
+  unsigned char cause = 0;
+  unsigned char r;
+  unsigned char axis;
+
+  for (r = 0; r < SNAPSHOT_RULES; r++) {
+    const SnapshotRule* rule = &snapshotRules[r];
+    const int* now = (rule->source == SNAPSHOT_GYRO) ? sample->gyro : sample->accel;
+    const int* before = (rule->source == SNAPSHOT_GYRO) ? previous.gyro : previous.accel;
+
+    if (rule->test == SNAPSHOT_STEP && !havePrevious) {
+      continue;
+    }
+    for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+      if (rule->test == SNAPSHOT_STEP) {
+        long step = (long)now[axis] - before[axis];
+
+        if (step >= rule->level || step <= -rule->level) {
+          break;
+        }
+      } else if ((now[axis] >= rule->level || now[axis] <= -rule->level) && //Crossing only, not staying above
+                 !(havePrevious && (before[axis] >= rule->level || before[axis] <= -rule->level))) {
+        break;
+      }
+    }
+    if (axis < SNAPSHOT_AXES) {
+      cause |= 1 << r;
+    }
+  }
+  return cause;
+}
+
+void snapshotSample(const int* gyro, const int* accel, unsigned long tick) {
+  SnapshotSample unrecorded;
+  SnapshotSample* sample;
+  unsigned char cause;
+  unsigned char axis;
+
+  if (!snapshots) {
+    return;
+  }
+  stats.samples++;
+
+  if (armed) {
+    sample = &armed->samples[armed->next];
+    armed -> next = (armed->next + 1) & (SNAPSHOT_LEN - 1);
+    if (armed->count < SNAPSHOT_LEN) {
+      armed -> count++;
+    }
+  } else {
+    sample = &unrecorded; //Only the rules see it
+  }
+  for (axis = 0; axis < SNAPSHOT_AXES; axis++) {
+    sample -> gyro[axis] = gyro[axis];
+    sample -> accel[axis] = accel[axis];
+  }
+
+  cause = snapshotCheck(sample) | pendingCause;
+  pendingCause = 0;
+  previous = *sample;
+  havePrevious = 1;
+
+  if (!armed) {
+    if (cause) {
+      stats.dropped++;
+    }
+    return;
+  }
+
+  if (armed->state == SNAPSHOT_ARMED) {
+    if (!cause) {
+      return;
+    }
+    armed -> state = SNAPSHOT_TRIGGERED;
+    armed -> triggerTick = tick;
+    armed -> pre = armed->count - 1 < SNAPSHOT_PRE ? armed->count - 1 : SNAPSHOT_PRE;
+    armed -> post = SNAPSHOT_POST;
+    stats.triggers++;
+  }
+  armed -> cause |= cause;
+
+  if (--armed->post == 0) { //Frozen: the trigger sample and everything after it, plus pre samples before
+    armed -> first = (armed->next - SNAPSHOT_POST - armed->pre) & (SNAPSHOT_LEN - 1);
+    armed -> sequence = sequence++;
+    armed -> state = SNAPSHOT_FROZEN;
+    armed = 0;
+    stats.frozen++;
+    snapshotArm();
+  }
+}
+
+void snapshotTrigger(unsigned char cause) {
+  pendingCause |= cause;
+}
+
+Snapshot* snapshotNext(void) {
+  Snapshot* oldest = 0;
+  unsigned char n;
+
+  if (!snapshots) {
+    return 0;
+  }
+  for (n = 0; n < SNAPSHOT_BUFFERS; n++) {
+    if (snapshots[n].state == SNAPSHOT_FROZEN &&
+        (!oldest || (int)(snapshots[n].sequence - oldest->sequence) < 0)) {
+      oldest = &snapshots[n];
+    }
+  }
+  return oldest;
+}
+
+const SnapshotSample* snapshotGetSample(const Snapshot* snapshot, unsigned char n) {
+  if (n >= snapshot->pre + SNAPSHOT_POST) {
+    return 0;
+  }
+  return &snapshot->samples[(snapshot->first + n) & (SNAPSHOT_LEN - 1)];
+}
+
+void snapshotRelease(Snapshot* snapshot) {
+  snapshot -> state = SNAPSHOT_FREE;
+  snapshotArm();
+}
+
+const SnapshotStats* snapshotGetStats(void) {
+  return &stats;
+}
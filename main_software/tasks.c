@@ -3,69 +3,152 @@
 */
 
 #include "tasks.h"
-#include "i2c_driver.h"
-#include "i2c_peripherals.h"
+#include "sampler.h"
+#include "drdy.h"
+#include "calib.h"
+#include "decim.h"
+#include "snapshot.h"
 #include "data.h"
+#include "antenna.h"
+#include "recorder.h"
+#include "downlink.h"
+#include "clock.h"
+#include "profile.h"
+#include "watchdog.h"
+#include "boot.h"
+
+Periodic imuPeriodic;
 
 void task_getIMUData() {
-  while(1) {
-    I2CConfig cfg;
-    I2CMessage msg;
+  static unsigned char delay; //static, locals do not survive a context switch
+  static int gyro[DATA_AXES]; //Calibrated, latest of each sensor
+  static int accel[DATA_AXES];
+  static int magnet[DATA_AXES];
+  static Decimator gyroDecimator;
+  static Decimator accelDecimator;
+  int in[DATA_AXES];
+  unsigned char fresh;
+  const DrdySample* sample;
 
-    char message_str[IMU_DATA_MSG_LEN];
-    char response_str[IMU_DATA_RESP_LEN];
-    char i = 0;
+  OS_TASK_BEGIN();
+  TASK_START(TASK_ID_GET_IMU_DATA);
+  calibInit(); //Identity if segment B holds no valid table; while the IMU starts up
+  //No check ins while waiting to start a device: the waits are well within the deadlines (watchdog.h), and checkpoints
+  //must not start before every init has read the kept block
+  while ((delay = bootWait(BOOT_IMU))) {
+    TASK_DELAY(TASK_ID_GET_IMU_DATA, delay);
+  }
+  if (!samplerInit()) { //Over budget (arenaReport() says so), or the IMU not answering
+    while (1) {
+      watchdogCheckIn(TASK_ID_GET_IMU_DATA);
+      TASK_DELAY(TASK_ID_GET_IMU_DATA, WATCHDOG_IMU_TICKS / 2);
+    }
+  }
+  bootMark(BOOT_IMU_CONFIGURED);
+  decimInit(&gyroDecimator);
+  decimInit(&accelDecimator);
+  periodicInit(&imuPeriodic, TASK_IMU_PERIOD_TICKS, TASK_IMU_DEADLINE_TICKS, 0);
 
-    for (i = 0; i < 2; i++) {
+  while(1) {
+    watchdogCheckIn(TASK_ID_GET_IMU_DATA);
+    delay = periodicDelay(&imuPeriodic);
+    if (delay) {
+      TASK_DELAY(TASK_ID_GET_IMU_DATA, delay);
+    } else {
+      TASK_YIELD(TASK_ID_GET_IMU_DATA); //Released already
+    }
+    periodicStart(&imuPeriodic);
 
-      char j;
-      for (j = 0; j < IMU_DATA_RESP_LEN, j++) {
-            response_str[i] = 0;
+    //Every sample is calibrated once, as it arrives.  History and log follow the gyroscope, with the latest sample of
+    //the other sensors; the log keeps the raw bytes, so the ground can fit the calibration again.
+    fresh = samplerStep();
+    if (fresh & SAMPLER_NEW(SENSOR_MAGNET)) {
+      calibApply(CALIB_MAGNET, samplerGetData(SENSOR_MAGNET), magnet);
+    }
+    if (fresh & SAMPLER_NEW(SENSOR_ACCEL)) {
+      calibApply(CALIB_ACCEL, samplerGetData(SENSOR_ACCEL), accel);
+    }
+    if (fresh & SAMPLER_NEW(SENSOR_GYRO)) {
+      calibApply(CALIB_GYRO, samplerGetData(SENSOR_GYRO), gyro);
+      dataStoreSample(gyro, accel, magnet);
+      snapshotSample(gyro, accel, clockGetTicks());
+      recorderAddSample(clockGetTicks(), samplerGetData(SENSOR_GYRO), samplerGetData(SENSOR_MAGNET));
+    }
+    //SAMPLER_IMU_DRDY, read by the interrupt routines since the last release at SAMPLER_IMU_HZ.  Only one in DECIM_RATIO
+    //reaches the history and the log, both filters take the same samples so their outputs come together.
+    while ((sample = drdyNext())) {
+      calibApply(CALIB_ACCEL, sample->raw + DRDY_ACCEL, in);
+      decimPush(&accelDecimator, in, accel);
+      calibApply(CALIB_GYRO, sample->raw + DRDY_GYRO, in);
+      if (decimPush(&gyroDecimator, in, gyro)) {
+        dataStoreSample(gyro, accel, magnet);
+        snapshotSample(gyro, accel, clockGetTicks());
+        recorderAddSample(clockGetTicks(), sample->raw + DRDY_GYRO, samplerGetData(SENSOR_MAGNET));
       }
+      drdyRelease();
+    }
+    periodicDone(&imuPeriodic);
+  }
+  OS_TASK_END();
+}
 
-      switch(i) {
-        case 0: //magnetometer
+void task_deployAntenna() {
+  static unsigned char delay; //static, locals do not survive a context switch
 
-          message_str[0] = MAGNET_START;
+  OS_TASK_BEGIN();
+  TASK_START(TASK_ID_DEPLOY_ANTENNA);
+  while ((delay = bootWait(BOOT_ANTENNA))) { //Deferred until the first sample
+    TASK_DELAY(TASK_ID_DEPLOY_ANTENNA, delay);
+  }
+  antennaInit();
+  bootMark(BOOT_ANTENNA_STARTED);
+
+  while(1) {
+    watchdogCheckIn(TASK_ID_DEPLOY_ANTENNA);
+    delay = antennaStep();
+    if (delay) {
+      TASK_DELAY(TASK_ID_DEPLOY_ANTENNA, delay);
+    } else {
+      TASK_YIELD(TASK_ID_DEPLOY_ANTENNA); //I2C transfer in flight, let the IMU task run meanwhile
+    }
+  }
+  OS_TASK_END();
+}
 
-          i2cInitializeConfig(cfg, SECONDARY, SMCLK, BAUD_DIVIDE_10);
-          i2cInitializeMessage(msg, message_str, IMU_DATA_MSG_LEN, MAGNET_ADDR, RX_MODE, IMU_DATA_RESP_LEN, response_str, SECONDARY);
-          i2cInit(cfg);
-          i2cSendMessage(msg);
+void task_recordData() {
+  static unsigned char delay;
 
-          if (bufferIndex == 99) {
-            bufferIndex = 0;
-          } else {
-            bufferIndex++;
-          }
+  OS_TASK_BEGIN();
+  TASK_START(TASK_ID_RECORD_DATA);
+  recorderInit();
 
-          for (j = 0; j < IMU_DATA_RESP_LEN; j++) {
-            magnetometerBuffer[j][bufferIndex] = response_str[j];
-          }
-          break;
-        case 1: //gyroscope
-    
-          message_str[0] = GYROSCOPE_START;
+  while(1) {
+    watchdogCheckIn(TASK_ID_RECORD_DATA);
+    delay = recorderStep();
+    if (delay) {
+      TASK_DELAY(TASK_ID_RECORD_DATA, delay);
+    } else {
+      TASK_YIELD(TASK_ID_RECORD_DATA); //Waiting for the primary I2C bus
+    }
+  }
+  OS_TASK_END();
+}
 
-          i2cInitializeConfig(cfg, SECONDARY, SMCLK, BAUD_DIVIDE_10);
-          i2cInitializeMessage(msg, message_str, IMU_DATA_MSG_LEN, IMU_I2C_ADDR, RX_MODE, IMU_DATA_RESP_LEN, response_str, SECONDARY);
-          i2cInit(cfg);
-          i2cSendMessage(msg);
+void task_sendData() {
+  static unsigned char delay;
 
-          if (bufferIndex == 99) {
-            bufferIndex = 0;
-          } else {
-            bufferIndex++;
-          }
+  OS_TASK_BEGIN();
+  TASK_START(TASK_ID_SEND_DATA);
+  while ((delay = bootWait(BOOT_RADIO))) { //Deferred until the first sample
+    TASK_DELAY(TASK_ID_SEND_DATA, delay);
+  }
+  downlinkInit();
+  bootMark(BOOT_RADIO_STARTED);
 
-          for (j = 0; j < IMU_DATA_RESP_LEN; j++) {
-            gyroscopeBuffer[j][bufferIndex] = response_str[j];
-          }
-          break;
-        default:
-          //do nothing
-      }
-    }
-    OS_Yield();
+  while(1) {
+    watchdogCheckIn(TASK_ID_SEND_DATA);
+    delay = downlinkStep();
+    TASK_DELAY(TASK_ID_SEND_DATA, delay);
   }
-}
\ No newline at end of file
+  OS_TASK_END();
+}
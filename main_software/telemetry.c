@@ -0,0 +1,236 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in telemetry.h
+*/
+
+#include "telemetry.h"
+#include "log_format.h"
+
+#define TELEMETRY_NONE 0xFF //End of a slot list
+
+//Health and command replies are small and always wanted, latest health first; snapshots, IMU frames and bulk chunks
+//share what is left 2:1:3 (a bulk download is asked for, the ground is waiting on it); snapshots and bulk chunks are
+//never dropped since their producers offer them again; IMU frames older than 5 s are better read from the flight log.
+const TelemetryPolicy telemetryPolicies[TELEMETRY_CLASSES] = {
+  {3, 1, 1, 0, TELEMETRY_FRAME_MAX, 0}, //TELEMETRY_HEALTH: one frame per pass at most
+  {5, 0, 0, 2 * TELEMETRY_FRAME_MAX, 0, 0}, //TELEMETRY_SNAPSHOT
+  {3, 1, 0, TELEMETRY_FRAME_MAX, 0, 500}, //TELEMETRY_IMU
+  {2, 0, 1, 0, 0, 0}, //TELEMETRY_REPLY: the ground sends again if it hears nothing
+  {3, 0, 0, 3 * TELEMETRY_FRAME_MAX, 0, 0} //TELEMETRY_BULK: a few ahead of the link is enough, the window is in bulk.c
+};
+
+static TelemetryPacket* pool;
+static const TelemetryPolicy* policies;
+static unsigned char freeSlot; //Head of the free list
+static unsigned char head[TELEMETRY_CLASSES];
+static unsigned char tail[TELEMETRY_CLASSES];
+static unsigned char count[TELEMETRY_CLASSES];
+static unsigned int deficit[TELEMETRY_CLASSES]; //Weighted classes, bytes they may still send this round
+static unsigned int passLeft[TELEMETRY_CLASSES]; //Classes with a passBytes budget
+static unsigned char turn; //Weighted class being served
+static char credited; //turn has had its quantum for this visit
+static unsigned int sequence;
+static TelemetryStats stats[TELEMETRY_CLASSES];
+
+/* Name: telemetryPop
+   Description:
+    Moves the head packet of the class to the free list.
+*/
+static void telemetryPop(TelemetryClass type) {
+  unsigned char slot = head[type];
+
+  head[type] = pool[slot].next;
+  count[type]--;
+  pool[slot].next = freeSlot;
+  freeSlot = slot;
+}
+
+void telemetryInit(TelemetryPacket* storage, const TelemetryPolicy* classPolicies) {
+  unsigned char n;
+
+  pool = storage;
+  policies = classPolicies;
+  freeSlot = TELEMETRY_NONE;
+  if (storage) {
+    for (n = 0; n < TELEMETRY_SLOTS; n++) {
+      storage[n].next = freeSlot;
+      freeSlot = n;
+    }
+  }
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    count[n] = 0;
+    deficit[n] = 0;
+    stats[n].queued = stats[n].sent = stats[n].dropped = stats[n].aged = 0;
+    stats[n].bytes = stats[n].latencyTotal = 0;
+    stats[n].latencyMax = 0;
+  }
+  turn = 0;
+  credited = 0;
+  sequence = 0;
+  telemetryBeginPass();
+}
+
+char telemetryPut(TelemetryClass type, const unsigned char* payload, unsigned char length, unsigned long tick) {
+  TelemetryPacket* packet;
+  unsigned char slot;
+  unsigned char n;
+
+  if (!pool || !length || length > TELEMETRY_PAYLOAD_MAX) {
+    return 0;
+  }
+  if (count[type] >= policies[type].slots) {
+    stats[type].dropped++;
+    if (!policies[type].dropOldest) {
+      return 0;
+    }
+    telemetryPop(type);
+  }
+
+  slot = freeSlot; //Never runs out, the classes' slots add up to TELEMETRY_SLOTS at most
+  packet = &pool[slot];
+  freeSlot = packet -> next;
+  packet -> tick = tick;
+  packet -> length = length;
+  packet -> next = TELEMETRY_NONE;
+  for (n = 0; n < length; n++) {
+    packet -> payload[n] = payload[n];
+  }
+
+  if (count[type]) {
+    pool[tail[type]].next = slot;
+  } else {
+    head[type] = slot;
+  }
+  tail[type] = slot;
+  count[type]++;
+  stats[type].queued++;
+  return 1;
+}
+
+unsigned char telemetryGetFree(TelemetryClass type) {
+  return pool ? policies[type].slots - count[type] : 0;
+}
+
+void telemetryBeginPass(void) {
+  unsigned char n;
+
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    passLeft[n] = policies ? policies[n].passBytes : 0;
+  }
+}
+
+/* Name: telemetryReady
+   Return value:
+    unsigned int - frame length of the class's head packet, 0 if the class is empty or its pass budget has no room for it
+*/
+static unsigned int telemetryReady(unsigned char type) {
+  unsigned int length;
+
+  if (!count[type]) {
+    return 0;
+  }
+  length = pool[head[type]].length + TELEMETRY_FRAME_OVERHEAD;
+  if (policies[type].passBytes && length > passLeft[type]) {
+    return 0;
+  }
+  return length;
+}
+
+/* Name: telemetryPick
+   Return value:
+    unsigned char - class to send next, TELEMETRY_CLASSES if nothing fits
+   Description:
+    Strict classes first, in class order.  Then deficit round robin over the rest: a class gets its quantum each time
+    its turn comes round, and keeps the turn while its head packet fits in what it has left.  When the packet that is
+    due does not fit in room, nothing is sent until it does; passing it over would let small packets take every gap
+    in the link and starve the large ones.
+*/
+static unsigned char telemetryPick(unsigned int room) {
+  unsigned int length;
+  unsigned char visits;
+  unsigned char n;
+
+  for (n = 0; n < TELEMETRY_CLASSES; n++) {
+    if (policies[n].strict && (length = telemetryReady(n))) {
+      return length <= room ? n : TELEMETRY_CLASSES;
+    }
+  }
+  for (visits = 0; visits <= TELEMETRY_CLASSES; visits++) { //Back to the class it started on, with a new quantum
+    n = turn;
+    if (!policies[n].strict && (length = telemetryReady(n))) {
+      if (length > room) {
+        return TELEMETRY_CLASSES;
+      }
+      if (!credited) {
+        deficit[n] += policies[n].quantum;
+        credited = 1;
+      }
+      if (length <= deficit[n]) {
+        deficit[n] -= length;
+        return n;
+      }
+    }
+    if (!count[n]) {
+      deficit[n] = 0; //An idle class does not save up credit
+    }
+    turn = (n + 1) % TELEMETRY_CLASSES;
+    credited = 0;
+  }
+  return TELEMETRY_CLASSES;
+}
+
+unsigned char telemetryDequeue(unsigned char* frame, unsigned int room, unsigned long tick) {
+  const TelemetryPacket* packet;
+  unsigned int crc;
+  unsigned int length;
+  unsigned long age;
+  unsigned char type;
+  unsigned char n;
+
+  if (!pool) {
+    return 0;
+  }
+  for (n = 0; n < TELEMETRY_CLASSES; n++) { //Queues are in tick order, only heads can be too old
+    while (count[n] && policies[n].maxAgeTicks && tick - pool[head[n]].tick > policies[n].maxAgeTicks) {
+      telemetryPop(n);
+      stats[n].aged++;
+    }
+  }
+
+  type = telemetryPick(room);
+  if (type == TELEMETRY_CLASSES) {
+    return 0;
+  }
+  packet = &pool[head[type]];
+  frame[0] = TELEMETRY_SYNC_0;
+  frame[1] = TELEMETRY_SYNC_1;
+  frame[2] = packet -> length;
+  frame[3] = type;
+  frame[4] = sequence & 0xFF;
+  frame[5] = sequence >> 8;
+  for (n = 0; n < packet -> length; n++) {
+    frame[TELEMETRY_FRAME_HEADER + n] = packet -> payload[n];
+  }
+  length = TELEMETRY_FRAME_HEADER + packet -> length;
+  crc = logCrc16(frame, length);
+  frame[length] = crc & 0xFF;
+  frame[length + 1] = crc >> 8;
+  length += 2;
+  sequence++;
+
+  age = tick - packet -> tick;
+  stats[type].sent++;
+  stats[type].bytes += length;
+  stats[type].latencyTotal += age;
+  if (age > stats[type].latencyMax) {
+    stats[type].latencyMax = age > 0xFFFF ? 0xFFFF : (unsigned int)age;
+  }
+  if (policies[type].passBytes) {
+    passLeft[type] -= length;
+  }
+  telemetryPop(type);
+  return (unsigned char)length;
+}
+
+const TelemetryStats* telemetryGetStats(TelemetryClass type) {
+  return &stats[type];
+}
@@ -0,0 +1,170 @@
+/* Author: John Walnut
+   Purpose: To implement functions defined in watchdog.h
+*/
+
+#include <stddef.h>
+#include "watchdog.h"
+#include "tasks.h"
+#include "data.h"
+#include "antenna.h"
+#include "recorder.h"
+#include "log_format.h"
+
+//Left alone by the startup code, so it survives a reset.  section_placement.xml places NO_INIT in RAM, not loaded and
+//not cleared.
+#pragma dataseg("NO_INIT")
+static WatchdogKept kept;
+#pragma dataseg(default)
+
+static WatchdogStats stats;
+static char started;
+static unsigned char supervised; //Bit per task with a deadline
+static unsigned char checkedIn; //Bit per task that has checked in since boot
+static unsigned long lastCheckIn[WATCHDOG_TASKS];
+static unsigned long lastService;
+
+static const unsigned int deadline[WATCHDOG_TASKS] = {WATCHDOG_IMU_TICKS, 0, 0, WATCHDOG_SEND_TICKS,
+                                                      WATCHDOG_ANTENNA_TICKS, WATCHDOG_RECORD_TICKS};
+
+/* Name: watchdogCrc
+   Description:
+    CRC of the kept block up to its crc field.
+*/
+static unsigned int watchdogCrc(void) {
+  return logCrc16((const unsigned char*)&kept, offsetof(WatchdogKept, crc));
+}
+
+/* Name: watchdogCheckpoint
+   Description:
+    Copies the state each module needs back into the kept block.
+*/
+static void watchdogCheckpoint(unsigned long now) {
+  const AntennaHealth* antenna = antennaGetHealth();
+  const RecorderHealth* recorder = recorderGetHealth();
+
+  kept.antennaState = antenna -> state;
+  kept.antennaAttempts = antenna -> attempts;
+  kept.antennaStatus = antenna -> status;
+  kept.recorderState = recorder -> state;
+  kept.cardHighCapacity = recorder -> highCapacity;
+  kept.ticks = now;
+  kept.logOffset = recorder -> nextOffset;
+  kept.logSequence = recorder -> nextSequence;
+  kept.bufferIndex = bufferIndex;
+  kept.crc = watchdogCrc();
+}
+
+/* Name: watchdogCheckpointDue
+   Description:
+    Every WATCHDOG_CHECKPOINT_TICKS, and straight away when the log has moved on or the antenna sequence changed state,
+    so a warm boot never writes over a log block or repeats a burn.
+*/
+static char watchdogCheckpointDue(unsigned long now) {
+  const AntennaHealth* antenna = antennaGetHealth();
+  const RecorderHealth* recorder = recorderGetHealth();
+
+  return now - kept.ticks >= WATCHDOG_CHECKPOINT_TICKS || recorder -> nextSequence != kept.logSequence ||
+         recorder -> state != kept.recorderState || antenna -> state != kept.antennaState ||
+         antenna -> attempts != kept.antennaAttempts;
+}
+
+char watchdogInit(void) {
+  unsigned char cause;
+  unsigned char* p;
+
+  WDTCTL = WDTPW + WDTHOLD;
+  cause = IFG1 & (WDTIFG + RSTIFG + PORIFG);
+  IFG1 &= ~(WDTIFG + RSTIFG + PORIFG);
+
+  stats.resetCause = cause;
+  stats.warm = !(cause & PORIFG) && kept.magic == WATCHDOG_MAGIC && kept.crc == watchdogCrc();
+  if (stats.warm) {
+    kept.restarts++;
+    if (cause & WDTIFG) { //Also set by a write to WDTCTL without the password, as from code gone astray
+      kept.watchdogResets++;
+    }
+    stats.lastLate = kept.lateTask;
+  } else { //All zeros is a cold start for every module: REC_STARTING, ANT_ARMING
+    for (p = (unsigned char*)&kept; p < (unsigned char*)(&kept + 1); p++) {
+      *p = 0;
+    }
+    kept.magic = WATCHDOG_MAGIC;
+    stats.lastLate = WATCHDOG_NONE;
+  }
+  kept.lateTask = WATCHDOG_NONE;
+  kept.crc = watchdogCrc();
+
+  stats.lateTask = WATCHDOG_NONE;
+  stats.restarts = kept.restarts;
+  stats.watchdogResets = kept.watchdogResets;
+  return stats.warm;
+}
+
+const WatchdogKept* watchdogGetKept(void) {
+  return stats.warm ? &kept : 0;
+}
+
+void watchdogStart(void) {
+  unsigned long now;
+  unsigned char n;
+
+  if (stats.warm) {
+    clockSetTicks(kept.ticks);
+  }
+  now = clockGetTicks();
+  supervised = 0;
+  checkedIn = 0;
+  for (n = 0; n < WATCHDOG_TASKS; n++) {
+    lastCheckIn[n] = now; //Deadlines for the first check in run from here
+    if (deadline[n]) {
+      supervised |= 1 << n;
+    }
+  }
+  lastService = now;
+  started = 1;
+  WDTCTL = WATCHDOG_KICK;
+}
+
+void watchdogCheckIn(unsigned char task) {
+  if (task < WATCHDOG_TASKS) {
+    lastCheckIn[task] = clockGetTicks();
+    checkedIn |= 1 << task;
+  }
+}
+
+void watchdogService(void) {
+  unsigned long now = clockGetTicks();
+  unsigned char n;
+
+  if (!started || now == lastService) {
+    return; //Once per tick
+  }
+  lastService = now;
+
+  for (n = 0; n < WATCHDOG_TASKS && stats.lateTask == WATCHDOG_NONE; n++) {
+    if (deadline[n] && now - lastCheckIn[n] > deadline[n]) {
+      stats.lateTask = n;
+      kept.lateTask = n;
+      kept.crc = watchdogCrc();
+    }
+  }
+  if (stats.lateTask == WATCHDOG_NONE) { //Once a task is late, the watchdog is left to run out
+    WDTCTL = WATCHDOG_KICK;
+  }
+
+  //Not before every task has run its init, which reads the kept block.  Still after a task is late, until the reset:
+  //the others, the recorder among them, carry on meanwhile
+  if ((checkedIn & supervised) == supervised && watchdogCheckpointDue(now)) {
+    watchdogCheckpoint(now);
+  }
+}
+
+void watchdogKick(void) {
+  if (started && stats.lateTask == WATCHDOG_NONE) {
+    WDTCTL = WATCHDOG_KICK;
+  }
+}
+
+const WatchdogStats* watchdogGetStats(void) {
+  return &stats;
+}